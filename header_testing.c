@@ -4,6 +4,10 @@
 / IME-USP: https://www.ime.usp.br/~pf/algorithms/appendices/libraries.html
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~*/
 
+// glibc only declares some GNU and POSIX extras (like copy_file_range())
+// if we ask for them, and we have to ask before including anything
+#define _GNU_SOURCE
+
 // INCLUDING ALL STANDARD LIBRARY HEADERS
 
 #include <assert.h> // macro that compares argument to zero
@@ -35,6 +39,31 @@
 #include <wchar.h> // extended multibyte and wide character utilities
 #include <wctype.h> // functions to determine the type contained in wide character data
 
+// NON-STANDARD (POSIX) HEADERS
+// these are not part of the C standard library, but the command line
+// runner and the benchmarks need them to talk to the operating system
+#include <dlfcn.h> // dladdr(), to name the functions in a profile
+#include <elf.h> // the layout of our own executable, for its symbol table
+#include <execinfo.h> // backtrace()
+#include <fcntl.h> // open() and its flags
+#include <langinfo.h> // nl_langinfo(), to ask which encoding the locale uses
+#include <linux/perf_event.h> // the hardware counters
+#include <malloc.h> // malloc_usable_size(), for the allocation accounting
+#include <strings.h> // strcasecmp()
+#include <sys/ioctl.h> // ioctl(), to start and stop the counters
+#include <sys/mman.h> // mmap(), madvise() and mprotect()
+#include <sys/resource.h> // getrusage()
+#include <sys/sendfile.h> // sendfile()
+#include <sys/stat.h> // fstat()
+#include <sys/syscall.h> // syscall(), for the calls glibc has no wrapper for
+#include <sys/time.h> // setitimer()
+#include <ucontext.h> // getcontext(), makecontext() and swapcontext()
+#include <unistd.h> // read(), write(), dup2(), copy_file_range(), sysconf()...
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h> // __get_cpuid(), to ask the CPU what it can do
+#include <immintrin.h> // SSE2 and AVX2 intrinsics, and __rdtsc()
+#endif
+
 // DECLARATION OF ALL THE TEST FUNCTIONS
 // 1 function per header, the function prototypes are
 // in the following format: 
@@ -69,671 +98,12015 @@ void testUcharH();
 void testWcharH();
 void testWCtypeH();
 
-// Now, to understand and test each header, just read
-// its respective function and call it in main to see it in action
-// (and ofc, modify the functions as you please, experiment!)
-int main(int argc, char const *argv[]) {
-	testTgMathH();
-	return 0;
+// DECLARATION OF THE BENCHMARKS
+// some headers also have a benchmark that builds something
+// bigger on top of them and measures it, in the same format:
+// void bench[HeaderName]H();
+
+void benchComplexH();
+void benchCtypeH();
+void benchFenvH();
+void benchFloatH();
+void benchIntTypesH();
+void benchLocaleH();
+void benchMathH();
+void benchSetjmpH();
+void benchStdArgH();
+void benchStdAtomicH();
+void benchStdDefH();
+void benchStdIntH();
+void benchStdIOH();
+void benchStdLibH();
+void benchStringH();
+void benchTgMathH();
+void benchThreadsH();
+void benchUcharH();
+void benchWcharH();
+void benchWCtypeH();
+
+
+
+// THE TEST REGISTRY
+// every function that can be called from the command line is listed here,
+// so main() can find it by name instead of us editing and recompiling the file
+
+// some tests can't be run in a loop: they wait for you to type something
+// or they end the whole program, so they are marked with these flags
+#define TEST_INTERACTIVE 1 // reads from the standard input
+#define TEST_EXITS 2 // never returns (calls exit() or raises a deadly signal)
+#define TEST_BENCHMARK 4 // a benchmark, it already times itself
+
+struct testEntry {
+	const char *name; // the function name, that's what you type in the command line
+	const char *header; // the header it plays with (you can type this too)
+	void (*function)();
+	int flags;
+};
+
+static const struct testEntry testRegistry[] = {
+	{"testAssertH", "assert.h", testAssertH, 0},
+	{"testComplexH", "complex.h", testComplexH, 0},
+	{"testCtypeH", "ctype.h", testCtypeH, 0},
+	{"testErrnoH", "errno.h", testErrnoH, 0},
+	{"testFenvH", "fenv.h", testFenvH, 0},
+	{"testFloatH", "float.h", testFloatH, 0},
+	{"testIntTypesH", "inttypes.h", testIntTypesH, TEST_INTERACTIVE},
+	{"testISO646H", "iso646.h", testISO646H, 0},
+	{"testLimitsH", "limits.h", testLimitsH, 0},
+	{"testLocaleH", "locale.h", testLocaleH, 0},
+	{"testMathH", "math.h", testMathH, 0},
+	{"testSetjmpH", "setjmp.h", testSetjmpH, 0},
+	{"testSignalH", "signal.h", testSignalH, TEST_EXITS},
+	{"testStdArgH", "stdarg.h", testStdArgH, 0},
+	{"testStdAtomicH", "stdatomic.h", testStdAtomicH, 0},
+	{"testStdBoolH", "stdbool.h", testStdBoolH, 0},
+	{"testStdDefH", "stddef.h", testStdDefH, 0},
+	{"testStdIntH", "stdint.h", testStdIntH, 0},
+	{"testStdIOH", "stdio.h", testStdIOH, TEST_INTERACTIVE},
+	{"testStdLibH", "stdlib.h", testStdLibH, TEST_EXITS},
+	{"testStdNoReturnH", "stdnoreturn.h", testStdNoReturnH, TEST_EXITS},
+	{"testStringH", "string.h", testStringH, 0},
+	{"testTgMathH", "tgmath.h", testTgMathH, 0},
+	{"testThreadsH", "threads.h", testThreadsH, 0},
+	{"testTimeH", "time.h", testTimeH, 0},
+	{"testUcharH", "uchar.h", testUcharH, 0},
+	{"testWcharH", "wchar.h", testWcharH, 0},
+	{"testWCtypeH", "wctype.h", testWCtypeH, 0},
+
+	{"benchComplexH", "complex.h", benchComplexH, TEST_BENCHMARK},
+	{"benchCtypeH", "ctype.h", benchCtypeH, TEST_BENCHMARK},
+	{"benchFenvH", "fenv.h", benchFenvH, TEST_BENCHMARK},
+	{"benchFloatH", "float.h", benchFloatH, TEST_BENCHMARK},
+	{"benchIntTypesH", "inttypes.h", benchIntTypesH, TEST_BENCHMARK},
+	{"benchLocaleH", "locale.h", benchLocaleH, TEST_BENCHMARK},
+	{"benchMathH", "math.h", benchMathH, TEST_BENCHMARK},
+	{"benchSetjmpH", "setjmp.h", benchSetjmpH, TEST_BENCHMARK},
+	{"benchStdArgH", "stdarg.h", benchStdArgH, TEST_BENCHMARK},
+	{"benchStdAtomicH", "stdatomic.h", benchStdAtomicH, TEST_BENCHMARK},
+	{"benchStdDefH", "stddef.h", benchStdDefH, TEST_BENCHMARK},
+	{"benchStdIntH", "stdint.h", benchStdIntH, TEST_BENCHMARK},
+	{"benchStdIOH", "stdio.h", benchStdIOH, TEST_BENCHMARK},
+	{"benchStdLibH", "stdlib.h", benchStdLibH, TEST_BENCHMARK},
+	{"benchStringH", "string.h", benchStringH, TEST_BENCHMARK},
+	{"benchTgMathH", "tgmath.h", benchTgMathH, TEST_BENCHMARK},
+	{"benchThreadsH", "threads.h", benchThreadsH, TEST_BENCHMARK},
+	{"benchUcharH", "uchar.h", benchUcharH, TEST_BENCHMARK},
+	{"benchWcharH", "wchar.h", benchWcharH, TEST_BENCHMARK},
+	{"benchWCtypeH", "wctype.h", benchWCtypeH, TEST_BENCHMARK},
+};
+#define TEST_COUNT (sizeof(testRegistry) / sizeof(testRegistry[0]))
+
+// looks a test up by its function name or by its header name,
+// ignoring case, so "testStringH", "teststringh" and "string.h" all work
+static const struct testEntry *findTest(const char *name) {
+	for(size_t i = 0; i < TEST_COUNT; i++) {
+		if(strcasecmp(name, testRegistry[i].name) == 0 || strcasecmp(name, testRegistry[i].header) == 0) {
+			return &testRegistry[i];
+		}
+	}
+	return NULL;
 }
 
 
 
-void testAssertH() {
-	// This header has basically only 1 function (the other one is deprecated)
-	int x = 10;
-	int y = 20;
+// THE MICRO-BENCHMARK HARNESS
+// the "bench" command calls a test over and over and tells us how long it took
 
-	printf("doing assert 1\n");
-	assert(x < y); // true
-	printf("doing assert 2\n");
-	assert(x != y); // true
+// how many threads the multithreaded benchmarks go up to (the -t option),
+// 0 means one per online CPU
+static int benchMaxThreads = 0;
+// the biggest data size the I/O and FFT benchmarks go up to, in MiB (the -s option)
+static int benchMaxMiB = 256;
+// check every possible value instead of a sample where a benchmark can (the -x option)
+static bool benchExhaustive = false;
 
-	// see what happens when assert() is given a false statement
-	printf("doing assert 3\n");
-	// uncomment the next line to see what happens
-	// assert(x == y); // false
-	printf("after assert 3 :^)\n");
-}
+// the sampling profiler behind the -p option. it lives next to testSignalH()
+// because it is a signal handler at heart
+static bool profilerStart(int hz, const char *name);
+static void profilerStop();
+static void profilerReport(const char *name);
 
+static int benchThreadCount() {
+	if(benchMaxThreads > 0) {
+		return benchMaxThreads;
+	}
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? (int) cpus : 1;
+}
 
+// sweeps thread counts as 1, 2, 4, 8... and then the maximum itself
+static int nextThreadStep(int threads, int maxThreads) {
+	if(threads >= maxThreads) {
+		return maxThreads + 1;
+	}
+	return threads * 2 > maxThreads ? maxThreads : threads * 2;
+}
 
-void testComplexH() {
-	// pure imaginary numbers
-	// there is an "imaginary" type but its not aways supported
-	float complex floatImag = 2.0 * I;
-	double complex doubleImag = 7.77 * I;
-	long double complex ldoubleImag = -2.5555555555 * I;
+// the same for data sizes: multiplies by "factor", but never skips the maximum
+static uint64_t nextSizeStep(uint64_t size, uint64_t maxSize, uint64_t factor) {
+	if(size >= maxSize) {
+		return maxSize + 1;
+	}
+	return size * factor > maxSize ? maxSize : size * factor;
+}
 
-	// pure real numbers
-	float floatReal = 111.1;
-	double doubleReal = 9.99;
-	long double ldoubleReal = 3.14159;
+// stops the compiler from deleting the work of a benchmark loop whose
+// result is never used (it can't see through an empty asm statement)
+#define benchKeep(value) __asm__ volatile("" : : "g"(value) : "memory")
 
-	// complex numbers
-	float complex floatComplex = floatReal + floatImag;
-	double complex doubleComplex = doubleReal + doubleImag;
-	long double complex ldoubleComplex = ldoubleReal + ldoubleImag;
+// a monotonic clock never jumps backwards (unlike the wall clock, which
+// can be changed by NTP or by you), so it's the right one to time things with
+static uint64_t monotonicNs() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
 
-	// the "crealf", "creal" and "creall" functions return the real part of a complex num
-	// the "cimag", "cimag" and "cimagl" functions return the imaginary part of a complex num
-	printf("\n\nfloat complex = %.1f + %.1fi\n", crealf(floatComplex), cimagf(floatComplex));
-	printf("double complex = %.2lf + %.2lfi\n", creal(doubleComplex), cimag(doubleComplex));
-	printf("long double complex = %.5Lf + %.5Lfi\n", creall(ldoubleComplex), cimagl(ldoubleComplex));
+// the CPU's time stamp counter ticks at a constant rate (about the nominal
+// clock speed) and costs only a few nanoseconds to read, so "per cycle"
+// numbers in the benchmarks are per tick of it
+static inline uint64_t cycleCounter() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return monotonicNs();
+#endif
+}
 
-	// some functions that manipulate complex numbers
-	printf("\nabsolute (modulus) value of a complex: %lf\n", cabs(doubleComplex));
-	printf("phase angle of a complex: %lf\n", carg(doubleComplex));
-	printf("conjulgate of a complex: %lf + %lfi\n", creal(conj(doubleComplex)), cimag(conj(doubleComplex)));
-	printf("projection of a complex on Riemann sphere: %lf + %lfi\n", creal(cproj(doubleComplex)), cimag(cproj(doubleComplex)));
+// nobody tells us how fast the counter ticks, so it's measured once against
+// the monotonic clock. and it's only a clock if the CPU promises the rate
+// never changes ("invariant TSC", cpuid says so), otherwise it speeds up
+// and slows down with the CPU frequency and we stay with clock_gettime()
+struct tscCalibration {
+	bool invariant;
+	double ticksPerNs;
+	double nsPerTick;
+	uint64_t baseTicks; // a moment in both clocks, to convert one to the other
+	uint64_t baseNs;
+	double timerOverheadNs; // what one timerNowNs() costs
+};
+
+static struct tscCalibration tsc;
+static once_flag tscOnce = ONCE_FLAG_INIT;
+
+// reads both clocks as close together as possible: the counter between two
+// clock_gettime() calls, keeping the try where those were the closest
+static void tscPairedRead(uint64_t *ticks, uint64_t *ns) {
+	uint64_t best = UINT64_MAX;
+	for(int i = 0; i < 16; i++) {
+		uint64_t before = monotonicNs();
+		uint64_t counter = cycleCounter();
+		uint64_t after = monotonicNs();
+		if(after - before < best) {
+			best = after - before;
+			*ticks = counter;
+			*ns = before + (after - before) / 2;
+		}
+	}
+}
 
-	// complex versions of the pow() and sqrt() functions
-	printf("\na complex to the power of 2: %lf + %lfi\n", creal(cpow(doubleComplex, 2)), cimag(cpow(doubleComplex, 2)));
-	printf("the square root of a complex: %lf + %lfi\n", creal(csqrt(doubleComplex)), cimag(csqrt(doubleComplex)));
+static uint64_t timerRead(const struct tscCalibration *calibration);
+
+static void tscCalibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned a, b, c, d;
+	tsc.invariant = __get_cpuid(0x80000007, &a, &b, &c, &d) && (d & (1u << 8));
+#endif
+	uint64_t endTicks = 0, endNs = 0;
+	tscPairedRead(&tsc.baseTicks, &tsc.baseNs);
+	// 20 ms is long enough for the reading error to be a few parts per million
+	do {
+		tscPairedRead(&endTicks, &endNs);
+	} while(endNs - tsc.baseNs < 20000000);
+	tsc.ticksPerNs = (double) (endTicks - tsc.baseTicks) / (endNs - tsc.baseNs);
+	tsc.nsPerTick = 1 / tsc.ticksPerNs;
+	double best = INFINITY;
+	for(int r = 0; r < 100; r++) {
+		uint64_t start = cycleCounter();
+		for(int i = 0; i < 100; i++) {
+			benchKeep(timerRead(&tsc));
+		}
+		double ns = (cycleCounter() - start) * tsc.nsPerTick / 100;
+		best = ns < best ? ns : best;
+	}
+	tsc.timerOverheadNs = best;
+}
 
-	// there are many other functions in the complex library, but I think you got the point,
-	// and I'm not math-pilled enough to know what exactly the other ones do. But if you want to know
-	// more, access https://en.cppreference.com/w/c/numeric/complex
+static const struct tscCalibration *tscCalibration() {
+	call_once(&tscOnce, tscCalibrate);
+	return &tsc;
 }
 
+static uint64_t timerRead(const struct tscCalibration *calibration) {
+	if(calibration->invariant) {
+		return calibration->baseNs + (uint64_t) ((int64_t) (cycleCounter() - calibration->baseTicks) * calibration->nsPerTick);
+	}
+	return monotonicNs();
+}
 
+// the cheapest good clock we have, in nanoseconds since some moment: the
+// counter when it's invariant, clock_gettime() when it isn't
+static uint64_t timerNowNs() {
+	return timerRead(tscCalibration());
+}
 
-void testCtypeH() {
-	char A = 'A';
-	char num1 = '1';
-	char dot = '.';
-	char space = ' ';
+// SCOPED TIMERS
+// times everything from the declaration to the end of the block it's in,
+// however the block ends (the cleanup attribute runs scopedTimerEnd() then).
+// the nanoseconds are added to *total, or printed with the label if total is NULL:
+//   { SCOPED_TIMER(timer, "sorting", NULL); qsort(...); }
+struct scopedTimer {
+	const char *label;
+	uint64_t *total;
+	uint64_t start;
+};
+
+static void scopedTimerEnd(struct scopedTimer *timer) {
+	uint64_t elapsed = timerNowNs() - timer->start;
+	if(timer->total != NULL) {
+		*timer->total += elapsed;
+	} else {
+		printf("%s: %.3f us\n", timer->label, elapsed / 1e3);
+	}
+}
 
-	// isalnum() checks if the char is alpha-numeric
-	printf("\n\n%c is %salphanumeric\n", dot, isalnum(dot) ? "" : "not ");
-	// isalpha() checks if the char is in the alphabet
-	printf("%c is %sin the alphabet\n", A, isalpha(A) ? "" : "not ");
-	// islower() checks if the char is lowercase
-	printf("%c is %slowercase\n", A, islower(A) ? "" : "not ");
-	// isupper() checks if the char is uppercase
-	printf("%c is %suppercase\n", A, isupper(A) ? "" : "not ");
-	// isdigit() checks if the char is a digit
-	printf("%c is %sa digit\n", num1, isdigit(num1) ? "" : "not ");
-	// isxdigit() checks if the char is a hex digit
-	printf("%c is %sa hex digit\n", A, isxdigit(A) ? "" : "not ");
-	// iscntrl() checks if the char is a control character
-	printf("space is %sa control character\n", iscntrl(space) ? "" : "not ");
-	// isgraph() checks if the char has a graphical representation
-	printf("%c has %sa graphical representation\n", num1, isgraph(num1) ? "" : "not ");
-	// isspace() checks if the char is the space char
-	printf("%c is %sthe space character\n", dot, isspace(dot) ? "" : "not ");
-	// isblank() checks if the char is the space or tab char
-	printf("space is %sa blank character\n", isblank(space) ? "" : "not ");
-	// isprint() checks if the char is printable
-	printf("%c is %sprintable\n", A, isprint(A) ? "" : "not ");
-	// ispunct() checks if the char is a punctuation
-	printf("%c is %sa punctuation\n", dot, ispunct(dot) ? "" : "not ");
+#define SCOPED_TIMER(name, label, total) \
+	struct scopedTimer name __attribute__((cleanup(scopedTimerEnd))) = {label, total, timerNowNs()}
+
+// hardware counters through perf_event_open(): the kernel counts events
+// like cache misses while our code runs. VMs and containers often don't
+// expose them, so -1 (from the open or from the stop) means "not available"
+static struct perf_event_attr perfCounterAttr(uint32_t type, uint64_t config) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1; // only our own code, that's all perf_event_paranoid = 2 allows
+	attr.exclude_hv = 1;
+	return attr;
+}
 
-	char lowercaseD = 'd';
-	char uppercaseD = 'D';
+static int perfCounterOpen(uint32_t type, uint64_t config) {
+	struct perf_event_attr attr = perfCounterAttr(type, config);
+	return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
 
-	// you can change a lowercase char to uppercase and vice-versa
-	printf("\nto lowercase: %c\n", tolower(uppercaseD));
-	printf("to uppercase: %c\n", toupper(lowercaseD));
+static void perfCounterStart(int counter) {
+	if(counter >= 0) {
+		ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+		ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+	}
 }
 
+static int64_t perfCounterStop(int counter) {
+	uint64_t value;
+	if(counter < 0) {
+		return -1;
+	}
+	ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+	if(read(counter, &value, sizeof(value)) != sizeof(value)) {
+		return -1;
+	}
+	return (int64_t) value;
+}
 
+// COUNTER GROUPS AROUND A WHOLE TEST (the -c option)
+// a group is a set of counters the kernel only ever puts on the CPU all
+// together, so their numbers come from the very same instructions and
+// ratios between them make sense. the CPU has few counters (on x86 cycles
+// and instructions have their own, plus 4 or 8 for anything else), and when
+// more are open than fit, the kernel takes turns ("multiplexing") and we
+// scale the counts up by how long each one really ran
+enum perfGroupEvent {
+	PERF_GROUP_CYCLES,
+	PERF_GROUP_INSTRUCTIONS,
+	PERF_GROUP_L1D_MISSES,
+	PERF_GROUP_LLC_MISSES,
+	PERF_GROUP_BRANCH_MISSES,
+	PERF_GROUP_DTLB_MISSES,
+	PERF_GROUP_EVENTS,
+};
+
+static const struct {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+} perfGroupEvents[] = {
+	{"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	{"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	{"L1D misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+	{"LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+	{"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	{"dTLB misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+struct perfGroup {
+	int fds[PERF_GROUP_EVENTS]; // -1 for the events this CPU (or VM) doesn't have
+	int leader; // the first one that opened, the others follow it
+	int error; // errno of the first failure, to explain when nothing opened
+};
+
+// the counts of one run, -1 where there's no number
+struct perfGroupReading {
+	int64_t counts[PERF_GROUP_EVENTS];
+	double running; // the fraction of the time the group was on the CPU
+};
+
+// inherit makes the threads a test starts count too (they're added to ours
+// when they end), which is why every counter is read on its own: the kernel
+// doesn't read a whole inherited group at once
+static bool perfGroupOpen(struct perfGroup *group) {
+	group->leader = -1;
+	group->error = 0;
+	for(int i = 0; i < PERF_GROUP_EVENTS; i++) {
+		struct perf_event_attr attr = perfCounterAttr(perfGroupEvents[i].type, perfGroupEvents[i].config);
+		attr.inherit = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.disabled = group->leader < 0; // the members start and stop with the leader
+		group->fds[i] = (int) syscall(SYS_perf_event_open, &attr, 0, -1, group->leader, 0);
+		if(group->fds[i] < 0 && group->error == 0) {
+			group->error = errno;
+		}
+		if(group->fds[i] >= 0 && group->leader < 0) {
+			group->leader = group->fds[i];
+		}
+	}
+	return group->leader >= 0;
+}
 
-void testErrnoH() {
-	// this header defines 3 error code macros, each begining with the letter E
-	int i = EDOM; // domain error
-	int j = EILSEQ; // illegal byte sequence error
-	int k = ERANGE; // range error
+static void perfGroupClose(struct perfGroup *group) {
+	for(int i = 0; i < PERF_GROUP_EVENTS; i++) {
+		if(group->fds[i] >= 0) {
+			close(group->fds[i]);
+		}
+	}
+	group->leader = -1;
+}
 
-	printf("\n\nEDOM == %d\n", i);
-	printf("EILSEQ == %d\n", j);
-	printf("ERANGE == %d\n", k);
+static void perfGroupStart(struct perfGroup *group) {
+	ioctl(group->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(group->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
 
-	// and also defines a thread-local preprocessor macro that
-	// becomes a modifiable variable
-	errno = 0;
+static struct perfGroupReading perfGroupStop(struct perfGroup *group) {
+	struct perfGroupReading reading;
+	reading.running = 1;
+	ioctl(group->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+	for(int i = 0; i < PERF_GROUP_EVENTS; i++) {
+		uint64_t values[3]; // the count, the time enabled and the time running
+		reading.counts[i] = -1;
+		if(group->fds[i] < 0 || read(group->fds[i], values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+			continue;
+		}
+		double fraction = values[1] > 0 ? (double) values[2] / values[1] : 1;
+		reading.counts[i] = (int64_t) (values[0] / fraction);
+		reading.running = fraction < reading.running ? fraction : reading.running;
+	}
+	return reading;
+}
 
-	// lets create a function that simulates what could happen if you
-	// tried to do some math that should give an error
-	void doSomeIllegalMath(int x) {
-		if(x != 0) {
-			printf("your result is %d\n", 727 / x);
+// IPC (instructions per cycle) says how busy the CPU was: modern ones can
+// retire 4 or more per cycle, and under 1 means it mostly waited (for memory,
+// or for a mispredicted branch to be thrown away). the misses are per 1000
+// instructions (MPKI), so tests of different lengths compare
+static void perfGroupReport(const char *name, const struct perfGroupReading *reading, int runs) {
+	const int64_t *counts = reading->counts;
+	printf("\ncounters for %s", name);
+	if(runs > 1) {
+		printf(" (per run, the average of %d)", runs);
+	}
+	printf(":\n ");
+	for(int i = PERF_GROUP_CYCLES; i <= PERF_GROUP_INSTRUCTIONS; i++) {
+		if(counts[i] >= 0) {
+			printf(" %.4g %s,", (double) counts[i] / runs, perfGroupEvents[i].name);
 		} else {
-			errno = EDOM;
-			printf("pls dont divide by 0\n");
+			printf(" no %s,", perfGroupEvents[i].name);
 		}
 	}
-	
-	doSomeIllegalMath(0);
+	if(counts[PERF_GROUP_CYCLES] > 0 && counts[PERF_GROUP_INSTRUCTIONS] >= 0) {
+		printf(" IPC %.2f", (double) counts[PERF_GROUP_INSTRUCTIONS] / counts[PERF_GROUP_CYCLES]);
+	}
+	printf("\n  per 1000 instructions:");
+	for(int i = PERF_GROUP_L1D_MISSES; i < PERF_GROUP_EVENTS; i++) {
+		if(counts[i] < 0) {
+			printf(" %s n/a", perfGroupEvents[i].name);
+		} else if(counts[PERF_GROUP_INSTRUCTIONS] > 0) {
+			printf(" %s %.2f", perfGroupEvents[i].name, 1000.0 * counts[i] / counts[PERF_GROUP_INSTRUCTIONS]);
+		} else {
+			printf(" %s %.4g", perfGroupEvents[i].name, (double) counts[i] / runs);
+		}
+		printf(i + 1 < PERF_GROUP_EVENTS ? "," : "\n");
+	}
+	if(reading->running < 0.99) {
+		printf("  (scaled up: the group was only on the CPU %.0f%% of the time)\n", 100 * reading->running);
+	}
+}
 
-	// this function belongs to the stdio header, but its output
-	// depends on the value of errno
-	perror("current error");
+// why there are no counters, once: no PMU in the VM (ENOENT), the kernel
+// says no (EACCES or EPERM, see perf_event_paranoid) or no perf at all (ENOSYS)
+static void perfGroupExplain(int error) {
+	int paranoid = -9;
+	FILE *setting = fopen("/proc/sys/kernel/perf_event_paranoid", "r");
+	if(setting != NULL) {
+		if(fscanf(setting, "%d", &paranoid) != 1) {
+			paranoid = -9;
+		}
+		fclose(setting);
+	}
+	fprintf(stderr, "no hardware counters here (%s", strerror(error));
+	if(paranoid != -9) {
+		fprintf(stderr, ", perf_event_paranoid is %d", paranoid);
+	}
+	fprintf(stderr, "), running without them\n");
 }
 
+// ALLOCATION ACCOUNTING (the -a option)
+// printf(), setlocale(), fopen() and friends call malloc() behind our backs.
+// a program that defines malloc() itself replaces glibc's everywhere, in
+// libc's own calls too (glibc allows it on purpose), so ours below count and
+// then hand the work to the real ones (glibc exports them as __libc_malloc()
+// and so on). the counters are atomics, since any thread can allocate, and
+// while -a isn't given all that's left is one relaxed load per call.
+// the address, thread and memory sanitizers replace malloc() too, so in
+// their builds ours stay out (gcc says which one with __SANITIZE_*__, clang
+// with __has_feature())
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define ALLOC_SANITIZED
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define ALLOC_SANITIZED
+#endif
+#endif
+
+// the size classes are powers of 2: up to 16 bytes, 17 to 32, ... and then over 1 MiB
+#define ALLOC_SIZE_CLASSES 18
+
+struct allocCounters {
+	atomic_bool enabled;
+	atomic_uint_fast64_t mallocs;
+	atomic_uint_fast64_t callocs;
+	atomic_uint_fast64_t reallocs;
+	atomic_uint_fast64_t aligned;
+	atomic_uint_fast64_t frees;
+	atomic_uint_fast64_t bytes; // what was asked for
+	// what malloc_usable_size() says, since we're told nothing on free().
+	// it's the net change since the reset, so it goes negative when a test
+	// frees something that was allocated before it
+	atomic_int_fast64_t live;
+	atomic_int_fast64_t peak;
+	atomic_uint_fast64_t sizeClasses[ALLOC_SIZE_CLASSES];
+};
+
+static struct allocCounters allocCounters;
+static size_t allocStartResident; // currentRssBytes() when the test started
+
+#if !defined(ALLOC_SANITIZED)
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *pointer);
+
+static inline bool allocCounting() {
+	return atomic_load_explicit(&allocCounters.enabled, memory_order_relaxed);
+}
 
+static void allocNoteLive(int64_t change) {
+	int64_t live = atomic_fetch_add_explicit(&allocCounters.live, change, memory_order_relaxed) + change;
+	int64_t peak = atomic_load_explicit(&allocCounters.peak, memory_order_relaxed);
+	while(live > peak && !atomic_compare_exchange_weak_explicit(&allocCounters.peak, &peak, live,
+		memory_order_relaxed, memory_order_relaxed)) {
+	}
+}
 
-void testFenvH() {
-	// this header has a lot that begin with FE_
-	// and a lot of functions that begin with fe
+static void allocNoteAllocation(void *pointer, size_t size) {
+	int sizeClass = size <= 16 ? 0 : 64 - __builtin_clzll((unsigned long long) size - 1) - 4;
+	sizeClass = sizeClass < ALLOC_SIZE_CLASSES ? sizeClass : ALLOC_SIZE_CLASSES - 1;
+	atomic_fetch_add_explicit(&allocCounters.sizeClasses[sizeClass], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&allocCounters.bytes, size, memory_order_relaxed);
+	allocNoteLive((int64_t) malloc_usable_size(pointer));
+}
 
-	// these macros are flags that indicate whether or not
-	// their exceptions have occured.
-	// each one is a different power of 2 (except FE_ALL_EXCEPT)
-	printf("FE_INVALID = \n\n%d\n", FE_INVALID);
-	printf("FE_DIVBYZERO = %d\n", FE_DIVBYZERO);
-	printf("FE_OVERFLOW = %d\n", FE_OVERFLOW);
-	printf("FE_UNDERFLOW = %d\n", FE_UNDERFLOW);
-	printf("FE_INEXACT = %d\n", FE_INEXACT);
-	printf("FE_ALL_EXCEPT = %d\n", FE_ALL_EXCEPT);
+void *malloc(size_t size) {
+	void *pointer = __libc_malloc(size);
+	if(pointer != NULL && allocCounting()) {
+		atomic_fetch_add_explicit(&allocCounters.mallocs, 1, memory_order_relaxed);
+		allocNoteAllocation(pointer, size);
+	}
+	return pointer;
+}
 
-	// lets clear our flags before we start experimenting
-	feclearexcept(FE_ALL_EXCEPT);
+void *calloc(size_t count, size_t size) {
+	void *pointer = __libc_calloc(count, size);
+	if(pointer != NULL && allocCounting()) {
+		atomic_fetch_add_explicit(&allocCounters.callocs, 1, memory_order_relaxed);
+		allocNoteAllocation(pointer, count * size); // (it would have failed if that overflowed)
+	}
+	return pointer;
+}
 
-	// and now lets check if our exceptions are cleared with fetestexcept()
-	printf("\n%s\n", fetestexcept(FE_ALL_EXCEPT) ? "NOT CLEARED\n" : "CLEARED\n");
+// a realloc() is a free() of the old block and an allocation of the new one,
+// unless it fails (and the old block stays)
+void *realloc(void *old, size_t size) {
+	if(!allocCounting()) {
+		return __libc_realloc(old, size);
+	}
+	size_t oldSize = old != NULL ? malloc_usable_size(old) : 0;
+	void *pointer = __libc_realloc(old, size);
+	if(pointer != NULL || size == 0) {
+		atomic_fetch_add_explicit(&allocCounters.reallocs, 1, memory_order_relaxed);
+		allocNoteLive(-(int64_t) oldSize);
+		if(pointer != NULL) {
+			allocNoteAllocation(pointer, size);
+		}
+	}
+	return pointer;
+}
 
-	// now do a lot of illegal math to activate some exception flags
-	printf("doing bad math\n");
-	double i = 1.0 / 0.0; // raising the FE_DIVBYZERO flag
-	double k = DBL_MAX * 10.0; // raising the FE_OVERFLOW flag
-	double j = 0.1 / 100000.0; // raising the FE_INEXACT flag
+void free(void *pointer) {
+	if(pointer != NULL && allocCounting()) {
+		atomic_fetch_add_explicit(&allocCounters.frees, 1, memory_order_relaxed);
+		allocNoteLive(-(int64_t) malloc_usable_size(pointer));
+	}
+	__libc_free(pointer);
+}
 
-	// and check again for each exception:
-	printf("%s", fetestexcept(FE_INVALID) ? "\nINVALID flag is up\n" : "");
-	printf("%s", fetestexcept(FE_DIVBYZERO) ? "DIVBYZERO flag is up\n" : "");
-	printf("%s", fetestexcept(FE_OVERFLOW) ? "OVERFLOW flag is up\n" : "");
-	printf("%s", fetestexcept(FE_UNDERFLOW) ? "UNDERFLOW flag is up\n" : "");
-	printf("%s", fetestexcept(FE_INEXACT) ? "INEXACT flag is up\n" : "");
+// the aligned ones have to be ours too, or their free() would subtract
+// blocks that were never added
+void *memalign(size_t alignment, size_t size) {
+	void *pointer = __libc_memalign(alignment, size);
+	if(pointer != NULL && allocCounting()) {
+		atomic_fetch_add_explicit(&allocCounters.aligned, 1, memory_order_relaxed);
+		allocNoteAllocation(pointer, size);
+	}
+	return pointer;
+}
 
-	/* you can also choose the rounding method your program
-	/  will use to one of these four:
-	/  - FE_TONEAREST
-	/  - FE_TOWARDZERO
-	/  - FE_UPWARD
-	/  - FE_DOWNWARD
-	/  lets see how each one acts                        */
+void *aligned_alloc(size_t alignment, size_t size) {
+	return memalign(alignment, size);
+}
 
-	float roundingNightmare = 1.5;
-	fesetround(FE_TONEAREST);
-	printf("\n1.5 to nearest: %.1f\n", rint(roundingNightmare));
-	fesetround(FE_TOWARDZERO);
-	printf("1.5 towards zero: %.1f\n", rint(roundingNightmare));
-	fesetround(FE_UPWARD);
-	printf("1.5 upwards: %.1f\n", rint(roundingNightmare));
-	fesetround(FE_DOWNWARD);
-	printf("1.5 downwards: %.1f\n", rint(roundingNightmare));
+int posix_memalign(void **out, size_t alignment, size_t size) {
+	if(alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0 || alignment == 0) {
+		return EINVAL;
+	}
+	void *pointer = memalign(alignment, size);
+	if(pointer == NULL) {
+		return ENOMEM;
+	}
+	*out = pointer;
+	return 0;
+}
 
-	// there's more to see in this header, but its too niche for my taste
+// the obsolete page aligned ones, pvalloc() rounding the size up to whole pages
+void *valloc(size_t size) {
+	return memalign((size_t) sysconf(_SC_PAGESIZE), size);
 }
 
+void *pvalloc(size_t size) {
+	size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	size_t rounded = (size + page - 1) & ~(page - 1);
+	if(rounded < size) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	return memalign(page, rounded != 0 ? rounded : page);
+}
+#endif
 
+// the resident set size: how much of our memory is really in RAM right now
+static size_t currentRssBytes() {
+	FILE *statm = fopen("/proc/self/statm", "r");
+	if(statm == NULL) {
+		return 0;
+	}
+	unsigned long pages = 0, resident = 0;
+	int got = fscanf(statm, "%lu %lu", &pages, &resident);
+	fclose(statm);
+	return got == 2 ? resident * (size_t) sysconf(_SC_PAGESIZE) : 0;
+}
 
-void testFloatH() {
-	// this header only has a bunch of macros representing float limits
-	printf("\n\nFLT_DECIMAL_DIG = %d\n", FLT_DECIMAL_DIG); // precision of a float in decimal digits
-	printf("FLT_RADIX = %d\n", FLT_RADIX); // the numerical base used to represent all float types
-	printf("FLT_MIN = %e\n", FLT_MIN); // the smallest number a float can represent
-	printf("FLT_TRUE_MIN = %e\n", FLT_TRUE_MIN); // the true smallest number a float can represent
-	printf("FLT_MAX = %e\n", FLT_MAX); // the largest number a float can represent
-	printf("FLT_EPSILON = %.15f\n", FLT_EPSILON); // the difference between 1.0 and the next representable float
-	printf("FLT_DIG = %d\n", FLT_DIG); // amount of decimal digits preserved when converting to text and back
-	printf("FLT_MANT_DIG = %d\n", FLT_MANT_DIG); // number of digits in the mantissa that maintain precision
+// the peak of the resident memory since the last reset, in KiB (VmHWM), and
+// the reset (writing 5 to clear_refs), so each test under -a (and each
+// conversion in testWcharH()) can have its own
+static size_t peakResidentKiB() {
+	FILE *status = fopen("/proc/self/status", "r");
+	if(status == NULL) {
+		return 0;
+	}
+	char line[256];
+	size_t peak = 0;
+	while(fgets(line, sizeof(line), status) != NULL) {
+		if(sscanf(line, "VmHWM: %zu", &peak) == 1) {
+			break;
+		}
+	}
+	fclose(status);
+	return peak;
 }
 
+static void resetPeakResident() {
+	int fd = open("/proc/self/clear_refs", O_WRONLY);
+	if(fd >= 0) {
+		ssize_t ignored = write(fd, "5", 1);
+		(void) ignored;
+		close(fd);
+	}
+}
 
+static bool allocAccountingAvailable() {
+#if defined(ALLOC_SANITIZED)
+	return false;
+#else
+	return true;
+#endif
+}
 
-void testIntTypesH() {
-	// this header contains macros for the printf and scanf family functions formating
-	// for example the %d, %i and etc.
-	int integer = 1000;
-	int octal = 0777;
-	int hexadecimal = 0xFFF;
-	printf("decimal formatting: \n\n%"PRId8"\n", integer); // PRId32 -> d
-	printf("octal formatting: %"PRIo32"\n", octal); // PRIo32 -> o
-	printf("hexadecimal formatting: %"PRIx32"\n", hexadecimal); // PRIx32 -> x
+static void allocAccountingStart() {
+	atomic_store(&allocCounters.enabled, false);
+	atomic_store(&allocCounters.mallocs, 0);
+	atomic_store(&allocCounters.callocs, 0);
+	atomic_store(&allocCounters.reallocs, 0);
+	atomic_store(&allocCounters.aligned, 0);
+	atomic_store(&allocCounters.frees, 0);
+	atomic_store(&allocCounters.bytes, 0);
+	atomic_store(&allocCounters.live, 0);
+	atomic_store(&allocCounters.peak, 0);
+	for(int i = 0; i < ALLOC_SIZE_CLASSES; i++) {
+		atomic_store(&allocCounters.sizeClasses[i], 0);
+	}
+	resetPeakResident();
+	allocStartResident = currentRssBytes();
+	atomic_store(&allocCounters.enabled, true);
+}
 
-	scanf("%"SCNd32, &integer); // SCNd32 -> d
-	scanf("%"SCNo32, &octal); // SCNo32 -> o
-	scanf("%"SCNx32, &hexadecimal); // SCNx32 -> x
+static void printBytes(double bytes) {
+	if(bytes < 0) {
+		printf("-");
+		bytes = -bytes;
+	}
+	if(bytes < 1024) {
+		printf("%.0f B", bytes);
+	} else if(bytes < 1024 * 1024) {
+		printf("%.1f KiB", bytes / 1024);
+	} else {
+		printf("%.1f MiB", bytes / (1024 * 1024));
+	}
+}
 
-	// there are many more macros, for every formating involving integers
-	// and for every integer size, but you got the point.
-	// I don't really know if there is any situation in which using these macros
-	// is better than writing %d or %o and so on.
+// stops counting (so the report's own printf() isn't in it) and prints what
+// the test did, per run for benchmarks. the peak and the live bytes are for
+// the whole window, not per run
+static void allocAccountingReport(const char *name, int runs) {
+	atomic_store(&allocCounters.enabled, false);
+	uint64_t mallocs = atomic_load(&allocCounters.mallocs), callocs = atomic_load(&allocCounters.callocs);
+	uint64_t reallocs = atomic_load(&allocCounters.reallocs), aligned = atomic_load(&allocCounters.aligned);
+	uint64_t calls = mallocs + callocs + reallocs + aligned;
+	printf("\nallocations in %s", name);
+	if(runs > 1) {
+		printf(" (per run, the average of %d)", runs);
+	}
+	printf(": %.4g calls (%.4g malloc, %.4g calloc, %.4g realloc, %.4g aligned), ", (double) calls / runs,
+		(double) mallocs / runs, (double) callocs / runs, (double) reallocs / runs, (double) aligned / runs);
+	printBytes((double) atomic_load(&allocCounters.bytes) / runs);
+	printf(" asked for, %.4g frees\n  peak ", (double) atomic_load(&allocCounters.frees) / runs);
+	printBytes((double) atomic_load(&allocCounters.peak));
+	printf(" live above the start, ");
+	printBytes((double) atomic_load(&allocCounters.live));
+	printf(" still live at the end\n");
+	if(calls > 0) {
+		printf("  sizes:");
+		for(int i = 0; i < ALLOC_SIZE_CLASSES; i++) {
+			uint64_t count = atomic_load(&allocCounters.sizeClasses[i]);
+			if(count == 0) {
+				continue;
+			}
+			if(i == ALLOC_SIZE_CLASSES - 1) {
+				printf(" >1M %.4g", (double) count / runs);
+			} else if(i >= 16) {
+				printf(" <=%dM %.4g", 16 << i >> 20, (double) count / runs);
+			} else if(i >= 6) {
+				printf(" <=%dK %.4g", 16 << i >> 10, (double) count / runs);
+			} else {
+				printf(" <=%d %.4g", 16 << i, (double) count / runs);
+			}
+		}
+		printf("\n");
+	}
+	// VmHWM was reset at the start, so its peak is the test's own (the
+	// kernel counts what's resident now in it, so it's never below that)
+	printf("  resident ");
+	printBytes(currentRssBytes());
+	printf(" now, ");
+	printBytes(peakResidentKiB() * 1024.0);
+	printf(" at the peak of the test, ");
+	printBytes(allocStartResident);
+	printf(" at its start\n");
 }
 
+static int compareU64(const void *a, const void *b) {
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
 
+// the tests print a lot (and some, like perror(), print to stderr), and we
+// don't want to time our terminal, so while benchmarking both output
+// streams are pointed to /dev/null
+struct savedOutput {
+	int out;
+	int err;
+};
+
+static struct savedOutput silenceOutput() {
+	struct savedOutput saved = {-1, -1};
+	fflush(stdout);
+	fflush(stderr);
+	int devNull = open("/dev/null", O_WRONLY);
+	if(devNull < 0) {
+		return saved;
+	}
+	saved.out = dup(STDOUT_FILENO);
+	saved.err = dup(STDERR_FILENO);
+	if(saved.out >= 0) dup2(devNull, STDOUT_FILENO);
+	if(saved.err >= 0) dup2(devNull, STDERR_FILENO);
+	close(devNull);
+	return saved;
+}
 
-void testISO646H() {
-	// this header has macros that offer alternative representations
-	// to operators that aren't in the ISO646:1983 character set
-	int zero = 0;
-	int one = 1;
-	int anyNum = 15;
-
-	// not -> !
-	// and -> &&
-	if((not zero) and one) {
-		printf("\n\n!0 && 1\n");
+static void restoreOutput(struct savedOutput saved) {
+	fflush(stdout);
+	fflush(stderr);
+	if(saved.out >= 0) {
+		dup2(saved.out, STDOUT_FILENO);
+		close(saved.out);
 	}
-	// or -> ||
-	if(zero or one) {
-		printf("0 || 1\n");
+	if(saved.err >= 0) {
+		dup2(saved.err, STDERR_FILENO);
+		close(saved.err);
 	}
+}
 
-	printf("0 | 1 = %d\n", zero bitor one); // bitor -> |
-	printf("0 & 1 = %d\n", zero bitand one); // bitand -> &
-	printf("%d ^ 1 = %d\n", anyNum, anyNum xor one); // xor -> ^
-	printf("~%d = %d\n", anyNum, compl anyNum); // compl -> ~
-	// other operator macros:
-	// and_eq -> &= 
-	// or_eq -> |=
-	// xor_eq -> ^=
-	// not_eq -> !=
+// runs the test "warmup" times without looking (so caches, page tables and
+// lazy libc initialization are already warm) and then "iterations" times
+// measuring each call, and reports the min, the median and the 99th percentile
+static int benchmarkTest(const struct testEntry *test, int iterations, int warmup, bool verbose) {
+	uint64_t *samples = malloc(sizeof(uint64_t) * iterations);
+	if(samples == NULL) {
+		perror("malloc");
+		return 1;
+	}
 
-	// there are also macros that replace }, {, [, ] and #
-	int array<:2:> = {3, 2}; // <: becomes [ and :> becomes ]
-	%:define message "HELLO THERE!\n" // %: becomes #
-	if(array<:0:> == 3) <% // <% becomes {
-		printf(message);
-	%> // %> becomes }
+	struct savedOutput saved = {-1, -1};
+	if(!verbose) {
+		saved = silenceOutput();
+	}
+	for(int i = 0; i < warmup; i++) {
+		test->function();
+	}
+	for(int i = 0; i < iterations; i++) {
+		samples[i] = 0;
+		SCOPED_TIMER(timer, test->name, &samples[i]);
+		test->function();
+	}
+	restoreOutput(saved);
+
+	qsort(samples, iterations, sizeof(uint64_t), compareU64);
+	double median = iterations % 2 ? samples[iterations / 2]
+		: (samples[iterations / 2 - 1] + samples[iterations / 2]) / 2.0;
+	// the p99 is the smallest sample that is bigger or equal to 99% of them
+	size_t p99 = (size_t) ceil(iterations * 0.99) - 1;
+
+	printf("%-18s %8d runs  min %10.3f us  median %10.3f us  p99 %10.3f us\n",
+		test->name, iterations, samples[0] / 1e3, median / 1e3, samples[p99] / 1e3);
+	// reading the clock isn't free either, and for very short tests it's
+	// a real part of what was measured
+	double overhead = tscCalibration()->timerOverheadNs;
+	if(samples[0] < 100 * overhead) {
+		printf("%-18s (reading the timer costs %.0f ns, %.1f%% of the min)\n", "", overhead, 100 * overhead / samples[0]);
+	}
+	free(samples);
+	return 0;
 }
 
 
 
-void testLimitsH() {
-	// a bunch of macros containing the bit size of some types
-	// and the max and min limits of integer types (such as short int and long int)
-	printf("\n\nCHAR_BIT = %d\n", CHAR_BIT); // how big is a char in bits
-	printf("MB_LEN_MAX = %d\n\n", MB_LEN_MAX); // how many bytes can a multibyte char have
-	
-	printf("CHAR_MIN = %+d\n", CHAR_MIN); // minimum value of a char
-	printf("CHAR_MAX = %+d\n", CHAR_MAX); // maximum value of a char
-	printf("SCHAR_MIN = %+d\n", SCHAR_MIN); // minimun value of a signed char
-	printf("SCHAR_MAX = %+d\n", SCHAR_MAX); //  maximum value of a signed char
-	printf("UCHAR_MAX = %u\n\n", UCHAR_MAX); // maximun value of an unsigned char
-	
-	printf("SHRT_MIN = %+d\n", SHRT_MIN); // minimum value of a short int
-	printf("SHRT_MAX = %+d\n", SHRT_MAX); // maximun value of a short int
-	printf("USHRT_MAX = %u\n\n", USHRT_MAX); // maximun value of an unsigned short int
-	
-	printf("INT_MIN = %+d\n", INT_MIN); // minimum value of an int
-	printf("INT_MAX = %+d\n", INT_MAX); // maximun value of an int
-	printf("UINT_MAX = %u\n\n", UINT_MAX); // maximun value of an unsigned int
-	
-	printf("LONG_MIN = %+ld\n", LONG_MIN); // minimum value of a long int
-	printf("LONG_MAX = %+ld\n", LONG_MAX); // maximun value of a long int
-	printf("ULONG_MAX = %lu\n\n", ULONG_MAX); // maximun value of an unsigned long int
-	
-	printf("LLONG_MIN = %+lld\n", LLONG_MIN); // minimum value of a long long int
-	printf("LLONG_MAX = %+lld\n", LLONG_MAX); // maximun value of a long long int
-	printf("ULLONG_MAX = %llu\n\n", ULLONG_MAX); // maximun value of an unsigned long long int
+// THE COMMAND LINE
+// Now, to understand and test each header, just read its respective
+// function and run it from the command line to see it in action
+// (and ofc, modify the functions as you please, experiment!)
+
+static void printUsage(const char *program) {
+	printf("usage: %s [options] <command> [tests...]\n\n", program);
+	printf("commands:\n");
+	printf("  list               show every test and the header it is about\n");
+	printf("  run <tests...>     run the tests once, in the given order\n");
+	printf("  bench <tests...>   time the tests (min/median/p99 of many runs)\n\n");
+	printf("a test can be named by its function (testStringH) or header (string.h),\n");
+	printf("and \"all\" means every test that neither waits for input nor exits.\n");
+	printf("the benchThingH functions already time themselves, so just \"run\" them\n\n");
+	printf("options:\n");
+	printf("  -n <count>   benchmark iterations (default 100)\n");
+	printf("  -w <count>   warm-up runs before measuring (default 10)\n");
+	printf("  -v           keep the tests' output while benchmarking\n");
+	printf("  -t <count>   max threads for the multithreaded benchmarks (default: CPUs)\n");
+	printf("  -s <MiB>     max data size for the I/O benchmarks (default 256)\n");
+	printf("  -x           exhaustive checks in the benchmarks (every float, takes minutes)\n");
+	printf("  -p <Hz>      profile each test, sampling that many times per CPU second (try 1000)\n");
+	printf("  -c           count cycles, instructions and cache, branch and TLB misses around each test\n");
+	printf("  -a           count the allocations of each test (calls, bytes, peak, sizes) and its memory\n");
 }
 
+static void listTests() {
+	for(size_t i = 0; i < TEST_COUNT; i++) {
+		const struct testEntry *test = &testRegistry[i];
+		printf("%-18s %-15s%s%s%s\n", test->name, test->header,
+			test->flags & TEST_INTERACTIVE ? " (reads stdin)" : "",
+			test->flags & TEST_EXITS ? " (exits)" : "",
+			test->flags & TEST_BENCHMARK ? " (benchmark)" : "");
+	}
+}
 
+// reads a positive count for the options that take a number
+static bool parseCount(const char *text, int *count) {
+	char *end;
+	long value = strtol(text, &end, 10);
+	if(*text == '\0' || *end != '\0' || value < 0 || value > INT_MAX) {
+		return false;
+	}
+	*count = (int) value;
+	return true;
+}
 
-void testLocaleH() {
-	// Basically this header lets you change the locale of your program,
-	// including the character set, the decimal separating symbol and the currency.
+int main(int argc, char const *argv[]) {
+	int iterations = 100;
+	int warmup = 10;
+	bool verbose = false;
+	int profileRate = 0;
+	bool counting = false;
+	bool accounting = false;
+	const char *command = NULL;
+	int status = 0;
+	// every argument is one test, or the whole registry for "all"
+	const struct testEntry **selected = malloc(sizeof(*selected) * argc * TEST_COUNT);
+	size_t selectedCount = 0;
+	if(selected == NULL) {
+		perror("malloc");
+		status = 1;
+		goto done;
+	}
 
-	// In most cases you will simply do the following to set the locale to the OS one
-	setlocale(LC_ALL, "");
-	printf("current locale: %s\n", setlocale(LC_ALL, NULL));
+	for(int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		if(strcmp(arg, "-n") == 0 || strcmp(arg, "-w") == 0) {
+			int *target = arg[1] == 'n' ? &iterations : &warmup;
+			if(i + 1 >= argc || !parseCount(argv[i + 1], target)) {
+				fprintf(stderr, "%s expects a number\n", arg);
+				status = 1;
+				goto done;
+			}
+			i++;
+		} else if(strcmp(arg, "-t") == 0 || strcmp(arg, "-s") == 0 || strcmp(arg, "-p") == 0) {
+			int *target = arg[1] == 't' ? &benchMaxThreads : arg[1] == 's' ? &benchMaxMiB : &profileRate;
+			if(i + 1 >= argc || !parseCount(argv[i + 1], target)) {
+				fprintf(stderr, "%s expects a number\n", arg);
+				status = 1;
+				goto done;
+			}
+			i++;
+		} else if(strcmp(arg, "-v") == 0) {
+			verbose = true;
+		} else if(strcmp(arg, "-x") == 0) {
+			benchExhaustive = true;
+		} else if(strcmp(arg, "-c") == 0) {
+			counting = true;
+		} else if(strcmp(arg, "-a") == 0) {
+			accounting = true;
+		} else if(arg[0] == '-') {
+			fprintf(stderr, "unknown option %s\n\n", arg);
+			printUsage(argv[0]);
+			status = 1;
+			goto done;
+		} else if(command == NULL) {
+			command = arg;
+		} else if(strcasecmp(arg, "all") == 0) {
+			for(size_t t = 0; t < TEST_COUNT; t++) {
+				if(!(testRegistry[t].flags & (TEST_INTERACTIVE | TEST_EXITS | TEST_BENCHMARK))) {
+					selected[selectedCount++] = &testRegistry[t];
+				}
+			}
+		} else {
+			const struct testEntry *test = findTest(arg);
+			if(test == NULL) {
+				fprintf(stderr, "there's no test called %s (try \"list\")\n", arg);
+				status = 1;
+				goto done;
+			}
+			selected[selectedCount++] = test;
+		}
+	}
+
+	if(command == NULL) {
+		printUsage(argv[0]);
+		status = 1;
+		goto done;
+	}
+	if(strcmp(command, "list") == 0) {
+		listTests();
+		goto done;
+	}
+	bool bench = strcmp(command, "bench") == 0;
+	if(!bench && strcmp(command, "run") != 0) {
+		fprintf(stderr, "unknown command %s\n\n", command);
+		printUsage(argv[0]);
+		status = 1;
+		goto done;
+	}
+	if(selectedCount == 0) {
+		fprintf(stderr, "which tests? (try \"list\")\n");
+		status = 1;
+		goto done;
+	}
+	if(bench && iterations == 0) {
+		fprintf(stderr, "-n must be at least 1\n");
+		status = 1;
+		goto done;
+	}
+
+	// one group for every test, opened before the first so a refusal is explained only once
+	struct perfGroup counters = {.leader = -1};
+	if(counting && !perfGroupOpen(&counters)) {
+		perfGroupExplain(counters.error);
+		counting = false;
+	}
+	if(accounting && !allocAccountingAvailable()) {
+		fprintf(stderr, "this build has its own malloc() (a sanitizer's), so there's no allocation accounting\n");
+		accounting = false;
+	}
+
+	for(size_t i = 0; i < selectedCount; i++) {
+		const struct testEntry *test = selected[i];
+		// only what really runs gets profiled (tests that exit get their report from atexit())
+		bool runs = !bench || !(test->flags & (TEST_INTERACTIVE | TEST_EXITS | TEST_BENCHMARK));
+		bool profiling = profileRate > 0 && runs && profilerStart(profileRate, test->name);
+		if(profileRate > 0 && runs && !profiling) {
+			fprintf(stderr, "couldn't start the profiler for %s\n", test->name);
+		}
+		// the counters see the warm-up runs of a benchmark too, so it's divided by all of them
+		if(counting && runs) {
+			perfGroupStart(&counters);
+		}
+		if(accounting && runs) {
+			allocAccountingStart();
+		}
+		if(!bench) {
+			test->function();
+		} else if(test->flags & (TEST_INTERACTIVE | TEST_EXITS)) {
+			// benchmarking something that waits for the keyboard or that
+			// kills the program on its first run doesn't make much sense
+			fprintf(stderr, "%s %s, so it can't be benchmarked\n", test->name,
+				test->flags & TEST_INTERACTIVE ? "reads from stdin" : "ends the program");
+			status = 1;
+		} else if(test->flags & TEST_BENCHMARK) {
+			fprintf(stderr, "%s is a benchmark already, \"run\" it instead\n", test->name);
+			status = 1;
+		} else {
+			status |= benchmarkTest(test, iterations, warmup, verbose);
+		}
+		// the counters stop first, so they don't see the allocation report's printf()
+		struct perfGroupReading reading;
+		if(counting && runs) {
+			reading = perfGroupStop(&counters);
+		}
+		if(accounting && runs) {
+			allocAccountingReport(test->name, bench ? iterations + warmup : 1);
+		}
+		if(counting && runs) {
+			perfGroupReport(test->name, &reading, bench ? iterations + warmup : 1);
+		}
+		if(profiling) {
+			profilerStop();
+			profilerReport(test->name);
+		}
+	}
+	if(counting) {
+		perfGroupClose(&counters);
+	}
+done:
+	free(selected);
+	return status;
 }
 
 
 
-void testMathH() {
-	// As the name sugests, this header contains a lot of usefull math functions
-	int a = 3;
-	int b = -5;
-	double c = 1.25;
-	double d = 4.999999;
-	double e = 10.0;
-	float f = 2.5;
-	float g = 8.0;
+void testAssertH() {
+	// This header has basically only 1 function (the other one is deprecated)
+	int x = 10;
+	int y = 20;
 
-	// absolute value
-	printf("\n\nabsolute value of %d: %d\n", b, abs(b));
-	// division: returns the quotient and the remainder
-	printf("%d/%d is equal to %d and the remainder is %d\n", b, a, div(b, a).quot, div(b, a).rem);
-	// calculates the remainder of a floating point division
-	printf("the remainder of %.1f/%.1f is %.1f\n", g, f, remainder(g, f));
-	// calculates (a * b) + c
-	printf("%lf * %lf + %lf = %lf\n", c, d, e, fma(c, d, e));
-	// get the bigger float
-	printf("the bigger foat is: %f\n", fmax(f, g));
-	// get the smaller float
-	printf("the smaller float is: %f\n", fmin(f, g));
-	// get the difference between two floats (or 0 if the first is smaller than the second)
-	printf("the difference between %f and %f is %f\n", g, f, fdim(g, f));
-	// get NaN (not a number)
-	printf("%f\n", nan("2"));
-	// exponential (in base e and 2)
-	printf("e^%d = %f\n", a, exp(a));
-	printf("2^%d = %f\n", b, exp2(b));
-	// logarithms (in base e, 2 and 10)
-	printf("ln(%d) = %f\n", a, log(a));
-	printf("log2(%d) = %f\n", a, log2(a));
-	printf("log10(%d) = %f\n", a, log10(a));
-	// power function (x^y)
-	printf("%d^%d = %f\n", b, a, pow(b, a));
-	// square root and cubic root
-	printf("square root of %d = %f\n", a, sqrt(a));
-	printf("cubic root of %d = %f\n", a, cbrt(a));
-	// trigonometric functions
-	printf("sine of %d = %f\n", a, sin(a));
-	printf("cosine of %d = %f\n", a, cos(a));
-	printf("tangent of %d = %f\n", a, tan(a));
-	// floor and ceil functions
-	printf("the floor of %.2f is %.1f\n", c, floor(c));
-	printf("the ceiling of %.2f is %.1f\n", c, ceil(c));
-	// INFINITY macro
-	printf("infinity = %f\n", INFINITY);
-	printf("%.1lf < %f = %s\n", pow(2, 64), INFINITY, pow(2, 64) < INFINITY ? "true" : "false");
+	printf("doing assert 1\n");
+	assert(x < y); // true
+	printf("doing assert 2\n");
+	assert(x != y); // true
 
+	// see what happens when assert() is given a false statement
+	printf("doing assert 3\n");
+	// uncomment the next line to see what happens
+	// assert(x == y); // false
+	printf("after assert 3 :^)\n");
 }
 
 
 
-void testSetjmpH() {
-	// this header allows you to save stack in a certain moment
-	// with setjpm() and then jump to that state with longjmp()
-	jmp_buf presentBuffer;
+// FAST FOURIER TRANSFORMS
+// the discrete Fourier transform turns n samples into n frequencies:
+// X[k] = the sum of x[j] * e^(-2 pi i jk / n), which done like that takes
+// n^2 complex multiplications. the FFT gets the same result in about n log n
+// by splitting the samples in halves again and again, and then putting the
+// small transforms back together level by level with "butterflies" that
+// multiply by twiddle factors (the e^(-2 pi i jk / n) above)
+//
+// there are two ways of keeping n complex numbers in memory:
+// interleaved, an array of complex (re, im, re, im...), which is what complex.h gives us
+// split, one array with the real parts and another one with the imaginary
+// parts (a "structure of arrays"), so SIMD loads get several real parts at once
+
+enum fftKind {
+	FFT_DOUBLE_INTERLEAVED,
+	FFT_DOUBLE_SPLIT,
+	FFT_FLOAT_INTERLEAVED,
+	FFT_FLOAT_SPLIT,
+};
+
+static const char *fftKindNames[] = {"double interleaved", "double split", "float interleaved", "float split"};
+
+// everything that only depends on n is computed once, in a plan
+struct fftPlan {
+	enum fftKind kind;
+	size_t n; // a power of 2
+	int log2n;
+	uint32_t *bitReverse; // where each sample goes before the first level
+	// the twiddles of every radix-4 level, one level after the other: for
+	// blocks of 4m samples that's w^j, then w^2j, then w^3j, for j from 0 to
+	// m - 1 (with w = e^(-2 pi i / 4m)), in the precision and layout of the plan
+	union {
+		double complex *doubles;
+		float complex *floats;
+		struct { double *re, *im; } splitDoubles;
+		struct { float *re, *im; } splitFloats;
+	} twiddles;
+};
+
+// the first radix-4 level works on blocks of 4m samples. with an odd log2(n)
+// one radix-2 level (blocks of 2) goes first, and the radix-4 ones start at 8
+static size_t fftFirstQuarter(int log2n) {
+	return log2n % 2 == 1 ? 2 : 1;
+}
 
-	void travelToThePast(int i) {
-		printf("we are in the past %d\n", i);
-		// go back to the future
-		puts("going back to the future...");
-		longjmp(presentBuffer, i + 1);
+static bool fftPlanInit(struct fftPlan *plan, size_t n, enum fftKind kind) {
+	memset(plan, 0, sizeof(*plan));
+	if(n == 0 || (n & (n - 1)) != 0 || n > ((size_t) 1 << 31)) {
+		return false;
+	}
+	plan->kind = kind;
+	plan->n = n;
+	while(((size_t) 1 << plan->log2n) < n) {
+		plan->log2n++;
 	}
 
-	int i = setjmp(presentBuffer);
-	printf("we are in the present %d\n", i);
-	if(i < 6) {
-		puts("traveling back to the past!!!");
-		travelToThePast(i);
+	size_t count = 0;
+	for(size_t m = fftFirstQuarter(plan->log2n); 4 * m <= n; m *= 4) {
+		count += 3 * m;
+	}
+	bool isFloat = kind == FFT_FLOAT_INTERLEAVED || kind == FFT_FLOAT_SPLIT;
+	size_t realSize = isFloat ? sizeof(float) : sizeof(double);
+	plan->bitReverse = malloc(n * sizeof(uint32_t));
+	void *twiddles = malloc(2 * count * realSize + 1); // (n = 1 and 2 have none)
+	if(plan->bitReverse == NULL || twiddles == NULL) {
+		free(plan->bitReverse);
+		free(twiddles);
+		plan->bitReverse = NULL;
+		return false;
+	}
+
+	for(size_t i = 0; i < n; i++) {
+		uint32_t reversed = 0;
+		for(int bit = 0; bit < plan->log2n; bit++) {
+			reversed = (reversed << 1) | ((i >> bit) & 1);
+		}
+		plan->bitReverse[i] = reversed;
+	}
+
+	switch(kind) {
+		case FFT_DOUBLE_INTERLEAVED: plan->twiddles.doubles = twiddles; break;
+		case FFT_FLOAT_INTERLEAVED: plan->twiddles.floats = twiddles; break;
+		case FFT_DOUBLE_SPLIT:
+			plan->twiddles.splitDoubles.re = twiddles;
+			plan->twiddles.splitDoubles.im = plan->twiddles.splitDoubles.re + count;
+			break;
+		case FFT_FLOAT_SPLIT:
+			plan->twiddles.splitFloats.re = twiddles;
+			plan->twiddles.splitFloats.im = plan->twiddles.splitFloats.re + count;
+			break;
+	}
+	size_t index = 0;
+	for(size_t m = fftFirstQuarter(plan->log2n); 4 * m <= n; m *= 4) {
+		for(size_t power = 1; power <= 3; power++) {
+			for(size_t j = 0; j < m; j++, index++) {
+				// in long double, so even the float plans get correctly rounded twiddles
+				long double angle = -2 * M_PIl * (long double) (power * j) / (long double) (4 * m);
+				long double re = cos(angle), im = sin(angle);
+				switch(kind) {
+					case FFT_DOUBLE_INTERLEAVED: plan->twiddles.doubles[index] = CMPLX((double) re, (double) im); break;
+					case FFT_FLOAT_INTERLEAVED: plan->twiddles.floats[index] = CMPLXF((float) re, (float) im); break;
+					case FFT_DOUBLE_SPLIT:
+						plan->twiddles.splitDoubles.re[index] = (double) re;
+						plan->twiddles.splitDoubles.im[index] = (double) im;
+						break;
+					case FFT_FLOAT_SPLIT:
+						plan->twiddles.splitFloats.re[index] = (float) re;
+						plan->twiddles.splitFloats.im[index] = (float) im;
+						break;
+				}
+			}
+		}
 	}
+	return true;
 }
 
+static void fftPlanDestroy(struct fftPlan *plan) {
+	free(plan->bitReverse);
+	// every member of the union starts with the same pointer
+	free(plan->twiddles.doubles);
+	memset(plan, 0, sizeof(*plan));
+}
 
+// one radix-4 butterfly combines 4 samples m apart: with c1 = w^2j x[j + m],
+// c2 = w^j x[j + 2m] and c3 = w^3j x[j + 3m] it does
+//   x[j]      = (x[j] + c1) + (c2 + c3)
+//   x[j + m]  = (x[j] - c1) - i (c2 - c3)
+//   x[j + 2m] = (x[j] + c1) - (c2 + c3)
+//   x[j + 3m] = (x[j] - c1) + i (c2 - c3)
+// which is the same as two radix-2 levels, with 3 multiplications instead of 4
+//
+// the same code is needed for doubles and floats, so it's written once as a
+// macro. multiplying with * on complex numbers follows Annex G of the
+// standard, which checks the result for NaNs and infinities (and calls a
+// library function when it finds one), so the butterflies multiply by hand
+#define FFT_INTERLEAVED_LEVELS(name, complexType, makeComplex, twiddleField) \
+	static void name(const struct fftPlan *plan, complexType *restrict data) { \
+		size_t n = plan->n; \
+		for(size_t i = 0; i < n; i++) { \
+			size_t j = plan->bitReverse[i]; \
+			if(i < j) { \
+				complexType swap = data[i]; \
+				data[i] = data[j]; \
+				data[j] = swap; \
+			} \
+		} \
+		if(plan->log2n % 2 == 1) { \
+			for(size_t i = 0; i < n; i += 2) { \
+				complexType a = data[i], b = data[i + 1]; \
+				data[i] = a + b; \
+				data[i + 1] = a - b; \
+			} \
+		} \
+		const complexType *twiddles = plan->twiddles.twiddleField; \
+		for(size_t m = fftFirstQuarter(plan->log2n); 4 * m <= n; m *= 4) { \
+			for(size_t start = 0; start < n; start += 4 * m) { \
+				complexType *x = data + start; \
+				for(size_t j = 0; j < m; j++) { \
+					complexType a1 = x[j + m], a2 = x[j + 2 * m], a3 = x[j + 3 * m]; \
+					complexType w1 = twiddles[j], w2 = twiddles[m + j], w3 = twiddles[2 * m + j]; \
+					complexType c1 = makeComplex(creal(a1) * creal(w2) - cimag(a1) * cimag(w2), creal(a1) * cimag(w2) + cimag(a1) * creal(w2)); \
+					complexType c2 = makeComplex(creal(a2) * creal(w1) - cimag(a2) * cimag(w1), creal(a2) * cimag(w1) + cimag(a2) * creal(w1)); \
+					complexType c3 = makeComplex(creal(a3) * creal(w3) - cimag(a3) * cimag(w3), creal(a3) * cimag(w3) + cimag(a3) * creal(w3)); \
+					complexType sum = x[j] + c1, difference = x[j] - c1; \
+					complexType outerSum = c2 + c3, outerDifference = c2 - c3; \
+					/* -i (a + bi) = b - ai */ \
+					complexType rotated = makeComplex(cimag(outerDifference), -creal(outerDifference)); \
+					x[j] = sum + outerSum; \
+					x[j + m] = difference + rotated; \
+					x[j + 2 * m] = sum - outerSum; \
+					x[j + 3 * m] = difference - rotated; \
+				} \
+			} \
+			twiddles += 3 * m; \
+		} \
+	}
 
-void testSignalH() {
-	// this header allows you to set up signal handlers
-	// and then raise the signals to call their handlers
-	
-	void customHandler1(int signal) {
-		printf("\n\nhandler 1 activated\n");
+#define FFT_SPLIT_LEVELS(name, real, twiddleField) \
+	static void name(const struct fftPlan *plan, real *restrict re, real *restrict im) { \
+		size_t n = plan->n; \
+		for(size_t i = 0; i < n; i++) { \
+			size_t j = plan->bitReverse[i]; \
+			if(i < j) { \
+				real swapRe = re[i], swapIm = im[i]; \
+				re[i] = re[j]; \
+				im[i] = im[j]; \
+				re[j] = swapRe; \
+				im[j] = swapIm; \
+			} \
+		} \
+		if(plan->log2n % 2 == 1) { \
+			for(size_t i = 0; i < n; i += 2) { \
+				real aRe = re[i], aIm = im[i], bRe = re[i + 1], bIm = im[i + 1]; \
+				re[i] = aRe + bRe; \
+				im[i] = aIm + bIm; \
+				re[i + 1] = aRe - bRe; \
+				im[i + 1] = aIm - bIm; \
+			} \
+		} \
+		const real *twiddlesRe = plan->twiddles.twiddleField.re; \
+		const real *twiddlesIm = plan->twiddles.twiddleField.im; \
+		for(size_t m = fftFirstQuarter(plan->log2n); 4 * m <= n; m *= 4) { \
+			for(size_t start = 0; start < n; start += 4 * m) { \
+				real *restrict xRe = re + start; \
+				real *restrict xIm = im + start; \
+				for(size_t j = 0; j < m; j++) { \
+					real a1Re = xRe[j + m], a1Im = xIm[j + m]; \
+					real a2Re = xRe[j + 2 * m], a2Im = xIm[j + 2 * m]; \
+					real a3Re = xRe[j + 3 * m], a3Im = xIm[j + 3 * m]; \
+					real w1Re = twiddlesRe[j], w1Im = twiddlesIm[j]; \
+					real w2Re = twiddlesRe[m + j], w2Im = twiddlesIm[m + j]; \
+					real w3Re = twiddlesRe[2 * m + j], w3Im = twiddlesIm[2 * m + j]; \
+					real c1Re = a1Re * w2Re - a1Im * w2Im, c1Im = a1Re * w2Im + a1Im * w2Re; \
+					real c2Re = a2Re * w1Re - a2Im * w1Im, c2Im = a2Re * w1Im + a2Im * w1Re; \
+					real c3Re = a3Re * w3Re - a3Im * w3Im, c3Im = a3Re * w3Im + a3Im * w3Re; \
+					real sumRe = xRe[j] + c1Re, sumIm = xIm[j] + c1Im; \
+					real differenceRe = xRe[j] - c1Re, differenceIm = xIm[j] - c1Im; \
+					real outerSumRe = c2Re + c3Re, outerSumIm = c2Im + c3Im; \
+					real outerDifferenceRe = c2Re - c3Re, outerDifferenceIm = c2Im - c3Im; \
+					xRe[j] = sumRe + outerSumRe; \
+					xIm[j] = sumIm + outerSumIm; \
+					xRe[j + m] = differenceRe + outerDifferenceIm; \
+					xIm[j + m] = differenceIm - outerDifferenceRe; \
+					xRe[j + 2 * m] = sumRe - outerSumRe; \
+					xIm[j + 2 * m] = sumIm - outerSumIm; \
+					xRe[j + 3 * m] = differenceRe - outerDifferenceIm; \
+					xIm[j + 3 * m] = differenceIm + outerDifferenceRe; \
+				} \
+			} \
+			twiddlesRe += 3 * m; \
+			twiddlesIm += 3 * m; \
+		} \
 	}
-	void customHandler2(int signal) {
-		printf("handler 2 activated\n");
+
+FFT_INTERLEAVED_LEVELS(fftLevelsDouble, double complex, CMPLX, doubles)
+FFT_INTERLEAVED_LEVELS(fftLevelsFloat, float complex, CMPLXF, floats)
+FFT_SPLIT_LEVELS(fftLevelsSplitDouble, double, splitDoubles)
+FFT_SPLIT_LEVELS(fftLevelsSplitFloat, float, splitFloats)
+
+// the transforms themselves, in place. the inverse one is the forward one on
+// the complex conjugates, conjugated back and divided by n. with split arrays
+// it's even simpler: swapping the real and imaginary arrays does the conjugating
+static void fftDouble(const struct fftPlan *plan, double complex *data, bool inverse) {
+	assert(plan->kind == FFT_DOUBLE_INTERLEAVED);
+	if(!inverse) {
+		fftLevelsDouble(plan, data);
+		return;
+	}
+	for(size_t i = 0; i < plan->n; i++) {
+		data[i] = conj(data[i]);
+	}
+	fftLevelsDouble(plan, data);
+	double scale = 1.0 / plan->n;
+	for(size_t i = 0; i < plan->n; i++) {
+		data[i] = CMPLX(creal(data[i]) * scale, -cimag(data[i]) * scale);
 	}
+}
 
-	// sig_atomic_t is an int type that can be accessed atomically in multithread programs 
-	volatile sig_atomic_t customSignal1 = 10;
-	volatile sig_atomic_t customSignal2 = 11;
-	signal(customSignal1, customHandler1);
-	signal(customSignal2, customHandler2);
-	raise(customSignal1);
-	raise(customSignal2);
+static void fftFloat(const struct fftPlan *plan, float complex *data, bool inverse) {
+	assert(plan->kind == FFT_FLOAT_INTERLEAVED);
+	if(!inverse) {
+		fftLevelsFloat(plan, data);
+		return;
+	}
+	for(size_t i = 0; i < plan->n; i++) {
+		data[i] = conj(data[i]);
+	}
+	fftLevelsFloat(plan, data);
+	float scale = 1.0f / plan->n;
+	for(size_t i = 0; i < plan->n; i++) {
+		data[i] = CMPLXF(creal(data[i]) * scale, -cimag(data[i]) * scale);
+	}
+}
 
-	// there are also some default handlers and default signals
-	signal(SIGFPE, SIG_IGN); // SIG_IGN is a handler that ignores the signal
-	raise(SIGFPE);
-	signal(SIGINT, SIG_DFL); // SIG_DFL is a default handler that depends on the signal
-	raise(SIGINT);
+static void fftSplitDouble(const struct fftPlan *plan, double *re, double *im, bool inverse) {
+	assert(plan->kind == FFT_DOUBLE_SPLIT);
+	if(!inverse) {
+		fftLevelsSplitDouble(plan, re, im);
+		return;
+	}
+	fftLevelsSplitDouble(plan, im, re);
+	double scale = 1.0 / plan->n;
+	for(size_t i = 0; i < plan->n; i++) {
+		re[i] *= scale;
+		im[i] *= scale;
+	}
 }
 
+static void fftSplitFloat(const struct fftPlan *plan, float *re, float *im, bool inverse) {
+	assert(plan->kind == FFT_FLOAT_SPLIT);
+	if(!inverse) {
+		fftLevelsSplitFloat(plan, re, im);
+		return;
+	}
+	fftLevelsSplitFloat(plan, im, re);
+	float scale = 1.0f / plan->n;
+	for(size_t i = 0; i < plan->n; i++) {
+		re[i] *= scale;
+		im[i] *= scale;
+	}
+}
 
+// the n^2 definition, summed in long double, to check the FFTs against
+static void naiveDft(const double complex *in, double complex *out, size_t n) {
+	long double *cosines = malloc(n * sizeof(long double));
+	long double *sines = malloc(n * sizeof(long double));
+	if(cosines == NULL || sines == NULL) {
+		free(cosines);
+		free(sines);
+		memset(out, 0, n * sizeof(double complex));
+		return;
+	}
+	for(size_t t = 0; t < n; t++) {
+		long double angle = -2 * M_PIl * (long double) t / (long double) n;
+		cosines[t] = cos(angle);
+		sines[t] = sin(angle);
+	}
+	for(size_t k = 0; k < n; k++) {
+		long double re = 0, im = 0;
+		for(size_t j = 0; j < n; j++) {
+			// e^(-2 pi i jk / n) repeats every n, so only jk mod n matters
+			size_t t = (j * k) & (n - 1);
+			re += creal(in[j]) * cosines[t] - cimag(in[j]) * sines[t];
+			im += creal(in[j]) * sines[t] + cimag(in[j]) * cosines[t];
+		}
+		out[k] = CMPLX((double) re, (double) im);
+	}
+	free(cosines);
+	free(sines);
+}
 
-void testStdArgH() {
-	// allows you to create variadic functions (functions
-	// that accept a variable number of arguments)
-	double getAvarage(int numOfNums, ...) {
-		// creates an object with info for the other header functions
-		va_list args;
-		
-		// enables access to the ... arguments
-		va_start(args, numOfNums);
+// the benchmark and the checks run every kind of plan through the same code,
+// on a buffer of 2n reals: n complex numbers, or n real parts and n imaginary ones
+static size_t fftBufferSize(const struct fftPlan *plan) {
+	bool isFloat = plan->kind == FFT_FLOAT_INTERLEAVED || plan->kind == FFT_FLOAT_SPLIT;
+	return 2 * plan->n * (isFloat ? sizeof(float) : sizeof(double));
+}
 
-		double result = 0;
-		for(int i = 0; i < numOfNums; i++) {
-			// accesses the next argument on the list
-			result += va_arg(args, double);
-		}
-		// terminates access to the ... arguments
-		va_end(args);
+static double complex fftGet(const struct fftPlan *plan, const void *buffer, size_t i) {
+	switch(plan->kind) {
+		case FFT_DOUBLE_INTERLEAVED: return ((const double complex *) buffer)[i];
+		case FFT_FLOAT_INTERLEAVED: return ((const float complex *) buffer)[i];
+		case FFT_DOUBLE_SPLIT: return CMPLX(((const double *) buffer)[i], ((const double *) buffer)[plan->n + i]);
+		case FFT_FLOAT_SPLIT: return CMPLX(((const float *) buffer)[i], ((const float *) buffer)[plan->n + i]);
+	}
+	return 0;
+}
 
-		return result/numOfNums;
+static void fftSet(const struct fftPlan *plan, void *buffer, size_t i, double complex value) {
+	switch(plan->kind) {
+		case FFT_DOUBLE_INTERLEAVED: ((double complex *) buffer)[i] = value; break;
+		case FFT_FLOAT_INTERLEAVED: ((float complex *) buffer)[i] = CMPLXF((float) creal(value), (float) cimag(value)); break;
+		case FFT_DOUBLE_SPLIT:
+			((double *) buffer)[i] = creal(value);
+			((double *) buffer)[plan->n + i] = cimag(value);
+			break;
+		case FFT_FLOAT_SPLIT:
+			((float *) buffer)[i] = (float) creal(value);
+			((float *) buffer)[plan->n + i] = (float) cimag(value);
+			break;
 	}
+}
 
-	printf("\n\naverage of 3.2, 8.6 and 2.99 = %.2lf\n", getAvarage(3, 3.2, 8.6, 2.99));
-	printf("average of 5, and 109.55 = %.3lf\n", getAvarage(2, 5, 109.55));
+static void fftRun(const struct fftPlan *plan, void *buffer, bool inverse) {
+	switch(plan->kind) {
+		case FFT_DOUBLE_INTERLEAVED: fftDouble(plan, buffer, inverse); break;
+		case FFT_FLOAT_INTERLEAVED: fftFloat(plan, buffer, inverse); break;
+		case FFT_DOUBLE_SPLIT: fftSplitDouble(plan, buffer, (double *) buffer + plan->n, inverse); break;
+		case FFT_FLOAT_SPLIT: fftSplitFloat(plan, buffer, (float *) buffer + plan->n, inverse); break;
+	}
 }
 
+// sqrt(sum |result - expected|^2 / sum |expected|^2), so the error doesn't depend on n
+static double fftError(const struct fftPlan *plan, const void *buffer, const double complex *expected) {
+	double error = 0, norm = 0;
+	for(size_t i = 0; i < plan->n; i++) {
+		double complex difference = fftGet(plan, buffer, i) - expected[i];
+		error += creal(difference) * creal(difference) + cimag(difference) * cimag(difference);
+		norm += creal(expected[i]) * creal(expected[i]) + cimag(expected[i]) * cimag(expected[i]);
+	}
+	return norm > 0 ? sqrt(error / norm) : sqrt(error);
+}
 
+static void fillWithSignal(double complex *samples, size_t n, unsigned seed) {
+	for(size_t i = 0; i < n; i++) {
+		seed = seed * 1103515245u + 12345u;
+		double re = (double) (seed >> 8) / (1 << 24) - 0.5;
+		seed = seed * 1103515245u + 12345u;
+		double im = (double) (seed >> 8) / (1 << 24) - 0.5;
+		samples[i] = CMPLX(re, im);
+	}
+}
 
-void testStdAtomicH() {
-	// this header gives us a way to make variables atomic and
+
+
+void testComplexH() {
+	// pure imaginary numbers
+	// there is an "imaginary" type but its not aways supported
+	float complex floatImag = 2.0 * I;
+	double complex doubleImag = 7.77 * I;
+	long double complex ldoubleImag = -2.5555555555 * I;
+
+	// pure real numbers
+	float floatReal = 111.1;
+	double doubleReal = 9.99;
+	long double ldoubleReal = 3.14159;
+
+	// complex numbers
+	float complex floatComplex = floatReal + floatImag;
+	double complex doubleComplex = doubleReal + doubleImag;
+	long double complex ldoubleComplex = ldoubleReal + ldoubleImag;
+
+	// the "crealf", "creal" and "creall" functions return the real part of a complex num
+	// the "cimag", "cimag" and "cimagl" functions return the imaginary part of a complex num
+	printf("\n\nfloat complex = %.1f + %.1fi\n", crealf(floatComplex), cimagf(floatComplex));
+	printf("double complex = %.2lf + %.2lfi\n", creal(doubleComplex), cimag(doubleComplex));
+	printf("long double complex = %.5Lf + %.5Lfi\n", creall(ldoubleComplex), cimagl(ldoubleComplex));
+
+	// some functions that manipulate complex numbers
+	printf("\nabsolute (modulus) value of a complex: %lf\n", cabs(doubleComplex));
+	printf("phase angle of a complex: %lf\n", carg(doubleComplex));
+	printf("conjulgate of a complex: %lf + %lfi\n", creal(conj(doubleComplex)), cimag(conj(doubleComplex)));
+	printf("projection of a complex on Riemann sphere: %lf + %lfi\n", creal(cproj(doubleComplex)), cimag(cproj(doubleComplex)));
+
+	// complex versions of the pow() and sqrt() functions
+	printf("\na complex to the power of 2: %lf + %lfi\n", creal(cpow(doubleComplex, 2)), cimag(cpow(doubleComplex, 2)));
+	printf("the square root of a complex: %lf + %lfi\n", creal(csqrt(doubleComplex)), cimag(csqrt(doubleComplex)));
+
+	// there are many other functions in the complex library, but I think you got the point,
+	// and I'm not math-pilled enough to know what exactly the other ones do. But if you want to know
+	// more, access https://en.cppreference.com/w/c/numeric/complex
+
+	// the FFT above testComplexH: a signal made of two waves, one going 3
+	// times around in 16 samples and a weaker one 5 times, shows up in the
+	// frequencies as two spikes, at 3 and at 5
+	double complex signal[16], frequencies[16];
+	for(int j = 0; j < 16; j++) {
+		signal[j] = cexp(2 * M_PI * I * 3 * j / 16) + 0.5 * cexp(2 * M_PI * I * 5 * j / 16);
+	}
+	struct fftPlan plan;
+	if(fftPlanInit(&plan, 16, FFT_DOUBLE_INTERLEAVED)) {
+		memcpy(frequencies, signal, sizeof(signal));
+		fftDouble(&plan, frequencies, false);
+		printf("\nthe magnitudes of the FFT of the signal:\n");
+		for(int k = 0; k < 16; k++) {
+			printf("%.1f ", cabs(frequencies[k]));
+		}
+		fftDouble(&plan, frequencies, true);
+		printf("\nand after the inverse FFT the signal is back (error %.1e)\n", fftError(&plan, frequencies, signal));
+		fftPlanDestroy(&plan);
+	}
+
+	// every kind of FFT against the n^2 definition, for every size up to 1024
+	double worst = 0;
+	for(size_t n = 1; n <= 1024; n *= 2) {
+		double complex *samples = malloc(n * sizeof(double complex));
+		double complex *expected = malloc(n * sizeof(double complex));
+		if(samples != NULL && expected != NULL) {
+			fillWithSignal(samples, n, (unsigned) n);
+			naiveDft(samples, expected, n);
+			for(int kind = FFT_DOUBLE_INTERLEAVED; kind <= FFT_FLOAT_SPLIT; kind++) {
+				if(!fftPlanInit(&plan, n, kind)) {
+					continue;
+				}
+				void *buffer = malloc(fftBufferSize(&plan));
+				if(buffer != NULL) {
+					for(size_t i = 0; i < n; i++) {
+						fftSet(&plan, buffer, i, samples[i]);
+					}
+					fftRun(&plan, buffer, false);
+					double error = fftError(&plan, buffer, expected);
+					worst = error > worst ? error : worst;
+				}
+				free(buffer);
+				fftPlanDestroy(&plan);
+			}
+		}
+		free(samples);
+		free(expected);
+	}
+	// floats have about 7 digits, so that's the error we can expect
+	printf("worst relative error against the naive DFT: %.1e (%s)\n", worst, worst < 1e-5 ? "ok" : "WRONG");
+}
+
+
+
+void benchComplexH() {
+	// GFLOPS of every kind of FFT from 2^6 to 2^22 points (or until the
+	// memory reaches -s MiB), counting the usual 5 n log2(n) floating point
+	// operations per transform, and how far its result is from the naive DFT
+	// (up to 2^12 points, after that it takes too long) and from the input
+	// after going forward and back
+	uint64_t maxBytes = (uint64_t) benchMaxMiB << 20;
+	printf("%-8s %-20s %10s %14s %14s\n", "points", "layout", "GFLOPS", "vs naive DFT", "round trip");
+	for(int log2n = 6; log2n <= 22; log2n++) {
+		size_t n = (size_t) 1 << log2n;
+		bool haveReference = log2n <= 12;
+		// the samples, the buffer and the plan (twiddles and bit reversal table)
+		if(n * (3 * sizeof(double complex) + sizeof(uint32_t)) > maxBytes) {
+			break;
+		}
+		double complex *samples = malloc(n * sizeof(double complex));
+		double complex *expected = haveReference ? malloc(n * sizeof(double complex)) : NULL;
+		if(samples == NULL || (haveReference && expected == NULL)) {
+			printf("couldn't allocate %zu points\n", n);
+			free(samples);
+			free(expected);
+			break;
+		}
+		fillWithSignal(samples, n, 7);
+		if(haveReference) {
+			naiveDft(samples, expected, n);
+		}
+
+		for(int kind = FFT_DOUBLE_INTERLEAVED; kind <= FFT_FLOAT_SPLIT; kind++) {
+			struct fftPlan plan;
+			void *buffer = NULL;
+			if(!fftPlanInit(&plan, n, kind) || (buffer = malloc(fftBufferSize(&plan))) == NULL) {
+				printf("%-8zu %-20s couldn't make the plan\n", n, fftKindNames[kind]);
+				fftPlanDestroy(&plan);
+				continue;
+			}
+			for(size_t i = 0; i < n; i++) {
+				fftSet(&plan, buffer, i, samples[i]);
+			}
+			// a forward and an inverse transform each time (forward ones alone would
+			// make the values grow until they overflow), about 2^26 points per
+			// measurement, and the best of 3 measurements
+			size_t repeats = ((size_t) 1 << 25) / (n * log2n) + 1;
+			uint64_t best = UINT64_MAX;
+			for(int r = 0; r < 3; r++) {
+				uint64_t start = monotonicNs();
+				for(size_t k = 0; k < repeats; k++) {
+					fftRun(&plan, buffer, false);
+					fftRun(&plan, buffer, true);
+					benchKeep(buffer);
+				}
+				uint64_t ns = monotonicNs() - start;
+				best = ns < best ? ns : best;
+			}
+			double gflops = 2 * 5.0 * n * log2n * repeats / best;
+
+			char versusDft[32] = "-";
+			for(size_t i = 0; i < n; i++) {
+				fftSet(&plan, buffer, i, samples[i]);
+			}
+			fftRun(&plan, buffer, false);
+			if(haveReference) {
+				snprintf(versusDft, sizeof(versusDft), "%.2e", fftError(&plan, buffer, expected));
+			}
+			fftRun(&plan, buffer, true);
+			printf("%-8zu %-20s %10.2f %14s %14.2e\n", n, fftKindNames[kind], gflops, versusDft, fftError(&plan, buffer, samples));
+			free(buffer);
+			fftPlanDestroy(&plan);
+		}
+		free(samples);
+		free(expected);
+	}
+}
+
+
+
+// BULK CHARACTER CLASSIFICATION
+// the functions above look at one char per call, which is what a tokenizer
+// does in a loop over a whole buffer. here we classify (or change the case of)
+// a whole buffer at once, in two ways:
+// - a 256-entry table: one load per byte tells us every class of that byte
+// - AVX2 "nibble shuffles": 32 bytes at a time, each byte is split in its low
+//   and high 4 bits, and each half indexes a 16-entry table with a shuffle
+//   instruction. a byte is in the class when both lookups share a bit
+// both follow the "C" locale rules (plain ASCII, nothing above 127 is in any class)
+
+enum ctypeClass {
+	CTYPE_ALNUM = 1 << 0,
+	CTYPE_ALPHA = 1 << 1,
+	CTYPE_BLANK = 1 << 2,
+	CTYPE_CNTRL = 1 << 3,
+	CTYPE_DIGIT = 1 << 4,
+	CTYPE_GRAPH = 1 << 5,
+	CTYPE_LOWER = 1 << 6,
+	CTYPE_PRINT = 1 << 7,
+	CTYPE_PUNCT = 1 << 8,
+	CTYPE_SPACE = 1 << 9,
+	CTYPE_UPPER = 1 << 10,
+	CTYPE_XDIGIT = 1 << 11,
+	CTYPE_CLASSES = 12
+};
+
+// the classes again, with their names and the ctype.h function to check them with
+static const struct {
+	const char *name;
+	enum ctypeClass bit;
+	int (*check)(int c);
+} ctypeClasses[CTYPE_CLASSES] = {
+	{"alnum", CTYPE_ALNUM, isalnum}, {"alpha", CTYPE_ALPHA, isalpha},
+	{"blank", CTYPE_BLANK, isblank}, {"cntrl", CTYPE_CNTRL, iscntrl},
+	{"digit", CTYPE_DIGIT, isdigit}, {"graph", CTYPE_GRAPH, isgraph},
+	{"lower", CTYPE_LOWER, islower}, {"print", CTYPE_PRINT, isprint},
+	{"punct", CTYPE_PUNCT, ispunct}, {"space", CTYPE_SPACE, isspace},
+	{"upper", CTYPE_UPPER, isupper}, {"xdigit", CTYPE_XDIGIT, isxdigit},
+};
+
+static uint16_t ctypeTable[256];
+static unsigned char upperTable[256];
+static unsigned char lowerTable[256];
+// the nibble tables of each class, for the AVX2 path
+static unsigned char nibbleLow[CTYPE_CLASSES][16];
+static unsigned char nibbleHigh[CTYPE_CLASSES][16];
+
+// the "C" locale rules written down, so the tables don't depend on
+// whatever locale the program happens to be in
+static uint16_t ctypeClassesOf(int c) {
+	uint16_t classes = 0;
+	bool upper = c >= 'A' && c <= 'Z';
+	bool lower = c >= 'a' && c <= 'z';
+	bool digit = c >= '0' && c <= '9';
+	bool graph = c >= 0x21 && c <= 0x7E;
+	if(upper) classes |= CTYPE_UPPER | CTYPE_ALPHA | CTYPE_ALNUM;
+	if(lower) classes |= CTYPE_LOWER | CTYPE_ALPHA | CTYPE_ALNUM;
+	if(digit) classes |= CTYPE_DIGIT | CTYPE_ALNUM;
+	if(digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')) classes |= CTYPE_XDIGIT;
+	if(graph) classes |= CTYPE_GRAPH | CTYPE_PRINT;
+	if(graph && !upper && !lower && !digit) classes |= CTYPE_PUNCT;
+	if(c == ' ') classes |= CTYPE_PRINT;
+	if(c == ' ' || c == '\t') classes |= CTYPE_BLANK;
+	if(c == ' ' || (c >= '\t' && c <= '\r')) classes |= CTYPE_SPACE;
+	if(c < 0x20 || c == 0x7F) classes |= CTYPE_CNTRL;
+	return classes;
+}
+
+// builds every table once. the nibble tables come from the big table: all
+// the bytes with the same high nibble form a "row", and the set of low
+// nibbles of that row which are in the class is the row's pattern. every
+// different pattern gets one bit: the high table marks which rows use it and
+// the low table marks which low nibbles it has. there are only 8 ASCII rows,
+// so 8 bits (one byte per table entry) are always enough
+static void ctypeTablesInit() {
+	static bool ready = false;
+	if(ready) {
+		return;
+	}
+	for(int c = 0; c < 256; c++) {
+		ctypeTable[c] = ctypeClassesOf(c);
+		upperTable[c] = c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+		lowerTable[c] = c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+	}
+	for(int k = 0; k < CTYPE_CLASSES; k++) {
+		uint16_t patterns[8];
+		int patternCount = 0;
+		memset(nibbleLow[k], 0, 16);
+		memset(nibbleHigh[k], 0, 16);
+		for(int high = 0; high < 8; high++) {
+			uint16_t pattern = 0;
+			for(int low = 0; low < 16; low++) {
+				if(ctypeTable[high << 4 | low] & ctypeClasses[k].bit) {
+					pattern |= 1 << low;
+				}
+			}
+			if(pattern == 0) {
+				continue;
+			}
+			int bit = 0;
+			while(bit < patternCount && patterns[bit] != pattern) {
+				bit++;
+			}
+			if(bit == patternCount) {
+				patterns[patternCount++] = pattern;
+			}
+			nibbleHigh[k][high] |= 1 << bit;
+			for(int low = 0; low < 16; low++) {
+				if(pattern & (1 << low)) {
+					nibbleLow[k][low] |= 1 << bit;
+				}
+			}
+		}
+	}
+	ready = true;
+}
+
+static int ctypeClassIndex(enum ctypeClass bit) {
+	return __builtin_ctz(bit);
+}
+
+// THE TABLE PATH
+
+// every class of every byte at once, one mask per byte
+static void classifyBytes(const unsigned char *in, size_t n, uint16_t *masks) {
+	ctypeTablesInit();
+	for(size_t i = 0; i < n; i++) {
+		masks[i] = ctypeTable[in[i]];
+	}
+}
+
+static size_t countClassTable(const unsigned char *in, size_t n, enum ctypeClass bit) {
+	size_t count = 0;
+	for(size_t i = 0; i < n; i++) {
+		count += (ctypeTable[in[i]] & bit) != 0;
+	}
+	return count;
+}
+
+// bit i of the bitmap is set when byte i is in the class, so a tokenizer can
+// jump from token to token with __builtin_ctzll() instead of testing every byte
+static void classBitmapTable(const unsigned char *in, size_t n, enum ctypeClass bit, uint64_t *bitmap) {
+	for(size_t start = 0; start < n; start += 64) {
+		size_t end = start + 64 < n ? start + 64 : n;
+		uint64_t word = 0;
+		for(size_t i = start; i < end; i++) {
+			word |= (uint64_t) ((ctypeTable[in[i]] & bit) != 0) << (i - start);
+		}
+		bitmap[start / 64] = word;
+	}
+}
+
+static void upperBytesTable(unsigned char *out, const unsigned char *in, size_t n) {
+	for(size_t i = 0; i < n; i++) {
+		out[i] = upperTable[in[i]];
+	}
+}
+
+static void lowerBytesTable(unsigned char *out, const unsigned char *in, size_t n) {
+	for(size_t i = 0; i < n; i++) {
+		out[i] = lowerTable[in[i]];
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// THE AVX2 PATH
+
+// a 32 bit mask of which of the 32 bytes at p are in class k
+__attribute__((target("avx2")))
+static inline uint32_t classMaskAvx2(const unsigned char *p, __m256i lowTable, __m256i highTable) {
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	__m256i bytes = _mm256_loadu_si256((const __m256i *) p);
+	__m256i low = _mm256_and_si256(bytes, nibble);
+	// there's no 8 bit shift, so shift 16 bit lanes and throw away what
+	// came from the neighbour byte
+	__m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+	__m256i both = _mm256_and_si256(_mm256_shuffle_epi8(lowTable, low), _mm256_shuffle_epi8(highTable, high));
+	return ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(both, _mm256_setzero_si256()));
+}
+
+// the shuffle looks up inside each 16 byte half of the register, so the
+// 16-entry table is copied to both halves
+__attribute__((target("avx2")))
+static inline __m256i nibbleTableAvx2(const unsigned char table[16]) {
+	return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) table));
+}
+
+__attribute__((target("avx2")))
+static size_t countClassAvx2(const unsigned char *in, size_t n, enum ctypeClass bit) {
+	int k = ctypeClassIndex(bit);
+	__m256i lowTable = nibbleTableAvx2(nibbleLow[k]);
+	__m256i highTable = nibbleTableAvx2(nibbleHigh[k]);
+	size_t count = 0;
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32) {
+		count += __builtin_popcount(classMaskAvx2(in + i, lowTable, highTable));
+	}
+	return count + countClassTable(in + i, n - i, bit);
+}
+
+__attribute__((target("avx2")))
+static void classBitmapAvx2(const unsigned char *in, size_t n, enum ctypeClass bit, uint64_t *bitmap) {
+	int k = ctypeClassIndex(bit);
+	__m256i lowTable = nibbleTableAvx2(nibbleLow[k]);
+	__m256i highTable = nibbleTableAvx2(nibbleHigh[k]);
+	size_t i = 0;
+	for(; i + 64 <= n; i += 64) {
+		uint64_t low = classMaskAvx2(in + i, lowTable, highTable);
+		uint64_t high = classMaskAvx2(in + i + 32, lowTable, highTable);
+		bitmap[i / 64] = low | high << 32;
+	}
+	if(i < n) {
+		classBitmapTable(in + i, n - i, bit, bitmap + i / 64);
+	}
+}
+
+// the lowercase letters become uppercase by clearing the 0x20 bit. to find
+// them we shift the bytes so that 'a' lands on -128 (the smallest signed
+// byte), then "smaller than -128 + 26" is exactly the 26 letters
+__attribute__((target("avx2")))
+static void flipCaseRangeAvx2(unsigned char *out, const unsigned char *in, size_t n, char first,
+	const unsigned char *table) {
+	const __m256i shift = _mm256_set1_epi8((char) (0x80 - first));
+	const __m256i limit = _mm256_set1_epi8((char) (-128 + 26));
+	const __m256i caseBit = _mm256_set1_epi8(0x20);
+	size_t i = 0;
+	for(; i + 32 <= n; i += 32) {
+		__m256i bytes = _mm256_loadu_si256((const __m256i *) (in + i));
+		__m256i letters = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(bytes, shift));
+		_mm256_storeu_si256((__m256i *) (out + i), _mm256_xor_si256(bytes, _mm256_and_si256(letters, caseBit)));
+	}
+	for(; i < n; i++) {
+		out[i] = table[in[i]];
+	}
+}
+
+__attribute__((target("avx2")))
+static void upperBytesAvx2(unsigned char *out, const unsigned char *in, size_t n) {
+	flipCaseRangeAvx2(out, in, n, 'a', upperTable);
+}
+
+__attribute__((target("avx2")))
+static void lowerBytesAvx2(unsigned char *out, const unsigned char *in, size_t n) {
+	flipCaseRangeAvx2(out, in, n, 'A', lowerTable);
+}
+
+#endif
+
+struct ctypeKernels {
+	const char *name;
+	size_t (*countClass)(const unsigned char *in, size_t n, enum ctypeClass bit);
+	void (*classBitmap)(const unsigned char *in, size_t n, enum ctypeClass bit, uint64_t *bitmap);
+	void (*upperBytes)(unsigned char *out, const unsigned char *in, size_t n);
+	void (*lowerBytes)(unsigned char *out, const unsigned char *in, size_t n);
+};
+
+static const struct ctypeKernels ctypeKernelSets[] = {
+	{"table", countClassTable, classBitmapTable, upperBytesTable, lowerBytesTable},
+#if defined(__x86_64__) || defined(__i386__)
+	{"avx2", countClassAvx2, classBitmapAvx2, upperBytesAvx2, lowerBytesAvx2},
+#endif
+};
+#define CTYPE_KERNEL_SETS (sizeof(ctypeKernelSets) / sizeof(ctypeKernelSets[0]))
+
+static bool ctypeKernelsSupported(const struct ctypeKernels *set) {
+#if defined(__x86_64__) || defined(__i386__)
+	if(strcmp(set->name, "avx2") == 0) {
+		return __builtin_cpu_supports("avx2");
+	}
+#endif
+	return true;
+}
+
+// some text that looks like a log file, to test and benchmark with
+static void fillWithLogText(unsigned char *buffer, size_t n, unsigned seed) {
+	static const char *words[] = {"GET", "/api/v2/users", "200", "0.0137s", "ERROR", "timeout",
+		"user_id=8812", "[2024-05-01T12:00:03Z]", "ok", "retry#3", "0xDEADBEEF", "\t", "\n", "Ünïcode"};
+	size_t i = 0;
+	while(i < n) {
+		seed = seed * 1103515245u + 12345u;
+		const char *word = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+		for(size_t k = 0; word[k] != '\0' && i < n; k++) {
+			buffer[i++] = (unsigned char) word[k];
+		}
+		if(i < n) {
+			buffer[i++] = ' ';
+		}
+	}
+}
+
+// checks the tables against the ctype.h functions for all 256 bytes, and
+// every bulk kernel against a plain per-char loop. the ctype.h functions
+// follow the current locale, so they are switched to "C" while we check.
+// returns how many results were wrong
+static size_t ctypeKernelsDifferentialTest() {
+	ctypeTablesInit();
+	char *previous = strdup(setlocale(LC_CTYPE, NULL));
+	setlocale(LC_CTYPE, "C");
+
+	size_t failures = 0;
+	for(int c = 0; c < 256; c++) {
+		for(int k = 0; k < CTYPE_CLASSES; k++) {
+			bool expected = ctypeClasses[k].check(c) != 0;
+			failures += expected != ((ctypeTable[c] & ctypeClasses[k].bit) != 0);
+			failures += expected != ((nibbleLow[k][c & 15] & nibbleHigh[k][c >> 4]) != 0);
+		}
+		failures += upperTable[c] != toupper(c);
+		failures += lowerTable[c] != tolower(c);
+	}
+
+	size_t n = 4099; // not a multiple of 32 or 64, so the tails get tested too
+	unsigned char *text = malloc(n);
+	unsigned char *converted = malloc(n);
+	uint64_t *bitmap = malloc((n + 63) / 64 * sizeof(uint64_t));
+	uint16_t *masks = malloc(n * sizeof(uint16_t));
+	if(text == NULL || converted == NULL || bitmap == NULL || masks == NULL) {
+		failures++;
+	} else {
+		fillWithLogText(text, n, 42);
+		for(size_t i = 0; i < 256; i++) {
+			text[i * 13 % n] = (unsigned char) i; // every byte value shows up
+		}
+		classifyBytes(text, n, masks);
+		for(size_t i = 0; i < n; i++) {
+			for(int k = 0; k < CTYPE_CLASSES; k++) {
+				failures += ((masks[i] & ctypeClasses[k].bit) != 0) != (ctypeClasses[k].check(text[i]) != 0);
+			}
+		}
+		for(size_t set = 0; set < CTYPE_KERNEL_SETS; set++) {
+			const struct ctypeKernels *kernels = &ctypeKernelSets[set];
+			if(!ctypeKernelsSupported(kernels)) {
+				continue;
+			}
+			for(int k = 0; k < CTYPE_CLASSES; k++) {
+				size_t expected = 0;
+				for(size_t i = 0; i < n; i++) {
+					expected += ctypeClasses[k].check(text[i]) != 0;
+				}
+				failures += kernels->countClass(text, n, ctypeClasses[k].bit) != expected;
+				kernels->classBitmap(text, n, ctypeClasses[k].bit, bitmap);
+				for(size_t i = 0; i < n; i++) {
+					bool inClass = bitmap[i / 64] >> (i % 64) & 1;
+					failures += inClass != (ctypeClasses[k].check(text[i]) != 0);
+				}
+			}
+			kernels->upperBytes(converted, text, n);
+			for(size_t i = 0; i < n; i++) {
+				failures += converted[i] != toupper(text[i]);
+			}
+			kernels->lowerBytes(converted, text, n);
+			for(size_t i = 0; i < n; i++) {
+				failures += converted[i] != tolower(text[i]);
+			}
+		}
+	}
+	free(text);
+	free(converted);
+	free(bitmap);
+	free(masks);
+
+	setlocale(LC_CTYPE, previous);
+	free(previous);
+	return failures;
+}
+
+
+
+void testCtypeH() {
+	char A = 'A';
+	char num1 = '1';
+	char dot = '.';
+	char space = ' ';
+
+	// isalnum() checks if the char is alpha-numeric
+	printf("\n\n%c is %salphanumeric\n", dot, isalnum(dot) ? "" : "not ");
+	// isalpha() checks if the char is in the alphabet
+	printf("%c is %sin the alphabet\n", A, isalpha(A) ? "" : "not ");
+	// islower() checks if the char is lowercase
+	printf("%c is %slowercase\n", A, islower(A) ? "" : "not ");
+	// isupper() checks if the char is uppercase
+	printf("%c is %suppercase\n", A, isupper(A) ? "" : "not ");
+	// isdigit() checks if the char is a digit
+	printf("%c is %sa digit\n", num1, isdigit(num1) ? "" : "not ");
+	// isxdigit() checks if the char is a hex digit
+	printf("%c is %sa hex digit\n", A, isxdigit(A) ? "" : "not ");
+	// iscntrl() checks if the char is a control character
+	printf("space is %sa control character\n", iscntrl(space) ? "" : "not ");
+	// isgraph() checks if the char has a graphical representation
+	printf("%c has %sa graphical representation\n", num1, isgraph(num1) ? "" : "not ");
+	// isspace() checks if the char is the space char
+	printf("%c is %sthe space character\n", dot, isspace(dot) ? "" : "not ");
+	// isblank() checks if the char is the space or tab char
+	printf("space is %sa blank character\n", isblank(space) ? "" : "not ");
+	// isprint() checks if the char is printable
+	printf("%c is %sprintable\n", A, isprint(A) ? "" : "not ");
+	// ispunct() checks if the char is a punctuation
+	printf("%c is %sa punctuation\n", dot, ispunct(dot) ? "" : "not ");
+
+	char lowercaseD = 'd';
+	char uppercaseD = 'D';
+
+	// you can change a lowercase char to uppercase and vice-versa
+	printf("\nto lowercase: %c\n", tolower(uppercaseD));
+	printf("to uppercase: %c\n", toupper(lowercaseD));
+
+	// calling these once per char is fine for a demo, but for a whole buffer
+	// the bulk functions above do the same work many bytes at a time
+	const char *line = "GET /index.html 200 0.013s";
+	uint64_t bitmap[1];
+	unsigned char shouting[32];
+	ctypeTablesInit();
+	const struct ctypeKernels *kernels = &ctypeKernelSets[0];
+	kernels->classBitmap((const unsigned char *) line, strlen(line), CTYPE_DIGIT, bitmap);
+	kernels->upperBytes(shouting, (const unsigned char *) line, strlen(line) + 1);
+	printf("\n\"%s\" has %zu digits, the first at index %d\n", line,
+		kernels->countClass((const unsigned char *) line, strlen(line), CTYPE_DIGIT), __builtin_ctzll(bitmap[0]));
+	printf("in uppercase: %s\n", shouting);
+
+	size_t failures = ctypeKernelsDifferentialTest();
+	printf("bulk classification against ctype.h: %s (%zu wrong results)\n", failures ? "FAILED" : "passed", failures);
+}
+
+
+
+// the way tokenizers usually do it: one isalnum() call per byte
+__attribute__((noinline))
+static size_t countAlnumLoop(const unsigned char *in, size_t n) {
+	size_t count = 0;
+	for(size_t i = 0; i < n; i++) {
+		count += isalnum(in[i]) != 0;
+	}
+	return count;
+}
+
+__attribute__((noinline))
+static void upperLoop(unsigned char *out, const unsigned char *in, size_t n) {
+	for(size_t i = 0; i < n; i++) {
+		out[i] = (unsigned char) toupper(in[i]);
+	}
+}
+
+void benchCtypeH() {
+	// bytes per cycle of the per-char ctype.h loops against the bulk kernels,
+	// on 1 MiB of log-like text (so it all fits in the L2/L3 cache)
+	size_t n = 1 << 20;
+	int repeats = 20;
+	unsigned char *text = malloc(n);
+	unsigned char *converted = malloc(n);
+	uint64_t *bitmap = malloc(n / 64 * sizeof(uint64_t));
+	if(text == NULL || converted == NULL || bitmap == NULL) {
+		printf("couldn't allocate the buffers\n");
+		free(text);
+		free(converted);
+		free(bitmap);
+		return;
+	}
+	fillWithLogText(text, n, 7);
+	ctypeTablesInit();
+
+	printf("%-26s %14s %8s\n", "", "bytes/cycle", "GB/s");
+	// every measurement is the best of a few runs, both in TSC ticks and in ns
+	void report(const char *name, uint64_t cycles, uint64_t nanoseconds) {
+		printf("%-26s %14.2f %8.2f\n", name, (double) n / cycles, (double) n / nanoseconds);
+	}
+	#define CTYPE_MEASURE(name, code) do { \
+		uint64_t bestCycles = UINT64_MAX, bestNs = UINT64_MAX; \
+		for(int r = 0; r < repeats; r++) { \
+			uint64_t startNs = monotonicNs(); \
+			uint64_t startCycles = cycleCounter(); \
+			code; \
+			uint64_t cycles = cycleCounter() - startCycles; \
+			uint64_t ns = monotonicNs() - startNs; \
+			bestCycles = cycles < bestCycles ? cycles : bestCycles; \
+			bestNs = ns < bestNs ? ns : bestNs; \
+		} \
+		report(name, bestCycles, bestNs); \
+	} while(0)
+
+	CTYPE_MEASURE("isalnum() loop, count", benchKeep(countAlnumLoop(text, n)));
+	for(size_t set = 0; set < CTYPE_KERNEL_SETS; set++) {
+		const struct ctypeKernels *kernels = &ctypeKernelSets[set];
+		if(ctypeKernelsSupported(kernels)) {
+			char name[64];
+			snprintf(name, sizeof(name), "%s, count alnum", kernels->name);
+			CTYPE_MEASURE(name, benchKeep(kernels->countClass(text, n, CTYPE_ALNUM)));
+			snprintf(name, sizeof(name), "%s, alnum bitmap", kernels->name);
+			CTYPE_MEASURE(name, kernels->classBitmap(text, n, CTYPE_ALNUM, bitmap); benchKeep(bitmap));
+		}
+	}
+	uint16_t *masks = malloc(n * sizeof(uint16_t));
+	if(masks != NULL) {
+		CTYPE_MEASURE("table, every class at once", classifyBytes(text, n, masks); benchKeep(masks));
+		free(masks);
+	}
+
+	printf("\n");
+	CTYPE_MEASURE("toupper() loop", upperLoop(converted, text, n); benchKeep(converted));
+	for(size_t set = 0; set < CTYPE_KERNEL_SETS; set++) {
+		const struct ctypeKernels *kernels = &ctypeKernelSets[set];
+		if(ctypeKernelsSupported(kernels)) {
+			char name[64];
+			snprintf(name, sizeof(name), "%s, to uppercase", kernels->name);
+			CTYPE_MEASURE(name, kernels->upperBytes(converted, text, n); benchKeep(converted));
+		}
+	}
+	#undef CTYPE_MEASURE
+
+	free(text);
+	free(converted);
+	free(bitmap);
+}
+
+
+
+void testErrnoH() {
+	// this header defines 3 error code macros, each begining with the letter E
+	int i = EDOM; // domain error
+	int j = EILSEQ; // illegal byte sequence error
+	int k = ERANGE; // range error
+
+	printf("\n\nEDOM == %d\n", i);
+	printf("EILSEQ == %d\n", j);
+	printf("ERANGE == %d\n", k);
+
+	// and also defines a thread-local preprocessor macro that
+	// becomes a modifiable variable
+	errno = 0;
+
+	// lets create a function that simulates what could happen if you
+	// tried to do some math that should give an error
+	void doSomeIllegalMath(int x) {
+		if(x != 0) {
+			printf("your result is %d\n", 727 / x);
+		} else {
+			errno = EDOM;
+			printf("pls dont divide by 0\n");
+		}
+	}
+	
+	doSomeIllegalMath(0);
+
+	// this function belongs to the stdio header, but its output
+	// depends on the value of errno
+	perror("current error");
+}
+
+
+
+// FAST FP REGIONS AND WHAT THE FP ENVIRONMENT COSTS
+// numbers smaller than DBL_MIN (or FLT_MIN) are "subnormal": they lose
+// precision little by little instead of dropping straight to 0. x86 CPUs
+// handle them in microcode, and an instruction that reads or produces one
+// can take ~100 cycles instead of ~4. the SSE control register (MXCSR) has
+// two bits that skip that: FTZ (flush to zero) turns subnormal results into
+// 0, and DAZ (denormals are zero) reads subnormal inputs as 0. they break the
+// IEEE rules, so they should only be on while a kernel that's ok with that runs
+
+#define FP_FLUSH_TO_ZERO 1
+#define FP_DENORMALS_ARE_ZERO 2
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MXCSR_FTZ 0x8000
+#define MXCSR_DAZ 0x0040
+#endif
+
+// everything needed to put the FP environment back as it was
+struct fpRegion {
+	fenv_t saved;
+	unsigned mxcsr;
+};
+
+// saves the environment, clears the exception flags, and turns on FTZ
+// and/or DAZ. rounding stays as it was
+static struct fpRegion fpRegionEnter(int modes) {
+	struct fpRegion region;
+	feholdexcept(&region.saved);
+#if defined(__x86_64__) || defined(__i386__)
+	region.mxcsr = _mm_getcsr();
+	unsigned mxcsr = region.mxcsr & ~(MXCSR_FTZ | MXCSR_DAZ);
+	mxcsr |= modes & FP_FLUSH_TO_ZERO ? MXCSR_FTZ : 0;
+	mxcsr |= modes & FP_DENORMALS_ARE_ZERO ? MXCSR_DAZ : 0;
+	_mm_setcsr(mxcsr);
+#else
+	region.mxcsr = 0;
+	(void) modes; // (other CPUs have their own version of these bits)
+#endif
+	return region;
+}
+
+// puts everything back, but the exception flags raised inside the region
+// stay raised (that's what feupdateenv() does, fesetenv() would lose them).
+// so only the control bits of MXCSR come back from the copy, the low 6 bits
+// are the flags raised so far and feupdateenv() still has to see them
+static void fpRegionLeave(struct fpRegion *region) {
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_setcsr((region->mxcsr & ~0x3Fu) | (_mm_getcsr() & 0x3Fu));
+#endif
+	feupdateenv(&region->saved);
+}
+
+// with GCC's cleanup attribute the region ends by itself when the variable
+// goes out of scope, even if we return from the middle of the block:
+//   { FAST_FP_REGION(fast, FP_FLUSH_TO_ZERO); ...kernel... }
+#define FAST_FP_REGION(name, modes) struct fpRegion name __attribute__((cleanup(fpRegionLeave))) = fpRegionEnter(modes)
+
+static bool fpModesSupported() {
+#if defined(__x86_64__) || defined(__i386__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+// fills "values" so that about "fraction" of them are subnormal and the
+// rest are normal numbers close to 1
+static void fillWithSubnormals(double *values, size_t n, double fraction, unsigned seed) {
+	for(size_t i = 0; i < n; i++) {
+		seed = seed * 1103515245u + 12345u;
+		double uniform = (double) (seed >> 8) / (1 << 24);
+		seed = seed * 1103515245u + 12345u;
+		double mantissa = 0.5 + (double) (seed >> 8) / (1 << 25);
+		values[i] = uniform < fraction ? DBL_MIN * mantissa : mantissa;
+	}
+}
+
+static double subnormalFraction(const double *values, size_t n) {
+	size_t count = 0;
+	for(size_t i = 0; i < n; i++) {
+		count += fpclassify(values[i]) == FP_SUBNORMAL;
+	}
+	return n > 0 ? (double) count / n : 0;
+}
+
+// the kernels: "scale" multiplies every value (a subnormal in gives a
+// subnormal out), "decay" is a filter whose state fades away towards 0,
+// the classic way audio code ends up full of subnormals
+static void fpScaleKernel(double *out, const double *in, size_t n) {
+	for(size_t i = 0; i < n; i++) {
+		out[i] = in[i] * 0.75 + in[i] * 0.125;
+	}
+}
+
+static void fpDecayKernel(double *out, const double *in, size_t n) {
+	double state = 0;
+	for(size_t i = 0; i < n; i++) {
+		state = state * 0.5 + in[i] * 0.25;
+		out[i] = state;
+	}
+}
+
+
+
+void testFenvH() {
+	// this header has a lot that begin with FE_
+	// and a lot of functions that begin with fe
+
+	// the whole floating point environment (rounding mode, exception flags...)
+	// can be saved in a fenv_t, we'll put it back at the end
+	fenv_t original;
+	fegetenv(&original);
+
+	// these macros are flags that indicate whether or not
+	// their exceptions have occured.
+	// each one is a different power of 2 (except FE_ALL_EXCEPT)
+	printf("FE_INVALID = \n\n%d\n", FE_INVALID);
+	printf("FE_DIVBYZERO = %d\n", FE_DIVBYZERO);
+	printf("FE_OVERFLOW = %d\n", FE_OVERFLOW);
+	printf("FE_UNDERFLOW = %d\n", FE_UNDERFLOW);
+	printf("FE_INEXACT = %d\n", FE_INEXACT);
+	printf("FE_ALL_EXCEPT = %d\n", FE_ALL_EXCEPT);
+
+	// lets clear our flags before we start experimenting
+	feclearexcept(FE_ALL_EXCEPT);
+
+	// and now lets check if our exceptions are cleared with fetestexcept()
+	printf("\n%s\n", fetestexcept(FE_ALL_EXCEPT) ? "NOT CLEARED\n" : "CLEARED\n");
+
+	// now do a lot of illegal math to activate some exception flags
+	printf("doing bad math\n");
+	double i = 1.0 / 0.0; // raising the FE_DIVBYZERO flag
+	double k = DBL_MAX * 10.0; // raising the FE_OVERFLOW flag
+	double j = 0.1 / 100000.0; // raising the FE_INEXACT flag
+
+	// and check again for each exception:
+	printf("%s", fetestexcept(FE_INVALID) ? "\nINVALID flag is up\n" : "");
+	printf("%s", fetestexcept(FE_DIVBYZERO) ? "DIVBYZERO flag is up\n" : "");
+	printf("%s", fetestexcept(FE_OVERFLOW) ? "OVERFLOW flag is up\n" : "");
+	printf("%s", fetestexcept(FE_UNDERFLOW) ? "UNDERFLOW flag is up\n" : "");
+	printf("%s", fetestexcept(FE_INEXACT) ? "INEXACT flag is up\n" : "");
+
+	/* you can also choose the rounding method your program
+	/  will use to one of these four:
+	/  - FE_TONEAREST
+	/  - FE_TOWARDZERO
+	/  - FE_UPWARD
+	/  - FE_DOWNWARD
+	/  lets see how each one acts                        */
+
+	float roundingNightmare = 1.5;
+	fesetround(FE_TONEAREST);
+	printf("\n1.5 to nearest: %.1f\n", rint(roundingNightmare));
+	fesetround(FE_TOWARDZERO);
+	printf("1.5 towards zero: %.1f\n", rint(roundingNightmare));
+	fesetround(FE_UPWARD);
+	printf("1.5 upwards: %.1f\n", rint(roundingNightmare));
+	fesetround(FE_DOWNWARD);
+	printf("1.5 downwards: %.1f\n", rint(roundingNightmare));
+
+	// there's more to see in this header, but its too niche for my taste
+
+	// a subnormal number, and the same division inside a fast FP region
+	volatile double tiny = DBL_MIN;
+	double smaller = tiny / 4;
+	printf("\nDBL_MIN / 4 = %g (%s)\n", smaller, fpclassify(smaller) == FP_SUBNORMAL ? "subnormal" : "normal");
+	if(fpModesSupported()) {
+		FAST_FP_REGION(fast, FP_FLUSH_TO_ZERO | FP_DENORMALS_ARE_ZERO);
+		double flushed = tiny / 4;
+		printf("with FTZ and DAZ on it's %g\n", flushed);
+	}
+	printf("and after the region it's %g again\n", tiny / 4);
+
+	// put the whole environment (rounding included) back the way we found it,
+	// or every test that runs after this one would be rounding downwards
+	fesetenv(&original);
+}
+
+
+
+void benchFenvH() {
+	// part 1: ns per element of the kernels above over inputs with more and
+	// more subnormals, with the IEEE behavior and with FTZ and/or DAZ on
+	size_t n = 1 << 16;
+	int repeats = 50;
+	double *in = malloc(n * sizeof(double));
+	double *out = malloc(n * sizeof(double));
+	if(in == NULL || out == NULL) {
+		printf("couldn't allocate the buffers\n");
+		free(in);
+		free(out);
+		return;
+	}
+	const double fractions[] = {0, 0.01, 0.1, 0.5, 1};
+	const int modes[] = {0, FP_FLUSH_TO_ZERO, FP_DENORMALS_ARE_ZERO, FP_FLUSH_TO_ZERO | FP_DENORMALS_ARE_ZERO};
+	int modeCount = fpModesSupported() ? 4 : 1;
+	struct {
+		const char *name;
+		void (*kernel)(double *out, const double *in, size_t n);
+	} kernels[] = {{"scale", fpScaleKernel}, {"decay", fpDecayKernel}};
+
+	// the best of a few runs, in ns per element
+	double perElement(void (*kernel)(double *, const double *, size_t), int mode) {
+		uint64_t best = UINT64_MAX;
+		for(int r = 0; r < repeats; r++) {
+			FAST_FP_REGION(region, mode);
+			uint64_t start = monotonicNs();
+			kernel(out, in, n);
+			benchKeep(out);
+			uint64_t ns = monotonicNs() - start;
+			best = ns < best ? ns : best;
+		}
+		return (double) best / n;
+	}
+
+	printf("%-6s %13s %14s %9s %9s %9s %9s %10s\n", "kernel", "subnormal in", "subnormal out", "IEEE", "FTZ", "DAZ", "FTZ+DAZ", "slowdown");
+	for(size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+		double baseline = 0;
+		for(size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); f++) {
+			fillWithSubnormals(in, n, fractions[f], 11);
+			kernels[k].kernel(out, in, n);
+			printf("%-6s %12.1f%% %13.1f%%", kernels[k].name, 100 * subnormalFraction(in, n), 100 * subnormalFraction(out, n));
+			double ieee = 0;
+			for(int m = 0; m < 4; m++) {
+				if(m < modeCount) {
+					double ns = perElement(kernels[k].kernel, modes[m]);
+					ieee = m == 0 ? ns : ieee;
+					printf(" %9.3f", ns);
+				} else {
+					printf(" %9s", "-");
+				}
+			}
+			baseline = f == 0 ? ieee : baseline;
+			printf(" %9.1fx\n", ieee / baseline);
+		}
+	}
+	printf("(ns per element, the slowdown is IEEE against no subnormals at all)\n\n");
+
+	// part 2: what the fenv.h calls cost when they end up inside a hot loop.
+	// reading the flags or the rounding mode only copies a register, but
+	// writing the control registers makes the CPU wait for every FP
+	// instruction in flight to finish
+	fillWithSubnormals(in, n, 0, 13);
+	fenv_t original;
+	fegetenv(&original);
+	double baseline = 0;
+	#define FENV_MEASURE(name, code) do { \
+		uint64_t best = UINT64_MAX; \
+		for(int r = 0; r < 10; r++) { \
+			double sum = 0; \
+			int sink = 0; \
+			uint64_t start = monotonicNs(); \
+			for(size_t i = 0; i < n; i++) { \
+				sum += in[i] * 1.0001; \
+				code; \
+			} \
+			uint64_t ns = monotonicNs() - start; \
+			benchKeep(sum); \
+			benchKeep(sink); \
+			best = ns < best ? ns : best; \
+		} \
+		double perIteration = (double) best / n; \
+		baseline = baseline == 0 ? perIteration : baseline; \
+		printf("%-42s %8.2f ns %+8.2f ns\n", name, perIteration, perIteration - baseline); \
+	} while(0)
+	printf("%-42s %11s %11s\n", "every iteration does", "per loop", "extra");
+	FENV_MEASURE("nothing", (void) 0);
+	FENV_MEASURE("fetestexcept(FE_INEXACT)", sink += fetestexcept(FE_INEXACT));
+	FENV_MEASURE("fegetround()", sink += fegetround());
+	FENV_MEASURE("feclearexcept(FE_ALL_EXCEPT)", sink += feclearexcept(FE_ALL_EXCEPT));
+	FENV_MEASURE("fesetround(FE_TONEAREST) (no change)", sink += fesetround(FE_TONEAREST));
+	FENV_MEASURE("fesetround() alternating 2 modes", sink += fesetround(i & 1 ? FE_TOWARDZERO : FE_TONEAREST));
+	FENV_MEASURE("fast FP region around the iteration", { FAST_FP_REGION(region, FP_FLUSH_TO_ZERO); sink++; });
+	#undef FENV_MEASURE
+	fesetenv(&original);
+
+	free(in);
+	free(out);
+}
+
+
+
+// SHORTEST ROUND-TRIP FLOATS
+// printf("%.17g") always writes 17 digits, so 0.1 comes out as
+// 0.10000000000000001, and plain "%g" keeps 6 and loses information. what
+// JSON (and anything else that saves numbers as text) wants is the shortest
+// text that still reads back as the very same double: "0.1".
+// the formatter is Schubfach (Raffaello Giulietti's algorithm): every double
+// sits in the middle of an interval of real numbers that round to it, and
+// one 128 bit multiplication by a power of 10 scales that interval so the
+// shortest number inside it falls out of a couple of divisions by 10.
+// the parser goes the other way with the Eisel-Lemire algorithm: the digits
+// (up to 19 of them) times the same 128 bit power of 10 tell the right double
+// straight away almost every time, and the few cases it can't decide go to
+// strtod(), which is slow but always right
+
+// the first 128 bits of 10^e (rounded down), for every e in this range,
+// which covers every double and every decimal exponent worth reading
+#define POW10_MIN_EXPONENT -342
+#define POW10_MAX_EXPONENT 324
+static unsigned __int128 powersOf10Bits[POW10_MAX_EXPONENT - POW10_MIN_EXPONENT + 1];
+
+// other libraries paste those 667 numbers as a huge table, here they are
+// computed once with some very simple big integers (arrays of 32 bit
+// "limbs", 10^342 is 1137 bits long). call this before anything below
+#define BIG_LIMBS 40
+static void floatConversionsInit() {
+	uint32_t power[BIG_LIMBS] = {1}; // 10^n
+	uint32_t remainder[BIG_LIMBS];
+	int bitLength(const uint32_t *big) {
+		for(int i = BIG_LIMBS - 1; i >= 0; i--) {
+			if(big[i] != 0) {
+				return 32 * i + 32 - __builtin_clz(big[i]);
+			}
+		}
+		return 0;
+	}
+	unsigned bit(const uint32_t *big, int i) {
+		return i < 0 ? 0 : (big[i / 32] >> (i % 32)) & 1;
+	}
+	bool atLeast(const uint32_t *a, const uint32_t *b) {
+		for(int i = BIG_LIMBS - 1; i >= 0; i--) {
+			if(a[i] != b[i]) {
+				return a[i] > b[i];
+			}
+		}
+		return true;
+	}
+
+	for(int n = 0; n <= -POW10_MIN_EXPONENT; n++) {
+		int length = bitLength(power);
+		if(n <= POW10_MAX_EXPONENT) {
+			// 10^n is an integer, so its top 128 bits are the answer
+			unsigned __int128 bits = 0;
+			for(int i = 0; i < 128; i++) {
+				bits = (bits << 1) | bit(power, length - 1 - i);
+			}
+			powersOf10Bits[n - POW10_MIN_EXPONENT] = bits;
+		}
+		if(n > 0) {
+			// 10^-n is 2^(length + 127) / 10^n shifted, so that's a long
+			// division, one bit at a time. 2^(length - 1) < 10^n, so only
+			// the last 128 bits of the quotient aren't zeros
+			memset(remainder, 0, sizeof(remainder));
+			remainder[(length - 1) / 32] = 1u << ((length - 1) % 32);
+			unsigned __int128 bits = 0;
+			for(int i = 0; i < 128; i++) {
+				for(int l = BIG_LIMBS - 1; l > 0; l--) {
+					remainder[l] = (remainder[l] << 1) | (remainder[l - 1] >> 31);
+				}
+				remainder[0] <<= 1;
+				bits <<= 1;
+				if(atLeast(remainder, power)) {
+					uint64_t borrow = 0;
+					for(int l = 0; l < BIG_LIMBS; l++) {
+						uint64_t difference = (uint64_t) remainder[l] - power[l] - borrow;
+						remainder[l] = (uint32_t) difference;
+						borrow = difference >> 63;
+					}
+					bits |= 1;
+				}
+			}
+			powersOf10Bits[-n - POW10_MIN_EXPONENT] = bits;
+		}
+		uint64_t carry = 0;
+		for(int l = 0; l < BIG_LIMBS; l++) {
+			uint64_t product = (uint64_t) power[l] * 10 + carry;
+			power[l] = (uint32_t) product;
+			carry = product >> 32;
+		}
+	}
+}
+
+// a double written as digits * 10^exponent
+struct decimalFloat {
+	uint64_t digits;
+	int exponent;
+};
+
+// floor(log2(10^e)), exact for every exponent used here
+static int floorLog2Pow10(int e) {
+	return (e * 1741647) >> 19;
+}
+
+// the top bits of g * x / 2^128 (or / 2^64 for floats), with the lowest bit
+// set if anything but zeros was cut off. rounding to odd like that keeps
+// the comparisons against the interval ends exact
+static uint64_t roundToOdd64(unsigned __int128 g, uint64_t x) {
+	unsigned __int128 low = (unsigned __int128) (uint64_t) g * x;
+	unsigned __int128 high = (unsigned __int128) (uint64_t) (g >> 64) * x + (uint64_t) (low >> 64);
+	return (uint64_t) (high >> 64) | ((uint64_t) high > 1);
+}
+
+static uint32_t roundToOdd32(uint64_t g, uint32_t x) {
+	unsigned __int128 product = (unsigned __int128) g * x;
+	return (uint32_t) (product >> 64) | ((uint32_t) (product >> 32) > 1);
+}
+
+// Schubfach itself. "c" is the significand and "q" the binary exponent, and
+// everything is multiplied by 4 so that the interval ends (c - 1/2 and
+// c + 1/2, or c - 1/4 below a power of 2) are integers too. then the
+// interval is scaled by 10^-k, where k is chosen so that it holds only a
+// few integers, and it's just a matter of trying the one that ends in 0
+// (one digit less) and then the closest one
+#define SCHUBFACH(type, roundToOdd, g, c, q, fraction, biasedExponent) ({ \
+	bool even = c % 2 == 0; \
+	bool closerBelow = fraction == 0 && biasedExponent > 1; \
+	int k = (q * 1262611 - (closerBelow ? 524031 : 0)) >> 22; \
+	int h = q + floorLog2Pow10(-k) + 1; \
+	g; \
+	type lower = roundToOdd(g, (4 * c - 2 + closerBelow) << h) + !even; \
+	type middle = roundToOdd(g, (4 * c) << h); \
+	type upper = roundToOdd(g, (4 * c + 2) << h) - !even; \
+	type s = middle / 4; \
+	struct decimalFloat result = {0, 0}; \
+	bool done = false; \
+	if(s >= 10) { \
+		type shorter = s / 10; \
+		bool belowInside = lower <= 40 * shorter; \
+		bool aboveInside = 40 * shorter + 40 <= upper; \
+		if(belowInside != aboveInside) { \
+			result = (struct decimalFloat) {shorter + aboveInside, k + 1}; \
+			done = true; \
+		} \
+	} \
+	if(!done) { \
+		bool belowInside = lower <= 4 * s; \
+		bool aboveInside = 4 * s + 4 <= upper; \
+		if(belowInside != aboveInside) { \
+			result = (struct decimalFloat) {s + aboveInside, k}; \
+		} else { \
+			bool roundUp = middle > 4 * s + 2 || (middle == 4 * s + 2 && (s & 1) != 0); \
+			result = (struct decimalFloat) {s + roundUp, k}; \
+		} \
+	} \
+	result; \
+})
+
+static struct decimalFloat shortestDouble(uint64_t fraction, int biasedExponent) {
+	uint64_t c = biasedExponent != 0 ? fraction | (1ull << 52) : fraction;
+	int q = (biasedExponent != 0 ? biasedExponent : 1) - 1075;
+	unsigned __int128 g;
+	return SCHUBFACH(uint64_t, roundToOdd64, g = powersOf10Bits[-k - POW10_MIN_EXPONENT] + 1, c, q, fraction, biasedExponent);
+}
+
+static struct decimalFloat shortestFloat(uint32_t fraction, int biasedExponent) {
+	uint32_t c = biasedExponent != 0 ? fraction | (1u << 23) : fraction;
+	int q = (biasedExponent != 0 ? biasedExponent : 1) - 150;
+	uint64_t g;
+	return SCHUBFACH(uint32_t, roundToOdd32, g = (uint64_t) (powersOf10Bits[-k - POW10_MIN_EXPONENT] >> 64) + 1, c, q, fraction, biasedExponent);
+}
+
+// formatU64() is in the integer section, further down
+static size_t formatU64(char *out, uint64_t value);
+
+// writes the number the way JavaScript (and so JSON.stringify()) does: plain
+// digits from 1e-6 up to 1e21 and scientific notation outside of that
+#define FLOAT_TEXT_SIZE 32
+static size_t writeDecimalFloat(char *out, bool negative, struct decimalFloat decimal) {
+	char *p = out;
+	if(negative) {
+		*p++ = '-';
+	}
+	while(decimal.digits % 10 == 0) {
+		decimal.digits /= 10;
+		decimal.exponent++;
+	}
+	char digits[24];
+	int length = (int) formatU64(digits, decimal.digits);
+	int point = length + decimal.exponent; // where the decimal point goes, counting from the first digit
+	if(point >= length && point <= 21) {
+		memcpy(p, digits, length);
+		memset(p + length, '0', point - length);
+		p += point;
+	} else if(point > 0 && point <= 21) {
+		memcpy(p, digits, point);
+		p[point] = '.';
+		memcpy(p + point + 1, digits + point, length - point);
+		p += length + 1;
+	} else if(point > -6 && point <= 0) {
+		p[0] = '0';
+		p[1] = '.';
+		memset(p + 2, '0', -point);
+		memcpy(p + 2 - point, digits, length);
+		p += 2 - point + length;
+	} else {
+		*p++ = digits[0];
+		if(length > 1) {
+			*p++ = '.';
+			memcpy(p, digits + 1, length - 1);
+			p += length - 1;
+		}
+		*p++ = 'e';
+		*p++ = point - 1 < 0 ? '-' : '+';
+		p += formatU64(p, (uint64_t) abs(point - 1));
+	}
+	*p = '\0';
+	return (size_t) (p - out);
+}
+
+// both write the shortest text that reads back as x into "out" (which needs
+// FLOAT_TEXT_SIZE chars) and return its length
+static size_t formatDoubleShortest(char *out, double x) {
+	uint64_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	bool negative = bits >> 63;
+	uint64_t fraction = bits & ((1ull << 52) - 1);
+	int biasedExponent = (int) (bits >> 52) & 0x7FF;
+	if(biasedExponent == 0x7FF) {
+		strcpy(out, fraction != 0 ? "nan" : negative ? "-inf" : "inf");
+		return strlen(out);
+	}
+	if(biasedExponent == 0 && fraction == 0) {
+		strcpy(out, negative ? "-0" : "0");
+		return strlen(out);
+	}
+	return writeDecimalFloat(out, negative, shortestDouble(fraction, biasedExponent));
+}
+
+static size_t formatFloatShortest(char *out, float x) {
+	uint32_t bits;
+	memcpy(&bits, &x, sizeof(bits));
+	bool negative = bits >> 31;
+	uint32_t fraction = bits & ((1u << 23) - 1);
+	int biasedExponent = (int) (bits >> 23) & 0xFF;
+	if(biasedExponent == 0xFF) {
+		strcpy(out, fraction != 0 ? "nan" : negative ? "-inf" : "inf");
+		return strlen(out);
+	}
+	if(biasedExponent == 0 && fraction == 0) {
+		strcpy(out, negative ? "-0" : "0");
+		return strlen(out);
+	}
+	return writeDecimalFloat(out, negative, shortestFloat(fraction, biasedExponent));
+}
+
+// reads [+-]digits[.digits][(e|E)[+-]digits] into digits * 10^exponent. it
+// says no to anything else (spaces, hex floats, "inf", "nan"...) and to
+// more than 19 significant digits, and strtod() takes over
+static bool scanDecimalFloat(const char *text, bool *negative, struct decimalFloat *decimal, const char **end) {
+	const char *p = text;
+	*negative = *p == '-';
+	p += *p == '-' || *p == '+';
+	if(p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		return false; // hexadecimal, like 0x1p-3
+	}
+	uint64_t digits = 0;
+	int count = 0;
+	int exponent = 0;
+	bool any = false;
+	while(*p == '0') {
+		p++;
+		any = true;
+	}
+	while(*p >= '0' && *p <= '9') {
+		if(count++ == 19) {
+			return false;
+		}
+		digits = digits * 10 + (uint64_t) (*p++ - '0');
+		any = true;
+	}
+	if(*p == '.') {
+		p++;
+		if(digits == 0) {
+			while(*p == '0') {
+				p++;
+				exponent--;
+				any = true;
+			}
+		}
+		while(*p >= '0' && *p <= '9') {
+			if(count++ == 19) {
+				return false;
+			}
+			digits = digits * 10 + (uint64_t) (*p++ - '0');
+			exponent--;
+			any = true;
+		}
+	}
+	if(!any) {
+		return false;
+	}
+	if(*p == 'e' || *p == 'E') {
+		const char *q = p + 1;
+		bool negativeExponent = *q == '-';
+		q += *q == '-' || *q == '+';
+		if(*q >= '0' && *q <= '9') {
+			int written = 0;
+			while(*q >= '0' && *q <= '9') {
+				written = written < 100000 ? written * 10 + (*q - '0') : written;
+				q++;
+			}
+			exponent += negativeExponent ? -written : written;
+			p = q;
+		}
+	}
+	decimal->digits = digits;
+	decimal->exponent = exponent;
+	*end = p;
+	return true;
+}
+
+// the powers of 10 that doubles and floats hold exactly
+static const double exactPowersOf10[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Eisel-Lemire. the digits are shifted all the way left, multiplied by the
+// 128 bit power of 10, and the top bits of the product are the significand
+// (plus one bit to round with). "slack" is how many bits below those can
+// hide the error of the truncated power: when they are all ones the next 64
+// bits of the power are multiplied in too, and when the answer still isn't
+// clear (or it's an exact tie, a subnormal, an overflow) it gives up.
+// "mantissaBits" and "bias" make the same code work for floats
+static bool eiselLemire(struct decimalFloat decimal, int mantissaBits, int bias, uint64_t *result) {
+	if(decimal.exponent < POW10_MIN_EXPONENT || decimal.exponent > POW10_MAX_EXPONENT) {
+		return false;
+	}
+	int slack = 64 - mantissaBits - 3;
+	uint64_t slackMask = (1ull << slack) - 1;
+	int zeros = __builtin_clzll(decimal.digits);
+	uint64_t digits = decimal.digits << zeros;
+	uint64_t binaryExponent = (uint64_t) (((217706 * decimal.exponent) >> 16) + 64 + bias - zeros);
+
+	unsigned __int128 power = powersOf10Bits[decimal.exponent - POW10_MIN_EXPONENT];
+	unsigned __int128 product = (unsigned __int128) digits * (uint64_t) (power >> 64);
+	uint64_t high = (uint64_t) (product >> 64);
+	uint64_t low = (uint64_t) product;
+	if((high & slackMask) == slackMask && low + digits < digits) {
+		unsigned __int128 more = (unsigned __int128) digits * (uint64_t) power;
+		uint64_t mergedLow = low + (uint64_t) (more >> 64);
+		uint64_t mergedHigh = high + (mergedLow < low);
+		if((mergedHigh & slackMask) == slackMask && mergedLow + 1 == 0 && (uint64_t) more + digits < digits) {
+			return false;
+		}
+		high = mergedHigh;
+		low = mergedLow;
+	}
+	uint64_t top = high >> 63;
+	uint64_t mantissa = high >> (top + slack);
+	binaryExponent -= 1 ^ top;
+	if(low == 0 && (high & slackMask) == 0 && (mantissa & 3) == 1) {
+		return false; // exactly halfway between two doubles
+	}
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if(mantissa >> (mantissaBits + 1) != 0) {
+		mantissa >>= 1;
+		binaryExponent++;
+	}
+	uint64_t infinity = 2 * (uint64_t) bias + 1; // the exponent of inf and nan
+	if(binaryExponent - 1 >= infinity - 1) {
+		return false; // subnormal, zero or infinite
+	}
+	*result = binaryExponent << mantissaBits | (mantissa & ((1ull << mantissaBits) - 1));
+	return true;
+}
+
+// drop-in replacements for strtod() and strtof()
+static double parseDouble(const char *text, char **end) {
+	bool negative;
+	struct decimalFloat decimal;
+	const char *stop;
+	if(scanDecimalFloat(text, &negative, &decimal, &stop)) {
+		double result;
+		bool done = true;
+		uint64_t bits;
+		if(decimal.digits == 0) {
+			result = 0;
+		} else if(decimal.digits <= 1ull << 53 && decimal.exponent >= -22 && decimal.exponent <= 22) {
+			// both numbers are exact doubles, so one operation rounds just once
+			result = decimal.exponent < 0 ? (double) decimal.digits / exactPowersOf10[-decimal.exponent]
+				: (double) decimal.digits * exactPowersOf10[decimal.exponent];
+		} else if(eiselLemire(decimal, 52, 1023, &bits)) {
+			memcpy(&result, &bits, sizeof(result));
+		} else {
+			done = false;
+		}
+		if(done) {
+			if(end != NULL) {
+				*end = (char *) stop;
+			}
+			return negative ? -result : result;
+		}
+	}
+	return strtod(text, end);
+}
+
+static float parseFloat(const char *text, char **end) {
+	bool negative;
+	struct decimalFloat decimal;
+	const char *stop;
+	if(scanDecimalFloat(text, &negative, &decimal, &stop)) {
+		float result;
+		bool done = true;
+		uint64_t bits;
+		if(decimal.digits == 0) {
+			result = 0;
+		} else if(decimal.digits <= 1u << 24 && decimal.exponent >= -10 && decimal.exponent <= 10) {
+			result = decimal.exponent < 0 ? (float) decimal.digits / (float) exactPowersOf10[-decimal.exponent]
+				: (float) decimal.digits * (float) exactPowersOf10[decimal.exponent];
+		} else if(eiselLemire(decimal, 23, 127, &bits)) {
+			uint32_t narrow = (uint32_t) bits;
+			memcpy(&result, &narrow, sizeof(result));
+		} else {
+			done = false;
+		}
+		if(done) {
+			if(end != NULL) {
+				*end = (char *) stop;
+			}
+			return negative ? -result : result;
+		}
+	}
+	return strtof(text, end);
+}
+
+// the shortest "%.*e" that reads back as x, the slow way: printf() rounds
+// correctly, so the first precision that round trips is the shortest and
+// closest text, which is exactly what Schubfach has to find
+static bool sameAsShortestPrintf(const char *ours, double x, bool isFloat) {
+	char theirs[FLOAT_TEXT_SIZE];
+	for(int precision = 0; precision < 17; precision++) {
+		snprintf(theirs, sizeof(theirs), "%.*e", precision, x);
+		if(isFloat ? strtof(theirs, NULL) == (float) x : strtod(theirs, NULL) == x) {
+			break;
+		}
+	}
+	return strtod(ours, NULL) == strtod(theirs, NULL);
+}
+
+// the significant digits in a formatted number
+static int significantDigits(const char *text) {
+	int count = 0;
+	bool leading = true;
+	for(; *text != '\0' && *text != 'e'; text++) {
+		if(*text >= '1' && *text <= '9') {
+			leading = false;
+		}
+		count += !leading && *text >= '0' && *text <= '9';
+	}
+	// zeros at the end of an integer aren't significant either
+	for(text--; *text == '0' && count > 1; text--) {
+		count--;
+	}
+	return count;
+}
+
+// formats one float every "stride" of all 2^32 (stride 1 is every single
+// one, and takes minutes) and reads it back with parseFloat() and
+// strtof(), which both have to give back the same bits. it also checks
+// the text against printf() and that it never needs more than
+// FLT_DECIMAL_DIG digits. returns how many floats failed
+static size_t floatRoundTripTest(uint64_t stride, size_t *checked) {
+	size_t failures = 0;
+	*checked = 0;
+	char text[FLOAT_TEXT_SIZE];
+	void check(float x, bool compareWithPrintf) {
+		formatFloatShortest(text, x);
+		float ours = parseFloat(text, NULL);
+		float theirs = strtof(text, NULL);
+		bool ok = isnan(x) ? isnan(ours) && isnan(theirs)
+			: memcmp(&ours, &x, sizeof(x)) == 0 && memcmp(&theirs, &x, sizeof(x)) == 0
+				&& significantDigits(text) <= FLT_DECIMAL_DIG
+				&& (!compareWithPrintf || isinf(x) || sameAsShortestPrintf(text, x, true));
+		if(!ok && failures++ < 5) {
+			printf("  %.9g became \"%s\"\n", x, text);
+		}
+		(*checked)++;
+	}
+	const float edges[] = {FLT_MIN, FLT_MAX, FLT_TRUE_MIN, FLT_EPSILON, 1 + FLT_EPSILON, 1 - FLT_EPSILON / 2,
+		nextafterf(FLT_MIN, 0), nextafterf(FLT_MAX, 0), 2 * FLT_TRUE_MIN, 0.1f, 1 / 3.0f, 16777216, 16777217, 1e10f};
+	for(size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+		check(edges[i], true);
+		check(-edges[i], true);
+	}
+	for(uint64_t bits = 0; bits < 1ull << 32; bits += stride) {
+		uint32_t narrow = (uint32_t) bits;
+		float x;
+		memcpy(&x, &narrow, sizeof(x));
+		check(x, *checked % 1024 == 0);
+	}
+	return failures;
+}
+
+// the same for doubles, but on random bits (and DBL_DECIMAL_DIG), plus
+// texts that strtod() has opinions about: huge exponents, ties between two
+// doubles, more than 19 digits
+static size_t doubleRoundTripTest(unsigned seed, size_t count) {
+	size_t failures = 0;
+	char text[FLOAT_TEXT_SIZE];
+	void check(double x, bool compareWithPrintf) {
+		formatDoubleShortest(text, x);
+		double ours = parseDouble(text, NULL);
+		double theirs = strtod(text, NULL);
+		bool ok = isnan(x) ? isnan(ours) && isnan(theirs)
+			: memcmp(&ours, &x, sizeof(x)) == 0 && memcmp(&theirs, &x, sizeof(x)) == 0
+				&& significantDigits(text) <= DBL_DECIMAL_DIG
+				&& (!compareWithPrintf || isinf(x) || sameAsShortestPrintf(text, x, false));
+		// and the other way, from all 17 digits
+		snprintf(text, sizeof(text), "%.17g", x);
+		ours = parseDouble(text, NULL);
+		ok = ok && (isnan(x) || memcmp(&ours, &x, sizeof(x)) == 0);
+		if(!ok && failures++ < 5) {
+			printf("  %.17g doesn't round trip\n", x);
+		}
+	}
+	const double edges[] = {DBL_MIN, DBL_MAX, DBL_TRUE_MIN, DBL_EPSILON, 1 + DBL_EPSILON, FLT_MIN, FLT_MAX,
+		nextafter(DBL_MIN, 0), nextafter(DBL_MAX, 0), 0.1, 0.3, 1 / 3.0, 9007199254740993.0, 1e21, 1e-7, 123e-9,
+		5e-324, 0, -0.0, INFINITY, NAN, 1e23, 8.41e21, 5.0e-310};
+	for(size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+		check(edges[i], true);
+		check(-edges[i], true);
+	}
+	for(int e = -325; e <= 309; e++) {
+		check(strtod((snprintf(text, sizeof(text), "1e%d", e), text), NULL), true);
+	}
+	for(size_t i = 0; i < count; i++) {
+		uint64_t bits = 0;
+		for(int k = 0; k < 4; k++) {
+			seed = seed * 1103515245u + 12345u;
+			bits = (bits << 16) | (seed >> 16);
+		}
+		double x;
+		memcpy(&x, &bits, sizeof(x));
+		check(x, i % 256 == 0);
+	}
+
+	const char *texts[] = {"1e400", "-1e400", "1e-400", "2.4703282292062327e-324", "2.4703282292062328e-324",
+		"9007199254740993", "9007199254740992.5", "1.00000000000000011102230246251565404236316680908203125",
+		"123456789012345678901234567890", "0.000000000000000000000000000000000000001", "  42", "0x1p-3",
+		"inf", "nan", "-0", ".5", "5.", "1e", "1e+", "+.e1", "7.2057594037927933e16", "2.2250738585072011e-308",
+		"1.7976931348623157e308", "1.7976931348623158e308", "4.9406564584124654e-324", "3.4028235e38"};
+	for(size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+		char *ourEnd, *theirEnd;
+		double ours = parseDouble(texts[i], &ourEnd);
+		double theirs = strtod(texts[i], &theirEnd);
+		float oursNarrow = parseFloat(texts[i], NULL);
+		float theirsNarrow = strtof(texts[i], NULL);
+		bool same = (isnan(ours) && isnan(theirs)) || memcmp(&ours, &theirs, sizeof(ours)) == 0;
+		bool sameNarrow = (isnan(oursNarrow) && isnan(theirsNarrow)) || memcmp(&oursNarrow, &theirsNarrow, sizeof(oursNarrow)) == 0;
+		if((!same || !sameNarrow || ourEnd != theirEnd) && failures++ < 5) {
+			printf("  \"%s\": strtod() and parseDouble() disagree\n", texts[i]);
+		}
+	}
+	return failures;
+}
+
+
+
+void testFloatH() {
+	// this header only has a bunch of macros representing float limits
+	printf("\n\nFLT_DECIMAL_DIG = %d\n", FLT_DECIMAL_DIG); // precision of a float in decimal digits
+	printf("FLT_RADIX = %d\n", FLT_RADIX); // the numerical base used to represent all float types
+	printf("FLT_MIN = %e\n", FLT_MIN); // the smallest number a float can represent
+	printf("FLT_TRUE_MIN = %e\n", FLT_TRUE_MIN); // the true smallest number a float can represent
+	printf("FLT_MAX = %e\n", FLT_MAX); // the largest number a float can represent
+	printf("FLT_EPSILON = %.15f\n", FLT_EPSILON); // the difference between 1.0 and the next representable float
+	printf("FLT_DIG = %d\n", FLT_DIG); // amount of decimal digits preserved when converting to text and back
+	printf("FLT_MANT_DIG = %d\n", FLT_MANT_DIG); // number of digits in the mantissa that maintain precision
+
+	// %e shows 6 digits whether the number needs them or not. the shortest
+	// text that reads back as the same float is often shorter, and never
+	// longer than FLT_DECIMAL_DIG digits (see SHORTEST ROUND-TRIP FLOATS above)
+	floatConversionsInit();
+	char text[FLOAT_TEXT_SIZE];
+	const float constants[] = {FLT_MIN, FLT_TRUE_MIN, FLT_MAX, FLT_EPSILON, 0.1f};
+	const char *names[] = {"FLT_MIN", "FLT_TRUE_MIN", "FLT_MAX", "FLT_EPSILON", "0.1f"};
+	printf("\n");
+	for(int i = 0; i < 5; i++) {
+		formatFloatShortest(text, constants[i]);
+		printf("%-12s shortest: %-16s %%.9g: %-16.9g reads back: %s\n", names[i], text, constants[i],
+			parseFloat(text, NULL) == constants[i] ? "yes" : "NO");
+	}
+	formatDoubleShortest(text, 0.1 + 0.2);
+	printf("0.1 + 0.2 as a double is %s\n", text);
+
+	// and FLT_DIG is the promise in the other direction: any decimal with 6
+	// digits survives a trip through a float, so the float prints back as it
+	int survived = 0;
+	unsigned seed = 1;
+	for(int i = 0; i < 100000; i++) {
+		seed = seed * 1103515245u + 12345u;
+		int digits = 100000 + (int) (seed >> 8) % 900000;
+		int exponent = (int) (seed >> 4) % 60 - 30;
+		char decimal[32];
+		snprintf(decimal, sizeof(decimal), "%de%d", digits, exponent);
+		formatFloatShortest(text, parseFloat(decimal, NULL));
+		survived += strtod(text, NULL) == strtod(decimal, NULL);
+	}
+	printf("%d of 100000 random %d digit decimals came back the same\n", survived, FLT_DIG);
+}
+
+
+
+void benchFloatH() {
+	// first the round trip checks (a sample of the floats, or all of them
+	// with -x), then conversions per microsecond against printf() and strtod()
+	floatConversionsInit();
+	size_t checked;
+	uint64_t start = monotonicNs();
+	size_t failures = floatRoundTripTest(benchExhaustive ? 1 : 9973, &checked);
+	printf("%zu floats formatted and read back: %s (%zu failed, %.1f s)%s\n", checked, failures == 0 ? "ok" : "FAILED",
+		failures, (monotonicNs() - start) / 1e9, benchExhaustive ? "" : " (-x checks all of them)");
+	failures = doubleRoundTripTest(99, 1000000);
+	printf("a million random doubles and the tricky texts: %s (%zu failed)\n\n", failures == 0 ? "ok" : "FAILED", failures);
+
+	size_t n = 1 << 14;
+	int repeats = 20;
+	double *doubles = malloc(n * sizeof(double));
+	float *floats = malloc(n * sizeof(float));
+	char *texts = malloc(n * FLOAT_TEXT_SIZE);
+	if(doubles == NULL || floats == NULL || texts == NULL) {
+		printf("couldn't allocate the buffers\n");
+		free(doubles);
+		free(floats);
+		free(texts);
+		return;
+	}
+
+	// the best of a few runs, each one going over every number many times
+	#define FLOAT_MEASURE(code) ({ \
+		uint64_t best = UINT64_MAX; \
+		for(int r = 0; r < 5; r++) { \
+			uint64_t start = monotonicNs(); \
+			for(int k = 0; k < repeats; k++) { \
+				for(size_t i = 0; i < n; i++) { \
+					code; \
+				} \
+				benchKeep(sum); \
+			} \
+			uint64_t ns = monotonicNs() - start; \
+			best = ns < best ? ns : best; \
+		} \
+		(double) n * repeats * 1000 / best; \
+	})
+
+	// any bits is the worst case for both sides (17 digits, exponents
+	// everywhere), prices (2 decimals below 100000) look more like real JSON
+	printf("%-16s %12s %12s %12s %12s   (conversions/us)\n", "", "printf", "shortest", "strtod", "parse");
+	unsigned seed = 3;
+	for(int kind = 0; kind < 4; kind++) {
+		bool isFloat = kind >= 2;
+		bool prices = kind % 2 == 1;
+		for(size_t i = 0; i < n; i++) {
+			uint64_t bits;
+			do {
+				bits = 0;
+				for(int k = 0; k < 4; k++) {
+					seed = seed * 1103515245u + 12345u;
+					bits = (bits << 16) | (seed >> 16);
+				}
+				if(isFloat) {
+					bits >>= 32;
+				}
+			} while(isFloat ? (bits >> 23 & 0xFF) == 0xFF : (bits >> 52 & 0x7FF) == 0x7FF);
+			if(prices) {
+				doubles[i] = (double) (bits % 10000000) / 100;
+				floats[i] = (float) doubles[i];
+			} else if(isFloat) {
+				uint32_t narrow = (uint32_t) bits;
+				memcpy(&floats[i], &narrow, sizeof(float));
+			} else {
+				memcpy(&doubles[i], &bits, sizeof(double));
+			}
+			if(isFloat) {
+				formatFloatShortest(&texts[i * FLOAT_TEXT_SIZE], floats[i]);
+			} else {
+				formatDoubleShortest(&texts[i * FLOAT_TEXT_SIZE], doubles[i]);
+			}
+		}
+		char buffer[FLOAT_TEXT_SIZE];
+		double sum = 0;
+		printf("%-16s", (const char *[]) {"double, any bits", "double, prices", "float, any bits", "float, prices"}[kind]);
+		if(isFloat) {
+			printf(" %12.2f", FLOAT_MEASURE(sum += snprintf(buffer, sizeof(buffer), "%.9g", floats[i])));
+			printf(" %12.2f", FLOAT_MEASURE(sum += formatFloatShortest(buffer, floats[i])));
+			printf(" %12.2f", FLOAT_MEASURE(sum += strtof(&texts[i * FLOAT_TEXT_SIZE], NULL)));
+			printf(" %12.2f\n", FLOAT_MEASURE(sum += parseFloat(&texts[i * FLOAT_TEXT_SIZE], NULL)));
+		} else {
+			printf(" %12.2f", FLOAT_MEASURE(sum += snprintf(buffer, sizeof(buffer), "%.17g", doubles[i])));
+			printf(" %12.2f", FLOAT_MEASURE(sum += formatDoubleShortest(buffer, doubles[i])));
+			printf(" %12.2f", FLOAT_MEASURE(sum += strtod(&texts[i * FLOAT_TEXT_SIZE], NULL)));
+			printf(" %12.2f\n", FLOAT_MEASURE(sum += parseDouble(&texts[i * FLOAT_TEXT_SIZE], NULL)));
+		}
+	}
+	#undef FLOAT_MEASURE
+
+	free(doubles);
+	free(floats);
+	free(texts);
+}
+
+
+
+// FAST INTEGER FORMATTING AND PARSING
+// printf() and strtoll() have to read a format string, deal with the locale,
+// padding, bases and errno, and then they convert one digit at a time with a
+// division or a multiplication each. when all we want is the digits:
+// formatting counts the digits first (with the leading zero bits and a table
+// of powers of 10), so it can write from the end without reversing
+// anything, two digits per division by 100 from a table of "00" to "99".
+// parsing checks and converts 8 digits at once inside a uint64_t (SWAR,
+// "SIMD within a register") instead of one by one
+
+// "00" "01" ... "99"
+static const char decimalPairs[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const uint64_t powersOf10[20] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+	1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+	100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+	1000000000000000000ull, 10000000000000000000ull,
+};
+
+// the number of bits times log10(2) (1233 / 4096 is close to it) is the number
+// of digits or one less than it, and one comparison tells which (value | 1
+// has the same number of digits, but 0 then counts as one digit instead of none)
+static int decimalDigitCount(uint64_t value) {
+	value |= 1;
+	int bits = 64 - __builtin_clzll(value);
+	int guess = (bits * 1233) >> 12;
+	return guess + (value >= powersOf10[guess]);
+}
+
+// every format function writes the digits and a '\0' to "out" (which needs
+// room for 21 chars, or 23 for octal) and returns the number of digits
+static size_t formatU64(char *out, uint64_t value) {
+	size_t length = (size_t) decimalDigitCount(value);
+	char *end = out + length;
+	*end = '\0';
+	while(value >= 100) {
+		const char *pair = &decimalPairs[2 * (value % 100)];
+		value /= 100;
+		end -= 2;
+		end[0] = pair[0];
+		end[1] = pair[1];
+	}
+	if(value >= 10) {
+		end -= 2;
+		end[0] = decimalPairs[2 * value];
+		end[1] = decimalPairs[2 * value + 1];
+	} else {
+		*--end = (char) ('0' + value);
+	}
+	return length;
+}
+
+static size_t formatI64(char *out, int64_t value) {
+	if(value >= 0) {
+		return formatU64(out, (uint64_t) value);
+	}
+	*out = '-';
+	// 0 - value in unsigned arithmetic, because -INT64_MIN doesn't fit in an int64_t
+	return 1 + formatU64(out + 1, 0 - (uint64_t) value);
+}
+
+// hexadecimal and octal numbers are the bits in groups of 4 and 3, so the
+// digit count comes straight from the leading zeros, and the pairs are two
+// groups at once (the tables are "00" to "ff" and "00" to "77")
+static char hexPairs[513];
+static char octalPairs[129];
+
+static void integerTablesInit() {
+	const char *digits = "0123456789abcdef";
+	for(int i = 0; i < 256; i++) {
+		hexPairs[2 * i] = digits[i >> 4];
+		hexPairs[2 * i + 1] = digits[i & 15];
+	}
+	for(int i = 0; i < 64; i++) {
+		octalPairs[2 * i] = digits[i >> 3];
+		octalPairs[2 * i + 1] = digits[i & 7];
+	}
+}
+
+static size_t formatHex(char *out, uint64_t value) {
+	int bits = 64 - __builtin_clzll(value | 1);
+	size_t length = (size_t) (bits + 3) / 4;
+	char *end = out + length;
+	*end = '\0';
+	while(end - out >= 2) {
+		end -= 2;
+		memcpy(end, &hexPairs[2 * (value & 0xFF)], 2);
+		value >>= 8;
+	}
+	if(end > out) {
+		*--end = hexPairs[2 * (value & 15) + 1];
+	}
+	return length;
+}
+
+static size_t formatOctal(char *out, uint64_t value) {
+	int bits = 64 - __builtin_clzll(value | 1);
+	size_t length = (size_t) (bits + 2) / 3;
+	char *end = out + length;
+	*end = '\0';
+	while(end - out >= 2) {
+		end -= 2;
+		memcpy(end, &octalPairs[2 * (value & 63)], 2);
+		value >>= 6;
+	}
+	if(end > out) {
+		*--end = octalPairs[2 * (value & 7) + 1];
+	}
+	return length;
+}
+
+// the same calls for every integer type. the stdint.h types are all typedefs
+// of these ones, so int8_t or uint64_t work too. hex and octal show the
+// bits of the value at its own width: -1 as an int8_t is "ff" (printf() only
+// sees the int it got promoted to, so "%" PRIx8 prints "ffffffff")
+#define AS_UNSIGNED(value) _Generic((value), \
+	signed char: (unsigned char) (value), \
+	short: (unsigned short) (value), \
+	int: (unsigned) (value), \
+	long: (unsigned long) (value), \
+	long long: (unsigned long long) (value), \
+	default: (value))
+
+#define formatDecimal(out, value) _Generic((value), \
+	signed char: formatI64, short: formatI64, int: formatI64, long: formatI64, long long: formatI64, \
+	default: formatU64)(out, value)
+#define formatHexadecimal(out, value) formatHex(out, AS_UNSIGNED(value))
+#define formatOctalDigits(out, value) formatOctal(out, AS_UNSIGNED(value))
+
+enum parseStatus {
+	PARSE_OK,
+	PARSE_NO_DIGITS,
+	PARSE_OVERFLOW, // the number doesn't fit in the type
+};
+
+// are the 8 bytes all between '0' and '9'? the high nibbles must be 3, and
+// adding 6 to the low ones can't carry (it would for ':' to '?')
+static bool eightDigits(uint64_t chunk) {
+	return ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+		== 0x3333333333333333;
+}
+
+// 8 digits to a number, with 3 multiplications instead of 8: first each
+// pair of digits becomes a byte, then each pair of those a 16 bit number,
+// and then those two become the result (the first char is the lowest byte)
+static uint32_t eightDigitsValue(uint64_t chunk) {
+	chunk -= 0x3030303030303030;
+	chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FF;
+	chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFF;
+	return (uint32_t) ((chunk * 10000 + (chunk >> 32)) & 0xFFFFFFFF);
+}
+
+// reads the decimal digits at the start of text (no spaces or sign), and
+// tells how many chars it used. only "length" chars are ever read
+static enum parseStatus parseU64(const char *text, size_t length, uint64_t *value, size_t *used) {
+	size_t i = 0;
+	while(i < length && text[i] == '0') {
+		i++; // leading zeros don't count towards the 20 digits
+	}
+	size_t start = i;
+	uint64_t result = 0;
+	// 19 digits always fit in a uint64_t, so until then no checks are needed
+	while(length - i >= 8 && i - start + 8 <= 19) {
+		uint64_t chunk;
+		memcpy(&chunk, text + i, 8);
+		if(!eightDigits(chunk)) {
+			break;
+		}
+		result = result * 100000000 + eightDigitsValue(chunk);
+		i += 8;
+	}
+	while(i < length && text[i] >= '0' && text[i] <= '9' && i - start < 19) {
+		result = result * 10 + (uint64_t) (text[i] - '0');
+		i++;
+	}
+	// a 20th digit may still fit, and a 21st never does
+	if(i < length && text[i] >= '0' && text[i] <= '9') {
+		if(__builtin_mul_overflow(result, 10, &result) || __builtin_add_overflow(result, (uint64_t) (text[i] - '0'), &result)
+			|| (i + 1 < length && text[i + 1] >= '0' && text[i + 1] <= '9')) {
+			*used = i;
+			return PARSE_OVERFLOW;
+		}
+		i++;
+	}
+	*used = i;
+	if(i == 0) {
+		return PARSE_NO_DIGITS;
+	}
+	*value = result;
+	return PARSE_OK;
+}
+
+// the same with an optional '+' or '-' in front
+static enum parseStatus parseI64(const char *text, size_t length, int64_t *value, size_t *used) {
+	bool negative = length > 0 && text[0] == '-';
+	size_t sign = length > 0 && (text[0] == '-' || text[0] == '+');
+	uint64_t magnitude;
+	enum parseStatus status = parseU64(text + sign, length - sign, &magnitude, used);
+	*used += sign;
+	if(status != PARSE_OK) {
+		*used = status == PARSE_NO_DIGITS ? 0 : *used;
+		return status;
+	}
+	if(magnitude > (uint64_t) INT64_MAX + negative) {
+		return PARSE_OVERFLOW;
+	}
+	*value = negative ? (int64_t) (0 - magnitude) : (int64_t) magnitude;
+	return PARSE_OK;
+}
+
+// and for the smaller types it's only a range check on top of those,
+// the lower bound only for the signed ones (min is 0 for the others)
+#define PARSE_NARROW(name, type, wideType, wideParse, min, max) \
+	static enum parseStatus name(const char *text, size_t length, type *value, size_t *used) { \
+		wideType wide; \
+		enum parseStatus status = wideParse(text, length, &wide, used); \
+		bool belowMin = (min) != 0 && (intmax_t) wide < (intmax_t) (min); \
+		if(status == PARSE_OK && (belowMin || wide > max)) { \
+			return PARSE_OVERFLOW; \
+		} \
+		if(status == PARSE_OK) { \
+			*value = (type) wide; \
+		} \
+		return status; \
+	}
+
+PARSE_NARROW(parseSignedChar, signed char, int64_t, parseI64, SCHAR_MIN, SCHAR_MAX)
+PARSE_NARROW(parseShort, short, int64_t, parseI64, SHRT_MIN, SHRT_MAX)
+PARSE_NARROW(parseInt, int, int64_t, parseI64, INT_MIN, INT_MAX)
+PARSE_NARROW(parseLong, long, int64_t, parseI64, LONG_MIN, LONG_MAX)
+PARSE_NARROW(parseLongLong, long long, int64_t, parseI64, LLONG_MIN, LLONG_MAX)
+PARSE_NARROW(parseUnsignedChar, unsigned char, uint64_t, parseU64, 0, UCHAR_MAX)
+PARSE_NARROW(parseUnsignedShort, unsigned short, uint64_t, parseU64, 0, USHRT_MAX)
+PARSE_NARROW(parseUnsigned, unsigned, uint64_t, parseU64, 0, UINT_MAX)
+PARSE_NARROW(parseUnsignedLong, unsigned long, uint64_t, parseU64, 0, ULONG_MAX)
+PARSE_NARROW(parseUnsignedLongLong, unsigned long long, uint64_t, parseU64, 0, ULLONG_MAX)
+
+// parseDecimal(text, length, &anyInteger, &used) picks the right one
+#define parseDecimal(text, length, pointer, used) _Generic((pointer), \
+	signed char *: parseSignedChar, short *: parseShort, int *: parseInt, long *: parseLong, \
+	long long *: parseLongLong, unsigned char *: parseUnsignedChar, unsigned short *: parseUnsignedShort, \
+	unsigned *: parseUnsigned, unsigned long *: parseUnsignedLong, \
+	unsigned long long *: parseUnsignedLongLong)(text, length, pointer, used)
+
+// checks everything above against snprintf() and strtoll()/strtoull(),
+// on the limits of every width and on random numbers of every length,
+// and returns how many results were different
+static size_t integerConversionsDifferentialTest(unsigned seed, size_t rounds) {
+	integerTablesInit();
+	size_t failures = 0;
+	char ours[32], theirs[32];
+	void compare(const char *what) {
+		if(strcmp(ours, theirs) != 0) {
+			if(failures++ < 5) {
+				printf("  %s: got \"%s\", printf says \"%s\"\n", what, ours, theirs);
+			}
+		}
+	}
+	// every width formatted the way its PRI macro does
+	void checkAll(uint64_t bits) {
+		int8_t i8 = (int8_t) bits; int16_t i16 = (int16_t) bits; int32_t i32 = (int32_t) bits; int64_t i64 = (int64_t) bits;
+		uint8_t u8 = (uint8_t) bits; uint16_t u16 = (uint16_t) bits; uint32_t u32 = (uint32_t) bits; uint64_t u64 = bits;
+		formatDecimal(ours, i8); snprintf(theirs, sizeof(theirs), "%" PRId8, i8); compare("int8_t");
+		formatDecimal(ours, i16); snprintf(theirs, sizeof(theirs), "%" PRId16, i16); compare("int16_t");
+		formatDecimal(ours, i32); snprintf(theirs, sizeof(theirs), "%" PRId32, i32); compare("int32_t");
+		formatDecimal(ours, i64); snprintf(theirs, sizeof(theirs), "%" PRId64, i64); compare("int64_t");
+		formatDecimal(ours, u8); snprintf(theirs, sizeof(theirs), "%" PRIu8, u8); compare("uint8_t");
+		formatDecimal(ours, u16); snprintf(theirs, sizeof(theirs), "%" PRIu16, u16); compare("uint16_t");
+		formatDecimal(ours, u32); snprintf(theirs, sizeof(theirs), "%" PRIu32, u32); compare("uint32_t");
+		formatDecimal(ours, u64); snprintf(theirs, sizeof(theirs), "%" PRIu64, u64); compare("uint64_t");
+		formatHexadecimal(ours, i8); snprintf(theirs, sizeof(theirs), "%" PRIx8, (uint8_t) i8); compare("int8_t hex");
+		formatHexadecimal(ours, i16); snprintf(theirs, sizeof(theirs), "%" PRIx16, (uint16_t) i16); compare("int16_t hex");
+		formatHexadecimal(ours, i32); snprintf(theirs, sizeof(theirs), "%" PRIx32, (uint32_t) i32); compare("int32_t hex");
+		formatHexadecimal(ours, u64); snprintf(theirs, sizeof(theirs), "%" PRIx64, u64); compare("uint64_t hex");
+		formatOctalDigits(ours, i8); snprintf(theirs, sizeof(theirs), "%" PRIo8, (uint8_t) i8); compare("int8_t octal");
+		formatOctalDigits(ours, i16); snprintf(theirs, sizeof(theirs), "%" PRIo16, (uint16_t) i16); compare("int16_t octal");
+		formatOctalDigits(ours, u32); snprintf(theirs, sizeof(theirs), "%" PRIo32, u32); compare("uint32_t octal");
+		formatOctalDigits(ours, i64); snprintf(theirs, sizeof(theirs), "%" PRIo64, (uint64_t) i64); compare("int64_t octal");
+
+		// and parsing the decimal text back, against strtoll() and strtoull()
+		snprintf(theirs, sizeof(theirs), "%" PRId64, i64);
+		int64_t parsed;
+		size_t used;
+		if(parseI64(theirs, strlen(theirs), &parsed, &used) != PARSE_OK || parsed != i64 || used != strlen(theirs)) {
+			if(failures++ < 5) printf("  parsing \"%s\" as int64_t failed\n", theirs);
+		}
+		int32_t parsed32;
+		errno = 0;
+		long expected = strtol(theirs, NULL, 10);
+		bool fits = errno == 0 && expected >= INT32_MIN && expected <= INT32_MAX;
+		enum parseStatus status = parseDecimal(theirs, strlen(theirs), &parsed32, &used);
+		if((status == PARSE_OK) != fits || (fits && parsed32 != expected)) {
+			if(failures++ < 5) printf("  parsing \"%s\" as int32_t got it wrong\n", theirs);
+		}
+	}
+	// the limits of every width and the numbers around every power of 10
+	const uint64_t edges[] = {0, 1, INT8_MAX, (uint8_t) INT8_MIN, UINT8_MAX, INT16_MAX, (uint16_t) INT16_MIN, UINT16_MAX,
+		INT32_MAX, (uint32_t) INT32_MIN, UINT32_MAX, INT64_MAX, (uint64_t) INT64_MIN, UINT64_MAX};
+	for(size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+		checkAll(edges[i]);
+		checkAll(edges[i] - 1);
+		checkAll(edges[i] + 1);
+	}
+	for(int p = 0; p < 20; p++) {
+		checkAll(powersOf10[p] - 1);
+		checkAll(powersOf10[p]);
+		checkAll(-powersOf10[p]);
+	}
+	for(size_t r = 0; r < rounds; r++) {
+		// a random length first, so short numbers get tested as much as long ones
+		seed = seed * 1103515245u + 12345u;
+		int digits = (int) ((seed >> 16) % 20);
+		uint64_t bits = 0;
+		for(int k = 0; k < 4; k++) {
+			seed = seed * 1103515245u + 12345u;
+			bits = (bits << 16) | (seed >> 16);
+		}
+		checkAll(digits < 19 ? bits % powersOf10[digits + 1] : bits);
+	}
+
+	// and strings strtoull() has opinions about: too long, leading zeros, junk after the digits
+	const char *texts[] = {"18446744073709551615", "18446744073709551616", "99999999999999999999",
+		"100000000000000000000", "000000000000000000000000123", "12345678x", "1234567812345678", "", "abc",
+		"00000000000000000000018446744073709551615", "9223372036854775807", "-9223372036854775808",
+		"9223372036854775808", "-9223372036854775809", "+42", "-0"};
+	for(size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+		const char *text = texts[i];
+		char *end;
+		errno = 0;
+		long long expected = strtoll(text, &end, 10);
+		bool ok = errno == 0 && end != text;
+		int64_t parsed;
+		size_t used;
+		enum parseStatus status = parseI64(text, strlen(text), &parsed, &used);
+		if((status == PARSE_OK) != ok || (ok && (parsed != expected || used != (size_t) (end - text)))) {
+			if(failures++ < 5) printf("  \"%s\": strtoll() and parseI64() disagree\n", text);
+		}
+		if(text[0] != '-' && text[0] != '+') {
+			errno = 0;
+			unsigned long long expectedUnsigned = strtoull(text, &end, 10);
+			ok = errno == 0 && end != text;
+			uint64_t parsedUnsigned;
+			status = parseU64(text, strlen(text), &parsedUnsigned, &used);
+			if((status == PARSE_OK) != ok || (ok && (parsedUnsigned != expectedUnsigned || used != (size_t) (end - text)))) {
+				if(failures++ < 5) printf("  \"%s\": strtoull() and parseU64() disagree\n", text);
+			}
+		}
+	}
+	return failures;
+}
+
+
+
+void testIntTypesH() {
+	// this header contains macros for the printf and scanf family functions formating
+	// for example the %d, %i and etc.
+	int integer = 1000;
+	int octal = 0777;
+	int hexadecimal = 0xFFF;
+	printf("decimal formatting: \n\n%"PRId8"\n", integer); // PRId32 -> d
+	printf("octal formatting: %"PRIo32"\n", octal); // PRIo32 -> o
+	printf("hexadecimal formatting: %"PRIx32"\n", hexadecimal); // PRIx32 -> x
+
+	// when all we want is the digits, the functions above testIntTypesH()
+	// do the same without reading a format string (benchIntTypesH() checks
+	// them against printf and says how much faster they are)
+	integerTablesInit();
+	char digits[32];
+	int8_t small = -1;
+	uint64_t big = UINT64_MAX;
+	formatDecimal(digits, small);
+	printf("\nint8_t -1 with formatDecimal: %s\n", digits);
+	formatHexadecimal(digits, small);
+	printf("int8_t -1 with formatHexadecimal: %s (printf says %"PRIx8")\n", digits, small);
+	formatDecimal(digits, big);
+	printf("UINT64_MAX with formatDecimal: %s\n", digits);
+	formatOctalDigits(digits, big);
+	printf("UINT64_MAX with formatOctalDigits: %s\n", digits);
+	int16_t parsed;
+	size_t used;
+	if(parseDecimal("40000", 5, &parsed, &used) == PARSE_OVERFLOW) {
+		printf("\"40000\" doesn't fit in an int16_t, parseDecimal says so\n");
+	}
+	if(parseDecimal("-1234 apples", 12, &parsed, &used) == PARSE_OK) {
+		printf("\"-1234 apples\" is %d, using %zu chars\n\n", parsed, used);
+	}
+
+	scanf("%"SCNd32, &integer); // SCNd32 -> d
+	scanf("%"SCNo32, &octal); // SCNo32 -> o
+	scanf("%"SCNx32, &hexadecimal); // SCNx32 -> x
+
+	// there are many more macros, for every formating involving integers
+	// and for every integer size, but you got the point.
+	// I don't really know if there is any situation in which using these macros
+	// is better than writing %d or %o and so on.
+}
+
+
+
+void benchIntTypesH() {
+	// first the fast conversions against printf and strtoll on a million
+	// numbers, then conversions per microsecond for three kinds of data:
+	// numbers of any uint64_t value (nearly all with 19 or 20 digits), numbers
+	// of a random length (1 to 20 digits, like IDs and sizes in a log), and
+	// small ones (below 1000, like most counters and ports)
+	size_t failures = integerConversionsDifferentialTest(2024, 1000000);
+	printf("differential test against printf and strtoll: %s (%zu differences)\n\n", failures == 0 ? "ok" : "FAILED", failures);
+
+	size_t n = 1 << 16;
+	int repeats = 20;
+	uint64_t *numbers = malloc(n * sizeof(uint64_t));
+	char *texts = malloc(n * 24); // every number as text, 24 chars apart
+	size_t *lengths = malloc(n * sizeof(size_t));
+	if(numbers == NULL || texts == NULL || lengths == NULL) {
+		printf("couldn't allocate the buffers\n");
+		free(numbers);
+		free(texts);
+		free(lengths);
+		return;
+	}
+
+	// the best of a few runs, each one going over every number many times
+	#define INTEGER_MEASURE(code) ({ \
+		uint64_t best = UINT64_MAX; \
+		for(int r = 0; r < 5; r++) { \
+			uint64_t start = monotonicNs(); \
+			for(int k = 0; k < repeats; k++) { \
+				for(size_t i = 0; i < n; i++) { \
+					code; \
+				} \
+				benchKeep(sum); \
+			} \
+			uint64_t ns = monotonicNs() - start; \
+			best = ns < best ? ns : best; \
+		} \
+		(double) n * repeats * 1000 / best; \
+	})
+
+	const char *distributions[] = {"any uint64_t", "random length", "below 1000"};
+	printf("%-14s %10s %10s %10s %10s %10s %10s   (conversions/us)\n", "", "snprintf", "formatU64",
+		"%llx", "formatHex", "strtoull", "parseU64");
+	unsigned seed = 7;
+	for(int d = 0; d < 3; d++) {
+		for(size_t i = 0; i < n; i++) {
+			uint64_t bits = 0;
+			for(int k = 0; k < 4; k++) {
+				seed = seed * 1103515245u + 12345u;
+				bits = (bits << 16) | (seed >> 16);
+			}
+			seed = seed * 1103515245u + 12345u;
+			int digits = (int) ((seed >> 16) % 20) + 1;
+			numbers[i] = d == 0 ? bits : d == 1 ? (digits == 20 ? bits : bits % powersOf10[digits]) : bits % 1000;
+			lengths[i] = formatU64(&texts[i * 24], numbers[i]);
+		}
+		char buffer[32];
+		uint64_t sum = 0;
+		printf("%-14s", distributions[d]);
+		printf(" %10.2f", INTEGER_MEASURE(sum += (uint64_t) snprintf(buffer, sizeof(buffer), "%" PRIu64, numbers[i])));
+		printf(" %10.2f", INTEGER_MEASURE(sum += formatU64(buffer, numbers[i])));
+		printf(" %10.2f", INTEGER_MEASURE(sum += (uint64_t) snprintf(buffer, sizeof(buffer), "%" PRIx64, numbers[i])));
+		printf(" %10.2f", INTEGER_MEASURE(sum += formatHex(buffer, numbers[i])));
+		printf(" %10.2f", INTEGER_MEASURE(sum += strtoull(&texts[i * 24], NULL, 10)));
+		printf(" %10.2f\n", INTEGER_MEASURE(uint64_t value = 0; size_t used; parseU64(&texts[i * 24], lengths[i], &value, &used); sum += value));
+	}
+	#undef INTEGER_MEASURE
+
+	free(numbers);
+	free(texts);
+	free(lengths);
+}
+
+
+
+void testISO646H() {
+	// this header has macros that offer alternative representations
+	// to operators that aren't in the ISO646:1983 character set
+	int zero = 0;
+	int one = 1;
+	int anyNum = 15;
+
+	// not -> !
+	// and -> &&
+	if((not zero) and one) {
+		printf("\n\n!0 && 1\n");
+	}
+	// or -> ||
+	if(zero or one) {
+		printf("0 || 1\n");
+	}
+
+	printf("0 | 1 = %d\n", zero bitor one); // bitor -> |
+	printf("0 & 1 = %d\n", zero bitand one); // bitand -> &
+	printf("%d ^ 1 = %d\n", anyNum, anyNum xor one); // xor -> ^
+	printf("~%d = %d\n", anyNum, compl anyNum); // compl -> ~
+	// other operator macros:
+	// and_eq -> &= 
+	// or_eq -> |=
+	// xor_eq -> ^=
+	// not_eq -> !=
+
+	// there are also macros that replace }, {, [, ] and #
+	int array<:2:> = {3, 2}; // <: becomes [ and :> becomes ]
+	%:define message "HELLO THERE!\n" // %: becomes #
+	if(array<:0:> == 3) <% // <% becomes {
+		printf(message);
+	%> // %> becomes }
+}
+
+
+
+void testLimitsH() {
+	// a bunch of macros containing the bit size of some types
+	// and the max and min limits of integer types (such as short int and long int)
+	printf("\n\nCHAR_BIT = %d\n", CHAR_BIT); // how big is a char in bits
+	printf("MB_LEN_MAX = %d\n\n", MB_LEN_MAX); // how many bytes can a multibyte char have
+	
+	printf("CHAR_MIN = %+d\n", CHAR_MIN); // minimum value of a char
+	printf("CHAR_MAX = %+d\n", CHAR_MAX); // maximum value of a char
+	printf("SCHAR_MIN = %+d\n", SCHAR_MIN); // minimun value of a signed char
+	printf("SCHAR_MAX = %+d\n", SCHAR_MAX); //  maximum value of a signed char
+	printf("UCHAR_MAX = %u\n\n", UCHAR_MAX); // maximun value of an unsigned char
+	
+	printf("SHRT_MIN = %+d\n", SHRT_MIN); // minimum value of a short int
+	printf("SHRT_MAX = %+d\n", SHRT_MAX); // maximun value of a short int
+	printf("USHRT_MAX = %u\n\n", USHRT_MAX); // maximun value of an unsigned short int
+	
+	printf("INT_MIN = %+d\n", INT_MIN); // minimum value of an int
+	printf("INT_MAX = %+d\n", INT_MAX); // maximun value of an int
+	printf("UINT_MAX = %u\n\n", UINT_MAX); // maximun value of an unsigned int
+	
+	printf("LONG_MIN = %+ld\n", LONG_MIN); // minimum value of a long int
+	printf("LONG_MAX = %+ld\n", LONG_MAX); // maximun value of a long int
+	printf("ULONG_MAX = %lu\n\n", ULONG_MAX); // maximun value of an unsigned long int
+	
+	printf("LLONG_MIN = %+lld\n", LLONG_MIN); // minimum value of a long long int
+	printf("LLONG_MAX = %+lld\n", LLONG_MAX); // maximun value of a long long int
+	printf("ULLONG_MAX = %llu\n\n", ULLONG_MAX); // maximun value of an unsigned long long int
+}
+
+
+
+// PER-THREAD LOCALES
+// setlocale() changes the locale of the whole program: calling it while
+// another thread formats a number is a data race, and switching back and
+// forth around every printf() needs a lock that every thread then waits on.
+// POSIX has locale objects instead: newlocale() makes one, uselocale() makes
+// it the locale of the calling thread only (printf() and friends follow it),
+// duplocale() copies one to hand to another thread and freelocale() frees it.
+// on top of that, the numbers only need 3 things from LC_NUMERIC: the decimal
+// point, the thousands separator and the grouping, so they are read once and
+// kept next to the locale, and formatFixed() uses them without asking libc
+
+// what LC_NUMERIC says about numbers, copied out of localeconv()
+struct numberFormat {
+	char decimalPoint[8];
+	char thousandsSeparator[8];
+	char grouping[8]; // sizes of the groups from the right, CHAR_MAX stops, 0 repeats the last one
+};
+
+struct threadLocale {
+	locale_t locale; // (locale_t) 0 while the thread uses the global one
+	struct numberFormat format;
+};
+
+static thread_local struct threadLocale threadLocale;
+
+// localeconv() answers for the locale of the calling thread
+static void numberFormatFromCurrent(struct numberFormat *format) {
+	struct lconv *conventions = localeconv();
+	snprintf(format->decimalPoint, sizeof(format->decimalPoint), "%s", conventions->decimal_point);
+	snprintf(format->thousandsSeparator, sizeof(format->thousandsSeparator), "%s", conventions->thousands_sep);
+	snprintf(format->grouping, sizeof(format->grouping), "%s", conventions->grouping);
+}
+
+// makes "locale" (which the thread now owns) the locale of this thread only
+static void threadLocaleAdopt(locale_t locale) {
+	uselocale(locale);
+	if(threadLocale.locale != (locale_t) 0) {
+		freelocale(threadLocale.locale);
+	}
+	threadLocale.locale = locale;
+	numberFormatFromCurrent(&threadLocale.format);
+}
+
+// the same from a name, like "pt_BR.UTF-8". false if there's no such locale
+static bool threadLocaleUse(const char *name) {
+	locale_t locale = newlocale(LC_ALL_MASK, name, (locale_t) 0);
+	if(locale == (locale_t) 0) {
+		return false;
+	}
+	threadLocaleAdopt(locale);
+	return true;
+}
+
+// a copy of this thread's locale, to start another thread with the same one
+static locale_t threadLocaleCopy() {
+	return duplocale(threadLocale.locale != (locale_t) 0 ? threadLocale.locale : LC_GLOBAL_LOCALE);
+}
+
+// back to the global locale (a thread must do this before it ends, or its locale leaks)
+static void threadLocaleRelease() {
+	uselocale(LC_GLOBAL_LOCALE);
+	if(threadLocale.locale != (locale_t) 0) {
+		freelocale(threadLocale.locale);
+		threadLocale.locale = (locale_t) 0;
+	}
+}
+
+// the cached format of this thread, or of the global locale (read each
+// time, since setlocale() can change it whenever it wants)
+static const struct numberFormat *threadNumberFormat() {
+	if(threadLocale.locale == (locale_t) 0) {
+		numberFormatFromCurrent(&threadLocale.format);
+	}
+	return &threadLocale.format;
+}
+
+// writes the digits of "value" with the separators the grouping asks for
+static size_t formatGroupedDigits(char *out, uint64_t value, const struct numberFormat *format) {
+	char digits[24];
+	size_t count = formatU64(digits, value);
+	size_t separatorLength = strlen(format->thousandsSeparator);
+	if(separatorLength == 0 || format->grouping[0] <= 0 || format->grouping[0] == CHAR_MAX) {
+		memcpy(out, digits, count);
+		return count;
+	}
+	// the digits in each group, from the right, until they run out
+	size_t groups[24], groupCount = 0;
+	const char *size = format->grouping;
+	for(size_t left = count; left > 0;) {
+		size_t group = *size == CHAR_MAX ? left : (size_t) *size;
+		group = group < left ? group : left;
+		groups[groupCount++] = group;
+		left -= group;
+		if(size[1] != '\0') {
+			size++; // and at the end of the string the last size repeats
+		}
+	}
+	size_t length = 0, next = 0;
+	for(size_t g = groupCount; g-- > 0;) {
+		memcpy(out + length, digits + next, groups[g]);
+		length += groups[g];
+		next += groups[g];
+		if(g > 0) {
+			memcpy(out + length, format->thousandsSeparator, separatorLength);
+			length += separatorLength;
+		}
+	}
+	return length;
+}
+
+// printf("%'.*f", decimals, value) in the given format, without printf():
+// the double is m * 2^e exactly, so m * 10^decimals fits in 128 bits and the
+// shift by e rounds it the way printf does (to nearest, ties to even, on the
+// exact value). what doesn't fit (huge, infinite or NaN) goes to snprintf(),
+// which uses the thread's locale too. "out" needs 64 bytes
+static size_t formatFixed(char *out, double value, int decimals, const struct numberFormat *format) {
+	if(!isfinite(value) || fabs(value) >= 1e18 || decimals < 0 || decimals > 9) {
+		return (size_t) snprintf(out, 64, "%'.*f", decimals, value);
+	}
+	int exponent;
+	double fraction = frexp(fabs(value), &exponent);
+	unsigned __int128 scaled = (unsigned __int128) (uint64_t) ldexp(fraction, 53) * powersOf10[decimals];
+	int shift = 53 - exponent;
+	if(shift > 0) {
+		if(shift > 120) {
+			scaled = 0; // much less than half of the last digit
+		} else {
+			unsigned __int128 half = (unsigned __int128) 1 << (shift - 1);
+			unsigned __int128 rest = scaled & ((half << 1) - 1);
+			scaled >>= shift;
+			scaled += rest > half || (rest == half && (scaled & 1));
+		}
+	} else {
+		scaled <<= -shift;
+	}
+	uint64_t whole = (uint64_t) (scaled / powersOf10[decimals]);
+	uint64_t part = (uint64_t) (scaled % powersOf10[decimals]);
+	size_t length = 0;
+	if(signbit(value)) {
+		out[length++] = '-'; // -0.001 is "-0.00" in printf too
+	}
+	length += formatGroupedDigits(out + length, whole, format);
+	if(decimals > 0) {
+		size_t pointLength = strlen(format->decimalPoint);
+		memcpy(out + length, format->decimalPoint, pointLength);
+		length += pointLength;
+		// the zeros on the left of the fraction, then its digits
+		int digits = decimalDigitCount(part);
+		memset(out + length, '0', decimals - digits);
+		formatU64(out + length + decimals - digits, part);
+		length += decimals;
+	}
+	out[length] = '\0';
+	return length;
+}
+
+// the locales worth trying: C and C.UTF-8 are always there, the others
+// only if they were generated (locale -a lists them)
+static const char *localeCandidates[] = {"C", "C.UTF-8", "en_US.UTF-8", "pt_BR.UTF-8", "de_DE.UTF-8", "fr_FR.UTF-8", "hi_IN.UTF-8"};
+#define LOCALE_CANDIDATES (sizeof(localeCandidates) / sizeof(localeCandidates[0]))
+
+// formatFixed() against snprintf() in every candidate locale this system
+// has, with random doubles of every size and 0 to 9 decimals, and the
+// halfway cases. returns how many came out different
+static size_t formatFixedTest(unsigned seed, int rounds) {
+	size_t failures = 0;
+	for(size_t c = 0; c < LOCALE_CANDIDATES; c++) {
+		if(!threadLocaleUse(localeCandidates[c])) {
+			continue;
+		}
+		const struct numberFormat *format = threadNumberFormat();
+		void check(double value, int decimals) {
+			char mine[64], theirs[64];
+			formatFixed(mine, value, decimals, format);
+			snprintf(theirs, sizeof(theirs), "%'.*f", decimals, value);
+			if(strcmp(mine, theirs) != 0 && failures++ < 5) {
+				printf("  %s: %.17g with %d decimals is \"%s\", printf says \"%s\"\n", localeCandidates[c], value, decimals, mine, theirs);
+			}
+		}
+		double special[] = {0.0, -0.0, 0.5, 1.5, 2.5, 0.125, 0.375, 1.005, 2.675, -0.001, 999.995, 1234567.891, 5e-324, 1e17 + 8, 0.045};
+		for(size_t s = 0; s < sizeof(special) / sizeof(special[0]); s++) {
+			for(int decimals = 0; decimals <= 9; decimals++) {
+				check(special[s], decimals);
+			}
+		}
+		for(int round = 0; round < rounds; round++) {
+			uint64_t bits = 0;
+			for(int k = 0; k < 4; k++) {
+				seed = seed * 1103515245u + 12345u;
+				bits = (bits << 16) | (seed >> 16);
+			}
+			// a random mantissa with a magnitude between 1e-12 and 1e18, and prices
+			double value = ldexp((double) (bits >> 11) / (1ull << 53), (int) (bits % 100) - 40);
+			check(round % 2 ? value : -value, round % 10);
+			check((double) (bits % 100000000) / 100, 2);
+		}
+	}
+	threadLocaleRelease();
+	return failures;
+}
+
+void testLocaleH() {
+	// Basically this header lets you change the locale of your program,
+	// including the character set, the decimal separating symbol and the currency.
+
+	// In most cases you will simply do the following to set the locale to the OS one
+	setlocale(LC_ALL, "");
+	printf("current locale: %s\n", setlocale(LC_ALL, NULL));
+
+	// but that's the locale of every thread. newlocale() and uselocale() give
+	// this thread its own (see PER-THREAD LOCALES above)
+	printf("locales here:");
+	for(size_t c = 0; c < LOCALE_CANDIDATES; c++) {
+		locale_t locale = newlocale(LC_ALL_MASK, localeCandidates[c], (locale_t) 0);
+		if(locale != (locale_t) 0) {
+			printf(" %s", localeCandidates[c]);
+			freelocale(locale);
+		}
+	}
+	printf("\n");
+	if(threadLocaleUse("C.UTF-8")) {
+		const struct numberFormat *format = threadNumberFormat();
+		printf("this thread uses C.UTF-8 now (the program still says %s): decimal point \"%s\", thousands \"%s\"\n",
+			setlocale(LC_ALL, NULL), format->decimalPoint, format->thousandsSeparator);
+		// a copy for some other thread, which would pass it to threadLocaleAdopt()
+		locale_t copy = threadLocaleCopy();
+		printf("duplocale() made a copy for another thread: %s\n", copy != (locale_t) 0 ? "yes" : "no");
+		freelocale(copy);
+		threadLocaleRelease();
+	}
+
+	// the format can also be written by hand, which is how to print numbers
+	// the Brazilian way even on a system without pt_BR
+	struct numberFormat brazilian = {",", ".", "\3"};
+	struct numberFormat indian = {".", ",", "\3\2"}; // the lakh: 1,23,45,678
+	char text[64];
+	formatFixed(text, 1234567.891, 2, &brazilian);
+	printf("formatFixed(1234567.891, 2) the Brazilian way: %s\n", text);
+	formatFixed(text, 12345678.5, 1, &indian);
+	printf("formatFixed(12345678.5, 1) the Indian way: %s\n", text);
+
+	size_t failures = formatFixedTest(5, 20000);
+	printf("formatFixed() against printf(\"%%'.*f\") in every locale above: %s (%zu different)\n", failures == 0 ? "ok" : "FAILED", failures);
+}
+
+
+// the ways the benchmark threads format their numbers
+enum localeMethod {
+	LOCALE_SETLOCALE, // setlocale() to the locale and back around every number, under a lock
+	LOCALE_GLOBAL, // snprintf() in the global locale, set once before the threads start
+	LOCALE_THREAD, // snprintf() in the thread's own locale from uselocale()
+	LOCALE_CACHED, // formatFixed() with the thread's cached format
+	LOCALE_METHODS
+};
+
+static const char *localeMethodNames[LOCALE_METHODS] = {"setlocale+lock", "global", "uselocale", "cached"};
+
+struct localeWorker {
+	enum localeMethod method;
+	const char *localeName;
+	mtx_t *lock;
+	size_t count;
+	size_t bytes; // so the work can't be thrown away
+};
+
+static int localeWorkerMain(void *arg) {
+	struct localeWorker *worker = arg;
+	if(worker->method == LOCALE_THREAD || worker->method == LOCALE_CACHED) {
+		threadLocaleUse(worker->localeName);
+	}
+	// only the cached method reads the format, and only from its own locale:
+	// in the others localeconv() would read the global locale while other
+	// workers are changing it
+	const struct numberFormat *format = worker->method == LOCALE_CACHED ? threadNumberFormat() : NULL;
+	char text[64];
+	unsigned seed = 77;
+	for(size_t i = 0; i < worker->count; i++) {
+		seed = seed * 1103515245u + 12345u;
+		double price = (double) (seed >> 4) / 100;
+		switch(worker->method) {
+			case LOCALE_SETLOCALE:
+				mtx_lock(worker->lock);
+				setlocale(LC_NUMERIC, worker->localeName);
+				worker->bytes += snprintf(text, sizeof(text), "%'.2f", price);
+				setlocale(LC_NUMERIC, "C");
+				mtx_unlock(worker->lock);
+				break;
+			case LOCALE_GLOBAL:
+			case LOCALE_THREAD:
+				worker->bytes += snprintf(text, sizeof(text), "%'.2f", price);
+				break;
+			default:
+				worker->bytes += formatFixed(text, price, 2, format);
+		}
+	}
+	threadLocaleRelease();
+	return 0;
+}
+
+void benchLocaleH() {
+	// millions of prices formatted per second by all the threads together,
+	// for 1, 2, 4... up to -t threads
+	const char *name = "C.UTF-8";
+	for(size_t c = 2; c < LOCALE_CANDIDATES; c++) {
+		locale_t locale = newlocale(LC_ALL_MASK, localeCandidates[c], (locale_t) 0);
+		if(locale != (locale_t) 0) {
+			name = localeCandidates[c]; // one with grouping, if there's any
+			freelocale(locale);
+			break;
+		}
+	}
+	size_t failures = formatFixedTest(5, 20000);
+	printf("formatFixed() against printf(): %s (%zu different)\n", failures == 0 ? "ok" : "FAILED", failures);
+	printf("formatting prices with 2 decimals in %s\n\n", name);
+
+	char *savedLocale = strdup(setlocale(LC_ALL, NULL));
+	mtx_t lock;
+	mtx_init(&lock, mtx_plain);
+	size_t count = 200000;
+	printf("%-8s", "threads");
+	for(int method = 0; method < LOCALE_METHODS; method++) {
+		printf(" %15s", localeMethodNames[method]);
+	}
+	printf("   (million numbers/s)\n");
+	int maxThreads = benchThreadCount();
+	for(int threads = 1; threads <= maxThreads; threads = nextThreadStep(threads, maxThreads)) {
+		printf("%-8d", threads);
+		for(int method = 0; method < LOCALE_METHODS; method++) {
+			setlocale(LC_NUMERIC, method == LOCALE_GLOBAL ? name : "C");
+			struct localeWorker workers[threads];
+			thrd_t ids[threads];
+			uint64_t start = monotonicNs();
+			int started = 0;
+			for(; started < threads; started++) {
+				workers[started] = (struct localeWorker) {method, name, &lock, count, 0};
+				if(thrd_create(&ids[started], localeWorkerMain, &workers[started]) != thrd_success) {
+					break;
+				}
+			}
+			for(int t = 0; t < started; t++) {
+				thrd_join(ids[t], NULL);
+				benchKeep(workers[t].bytes);
+			}
+			uint64_t ns = monotonicNs() - start;
+			printf(" %15.2f", (double) started * count * 1000 / ns);
+		}
+		printf("\n");
+	}
+	mtx_destroy(&lock);
+	setlocale(LC_ALL, savedLocale);
+	free(savedLocale);
+}
+
+
+
+// BATCH MATH ON WHOLE ARRAYS
+// the functions above take one number and give back one number, so calling
+// them on a million values means a million calls, each one checking for
+// special cases on its own. here we compute 8 floats (or 4 doubles) at once
+// with polynomial approximations, using GCC's vector extensions: a vector
+// type works like a small array that + - * / and comparisons operate on lane
+// by lane. the same code becomes SSE2 instructions by default, and AVX2 (with
+// FMA) in the functions compiled with target("avx2,fma")
+//
+// the kernels take pointers instead of vector values because passing 32 byte
+// vectors by value to code compiled without AVX changes the calling convention
+
+typedef float mathFloats __attribute__((vector_size(32))); // 8 floats
+typedef int32_t mathInts __attribute__((vector_size(32))); // and their bits
+typedef uint32_t mathUnsignedInts __attribute__((vector_size(32)));
+typedef double mathDoubles __attribute__((vector_size(32))); // 4 doubles
+typedef int64_t mathLongs __attribute__((vector_size(32)));
+// SSE2 can't shift 64 bit integers right keeping the sign, so those shifts are done unsigned
+typedef uint64_t mathUnsignedLongs __attribute__((vector_size(32)));
+// and the 16 byte halves of all of them
+typedef float mathFloatHalf __attribute__((vector_size(16)));
+typedef int32_t mathIntHalf __attribute__((vector_size(16)));
+typedef double mathDoubleHalf __attribute__((vector_size(16)));
+typedef int64_t mathLongHalf __attribute__((vector_size(16)));
+
+#define MATH_FLOAT_LANES 8
+#define MATH_DOUBLE_LANES 4
+
+// comparisons give -1 (all bits set) in the lanes where they are true and 0
+// elsewhere, so choosing between a and b lane by lane is just bitwise logic
+#define SELECT_FLOATS(mask, a, b) ((mathFloats) (((mathInts) (a) & (mask)) | ((mathInts) (b) & ~(mask))))
+#define SELECT_DOUBLES(mask, a, b) ((mathDoubles) (((mathLongs) (a) & (mask)) | ((mathLongs) (b) & ~(mask))))
+
+// a vector with c in every lane
+#define BROADCAST_FLOATS(c) ((mathFloats) {0} + (c))
+#define BROADCAST_DOUBLES(c) ((mathDoubles) {0} + (c))
+
+// comparing two 32 byte vectors is one instruction with AVX, but in plain SSE2
+// code GCC turns it into a scalar comparison and a jump per lane. with split
+// set they are compared 16 bytes at a time instead, through a union (GCC
+// glues unions back together better than shuffles). split is always a
+// constant, so the branch that isn't taken disappears from the code
+#define COMPARE_FLOATS(a, op, b, split) ({ \
+	mathFloats leftSide = (a), rightSide = BROADCAST_FLOATS(b); \
+	mathInts mask; \
+	if(split) { \
+		union { mathInts whole; mathIntHalf halves[2]; mathFloatHalf sides[2]; } left = {.whole = (mathInts) leftSide}, right = {.whole = (mathInts) rightSide}, result; \
+		result.halves[0] = left.sides[0] op right.sides[0]; \
+		result.halves[1] = left.sides[1] op right.sides[1]; \
+		mask = result.whole; \
+	} else { \
+		mask = leftSide op rightSide; \
+	} \
+	mask; \
+})
+#define COMPARE_DOUBLES(a, op, b, split) ({ \
+	mathDoubles leftSide = (a), rightSide = BROADCAST_DOUBLES(b); \
+	mathLongs mask; \
+	if(split) { \
+		union { mathLongs whole; mathLongHalf halves[2]; mathDoubleHalf sides[2]; } left = {.whole = (mathLongs) leftSide}, right = {.whole = (mathLongs) rightSide}, result; \
+		result.halves[0] = left.sides[0] op right.sides[0]; \
+		result.halves[1] = left.sides[1] op right.sides[1]; \
+		mask = result.whole; \
+	} else { \
+		mask = leftSide op rightSide; \
+	} \
+	mask; \
+})
+
+// adding and subtracting 1.5 * 2^23 rounds a float to the nearest integer
+// (the addition pushes the fraction bits out of the mantissa), and right after
+// the addition the low bits of the float ARE that integer, so we get it as an
+// int without a conversion instruction. the same goes for doubles with 1.5 * 2^52
+#define FLOAT_ROUNDER 12582912.0f
+#define FLOAT_ROUNDER_BITS 0x4B400000
+#define DOUBLE_ROUNDER 6755399441055744.0
+#define DOUBLE_ROUNDER_BITS 0x4338000000000000
+
+static inline __attribute__((always_inline)) void expFloatLanes(mathFloats *value, bool split) {
+	mathFloats x = *value;
+	// outside this range the result is 0 or infinity anyway
+	mathFloats clamped = SELECT_FLOATS(COMPARE_FLOATS(x, >, 89.0f, split), BROADCAST_FLOATS(89.0f), x);
+	clamped = SELECT_FLOATS(COMPARE_FLOATS(clamped, <, -104.0f, split), BROADCAST_FLOATS(-104.0f), clamped);
+	// e^x = 2^n * e^r, with n = round(x / ln 2) and |r| <= ln(2) / 2
+	mathFloats shifted = clamped * 1.44269504088896341f + FLOAT_ROUNDER;
+	mathInts n = (mathInts) shifted - FLOAT_ROUNDER_BITS;
+	mathFloats nf = shifted - FLOAT_ROUNDER;
+	// ln 2 in two parts, the first with few bits so n * part is exact
+	mathFloats r = clamped - nf * 0.693359375f;
+	r = r - nf * -2.12194440e-4f;
+	// the polynomial for e^r (coefficients from the Cephes library)
+	mathFloats p = BROADCAST_FLOATS(1.9875691500e-4f);
+	p = p * r + 1.3981999507e-3f;
+	p = p * r + 8.3334519073e-3f;
+	p = p * r + 4.1665795894e-2f;
+	p = p * r + 1.6666665459e-1f;
+	p = p * r + 5.0000001201e-1f;
+	p = p * r * r + r + 1.0f;
+	// 2^n is built right in the exponent bits, in two halves so that neither
+	// half overflows, and results that are too small fade out gradually
+	mathInts half = n >> 1;
+	mathFloats scale1 = (mathFloats) ((half + 127) << 23);
+	mathFloats scale2 = (mathFloats) ((n - half + 127) << 23);
+	mathFloats y = p * scale1 * scale2;
+	*value = SELECT_FLOATS(COMPARE_FLOATS(x, !=, x, split), x, y); // NaN stays NaN
+}
+
+static inline __attribute__((always_inline)) void expDoubleLanes(mathDoubles *value, bool split) {
+	mathDoubles x = *value;
+	mathDoubles clamped = SELECT_DOUBLES(COMPARE_DOUBLES(x, >, 710.0, split), BROADCAST_DOUBLES(710.0), x);
+	clamped = SELECT_DOUBLES(COMPARE_DOUBLES(clamped, <, -746.0, split), BROADCAST_DOUBLES(-746.0), clamped);
+	mathDoubles shifted = clamped * 1.44269504088896338700 + DOUBLE_ROUNDER;
+	mathLongs n = (mathLongs) shifted - DOUBLE_ROUNDER_BITS;
+	mathDoubles nf = shifted - DOUBLE_ROUNDER;
+	mathDoubles r = clamped - nf * 6.93147180369123816490e-01;
+	r = r - nf * 1.90821492927058770002e-10;
+	// for doubles the Taylor series up to r^13 / 13! is already good enough
+	mathDoubles p = BROADCAST_DOUBLES(1.0 / 6227020800.0);
+	p = p * r + 1.0 / 479001600.0;
+	p = p * r + 1.0 / 39916800.0;
+	p = p * r + 1.0 / 3628800.0;
+	p = p * r + 1.0 / 362880.0;
+	p = p * r + 1.0 / 40320.0;
+	p = p * r + 1.0 / 5040.0;
+	p = p * r + 1.0 / 720.0;
+	p = p * r + 1.0 / 120.0;
+	p = p * r + 1.0 / 24.0;
+	p = p * r + 1.0 / 6.0;
+	p = p * r + 0.5;
+	p = p * r * r + r + 1.0;
+	// n / 2 rounded (any split of n in two halves works)
+	mathLongs half = (mathLongs) (nf * 0.5 + DOUBLE_ROUNDER) - DOUBLE_ROUNDER_BITS;
+	mathDoubles scale1 = (mathDoubles) ((half + 1023) << 52);
+	mathDoubles scale2 = (mathDoubles) ((n - half + 1023) << 52);
+	mathDoubles y = p * scale1 * scale2;
+	*value = SELECT_DOUBLES(COMPARE_DOUBLES(x, !=, x, split), x, y);
+}
+
+static inline __attribute__((always_inline)) void logFloatLanes(mathFloats *value, bool split) {
+	mathFloats x = *value;
+	// subnormal numbers don't have the usual exponent bits, so scale them
+	// up by 2^25 first and take 25 out of the exponent later
+	mathInts tiny = COMPARE_FLOATS(x, <, 1.17549435e-38f, split);
+	mathFloats scaled = SELECT_FLOATS(tiny, x * 33554432.0f, x);
+	mathInts bits = (mathInts) scaled;
+	mathInts e = ((bits >> 23) & 0xFF) - 127 - (tiny & 25);
+	// x = 2^e * m, with m in [sqrt(2)/2, sqrt(2)) so log(m) is small
+	mathFloats m = (mathFloats) ((bits & 0x007FFFFF) | 0x3F800000);
+	mathInts big = COMPARE_FLOATS(m, >, 1.41421356f, split);
+	m = SELECT_FLOATS(big, m * 0.5f, m);
+	e = e - big; // big is -1 where it's true
+	mathFloats ef = (mathFloats) (e + FLOAT_ROUNDER_BITS) - FLOAT_ROUNDER;
+	// log(1 + f) = 2 atanh(s) with s = f / (2 + f), and the polynomial is in
+	// s^2 (this way of splitting the sum comes from fdlibm)
+	mathFloats f = m - 1.0f;
+	mathFloats s = f / (f + 2.0f);
+	mathFloats z = s * s;
+	mathFloats halfSquare = 0.5f * f * f;
+	mathFloats r = z * (0.66666662693f + z * (0.40000972152f + z * (0.28498786688f + z * 0.24279078841f)));
+	mathFloats y = ef * 6.9313812256e-01f - ((halfSquare - (s * (halfSquare + r) + ef * 9.0580006145e-06f)) - f);
+	// log(negative) is NaN, log(0) is -infinity and log(infinity) is infinity
+	y = SELECT_FLOATS(COMPARE_FLOATS(x, ==, 0.0f, split), BROADCAST_FLOATS(-__builtin_inff()), y);
+	y = SELECT_FLOATS(COMPARE_FLOATS(x, ==, __builtin_inff(), split), x, y);
+	y = SELECT_FLOATS(COMPARE_FLOATS(x, <, 0.0f, split), BROADCAST_FLOATS(__builtin_nanf("")), y);
+	*value = SELECT_FLOATS(COMPARE_FLOATS(x, !=, x, split), x, y);
+}
+
+static inline __attribute__((always_inline)) void logDoubleLanes(mathDoubles *value, bool split) {
+	mathDoubles x = *value;
+	mathLongs tiny = COMPARE_DOUBLES(x, <, 2.2250738585072014e-308, split);
+	mathDoubles scaled = SELECT_DOUBLES(tiny, x * 18014398509481984.0, x);
+	mathLongs bits = (mathLongs) scaled;
+	mathLongs e = (mathLongs) (((mathUnsignedLongs) bits >> 52) & 0x7FF) - 1023 - (tiny & 54);
+	mathDoubles m = (mathDoubles) ((bits & 0x000FFFFFFFFFFFFF) | 0x3FF0000000000000);
+	mathLongs big = COMPARE_DOUBLES(m, >, 1.4142135623730951, split);
+	m = SELECT_DOUBLES(big, m * 0.5, m);
+	e = e - big;
+	mathDoubles ed = (mathDoubles) (e + DOUBLE_ROUNDER_BITS) - DOUBLE_ROUNDER;
+	mathDoubles f = m - 1.0;
+	mathDoubles s = f / (f + 2.0);
+	mathDoubles z = s * s;
+	mathDoubles halfSquare = 0.5 * f * f;
+	// the fdlibm coefficients, slightly tuned versions of 2 / (2k + 1)
+	mathDoubles r = BROADCAST_DOUBLES(1.479819860511658591e-01);
+	r = r * z + 1.531383769920937332e-01;
+	r = r * z + 1.818357216161805012e-01;
+	r = r * z + 2.222219843214978396e-01;
+	r = r * z + 2.857142874366239149e-01;
+	r = r * z + 3.999999999940941908e-01;
+	r = r * z + 6.666666666666735130e-01;
+	r = r * z;
+	mathDoubles y = ed * 6.93147180369123816490e-01 - ((halfSquare - (s * (halfSquare + r) + ed * 1.90821492927058770002e-10)) - f);
+	y = SELECT_DOUBLES(COMPARE_DOUBLES(x, ==, 0.0, split), BROADCAST_DOUBLES(-__builtin_inf()), y);
+	y = SELECT_DOUBLES(COMPARE_DOUBLES(x, ==, __builtin_inf(), split), x, y);
+	y = SELECT_DOUBLES(COMPARE_DOUBLES(x, <, 0.0, split), BROADCAST_DOUBLES(__builtin_nan("")), y);
+	*value = SELECT_DOUBLES(COMPARE_DOUBLES(x, !=, x, split), x, y);
+}
+
+// sine and cosine share everything: x = n * pi/2 + r with |r| <= pi/4, and
+// then depending on n % 4 the answer is sin(r), cos(r), -sin(r) or -cos(r).
+// "phase" is 0 for sine and 1 for cosine (cos(x) = sin(x + pi/2)).
+// pi/2 is split in three parts so n * part stays exact, which only works
+// while n is small: bigger inputs go to libm one by one
+#define SINCOS_LIMIT 100000.0
+
+static inline __attribute__((always_inline)) void sinCosFloatLanes(mathFloats *value, int phase) {
+	mathFloats x = *value;
+	// near the zeros of sin and cos r is tiny and a float version of pi/2
+	// loses all its bits, so the reduction is done in doubles, half at a time
+	mathFloatHalf rHalves[2];
+	mathIntHalf nHalves[2];
+	for(int h = 0; h < 2; h++) {
+		mathFloatHalf half = h == 0 ? __builtin_shufflevector(x, x, 0, 1, 2, 3) : __builtin_shufflevector(x, x, 4, 5, 6, 7);
+		mathDoubles xd = __builtin_convertvector(half, mathDoubles);
+		mathDoubles shifted = xd * 6.36619772367581382433e-01 + DOUBLE_ROUNDER;
+		mathDoubles nf = shifted - DOUBLE_ROUNDER;
+		mathDoubles r = (xd - nf * 1.57079632673412561417e+00) - nf * 6.07710050650619224932e-11;
+		rHalves[h] = __builtin_convertvector(r, mathFloatHalf);
+		nHalves[h] = __builtin_convertvector((mathLongs) shifted - DOUBLE_ROUNDER_BITS, mathIntHalf);
+	}
+	mathFloats r = __builtin_shufflevector(rHalves[0], rHalves[1], 0, 1, 2, 3, 4, 5, 6, 7);
+	mathInts n = __builtin_shufflevector(nHalves[0], nHalves[1], 0, 1, 2, 3, 4, 5, 6, 7);
+	mathFloats z = r * r;
+	// the Cephes polynomials for sin and cos on [-pi/4, pi/4]
+	mathFloats sine = r + r * z * ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f);
+	mathFloats cosine = 1.0f - 0.5f * z + z * z * ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f);
+	mathInts quadrant = n + phase;
+	mathFloats y = SELECT_FLOATS(-(quadrant & 1), cosine, sine); // -1 in the odd quadrants
+	y = (mathFloats) ((mathUnsignedInts) y ^ ((mathUnsignedInts) (quadrant & 2) << 30)); // flip the sign bit in quadrants 2 and 3
+	*value = y;
+}
+
+static inline __attribute__((always_inline)) void sinCosDoubleLanes(mathDoubles *value, int phase) {
+	mathDoubles x = *value;
+	mathDoubles shifted = x * 6.36619772367581382433e-01 + DOUBLE_ROUNDER;
+	mathLongs n = (mathLongs) shifted - DOUBLE_ROUNDER_BITS;
+	mathDoubles nf = shifted - DOUBLE_ROUNDER;
+	mathDoubles r = ((x - nf * 1.57079632673412561417e+00) - nf * 6.07710050630396597660e-11) - nf * 2.02226624879595063154e-21;
+	mathDoubles z = r * r;
+	// the fdlibm kernel polynomials
+	mathDoubles sine = BROADCAST_DOUBLES(1.58969099521155010221e-10);
+	sine = sine * z - 2.50507602534068634195e-08;
+	sine = sine * z + 2.75573137070700676789e-06;
+	sine = sine * z - 1.98412698298579493134e-04;
+	sine = sine * z + 8.33333333332248946124e-03;
+	sine = sine * z - 1.66666666666666324348e-01;
+	sine = r + r * z * sine;
+	mathDoubles cosine = BROADCAST_DOUBLES(-1.13596475577881948265e-11);
+	cosine = cosine * z + 2.08757232129817482790e-09;
+	cosine = cosine * z - 2.75573143513906633035e-07;
+	cosine = cosine * z + 2.48015872894767294178e-05;
+	cosine = cosine * z - 1.38888888888741095749e-03;
+	cosine = cosine * z + 4.16666666666666019037e-02;
+	cosine = 1.0 - 0.5 * z + z * z * cosine;
+	mathLongs quadrant = n + phase;
+	mathDoubles y = SELECT_DOUBLES(-(quadrant & 1), cosine, sine);
+	y = (mathDoubles) ((mathLongs) ((mathUnsignedLongs) y ^ ((mathUnsignedLongs) (quadrant & 2) << 62)));
+	*value = y;
+}
+
+// whether every lane is inside the range the reduction above handles. one
+// vector comparison (split like the others) instead of one per lane, and
+// !(|x| <= limit) is also true for NaN and infinity
+static inline __attribute__((always_inline)) bool sinCosFloatsInRange(mathFloats x, bool split) {
+	mathFloats magnitude = (mathFloats) ((mathUnsignedInts) x & 0x7FFFFFFFu);
+	mathInts inside = COMPARE_FLOATS(magnitude, <=, (float) SINCOS_LIMIT, split);
+	int all = -1;
+	for(int i = 0; i < MATH_FLOAT_LANES; i++) {
+		all &= inside[i];
+	}
+	return all != 0;
+}
+
+static inline __attribute__((always_inline)) bool sinCosDoublesInRange(mathDoubles x, bool split) {
+	mathDoubles magnitude = (mathDoubles) ((mathLongs) ((mathUnsignedLongs) x & 0x7FFFFFFFFFFFFFFFu));
+	mathLongs inside = COMPARE_DOUBLES(magnitude, <=, SINCOS_LIMIT, split);
+	int64_t all = -1;
+	for(int i = 0; i < MATH_DOUBLE_LANES; i++) {
+		all &= inside[i];
+	}
+	return all != 0;
+}
+
+static inline __attribute__((always_inline)) void sinFloatLanes(mathFloats *value, bool split) {
+	mathFloats x = *value;
+	sinCosFloatLanes(value, 0);
+	if(sinCosFloatsInRange(x, split)) {
+		return;
+	}
+	for(int i = 0; i < MATH_FLOAT_LANES; i++) {
+		if(!(__builtin_fabsf(x[i]) <= SINCOS_LIMIT)) (*value)[i] = sinf(x[i]);
+	}
+}
+
+static inline __attribute__((always_inline)) void cosFloatLanes(mathFloats *value, bool split) {
+	mathFloats x = *value;
+	sinCosFloatLanes(value, 1);
+	if(sinCosFloatsInRange(x, split)) {
+		return;
+	}
+	for(int i = 0; i < MATH_FLOAT_LANES; i++) {
+		if(!(__builtin_fabsf(x[i]) <= SINCOS_LIMIT)) (*value)[i] = cosf(x[i]);
+	}
+}
+
+static inline __attribute__((always_inline)) void sinDoubleLanes(mathDoubles *value, bool split) {
+	mathDoubles x = *value;
+	sinCosDoubleLanes(value, 0);
+	if(sinCosDoublesInRange(x, split)) {
+		return;
+	}
+	for(int i = 0; i < MATH_DOUBLE_LANES; i++) {
+		if(!(__builtin_fabs(x[i]) <= SINCOS_LIMIT)) (*value)[i] = sin(x[i]);
+	}
+}
+
+static inline __attribute__((always_inline)) void cosDoubleLanes(mathDoubles *value, bool split) {
+	mathDoubles x = *value;
+	sinCosDoubleLanes(value, 1);
+	if(sinCosDoublesInRange(x, split)) {
+		return;
+	}
+	for(int i = 0; i < MATH_DOUBLE_LANES; i++) {
+		if(!(__builtin_fabs(x[i]) <= SINCOS_LIMIT)) (*value)[i] = cos(x[i]);
+	}
+}
+
+// the array loop around a kernel: whole vectors straight from the array, and
+// the last few elements through a vector padded with ones, so every element
+// goes through exactly the same code
+#define VECTOR_MATH_LOOP(name, type, vectorType, lanes, kernel, split, attributes) \
+	attributes static void name(type *out, const type *in, size_t n) { \
+		size_t i = 0; \
+		for(; i + lanes <= n; i += lanes) { \
+			vectorType v; \
+			memcpy(&v, in + i, sizeof(v)); \
+			kernel(&v, split); \
+			memcpy(out + i, &v, sizeof(v)); \
+		} \
+		if(i < n) { \
+			vectorType v; \
+			for(size_t k = 0; k < lanes; k++) { \
+				v[k] = i + k < n ? in[i + k] : 1; \
+			} \
+			kernel(&v, split); \
+			for(size_t k = 0; i + k < n; k++) { \
+				out[i + k] = v[k]; \
+			} \
+		} \
+	}
+
+#define MATH_AVX2 __attribute__((target("avx2,fma")))
+
+VECTOR_MATH_LOOP(vexpfSse2, float, mathFloats, MATH_FLOAT_LANES, expFloatLanes, true, )
+VECTOR_MATH_LOOP(vlogfSse2, float, mathFloats, MATH_FLOAT_LANES, logFloatLanes, true, )
+VECTOR_MATH_LOOP(vsinfSse2, float, mathFloats, MATH_FLOAT_LANES, sinFloatLanes, true, )
+VECTOR_MATH_LOOP(vcosfSse2, float, mathFloats, MATH_FLOAT_LANES, cosFloatLanes, true, )
+VECTOR_MATH_LOOP(vexpSse2, double, mathDoubles, MATH_DOUBLE_LANES, expDoubleLanes, true, )
+VECTOR_MATH_LOOP(vlogSse2, double, mathDoubles, MATH_DOUBLE_LANES, logDoubleLanes, true, )
+VECTOR_MATH_LOOP(vsinSse2, double, mathDoubles, MATH_DOUBLE_LANES, sinDoubleLanes, true, )
+VECTOR_MATH_LOOP(vcosSse2, double, mathDoubles, MATH_DOUBLE_LANES, cosDoubleLanes, true, )
+#if defined(__x86_64__) || defined(__i386__)
+VECTOR_MATH_LOOP(vexpfAvx2, float, mathFloats, MATH_FLOAT_LANES, expFloatLanes, false, MATH_AVX2)
+VECTOR_MATH_LOOP(vlogfAvx2, float, mathFloats, MATH_FLOAT_LANES, logFloatLanes, false, MATH_AVX2)
+VECTOR_MATH_LOOP(vsinfAvx2, float, mathFloats, MATH_FLOAT_LANES, sinFloatLanes, false, MATH_AVX2)
+VECTOR_MATH_LOOP(vcosfAvx2, float, mathFloats, MATH_FLOAT_LANES, cosFloatLanes, false, MATH_AVX2)
+VECTOR_MATH_LOOP(vexpAvx2, double, mathDoubles, MATH_DOUBLE_LANES, expDoubleLanes, false, MATH_AVX2)
+VECTOR_MATH_LOOP(vlogAvx2, double, mathDoubles, MATH_DOUBLE_LANES, logDoubleLanes, false, MATH_AVX2)
+VECTOR_MATH_LOOP(vsinAvx2, double, mathDoubles, MATH_DOUBLE_LANES, sinDoubleLanes, false, MATH_AVX2)
+VECTOR_MATH_LOOP(vcosAvx2, double, mathDoubles, MATH_DOUBLE_LANES, cosDoubleLanes, false, MATH_AVX2)
+#else
+// without x86 the "Avx2" versions are just the generic ones
+#define vexpfAvx2 vexpfSse2
+#define vlogfAvx2 vlogfSse2
+#define vsinfAvx2 vsinfSse2
+#define vcosfAvx2 vcosfSse2
+#define vexpAvx2 vexpSse2
+#define vlogAvx2 vlogSse2
+#define vsinAvx2 vsinSse2
+#define vcosAvx2 vcosSse2
+#endif
+
+static bool mathHasAvx2() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+	return false;
+#endif
+}
+
+// the public functions: out[i] = f(in[i]) for every i (out may be the same array as in)
+static void vexpf(float *out, const float *in, size_t n) { (mathHasAvx2() ? vexpfAvx2 : vexpfSse2)(out, in, n); }
+static void vlogf(float *out, const float *in, size_t n) { (mathHasAvx2() ? vlogfAvx2 : vlogfSse2)(out, in, n); }
+static void vsinf(float *out, const float *in, size_t n) { (mathHasAvx2() ? vsinfAvx2 : vsinfSse2)(out, in, n); }
+static void vcosf(float *out, const float *in, size_t n) { (mathHasAvx2() ? vcosfAvx2 : vcosfSse2)(out, in, n); }
+static void vexp(double *out, const double *in, size_t n) { (mathHasAvx2() ? vexpAvx2 : vexpSse2)(out, in, n); }
+static void vlog(double *out, const double *in, size_t n) { (mathHasAvx2() ? vlogAvx2 : vlogSse2)(out, in, n); }
+static void vsin(double *out, const double *in, size_t n) { (mathHasAvx2() ? vsinAvx2 : vsinSse2)(out, in, n); }
+static void vcos(double *out, const double *in, size_t n) { (mathHasAvx2() ? vcosAvx2 : vcosSse2)(out, in, n); }
+
+// everything the accuracy sweep and the benchmark need to know about each function
+struct floatMathFunction {
+	const char *name;
+	void (*versions[2])(float *out, const float *in, size_t n); // SSE2 and AVX2
+	float (*libm)(float x);
+	float low, high; // the domain to sweep
+	bool logarithmic; // sweep the exponents evenly instead of the values
+};
+
+struct doubleMathFunction {
+	const char *name;
+	void (*versions[2])(double *out, const double *in, size_t n);
+	double (*libm)(double x);
+	double low, high;
+	bool logarithmic;
+};
+
+// (with tgmath.h, "exp" followed by parentheses is a macro, but
+// without them it's just the name of the libm function)
+static const struct floatMathFunction floatMathFunctions[] = {
+	{"vexpf", {vexpfSse2, vexpfAvx2}, expf, -103.0f, 88.7f, false},
+	{"vlogf", {vlogfSse2, vlogfAvx2}, logf, 1e-44f, 3e38f, true},
+	{"vsinf", {vsinfSse2, vsinfAvx2}, sinf, -SINCOS_LIMIT, SINCOS_LIMIT, false},
+	{"vcosf", {vcosfSse2, vcosfAvx2}, cosf, -SINCOS_LIMIT, SINCOS_LIMIT, false},
+};
+
+static const struct doubleMathFunction doubleMathFunctions[] = {
+	{"vexp", {vexpSse2, vexpAvx2}, exp, -708.0, 709.0, false},
+	{"vlog", {vlogSse2, vlogAvx2}, log, 1e-320, 1e308, true},
+	{"vsin", {vsinSse2, vsinAvx2}, sin, -SINCOS_LIMIT, SINCOS_LIMIT, false},
+	{"vcos", {vcosSse2, vcosAvx2}, cos, -SINCOS_LIMIT, SINCOS_LIMIT, false},
+};
+
+static const char *mathVersionNames[2] = {"sse2", "avx2"};
+
+// the distance between two floats in ULPs (units in the last place): how many
+// representable floats are between them. reinterpreting the bits as integers
+// (and flipping the negative ones) puts all floats in order on a number line
+static uint64_t ulpDistanceFloat(float a, float b) {
+	if(a != a || b != b) {
+		return (a != a) == (b != b) ? 0 : UINT32_MAX; // two NaNs are "equal"
+	}
+	int32_t x, y;
+	memcpy(&x, &a, sizeof(x));
+	memcpy(&y, &b, sizeof(y));
+	int64_t ox = x < 0 ? (int64_t) INT32_MIN - x : x;
+	int64_t oy = y < 0 ? (int64_t) INT32_MIN - y : y;
+	return ox > oy ? ox - oy : oy - ox;
+}
+
+static uint64_t ulpDistanceDouble(double a, double b) {
+	if(a != a || b != b) {
+		return (a != a) == (b != b) ? 0 : UINT64_MAX;
+	}
+	int64_t x, y;
+	memcpy(&x, &a, sizeof(x));
+	memcpy(&y, &b, sizeof(y));
+	// the ordered values of two doubles of opposite signs can be 2^64 apart,
+	// so the subtraction is done in unsigned arithmetic
+	uint64_t ox = x < 0 ? (uint64_t) INT64_MIN - (uint64_t) x : (uint64_t) x + (uint64_t) INT64_MIN;
+	uint64_t oy = y < 0 ? (uint64_t) INT64_MIN - (uint64_t) y : (uint64_t) y + (uint64_t) INT64_MIN;
+	return ox > oy ? ox - oy : oy - ox;
+}
+
+// the i-th of "count" points spread over [low, high]
+static double sweepPoint(double low, double high, bool logarithmic, size_t i, size_t count) {
+	double t = (double) i / (count - 1);
+	if(logarithmic) {
+		return exp2(log2(low) + t * (log2(high) - log2(low)));
+	}
+	return low + t * (high - low);
+}
+
+struct ulpReport {
+	uint64_t max;
+	double mean;
+	double worstInput;
+};
+
+static struct ulpReport floatUlpSweep(const struct floatMathFunction *function, int version, size_t count) {
+	struct ulpReport report = {0, 0, 0};
+	float *in = malloc(count * sizeof(float));
+	float *out = malloc(count * sizeof(float));
+	if(in == NULL || out == NULL) {
+		free(in);
+		free(out);
+		report.max = UINT64_MAX;
+		return report;
+	}
+	for(size_t i = 0; i < count; i++) {
+		in[i] = (float) sweepPoint(function->low, function->high, function->logarithmic, i, count);
+	}
+	function->versions[version](out, in, count);
+	double total = 0;
+	for(size_t i = 0; i < count; i++) {
+		uint64_t ulps = ulpDistanceFloat(out[i], function->libm(in[i]));
+		total += ulps;
+		if(ulps > report.max) {
+			report.max = ulps;
+			report.worstInput = in[i];
+		}
+	}
+	report.mean = total / count;
+	free(in);
+	free(out);
+	return report;
+}
+
+static struct ulpReport doubleUlpSweep(const struct doubleMathFunction *function, int version, size_t count) {
+	struct ulpReport report = {0, 0, 0};
+	double *in = malloc(count * sizeof(double));
+	double *out = malloc(count * sizeof(double));
+	if(in == NULL || out == NULL) {
+		free(in);
+		free(out);
+		report.max = UINT64_MAX;
+		return report;
+	}
+	for(size_t i = 0; i < count; i++) {
+		in[i] = sweepPoint(function->low, function->high, function->logarithmic, i, count);
+	}
+	function->versions[version](out, in, count);
+	double total = 0;
+	for(size_t i = 0; i < count; i++) {
+		uint64_t ulps = ulpDistanceDouble(out[i], function->libm(in[i]));
+		total += ulps;
+		if(ulps > report.max) {
+			report.max = ulps;
+			report.worstInput = in[i];
+		}
+	}
+	report.mean = total / count;
+	free(in);
+	free(out);
+	return report;
+}
+
+
+
+void testMathH() {
+	// As the name sugests, this header contains a lot of usefull math functions
+	int a = 3;
+	int b = -5;
+	double c = 1.25;
+	double d = 4.999999;
+	double e = 10.0;
+	float f = 2.5;
+	float g = 8.0;
+
+	// absolute value
+	printf("\n\nabsolute value of %d: %d\n", b, abs(b));
+	// division: returns the quotient and the remainder
+	printf("%d/%d is equal to %d and the remainder is %d\n", b, a, div(b, a).quot, div(b, a).rem);
+	// calculates the remainder of a floating point division
+	printf("the remainder of %.1f/%.1f is %.1f\n", g, f, remainder(g, f));
+	// calculates (a * b) + c
+	printf("%lf * %lf + %lf = %lf\n", c, d, e, fma(c, d, e));
+	// get the bigger float
+	printf("the bigger foat is: %f\n", fmax(f, g));
+	// get the smaller float
+	printf("the smaller float is: %f\n", fmin(f, g));
+	// get the difference between two floats (or 0 if the first is smaller than the second)
+	printf("the difference between %f and %f is %f\n", g, f, fdim(g, f));
+	// get NaN (not a number)
+	printf("%f\n", nan("2"));
+	// exponential (in base e and 2)
+	printf("e^%d = %f\n", a, exp(a));
+	printf("2^%d = %f\n", b, exp2(b));
+	// logarithms (in base e, 2 and 10)
+	printf("ln(%d) = %f\n", a, log(a));
+	printf("log2(%d) = %f\n", a, log2(a));
+	printf("log10(%d) = %f\n", a, log10(a));
+	// power function (x^y)
+	printf("%d^%d = %f\n", b, a, pow(b, a));
+	// square root and cubic root
+	printf("square root of %d = %f\n", a, sqrt(a));
+	printf("cubic root of %d = %f\n", a, cbrt(a));
+	// trigonometric functions
+	printf("sine of %d = %f\n", a, sin(a));
+	printf("cosine of %d = %f\n", a, cos(a));
+	printf("tangent of %d = %f\n", a, tan(a));
+	// floor and ceil functions
+	printf("the floor of %.2f is %.1f\n", c, floor(c));
+	printf("the ceiling of %.2f is %.1f\n", c, ceil(c));
+	// INFINITY macro
+	printf("infinity = %f\n", INFINITY);
+	printf("%.1lf < %f = %s\n", pow(2, 64), INFINITY, pow(2, 64) < INFINITY ? "true" : "false");
+
+	// the batch versions (see above testMathH) do a whole array per call
+	float inputs[8] = {-2.0f, -0.5f, 0.0f, 0.5f, 1.0f, 2.5f, 10.0f, 80.0f};
+	float results[8];
+	vexpf(results, inputs, 8);
+	printf("\nvexpf against expf (%s kernels):\n", mathVersionNames[mathHasAvx2()]);
+	for(int i = 0; i < 8; i++) {
+		printf("  e^%-5.1f = %-14g %-14g (%llu ulps apart)\n", inputs[i], results[i], expf(inputs[i]),
+			(unsigned long long) ulpDistanceFloat(results[i], expf(inputs[i])));
+	}
+	// log undoes exp, and sin^2 + cos^2 is 1, for whole arrays at a time
+	double values[5] = {-3.0, 0.001, 0.7, 42.0, 600.0};
+	double exps[5], logs[5], sines[5], cosines[5];
+	float floatValues[5] = {0.25f, 1.0f, 3.0f, 100.0f, 5000.0f};
+	float floatLogs[5], floatSines[5], floatCosines[5];
+	vexp(exps, values, 5);
+	vlog(logs, exps, 5);
+	vsin(sines, values, 5);
+	vcos(cosines, values, 5);
+	vlogf(floatLogs, floatValues, 5);
+	vsinf(floatSines, floatValues, 5);
+	vcosf(floatCosines, floatValues, 5);
+	for(int i = 0; i < 5; i++) {
+		printf("  log(e^%g) = %.17g, sin^2 + cos^2 = %.17g | ln(%g) = %.9g, sin^2 + cos^2 = %.9g\n",
+			values[i], logs[i], sines[i] * sines[i] + cosines[i] * cosines[i],
+			floatValues[i], floatLogs[i], floatSines[i] * floatSines[i] + floatCosines[i] * floatCosines[i]);
+	}
+	// and a quick accuracy sweep of every function (benchMathH does a longer one)
+	bool accurate = true;
+	for(size_t i = 0; i < sizeof(floatMathFunctions) / sizeof(floatMathFunctions[0]); i++) {
+		struct ulpReport report = floatUlpSweep(&floatMathFunctions[i], mathHasAvx2(), 10000);
+		printf("%-6s max %llu ulps\n", floatMathFunctions[i].name, (unsigned long long) report.max);
+		accurate = accurate && report.max <= 4;
+	}
+	for(size_t i = 0; i < sizeof(doubleMathFunctions) / sizeof(doubleMathFunctions[0]); i++) {
+		struct ulpReport report = doubleUlpSweep(&doubleMathFunctions[i], mathHasAvx2(), 10000);
+		printf("%-6s max %llu ulps\n", doubleMathFunctions[i].name, (unsigned long long) report.max);
+		accurate = accurate && report.max <= 4;
+	}
+	printf("batch math %s\n", accurate ? "within 4 ulps of libm" : "TOO FAR FROM LIBM");
+}
+
+
+
+void benchMathH() {
+	// first how far each kernel is from libm over its whole domain,
+	// then elements per nanosecond on an array that fits in the L1 cache
+	size_t samples = 1 << 22;
+	size_t n = 4096;
+	int repeats = 2000;
+	bool avx2 = mathHasAvx2();
+
+	printf("%-6s %-5s %10s %10s   %s\n", "", "", "max ulps", "mean ulps", "worst input");
+	for(size_t i = 0; i < sizeof(floatMathFunctions) / sizeof(floatMathFunctions[0]); i++) {
+		for(int version = 0; version <= avx2; version++) {
+			struct ulpReport report = floatUlpSweep(&floatMathFunctions[i], version, samples);
+			printf("%-6s %-5s %10llu %10.4f   %.9g\n", floatMathFunctions[i].name, mathVersionNames[version],
+				(unsigned long long) report.max, report.mean, report.worstInput);
+		}
+	}
+	for(size_t i = 0; i < sizeof(doubleMathFunctions) / sizeof(doubleMathFunctions[0]); i++) {
+		for(int version = 0; version <= avx2; version++) {
+			struct ulpReport report = doubleUlpSweep(&doubleMathFunctions[i], version, samples);
+			printf("%-6s %-5s %10llu %10.4f   %.17g\n", doubleMathFunctions[i].name, mathVersionNames[version],
+				(unsigned long long) report.max, report.mean, report.worstInput);
+		}
+	}
+
+	float *floatsIn = malloc(n * sizeof(float));
+	float *floatsOut = malloc(n * sizeof(float));
+	double *doublesIn = malloc(n * sizeof(double));
+	double *doublesOut = malloc(n * sizeof(double));
+	if(floatsIn == NULL || floatsOut == NULL || doublesIn == NULL || doublesOut == NULL) {
+		printf("couldn't allocate the buffers\n");
+		free(floatsIn);
+		free(floatsOut);
+		free(doublesIn);
+		free(doublesOut);
+		return;
+	}
+
+	// the best of a few runs, each one going over the array many times
+	#define MATH_MEASURE(code) ({ \
+		uint64_t best = UINT64_MAX; \
+		for(int r = 0; r < 5; r++) { \
+			uint64_t start = monotonicNs(); \
+			for(int k = 0; k < repeats; k++) { \
+				code; \
+			} \
+			uint64_t ns = monotonicNs() - start; \
+			best = ns < best ? ns : best; \
+		} \
+		(double) n * repeats / best; \
+	})
+
+	printf("\n%-6s %14s %14s %14s   (elements/ns)\n", "", "libm loop", "sse2", "avx2");
+	for(size_t i = 0; i < sizeof(floatMathFunctions) / sizeof(floatMathFunctions[0]); i++) {
+		const struct floatMathFunction *function = &floatMathFunctions[i];
+		for(size_t k = 0; k < n; k++) {
+			floatsIn[k] = (float) sweepPoint(function->low, function->high, function->logarithmic, k, n);
+		}
+		printf("%-6s", function->name);
+		printf(" %14.3f", MATH_MEASURE(for(size_t e = 0; e < n; e++) floatsOut[e] = function->libm(floatsIn[e]); benchKeep(floatsOut)));
+		printf(" %14.3f", MATH_MEASURE(function->versions[0](floatsOut, floatsIn, n); benchKeep(floatsOut)));
+		if(avx2) {
+			printf(" %14.3f\n", MATH_MEASURE(function->versions[1](floatsOut, floatsIn, n); benchKeep(floatsOut)));
+		} else {
+			printf(" %14s\n", "-");
+		}
+	}
+	for(size_t i = 0; i < sizeof(doubleMathFunctions) / sizeof(doubleMathFunctions[0]); i++) {
+		const struct doubleMathFunction *function = &doubleMathFunctions[i];
+		for(size_t k = 0; k < n; k++) {
+			doublesIn[k] = sweepPoint(function->low, function->high, function->logarithmic, k, n);
+		}
+		printf("%-6s", function->name);
+		printf(" %14.3f", MATH_MEASURE(for(size_t e = 0; e < n; e++) doublesOut[e] = function->libm(doublesIn[e]); benchKeep(doublesOut)));
+		printf(" %14.3f", MATH_MEASURE(function->versions[0](doublesOut, doublesIn, n); benchKeep(doublesOut)));
+		if(avx2) {
+			printf(" %14.3f\n", MATH_MEASURE(function->versions[1](doublesOut, doublesIn, n); benchKeep(doublesOut)));
+		} else {
+			printf(" %14s\n", "-");
+		}
+	}
+	#undef MATH_MEASURE
+
+	free(floatsIn);
+	free(floatsOut);
+	free(doublesIn);
+	free(doublesOut);
+}
+
+
+
+// COROUTINES
+// setjmp() and longjmp() can only jump back into a function that is still
+// running on the same stack. give every task its own stack and the "jump"
+// can go both ways: a coroutine runs until it says "yield", and later it's
+// resumed right there, with its locals and call stack untouched. it's how
+// one thread can juggle thousands of requests that spend most of their
+// time waiting, without a thread (and a kernel context switch) for each.
+// switching is just saving the registers the C calling convention says a
+// function must preserve, swapping the stack pointer and restoring the
+// other side's registers: a few nanoseconds, no system call
+
+// the stacks come from mmap(), so the lowest page of each one can be made
+// unreadable: a coroutine that overflows its stack crashes right there
+// instead of silently writing over someone else's memory. mapping and
+// protecting pages are system calls, so finished stacks are kept in a free
+// list and reused (a free stack holds the pointer to the next one, like the
+// blocks of the fixed-size pool in the stdlib.h section)
+struct stackPool {
+	size_t stackSize; // usable bytes, without the guard page
+	size_t pageSize;
+	struct freeStack *free;
+	size_t mapped; // how many stacks exist, for the benchmark
+};
+
+struct freeStack {
+	struct freeStack *next;
+};
+
+static void stackPoolInit(struct stackPool *pool, size_t stackSize) {
+	pool->pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	pool->stackSize = (stackSize + pool->pageSize - 1) & ~(pool->pageSize - 1);
+	pool->free = NULL;
+	pool->mapped = 0;
+}
+
+// returns the lowest usable address, the stack grows down from base + stackSize
+static void *stackPoolTake(struct stackPool *pool) {
+	if(pool->free != NULL) {
+		struct freeStack *stack = pool->free;
+		pool->free = stack->next;
+		return stack;
+	}
+	char *mapping = mmap(NULL, pool->stackSize + pool->pageSize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	if(mapping == MAP_FAILED) {
+		return NULL;
+	}
+	if(mprotect(mapping, pool->pageSize, PROT_NONE) != 0) {
+		munmap(mapping, pool->stackSize + pool->pageSize);
+		return NULL;
+	}
+	pool->mapped++;
+	return mapping + pool->pageSize;
+}
+
+static void stackPoolGive(struct stackPool *pool, void *base) {
+	struct freeStack *stack = base;
+	stack->next = pool->free;
+	pool->free = stack;
+}
+
+// only the free stacks are unmapped, so every coroutine must have finished
+static void stackPoolDestroy(struct stackPool *pool) {
+	while(pool->free != NULL) {
+		struct freeStack *next = pool->free->next;
+		munmap((char *) pool->free - pool->pageSize, pool->stackSize + pool->pageSize);
+		pool->free = next;
+	}
+}
+
+struct coroutine {
+#if defined(__x86_64__)
+	void *stackPointer; // where its registers were saved when it stopped
+	void *callerStackPointer; // the same for whoever resumed it
+#else
+	// other CPUs get the (much slower, see benchSetjmpH) ucontext.h functions
+	ucontext_t context;
+	ucontext_t callerContext;
+#endif
+	void *stack;
+	void (*function)(void *argument);
+	void *argument;
+	bool finished;
+	struct coroutine *next; // in the scheduler's queue
+};
+
+// the coroutine running in this thread right now (NULL outside of them)
+static thread_local struct coroutine *currentCoroutine;
+
+#if defined(__x86_64__)
+// saves rbp, rbx and r12 to r15 (plus the SSE and x87 control words, which
+// a FAST_FP_REGION may have changed) on the current stack, stores the stack
+// pointer in *save and does the reverse with "load". the "ret" at the end
+// returns into wherever the other side called coroutineSwitch() from
+void coroutineSwitch(void **save, void *load);
+__asm__(
+	".text\n"
+	".type coroutineSwitch, @function\n"
+	"coroutineSwitch:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size coroutineSwitch, .-coroutineSwitch\n"
+	// a new coroutine "returns" here the first time, with itself in rbx
+	".type coroutineStart, @function\n"
+	"coroutineStart:\n"
+	"	movq %rbx, %rdi\n"
+	"	call coroutineMain\n"
+	"	ud2\n"
+	".size coroutineStart, .-coroutineStart\n"
+);
+void coroutineStart();
+#endif
+
+static void coroutineMain(struct coroutine *coroutine);
+
+#if defined(__x86_64__)
+static void switchIntoCoroutine(struct coroutine *coroutine) {
+	coroutineSwitch(&coroutine->callerStackPointer, coroutine->stackPointer);
+}
+
+static void switchOutOfCoroutine(struct coroutine *coroutine) {
+	coroutineSwitch(&coroutine->stackPointer, coroutine->callerStackPointer);
+}
+
+// a fake frame at the top of the new stack, laid out just like the ones
+// coroutineSwitch() leaves behind, so the first switch "returns" into
+// coroutineStart(). the stack has to be 16 byte aligned when it calls coroutineMain()
+static void coroutinePrepare(struct coroutine *coroutine, size_t stackSize) {
+	uint64_t *top = (uint64_t *) ((char *) coroutine->stack + stackSize);
+	uint64_t *frame = top - 10;
+	uint16_t x87ControlWord;
+	__asm__("fnstcw %0" : "=m"(x87ControlWord));
+	uint32_t controlWords[2] = {_mm_getcsr(), x87ControlWord};
+	memcpy(&frame[0], controlWords, sizeof(controlWords));
+	frame[1] = frame[2] = frame[3] = frame[4] = 0; // r15, r14, r13, r12
+	frame[5] = (uint64_t) coroutine; // rbx
+	frame[6] = 0; // rbp
+	frame[7] = (uint64_t) coroutineStart; // the return address
+	coroutine->stackPointer = frame;
+}
+#else
+static void switchIntoCoroutine(struct coroutine *coroutine) {
+	swapcontext(&coroutine->callerContext, &coroutine->context);
+}
+
+static void switchOutOfCoroutine(struct coroutine *coroutine) {
+	swapcontext(&coroutine->context, &coroutine->callerContext);
+}
+
+// makecontext() only passes ints, so the pointer goes in two halves
+static void coroutineStartHalves(unsigned high, unsigned low) {
+	coroutineMain((struct coroutine *) (uintptr_t) ((uint64_t) high << 32 | low));
+}
+
+static void coroutinePrepare(struct coroutine *coroutine, size_t stackSize) {
+	getcontext(&coroutine->context);
+	coroutine->context.uc_stack.ss_sp = coroutine->stack;
+	coroutine->context.uc_stack.ss_size = stackSize;
+	coroutine->context.uc_link = NULL;
+	uint64_t address = (uint64_t) (uintptr_t) coroutine;
+	makecontext(&coroutine->context, (void (*)()) coroutineStartHalves, 2, (unsigned) (address >> 32), (unsigned) address);
+}
+#endif
+
+// every coroutine starts here, and when its function returns it goes back
+// to whoever resumed it for the last time, for good
+__attribute__((used)) static void coroutineMain(struct coroutine *coroutine) {
+	coroutine->function(coroutine->argument);
+	coroutine->finished = true;
+	switchOutOfCoroutine(coroutine);
+	__builtin_unreachable();
+}
+
+// a coroutine that will run "function(argument)" the first time it's resumed,
+// or NULL if there's no memory for it
+static struct coroutine *coroutineCreate(struct stackPool *pool, void (*function)(void *), void *argument) {
+	struct coroutine *coroutine = malloc(sizeof(struct coroutine));
+	if(coroutine == NULL) {
+		return NULL;
+	}
+	coroutine->stack = stackPoolTake(pool);
+	if(coroutine->stack == NULL) {
+		free(coroutine);
+		return NULL;
+	}
+	coroutine->function = function;
+	coroutine->argument = argument;
+	coroutine->finished = false;
+	coroutine->next = NULL;
+	coroutinePrepare(coroutine, pool->stackSize);
+	return coroutine;
+}
+
+// runs the coroutine until it yields or finishes. returns false if it had
+// already finished (and then there's nothing left to resume)
+static bool coroutineResume(struct coroutine *coroutine) {
+	if(coroutine->finished) {
+		return false;
+	}
+	struct coroutine *resumer = currentCoroutine;
+	currentCoroutine = coroutine;
+	switchIntoCoroutine(coroutine);
+	currentCoroutine = resumer;
+	return !coroutine->finished;
+}
+
+// called from inside a coroutine: goes back to whoever resumed it
+static void coroutineYield() {
+	switchOutOfCoroutine(currentCoroutine);
+}
+
+static void coroutineDestroy(struct stackPool *pool, struct coroutine *coroutine) {
+	stackPoolGive(pool, coroutine->stack);
+	free(coroutine);
+}
+
+// THE ROUND-ROBIN SCHEDULER
+// a queue of coroutines: the first one runs until it yields and goes to
+// the back of the line, until every one of them has finished
+struct coroutineScheduler {
+	struct stackPool stacks;
+	struct coroutine *first;
+	struct coroutine *last;
+	size_t switches; // resumes, really, each one is two switches
+};
+
+static void schedulerInit(struct coroutineScheduler *scheduler, size_t stackSize) {
+	stackPoolInit(&scheduler->stacks, stackSize);
+	scheduler->first = scheduler->last = NULL;
+	scheduler->switches = 0;
+}
+
+static bool schedulerSpawn(struct coroutineScheduler *scheduler, void (*function)(void *), void *argument) {
+	struct coroutine *coroutine = coroutineCreate(&scheduler->stacks, function, argument);
+	if(coroutine == NULL) {
+		return false;
+	}
+	if(scheduler->last == NULL) {
+		scheduler->first = coroutine;
+	} else {
+		scheduler->last->next = coroutine;
+	}
+	scheduler->last = coroutine;
+	return true;
+}
+
+// coroutines can spawn more coroutines while this runs
+static void schedulerRun(struct coroutineScheduler *scheduler) {
+	while(scheduler->first != NULL) {
+		struct coroutine *coroutine = scheduler->first;
+		scheduler->first = coroutine->next;
+		if(scheduler->first == NULL) {
+			scheduler->last = NULL;
+		}
+		coroutine->next = NULL;
+		scheduler->switches++;
+		if(coroutineResume(coroutine)) {
+			if(scheduler->last == NULL) {
+				scheduler->first = coroutine;
+			} else {
+				scheduler->last->next = coroutine;
+			}
+			scheduler->last = coroutine;
+		} else {
+			coroutineDestroy(&scheduler->stacks, coroutine);
+		}
+	}
+}
+
+static void schedulerDestroy(struct coroutineScheduler *scheduler) {
+	stackPoolDestroy(&scheduler->stacks);
+}
+
+
+
+// the coroutines of testSetjmpH() and benchSetjmpH(). they are normal
+// functions and not nested ones on purpose: taking the address of a nested
+// function that uses its parent's variables needs code on the stack
+
+// a generator: every resume makes the next Fibonacci number
+static void fibonacciCoroutine(void *argument) {
+	long *out = argument;
+	long a = 0, b = 1;
+	for(int i = 0; i < 10; i++) {
+		*out = a;
+		coroutineYield();
+		long next = a + b;
+		a = b;
+		b = next;
+	}
+}
+
+// pretends to handle a request that has to wait for the disk a few times,
+// yielding where a real one would wait for the I/O
+struct fakeRequest {
+	int id;
+	int waits;
+};
+
+static void fakeRequestCoroutine(void *argument) {
+	struct fakeRequest *request = argument;
+	for(int i = 0; i < request->waits; i++) {
+		printf("request %d: waiting for the disk (%d of %d)\n", request->id, i + 1, request->waits);
+		coroutineYield();
+	}
+	printf("request %d: done\n", request->id);
+}
+
+// yields *argument times, for timing the switches
+static void yieldingCoroutine(void *argument) {
+	size_t times = *(size_t *) argument;
+	for(size_t i = 0; i < times; i++) {
+		coroutineYield();
+	}
+}
+
+
+
+void testSetjmpH() {
+	// this header allows you to save stack in a certain moment
+	// with setjpm() and then jump to that state with longjmp()
+	jmp_buf presentBuffer;
+
+	void travelToThePast(int i) {
+		printf("we are in the past %d\n", i);
+		// go back to the future
+		puts("going back to the future...");
+		longjmp(presentBuffer, i + 1);
+	}
+
+	int i = setjmp(presentBuffer);
+	printf("we are in the present %d\n", i);
+	if(i < 6) {
+		puts("traveling back to the past!!!");
+		travelToThePast(i);
+	}
+
+	// and with a stack for each side the jump can go both ways: a coroutine
+	// (see COROUTINES above) keeps running from where it stopped
+	struct stackPool stacks;
+	stackPoolInit(&stacks, 64 * 1024);
+	long number;
+	struct coroutine *fibonacci = coroutineCreate(&stacks, fibonacciCoroutine, &number);
+	if(fibonacci != NULL) {
+		printf("\nfibonacci numbers from a coroutine:");
+		while(coroutineResume(fibonacci)) {
+			printf(" %ld", number);
+		}
+		printf("\n\n");
+		coroutineDestroy(&stacks, fibonacci);
+	}
+	stackPoolDestroy(&stacks);
+
+	// and three "requests" sharing one thread, taking turns whenever one waits
+	struct coroutineScheduler scheduler;
+	schedulerInit(&scheduler, 64 * 1024);
+	struct fakeRequest requests[] = {{1, 3}, {2, 1}, {3, 2}};
+	for(int r = 0; r < 3; r++) {
+		schedulerSpawn(&scheduler, fakeRequestCoroutine, &requests[r]);
+	}
+	schedulerRun(&scheduler);
+	printf("%zu resumes, %zu stacks mapped for 3 coroutines\n", scheduler.switches, scheduler.stacks.mapped);
+	schedulerDestroy(&scheduler);
+}
+
+
+
+// the swapcontext() side of benchSetjmpH()
+static ucontext_t pingMainContext;
+static ucontext_t pingOtherContext;
+static size_t pingRounds;
+
+static void pingContextFunction() {
+	for(size_t i = 0; i < pingRounds; i++) {
+		swapcontext(&pingOtherContext, &pingMainContext);
+	}
+}
+
+// one run of rounds round trips, in ns. it's a function of its own because
+// swapcontext() returns twice like setjmp() does, and the locals of the
+// function that calls it could be clobbered (gcc says so with -Wextra)
+static uint64_t pingContextRun(void *stack, size_t stackSize, size_t rounds) {
+	pingRounds = rounds;
+	getcontext(&pingOtherContext);
+	pingOtherContext.uc_stack.ss_sp = stack;
+	pingOtherContext.uc_stack.ss_size = stackSize;
+	pingOtherContext.uc_link = &pingMainContext;
+	makecontext(&pingOtherContext, pingContextFunction, 0);
+	uint64_t start = monotonicNs();
+	swapcontext(&pingMainContext, &pingOtherContext);
+	for(size_t i = 0; i < rounds; i++) {
+		swapcontext(&pingMainContext, &pingOtherContext);
+	}
+	return monotonicNs() - start;
+}
+
+// and the threads side: two threads taking turns through a condition variable
+struct pingPong {
+	mtx_t lock;
+	cnd_t changed;
+	int turn;
+	size_t rounds;
+};
+
+static int pingPongThread(void *argument) {
+	struct pingPong *game = argument;
+	mtx_lock(&game->lock);
+	for(size_t i = 0; i < game->rounds; i++) {
+		while(game->turn != 1) {
+			cnd_wait(&game->changed, &game->lock);
+		}
+		game->turn = 0;
+		cnd_signal(&game->changed);
+	}
+	mtx_unlock(&game->lock);
+	return 0;
+}
+
+void benchSetjmpH() {
+	// the price of one switch (half a round trip) between two contexts:
+	// our coroutines, ucontext.h's swapcontext() (which also saves the signal
+	// mask, with a system call) and two threads handing a turn to each other.
+	// then the scheduler with a lot of coroutines, and what creating one costs
+	size_t rounds = 1000000;
+	struct stackPool stacks;
+	stackPoolInit(&stacks, 64 * 1024);
+
+	uint64_t best = UINT64_MAX;
+	for(int r = 0; r < 5; r++) {
+		struct coroutine *coroutine = coroutineCreate(&stacks, yieldingCoroutine, &rounds);
+		if(coroutine == NULL) {
+			printf("couldn't create a coroutine\n");
+			stackPoolDestroy(&stacks);
+			return;
+		}
+		uint64_t start = monotonicNs();
+		while(coroutineResume(coroutine)) {
+		}
+		uint64_t ns = monotonicNs() - start;
+		best = ns < best ? ns : best;
+		coroutineDestroy(&stacks, coroutine);
+	}
+	printf("%-34s %8.1f ns per switch\n", "coroutineResume/coroutineYield", best / (2.0 * rounds));
+
+	void *contextStack = stackPoolTake(&stacks);
+	if(contextStack != NULL) {
+		best = UINT64_MAX;
+		for(int r = 0; r < 5; r++) {
+			uint64_t ns = pingContextRun(contextStack, stacks.stackSize, rounds);
+			best = ns < best ? ns : best;
+		}
+		stackPoolGive(&stacks, contextStack);
+		printf("%-34s %8.1f ns per switch\n", "swapcontext", best / (2.0 * rounds));
+	}
+
+	struct pingPong game = {.turn = 0, .rounds = rounds / 10};
+	thrd_t other;
+	if(mtx_init(&game.lock, mtx_plain) == thrd_success && cnd_init(&game.changed) == thrd_success
+		&& thrd_create(&other, pingPongThread, &game) == thrd_success) {
+		uint64_t start = monotonicNs();
+		mtx_lock(&game.lock);
+		for(size_t i = 0; i < game.rounds; i++) {
+			game.turn = 1;
+			cnd_signal(&game.changed);
+			while(game.turn != 0) {
+				cnd_wait(&game.changed, &game.lock);
+			}
+		}
+		mtx_unlock(&game.lock);
+		uint64_t ns = monotonicNs() - start;
+		thrd_join(other, NULL);
+		printf("%-34s %8.1f ns per switch\n", "thrd_t ping-pong over a cnd_t", ns / (2.0 * game.rounds));
+		cnd_destroy(&game.changed);
+		mtx_destroy(&game.lock);
+	}
+
+	// many coroutines at once: every resume touches a different stack, so
+	// this is where the caches start to matter
+	printf("\n%-12s %14s %14s %14s\n", "coroutines", "ns per resume", "ns per spawn", "stacks mapped");
+	for(size_t count = 1; count <= 10000; count *= 10) {
+		struct coroutineScheduler scheduler;
+		schedulerInit(&scheduler, 64 * 1024);
+		size_t yields = 1000000 / count;
+		// the first run maps the stacks, the second one reuses them from the pool
+		uint64_t spawnNs = 0, runNs = 0;
+		for(int pass = 0; pass < 2; pass++) {
+			uint64_t start = monotonicNs();
+			size_t spawned = 0;
+			for(size_t c = 0; c < count; c++) {
+				spawned += schedulerSpawn(&scheduler, yieldingCoroutine, &yields);
+			}
+			uint64_t middle = monotonicNs();
+			scheduler.switches = 0;
+			schedulerRun(&scheduler);
+			spawnNs = middle - start;
+			runNs = monotonicNs() - middle;
+			if(spawned < count) {
+				printf("only %zu coroutines fit in memory\n", spawned);
+				break;
+			}
+		}
+		printf("%-12zu %14.1f %14.1f %14zu\n", count, (double) runNs / scheduler.switches,
+			(double) spawnNs / count, scheduler.stacks.mapped);
+		schedulerDestroy(&scheduler);
+	}
+	stackPoolDestroy(&stacks);
+}
+
+
+
+// THE SAMPLING PROFILER
+// a profiler doesn't have to instrument every function: if a timer stops
+// the program every millisecond of CPU time and notes where it was, the
+// functions that show up the most are the ones that take the most time.
+// setitimer(ITIMER_PROF) sends SIGPROF after each interval of CPU time the
+// process uses, the handler saves the interrupted instruction and the call
+// stack, and turning addresses into names waits until the end.
+// the kernel only checks CPU time timers on its tick (250 times a second
+// on most distributions, and a timer_create() one on CLOCK_PROCESS_CPUTIME_ID
+// is no faster), so the report takes the rate from the CPU time really used
+// a signal handler can interrupt anything (even malloc() or printf() halfway
+// through), so it may only do async-signal-safe things: no locks, no
+// allocations, no stdio. the samples go into a ring allocated beforehand
+// and each handler claims a slot with one atomic increment, so handlers
+// running in several threads at once never wait for each other
+
+#define PROFILE_DEPTH 32 // frames kept per sample
+#define PROFILE_RING_SIZE 16384 // samples kept, after that the oldest ones are overwritten
+
+struct profileSample {
+	atomic_size_t sequence; // which sample this is (+1), written last so a half written one is never read
+	int depth;
+	void *frames[PROFILE_DEPTH];
+};
+
+static struct profileSample *profileRing;
+static atomic_size_t profileClaimed;
+static atomic_uint_fast64_t profileHandlerTicks; // time spent in the handler, in cycleCounter() ticks
+static uint64_t profileStartTicks;
+static uint64_t profileStopTicks;
+static uint64_t profileStartCpuNs; // CLOCK_PROCESS_CPUTIME_ID, to say how often the timer really fired
+static uint64_t profileStopCpuNs;
+static int profileHz;
+static const char *profileName; // what is being profiled, for the report at exit
+static bool profileRunning;
+
+static void profileHandler(int signal, siginfo_t *info, void *context) {
+	(void) signal; // always SIGPROF
+	(void) info;
+	uint64_t start = cycleCounter();
+	int savedErrno = errno;
+	size_t claim = atomic_fetch_add_explicit(&profileClaimed, 1, memory_order_relaxed);
+	struct profileSample *sample = &profileRing[claim % PROFILE_RING_SIZE];
+	void *frames[PROFILE_DEPTH + 4];
+	int depth = backtrace(frames, PROFILE_DEPTH + 4);
+	// the first frames are this handler and the kernel's signal trampoline,
+	// the interrupted code starts where the instruction pointer was
+	void *interrupted = NULL;
+#if defined(__x86_64__)
+	interrupted = (void *) ((ucontext_t *) context)->uc_mcontext.gregs[REG_RIP];
+#endif
+	int first = depth;
+	for(int i = 0; i < depth; i++) {
+		if(frames[i] == interrupted) {
+			first = i;
+			break;
+		}
+	}
+	if(first == depth) {
+		// the stack couldn't be walked past the trampoline, keep what we know
+		sample->depth = interrupted != NULL ? 1 : 0;
+		sample->frames[0] = interrupted;
+	} else {
+		sample->depth = depth - first < PROFILE_DEPTH ? depth - first : PROFILE_DEPTH;
+		memcpy(sample->frames, &frames[first], sample->depth * sizeof(void *));
+	}
+	atomic_store_explicit(&sample->sequence, claim + 1, memory_order_release);
+	errno = savedErrno;
+	atomic_fetch_add_explicit(&profileHandlerTicks, cycleCounter() - start, memory_order_relaxed);
+}
+
+static uint64_t profileCpuNs() {
+	struct timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+// programs that end with exit() still get their report
+static void profilerAtExit() {
+	if(profileRunning) {
+		profilerStop();
+		profilerReport(profileName);
+	}
+}
+
+// there's one session at a time (one timer and one ring), so starting a
+// second one while the first runs fails instead of wiping it
+static bool profilerStart(int hz, const char *name) {
+	static bool atExitRegistered = false;
+	if(profileRunning) {
+		return false;
+	}
+	if(profileRing == NULL) {
+		profileRing = calloc(PROFILE_RING_SIZE, sizeof(struct profileSample));
+		if(profileRing == NULL) {
+			return false;
+		}
+	}
+	if(!atExitRegistered) {
+		atexit(profilerAtExit);
+		atExitRegistered = true;
+	}
+	for(size_t i = 0; i < PROFILE_RING_SIZE; i++) {
+		atomic_store(&profileRing[i].sequence, 0);
+	}
+	atomic_store(&profileClaimed, 0);
+	atomic_store(&profileHandlerTicks, 0);
+	// the first backtrace() loads libgcc's unwinder with dlopen(), which
+	// isn't something to do inside a signal handler, so it happens here
+	void *warmUp[2];
+	backtrace(warmUp, 2);
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_sigaction = profileHandler;
+	action.sa_flags = SA_SIGINFO | SA_RESTART; // SA_RESTART: read() and friends don't fail with EINTR
+	sigemptyset(&action.sa_mask);
+	if(sigaction(SIGPROF, &action, NULL) != 0) {
+		return false;
+	}
+	profileHz = hz;
+	profileName = name;
+	profileRunning = true;
+	profileStartTicks = cycleCounter();
+	profileStartCpuNs = profileCpuNs();
+	struct itimerval interval = {{0, 1000000 / hz}, {0, 1000000 / hz}};
+	if(interval.it_interval.tv_usec == 0) {
+		interval.it_interval.tv_usec = interval.it_value.tv_usec = 1;
+	}
+	if(setitimer(ITIMER_PROF, &interval, NULL) != 0) {
+		profileRunning = false;
+		return false;
+	}
+	return true;
+}
+
+static void profilerStop() {
+	struct itimerval off;
+	memset(&off, 0, sizeof(off));
+	setitimer(ITIMER_PROF, &off, NULL);
+	profileStopCpuNs = profileCpuNs();
+	// a signal that was already on its way is just ignored
+	signal(SIGPROF, SIG_IGN);
+	profileStopTicks = cycleCounter();
+	profileRunning = false;
+}
+
+// our own functions are mostly static, and those aren't in the dynamic
+// symbol table dladdr() reads. so the symbol table of the program itself is
+// read from /proc/self/exe (it's an ELF file) once, and libc and friends
+// are left to dladdr()
+struct elfFunction {
+	uintptr_t start;
+	size_t size;
+	const char *name;
+};
+
+static struct elfFunction *elfFunctions;
+static size_t elfFunctionCount;
+
+static int compareElfFunctions(const void *a, const void *b) {
+	const struct elfFunction *x = a, *y = b;
+	return (x->start > y->start) - (x->start < y->start);
+}
+
+static void loadOwnSymbols() {
+	if(elfFunctions != NULL) {
+		return;
+	}
+	int file = open("/proc/self/exe", O_RDONLY);
+	struct stat info;
+	if(file < 0 || fstat(file, &info) != 0) {
+		if(file >= 0) {
+			close(file);
+		}
+		return;
+	}
+	// the mapping stays for the rest of the program, the names point into it
+	const char *image = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if(image == MAP_FAILED) {
+		return;
+	}
+	const Elf64_Ehdr *header = (const Elf64_Ehdr *) image;
+	if(memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 || header->e_ident[EI_CLASS] != ELFCLASS64) {
+		return;
+	}
+	const Elf64_Shdr *sections = (const Elf64_Shdr *) (image + header->e_shoff);
+	for(int s = 0; s < header->e_shnum; s++) {
+		if(sections[s].sh_type != SHT_SYMTAB) {
+			continue;
+		}
+		const Elf64_Sym *symbols = (const Elf64_Sym *) (image + sections[s].sh_offset);
+		const char *names = image + sections[sections[s].sh_link].sh_offset;
+		size_t count = sections[s].sh_size / sizeof(Elf64_Sym);
+		elfFunctions = malloc(count * sizeof(struct elfFunction));
+		if(elfFunctions == NULL) {
+			return;
+		}
+		uintptr_t mainAddress = 0;
+		for(size_t i = 0; i < count; i++) {
+			if(ELF64_ST_TYPE(symbols[i].st_info) == STT_FUNC && symbols[i].st_value != 0) {
+				const char *name = names + symbols[i].st_name;
+				elfFunctions[elfFunctionCount++] = (struct elfFunction) {symbols[i].st_value, symbols[i].st_size, name};
+				mainAddress = strcmp(name, "main") == 0 ? symbols[i].st_value : mainAddress;
+			}
+		}
+		// the program is position independent, so everything moved by the
+		// same amount as main() did
+		uintptr_t base = (uintptr_t) main - mainAddress;
+		for(size_t i = 0; i < elfFunctionCount; i++) {
+			elfFunctions[i].start += base;
+		}
+		qsort(elfFunctions, elfFunctionCount, sizeof(struct elfFunction), compareElfFunctions);
+		return;
+	}
+}
+
+// the function an address is in: its name, and its start address as an id
+static const char *symbolize(uintptr_t address, uintptr_t *start) {
+	size_t low = 0, high = elfFunctionCount;
+	while(low < high) {
+		size_t middle = (low + high) / 2;
+		if(elfFunctions[middle].start <= address) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if(low > 0 && address < elfFunctions[low - 1].start + (elfFunctions[low - 1].size ? elfFunctions[low - 1].size : 1)) {
+		*start = elfFunctions[low - 1].start;
+		return elfFunctions[low - 1].name;
+	}
+	Dl_info info;
+	if(dladdr((void *) address, &info) != 0 && info.dli_sname != NULL) {
+		*start = (uintptr_t) info.dli_saddr;
+		return info.dli_sname;
+	}
+	if(dladdr((void *) address, &info) != 0 && info.dli_fname != NULL) {
+		*start = (uintptr_t) info.dli_fbase;
+		return strrchr(info.dli_fname, '/') != NULL ? strrchr(info.dli_fname, '/') + 1 : info.dli_fname;
+	}
+	*start = address;
+	return "???";
+}
+
+struct profileFunction {
+	uintptr_t start;
+	const char *name;
+	size_t self; // samples where it was the one running
+	size_t total; // samples where it was anywhere on the stack
+	size_t lastSample; // so recursion counts once per sample
+};
+
+#define PROFILE_FUNCTIONS 4096 // a hash table, more functions than this are left out
+
+static int compareSelf(const void *a, const void *b) {
+	const struct profileFunction *x = a, *y = b;
+	return (x->self < y->self) - (x->self > y->self);
+}
+
+static int compareTotal(const void *a, const void *b) {
+	const struct profileFunction *x = a, *y = b;
+	return (x->total < y->total) - (x->total > y->total);
+}
+
+// the flat profile (where the samples landed) and the cumulative one
+// (what was on the stack), the top 15 of each
+static void profilerReport(const char *name) {
+	size_t taken = atomic_load(&profileClaimed);
+	// the CPU time that was really used, and so the rate the timer really had
+	double seconds = (double) (profileStopCpuNs - profileStartCpuNs) / 1e9;
+	double overhead = profileStopTicks > profileStartTicks
+		? 100.0 * atomic_load(&profileHandlerTicks) / (profileStopTicks - profileStartTicks) : 0;
+	printf("\nprofile of %s: %zu samples in %.2f s of CPU time (%.0f Hz, %d asked for), the handler took %.2f%% of the run\n",
+		name, taken, seconds, seconds > 0 ? taken / seconds : 0, profileHz, overhead);
+	if(taken == 0) {
+		return;
+	}
+	if(taken > PROFILE_RING_SIZE) {
+		printf("(only the last %d samples were kept)\n", PROFILE_RING_SIZE);
+	}
+	struct profileFunction *functions = calloc(PROFILE_FUNCTIONS, sizeof(struct profileFunction));
+	if(functions == NULL) {
+		return;
+	}
+	loadOwnSymbols();
+	size_t used = 0, counted = 0;
+	for(size_t s = 0; s < PROFILE_RING_SIZE; s++) {
+		struct profileSample *sample = &profileRing[s];
+		if(atomic_load_explicit(&sample->sequence, memory_order_acquire) == 0 || sample->depth == 0) {
+			continue;
+		}
+		counted++;
+		for(int f = 0; f < sample->depth; f++) {
+			// the callers' frames are return addresses, which already point
+			// at the next instruction (maybe of the next function)
+			uintptr_t address = (uintptr_t) sample->frames[f] - (f > 0);
+			uintptr_t start;
+			const char *functionName = symbolize(address, &start);
+			size_t slot = (start * 0x9E3779B97F4A7C15ull >> 52) % PROFILE_FUNCTIONS;
+			while(functions[slot].name != NULL && functions[slot].start != start) {
+				slot = (slot + 1) % PROFILE_FUNCTIONS;
+			}
+			if(functions[slot].name == NULL) {
+				if(used == PROFILE_FUNCTIONS - 1) {
+					continue;
+				}
+				functions[slot] = (struct profileFunction) {start, functionName, 0, 0, 0};
+				used++;
+			}
+			functions[slot].self += f == 0;
+			if(functions[slot].lastSample != s + 1) {
+				functions[slot].total++;
+				functions[slot].lastSample = s + 1;
+			}
+		}
+	}
+	for(int table = 0; table < 2; table++) {
+		qsort(functions, PROFILE_FUNCTIONS, sizeof(struct profileFunction), table == 0 ? compareSelf : compareTotal);
+		printf(table == 0 ? "\n  self   total   function (by self)\n" : "\n  self   total   function (by total)\n");
+		for(size_t i = 0; i < 15 && i < used; i++) {
+			if(table == 0 && functions[i].self == 0) {
+				break;
+			}
+			printf("%5.1f%%  %5.1f%%   %s\n", 100.0 * functions[i].self / counted,
+				100.0 * functions[i].total / counted, functions[i].name);
+		}
+	}
+	free(functions);
+}
+
+// something to profile in testSignalH(), noinline so they don't disappear into their caller
+__attribute__((noinline)) static double profileDemoSlow(double x) {
+	for(int i = 0; i < 3000; i++) {
+		x = sqrt(x + i);
+	}
+	return x;
+}
+
+__attribute__((noinline)) static double profileDemoFast(double x) {
+	for(int i = 0; i < 1000; i++) {
+		x = sqrt(x + i);
+	}
+	return x;
+}
+
+
+
+void testSignalH() {
+	// this header allows you to set up signal handlers
+	// and then raise the signals to call their handlers
+	
+	void customHandler1(int signal) {
+		printf("\n\nhandler 1 activated\n");
+	}
+	void customHandler2(int signal) {
+		printf("handler 2 activated\n");
+	}
+
+	// sig_atomic_t is an int type that can be accessed atomically in multithread programs 
+	volatile sig_atomic_t customSignal1 = 10;
+	volatile sig_atomic_t customSignal2 = 11;
+	signal(customSignal1, customHandler1);
+	signal(customSignal2, customHandler2);
+	raise(customSignal1);
+	raise(customSignal2);
+
+	// there are also some default handlers and default signals
+	signal(SIGFPE, SIG_IGN); // SIG_IGN is a handler that ignores the signal
+	raise(SIGFPE);
+
+	// SIGPROF is what profilers use: with setitimer(ITIMER_PROF) the kernel
+	// sends it every so often of CPU time, and the handler notes where the
+	// program was (see THE SAMPLING PROFILER above, and the -p option).
+	// the slow function should get about 3 times the samples of the fast one
+	// with -p the whole test is being profiled already, so the demo just
+	// runs inside that session and shows up in its report
+	bool ownSession = !profileRunning && profilerStart(1000, "testSignalH");
+	if(ownSession || profileRunning) {
+		double x = 1;
+		uint64_t start = monotonicNs();
+		while(monotonicNs() - start < 300000000) {
+			x = profileDemoSlow(x) + profileDemoFast(x);
+		}
+		benchKeep(x);
+	}
+	if(ownSession) {
+		profilerStop();
+		profilerReport("testSignalH");
+	}
+
+	// the SIGINT below ends the program without running atexit(), so a
+	// session that's still running (the -p one) reports now, and stdout is
+	// flushed by hand, or a report going to a file or a pipe dies in its buffer
+	profilerAtExit();
+	fflush(stdout);
+	signal(SIGINT, SIG_DFL); // SIG_DFL is a default handler that depends on the signal
+	raise(SIGINT);
+}
+
+
+
+// REDUCTIONS OVER ARRAYS
+// a variadic function can only take its arguments one at a time with
+// va_arg(), each one from wherever the calling convention put it (a
+// register or the stack), so the compiler can't turn the loop into vector
+// code. if the numbers are in an array we can add 4 doubles per instruction
+// (8 with AVX-512, but AVX2 is enough here) into several accumulators at
+// once, so the next addition doesn't have to wait for the one before it
+// adding in a different order changes the rounding, and that's where the
+// compensated sums come in:
+// - pairwise: add the two halves separately and then together (recursively).
+//   the error grows with log(n) instead of n, and it costs nothing, since
+//   the blocks at the bottom are summed with the vector code anyway
+// - kahan: keep the bits lost by every addition in a second variable and
+//   add them back at the end. the error doesn't grow with n at all, for 4
+//   more operations per element (which the vectors hide in part)
+
+// what one addition lost, exactly: Knuth's "two-sum". plain Kahan only gets
+// it right when the sum is bigger than the value, this works either way and
+// needs no comparison, so it's the same few operations on whole vectors
+static inline void twoSumAdd(double *sum, double *error, double value) {
+	double total = *sum + value;
+	double fromValue = total - *sum;
+	*error += (*sum - (total - fromValue)) + (value - fromValue);
+	*sum = total;
+}
+
+#define TWO_SUM_LANES(sum, error, value) do { \
+	lanes total = (sum) + (value); \
+	lanes fromValue = total - (sum); \
+	(error) += ((sum) - (total - fromValue)) + ((value) - fromValue); \
+	(sum) = total; \
+} while(0)
+
+#define SELECT_LANES(mask, a, b) ((lanes) (((masks) (a) & (mask)) | ((masks) (b) & ~(mask))))
+
+#define REDUCTION_KERNELS(suffix, bytes, attributes) \
+	attributes static double reductionSum##suffix(const double *x, size_t n) { \
+		typedef double lanes __attribute__((vector_size(bytes))); \
+		const size_t count = bytes / sizeof(double); \
+		lanes first = {0}, second = {0}, third = {0}, fourth = {0}; \
+		size_t i = 0; \
+		for(; i + 4 * count <= n; i += 4 * count) { \
+			lanes a, b, c, d; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, x + i + count, bytes); \
+			memcpy(&c, x + i + 2 * count, bytes); \
+			memcpy(&d, x + i + 3 * count, bytes); \
+			first += a; \
+			second += b; \
+			third += c; \
+			fourth += d; \
+		} \
+		for(; i + count <= n; i += count) { \
+			lanes a; \
+			memcpy(&a, x + i, bytes); \
+			first += a; \
+		} \
+		first = (first + second) + (third + fourth); \
+		double sum = 0; \
+		for(size_t k = 0; k < count; k++) { \
+			sum += first[k]; \
+		} \
+		for(; i < n; i++) { \
+			sum += x[i]; \
+		} \
+		return sum; \
+	} \
+	attributes static double reductionSumKahan##suffix(const double *x, size_t n) { \
+		typedef double lanes __attribute__((vector_size(bytes))); \
+		const size_t count = bytes / sizeof(double); \
+		lanes firstSum = {0}, firstError = {0}, secondSum = {0}, secondError = {0}; \
+		size_t i = 0; \
+		for(; i + 2 * count <= n; i += 2 * count) { \
+			lanes a, b; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, x + i + count, bytes); \
+			TWO_SUM_LANES(firstSum, firstError, a); \
+			TWO_SUM_LANES(secondSum, secondError, b); \
+		} \
+		double sum = 0, error = 0; \
+		for(size_t k = 0; k < count; k++) { \
+			twoSumAdd(&sum, &error, firstSum[k]); \
+			twoSumAdd(&sum, &error, secondSum[k]); \
+			error += firstError[k] + secondError[k]; \
+		} \
+		for(; i < n; i++) { \
+			twoSumAdd(&sum, &error, x[i]); \
+		} \
+		return sum + error; \
+	} \
+	/* NaNs are skipped (a comparison with them is always false), like fmin() and fmax() do */ \
+	attributes static void reductionMinMax##suffix(const double *x, size_t n, double *minimum, double *maximum) { \
+		typedef double lanes __attribute__((vector_size(bytes))); \
+		typedef int64_t masks __attribute__((vector_size(bytes))); \
+		const size_t count = bytes / sizeof(double); \
+		/* 4 of each, since every step waits for a comparison and then a blend */ \
+		lanes low0 = (lanes) {0} + INFINITY, low1 = low0, low2 = low0, low3 = low0; \
+		lanes high0 = (lanes) {0} - INFINITY, high1 = high0, high2 = high0, high3 = high0; \
+		size_t i = 0; \
+		for(; i + 4 * count <= n; i += 4 * count) { \
+			lanes a, b, c, d; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, x + i + count, bytes); \
+			memcpy(&c, x + i + 2 * count, bytes); \
+			memcpy(&d, x + i + 3 * count, bytes); \
+			low0 = SELECT_LANES(a < low0, a, low0); \
+			low1 = SELECT_LANES(b < low1, b, low1); \
+			low2 = SELECT_LANES(c < low2, c, low2); \
+			low3 = SELECT_LANES(d < low3, d, low3); \
+			high0 = SELECT_LANES(a > high0, a, high0); \
+			high1 = SELECT_LANES(b > high1, b, high1); \
+			high2 = SELECT_LANES(c > high2, c, high2); \
+			high3 = SELECT_LANES(d > high3, d, high3); \
+		} \
+		low0 = SELECT_LANES(low1 < low0, low1, low0); \
+		low2 = SELECT_LANES(low3 < low2, low3, low2); \
+		low0 = SELECT_LANES(low2 < low0, low2, low0); \
+		high0 = SELECT_LANES(high1 > high0, high1, high0); \
+		high2 = SELECT_LANES(high3 > high2, high3, high2); \
+		high0 = SELECT_LANES(high2 > high0, high2, high0); \
+		double low = INFINITY, high = -INFINITY; \
+		for(size_t k = 0; k < count; k++) { \
+			low = low0[k] < low ? low0[k] : low; \
+			high = high0[k] > high ? high0[k] : high; \
+		} \
+		for(; i < n; i++) { \
+			low = x[i] < low ? x[i] : low; \
+			high = x[i] > high ? x[i] : high; \
+		} \
+		*minimum = low; \
+		*maximum = high; \
+	} \
+	/* the sum of (x - mean)^2, minus (the sum of (x - mean))^2 / n, which */ \
+	/* takes out most of the error of the mean itself (the "corrected two-pass" */ \
+	/* algorithm of Chan, Golub and LeVeque) */ \
+	attributes static double reductionDeviations##suffix(const double *x, size_t n, double mean) { \
+		typedef double lanes __attribute__((vector_size(bytes))); \
+		const size_t count = bytes / sizeof(double); \
+		lanes firstSquares = {0}, secondSquares = {0}, firstPlain = {0}, secondPlain = {0}; \
+		size_t i = 0; \
+		for(; i + 2 * count <= n; i += 2 * count) { \
+			lanes a, b; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, x + i + count, bytes); \
+			a -= mean; \
+			b -= mean; \
+			firstSquares += a * a; \
+			secondSquares += b * b; \
+			firstPlain += a; \
+			secondPlain += b; \
+		} \
+		firstSquares += secondSquares; \
+		firstPlain += secondPlain; \
+		double squares = 0, plain = 0; \
+		for(size_t k = 0; k < count; k++) { \
+			squares += firstSquares[k]; \
+			plain += firstPlain[k]; \
+		} \
+		for(; i < n; i++) { \
+			double deviation = x[i] - mean; \
+			squares += deviation * deviation; \
+			plain += deviation; \
+		} \
+		return squares - plain * plain / n; \
+	}
+
+REDUCTION_KERNELS(Sse2, 16, )
+#if defined(__x86_64__) || defined(__i386__)
+REDUCTION_KERNELS(Avx2, 32, MATH_AVX2)
+#else
+#define reductionSumAvx2 reductionSumSse2
+#define reductionSumKahanAvx2 reductionSumKahanSse2
+#define reductionMinMaxAvx2 reductionMinMaxSse2
+#define reductionDeviationsAvx2 reductionDeviationsSse2
+#endif
+#undef TWO_SUM_LANES
+#undef SELECT_LANES
+
+// the one accumulator loop, what getAvarage() used to do (kept for the comparisons)
+static double reductionSumNaive(const double *x, size_t n) {
+	double sum = 0;
+	for(size_t i = 0; i < n; i++) {
+		sum += x[i];
+	}
+	return sum;
+}
+
+static double reductionSum(const double *x, size_t n) {
+	return (mathHasAvx2() ? reductionSumAvx2 : reductionSumSse2)(x, n);
+}
+
+static double reductionSumKahan(const double *x, size_t n) {
+	return (mathHasAvx2() ? reductionSumKahanAvx2 : reductionSumKahanSse2)(x, n);
+}
+
+// blocks of 256 are small enough for the error inside them not to matter
+static double reductionSumPairwise(const double *x, size_t n) {
+	if(n <= 256) {
+		return reductionSum(x, n);
+	}
+	size_t half = n / 2;
+	return reductionSumPairwise(x, half) + reductionSumPairwise(x + half, n - half);
+}
+
+// below 32 elements the vector code costs more in its setup and its tails
+// than it saves, and the error of a short sum is a few ulps at most
+static double reductionMean(const double *x, size_t n) {
+	if(n == 0) {
+		return NAN;
+	}
+	return (n < 32 ? reductionSumNaive(x, n) : reductionSum(x, n)) / n;
+}
+
+// the same with the compensated sum, for when the mean of a long or
+// badly conditioned array has to be right to the last bit
+static double reductionMeanKahan(const double *x, size_t n) {
+	return n == 0 ? NAN : reductionSumKahan(x, n) / n;
+}
+
+// the sample variance (divided by n - 1), NaN with less than 2 elements
+static double reductionVariance(const double *x, size_t n) {
+	if(n < 2) {
+		return NAN;
+	}
+	double mean = reductionMean(x, n);
+	return (mathHasAvx2() ? reductionDeviationsAvx2 : reductionDeviationsSse2)(x, n, mean) / (n - 1);
+}
+
+// both in one pass. +infinity and -infinity for an empty array
+static void reductionMinMax(const double *x, size_t n, double *minimum, double *maximum) {
+	(mathHasAvx2() ? reductionMinMaxAvx2 : reductionMinMaxSse2)(x, n, minimum, maximum);
+}
+
+static double reductionMin(const double *x, size_t n) {
+	double minimum, maximum;
+	reductionMinMax(x, n, &minimum, &maximum);
+	return minimum;
+}
+
+static double reductionMax(const double *x, size_t n) {
+	double minimum, maximum;
+	reductionMinMax(x, n, &minimum, &maximum);
+	return maximum;
+}
+
+// the classic ill-conditioned sum: big numbers that cancel out in pairs
+// (but far apart in the array) and small integers, so the exact answer is
+// just the sum of the small ones. condition is the sum of the magnitudes
+// over the magnitude of the sum: how much the rounding errors get magnified
+static double reductionIllConditioned(double *x, size_t n, unsigned seed, double *condition) {
+	double exact = 0, magnitudes = 0;
+	size_t i = 0;
+	for(; i + 3 <= n; i += 3) {
+		seed = seed * 1103515245u + 12345u;
+		double big = ldexp((double) (seed >> 8), 20 + (int) (seed % 30));
+		seed = seed * 1103515245u + 12345u;
+		double small = (double) (seed % 9 + 1);
+		x[i] = big;
+		x[i + 1] = -big;
+		x[i + 2] = small;
+		exact += small;
+		magnitudes += 2 * big + small;
+	}
+	for(; i < n; i++) {
+		x[i] = 0;
+	}
+	// shuffled, so each big number meets its negative only much later
+	for(size_t k = n - 1; k > 0; k--) {
+		seed = seed * 1103515245u + 12345u;
+		size_t other = (seed >> 4) % (k + 1);
+		double swap = x[k];
+		x[k] = x[other];
+		x[other] = swap;
+	}
+	*condition = magnitudes / exact;
+	return exact;
+}
+
+// the array functions on small cases with known answers, and the paths against
+// each other on random data. returns the failures
+static size_t reductionTest() {
+	size_t failures = 0;
+	void check(bool ok, const char *what) {
+		if(!ok && failures++ < 5) {
+			printf("  %s is off\n", what);
+		}
+	}
+	double small[] = {4, -1.5, 8, 2.5, 0, 7};
+	for(size_t n = 0; n <= 6; n++) {
+		double sum = 0, low = INFINITY, high = -INFINITY;
+		for(size_t i = 0; i < n; i++) {
+			sum += small[i];
+			low = small[i] < low ? small[i] : low;
+			high = small[i] > high ? small[i] : high;
+		}
+		check(reductionSum(small, n) == sum && reductionSumKahan(small, n) == sum && reductionSumPairwise(small, n) == sum, "the small sums");
+		check(reductionMin(small, n) == low && reductionMax(small, n) == high, "the small min and max");
+	}
+	check(fabs(reductionVariance(small, 6) - 85.0 / 6) < 1e-12, "the small variance");
+	double withNan[] = {NAN, 3, -2, NAN, 9};
+	check(reductionMin(withNan, 5) == -2 && reductionMax(withNan, 5) == 9, "min and max with NaNs");
+
+	size_t n = 100003;
+	double *x = malloc(n * sizeof(double));
+	if(x == NULL) {
+		return failures + 1;
+	}
+	unsigned seed = 11;
+	long double exact = 0;
+	for(size_t i = 0; i < n; i++) {
+		seed = seed * 1103515245u + 12345u;
+		x[i] = (double) (seed >> 8) / (1 << 24) + 100; // a big mean and a small spread
+		exact += x[i];
+	}
+	for(size_t length = n - 50; length <= n; length++) {
+		check(fabs(reductionSum(x, length) - reductionSumNaive(x, length)) < 1e-6, "the vector sum");
+	}
+	check(fabs(reductionSumKahan(x, n) - (double) exact) < 1e-6 && fabs(reductionSumPairwise(x, n) - (double) exact) < 1e-6, "the compensated sums");
+	// uniform in [100, 101): the variance is 1 / 12
+	check(fabs(reductionVariance(x, n) - 1.0 / 12) < 1e-2, "the variance");
+	double condition;
+	double ill = reductionIllConditioned(x, n, 5, &condition);
+	check(reductionSumKahan(x, n) == ill, "kahan on the ill-conditioned sum");
+	check(reductionMeanKahan(x, n) == ill / n, "the compensated mean");
+	free(x);
+	return failures;
+}
+
+// the variadic form is a convenience for a handful of numbers: va_arg()
+// copies them 16 at a time into an array (on the stack), and the array
+// code sums each block
+static double getAvarage(int numOfNums, ...) {
+	// creates an object with info for the other header functions
+	va_list args;
+
+	// enables access to the ... arguments
+	va_start(args, numOfNums);
+
+	double numbers[16], sum = 0;
+	for(int i = 0; i < numOfNums; i += 16) {
+		int block = numOfNums - i < 16 ? numOfNums - i : 16;
+		for(int k = 0; k < block; k++) {
+			// accesses the next argument on the list
+			numbers[k] = va_arg(args, double);
+		}
+		sum += reductionSumNaive(numbers, block);
+	}
+	// terminates access to the ... arguments
+	va_end(args);
+
+	return numOfNums > 0 ? sum / numOfNums : NAN;
+}
+
+
+
+void testStdArgH() {
+	// allows you to create variadic functions (functions
+	// that accept a variable number of arguments), like getAvarage() above.
+	// the arguments arrive "promoted": float as double and char or short as
+	// int, so va_arg() has to ask for double, and an int passed where a
+	// double is expected (like a plain 5) is undefined behaviour
+	printf("\n\naverage of 3.2, 8.6 and 2.99 = %.2lf\n", getAvarage(3, 3.2, 8.6, 2.99));
+	printf("average of 5, and 109.55 = %.3lf\n", getAvarage(2, 5.0, 109.55));
+
+	// for more than a handful of numbers, put them in an array
+	double numbers[] = {3.2, 8.6, 2.99, 5, 109.55};
+	printf("the same 5 numbers from an array: mean %.3f, variance %.3f, min %.2f, max %.2f\n", reductionMean(numbers, 5),
+		reductionVariance(numbers, 5), reductionMin(numbers, 5), reductionMax(numbers, 5));
+	size_t failures = reductionTest();
+	printf("the array reductions: %s (%zu failed)\n", failures == 0 ? "ok" : "FAILED", failures);
+}
+
+
+
+void benchStdArgH() {
+	size_t failures = reductionTest();
+	printf("the array reductions: %s (%zu failed)\n", failures == 0 ? "ok" : "FAILED", failures);
+	printf("reductions: %s\n", mathHasAvx2() ? "avx2" : "sse2");
+
+	// the cost of a call with 8 numbers. the old getAvarage() loop (one va_arg
+	// at a time into one sum), the wrapper (va_arg into an array, then the
+	// array code) and the array function itself
+	double averageOneByOne(int count, ...) {
+		va_list args;
+		va_start(args, count);
+		double result = 0;
+		for(int i = 0; i < count; i++) {
+			result += va_arg(args, double);
+		}
+		va_end(args);
+		return result / count;
+	}
+	#define REDUCTION_MEASURE(calls, code) ({ \
+		uint64_t best = UINT64_MAX; \
+		for(int r = 0; r < 5; r++) { \
+			uint64_t start = monotonicNs(); \
+			for(size_t call = 0; call < (calls); call++) { \
+				code; \
+			} \
+			uint64_t ns = monotonicNs() - start; \
+			best = ns < best ? ns : best; \
+		} \
+		best; \
+	})
+	// v goes through memory every call, or the compiler could see that the
+	// calls all compute the same thing and make only one
+	double eight[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	size_t calls = 1000000;
+	printf("\n%-30s %9s\n", "an average of 8 numbers", "ns/call");
+	uint64_t ns = REDUCTION_MEASURE(calls, {
+		double v = 1;
+		benchKeep(&v);
+		benchKeep(averageOneByOne(8, v, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0));
+	});
+	printf("%-30s %9.2f\n", "variadic, one by one", (double) ns / calls);
+	ns = REDUCTION_MEASURE(calls, {
+		double v = 1;
+		benchKeep(&v);
+		benchKeep(getAvarage(8, v, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0));
+	});
+	printf("%-30s %9.2f\n", "variadic wrapper", (double) ns / calls);
+	ns = REDUCTION_MEASURE(calls, {
+		benchKeep(eight);
+		benchKeep(reductionMean(eight, 8));
+	});
+	printf("%-30s %9.2f\n", "array", (double) ns / calls);
+	ns = REDUCTION_MEASURE(calls, {
+		benchKeep(eight);
+		benchKeep(reductionMeanKahan(eight, 8));
+	});
+	printf("%-30s %9.2f\n", "array, compensated", (double) ns / calls);
+	printf("(va_arg() is most of a variadic call, the wrapper adds the copy into its\n"
+		"array, and for 8 numbers the compensation costs several times the sum itself:\n"
+		"it pays only on long or badly conditioned arrays)\n");
+
+	// throughput on arrays that fit in L1 (32 KiB) and that don't (8 MiB)
+	size_t sizes[] = {4096, 1 << 20};
+	double *x = malloc(sizes[1] * sizeof(double));
+	if(x == NULL) {
+		printf("couldn't allocate the array\n");
+		return;
+	}
+	for(size_t i = 0; i < sizes[1]; i++) {
+		x[i] = (double) (i % 1000) / 7;
+	}
+	printf("\n%-30s %9s %9s   (elements/ns)\n", "", "32 KiB", "8 MiB");
+	const char *names[] = {"one accumulator", "vectors, 4 accumulators", "pairwise", "kahan", "min and max", "variance"};
+	for(int method = 0; method < 6; method++) {
+		printf("%-30s", names[method]);
+		for(int s = 0; s < 2; s++) {
+			size_t n = sizes[s], passes = (1 << 24) / n;
+			ns = REDUCTION_MEASURE(passes, {
+				benchKeep(x);
+				if(method == 0) {
+					benchKeep(reductionSumNaive(x, n));
+				} else if(method == 1) {
+					benchKeep(reductionSum(x, n));
+				} else if(method == 2) {
+					benchKeep(reductionSumPairwise(x, n));
+				} else if(method == 3) {
+					benchKeep(reductionSumKahan(x, n));
+				} else if(method == 4) {
+					double minimum;
+					double maximum;
+					reductionMinMax(x, n, &minimum, &maximum);
+					benchKeep(minimum + maximum);
+				} else {
+					benchKeep(reductionVariance(x, n));
+				}
+			});
+			// the variance is two passes (the mean and the deviations)
+			printf(" %9.2f", (double) n * passes / ns * (method == 5 ? 2 : 1));
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+	#undef REDUCTION_MEASURE
+
+	// how wrong each sum gets. first the ill-conditioned sum, then 1 followed
+	// by a million halves of the double epsilon: one at a time, each of them is
+	// too small to change 1 (it rounds back to even), but all of them together add 2^-33
+	size_t n = sizes[1];
+	double condition;
+	double exact = reductionIllConditioned(x, n, 7, &condition);
+	printf("\nbig numbers cancelling, condition %.1e, exact sum %.17g\n", condition, exact);
+	void accuracy(const char *name, double sum) {
+		printf("  %-28s %24.17g   relative error %.1e\n", name, sum, fabs(sum - exact) / fabs(exact));
+	}
+	accuracy("one accumulator", reductionSumNaive(x, n));
+	accuracy("vectors, 4 accumulators", reductionSum(x, n));
+	accuracy("pairwise", reductionSumPairwise(x, n));
+	accuracy("kahan", reductionSumKahan(x, n));
+	x[0] = 1;
+	for(size_t i = 1; i < n; i++) {
+		x[i] = 0x1p-53;
+	}
+	exact = 1 + (n - 1) * 0x1p-53;
+	printf("1 + %zu times 2^-53, exact sum %.17g\n", n - 1, exact);
+	accuracy("one accumulator", reductionSumNaive(x, n));
+	accuracy("vectors, 4 accumulators", reductionSum(x, n));
+	accuracy("pairwise", reductionSumPairwise(x, n));
+	accuracy("kahan", reductionSumKahan(x, n));
+	free(x);
+}
+
+
+
+// A LOCK-FREE MULTI-PRODUCER/MULTI-CONSUMER QUEUE
+// a bounded ring buffer (Dmitry Vyukov's design) where every cell has a
+// sequence number saying whose turn it is: a producer may fill cell i when
+// its sequence is i, a consumer may empty it when its sequence is i + 1.
+// producers fight for the tail and consumers for the head with a
+// compare-and-swap, so nobody ever holds a lock
+
+#define CACHE_LINE 64
+
+// the value is atomic too, but only ever read and written relaxed (the same
+// plain mov on x86): the sequence is what orders it, and with the "relaxed"
+// flavor below nothing does, so there it can be stale but it's never a data race
+struct mpmcCell {
+	atomic_size_t sequence;
+	_Atomic uint64_t value;
+};
+
+// head and tail are written by different threads all the time, so each one
+// gets a whole cache line: if they shared one, every push would kick the line
+// out of the consumers' caches and vice-versa ("false sharing")
+struct mpmcQueue {
+	_Alignas(CACHE_LINE) atomic_size_t tail; // next cell to fill
+	_Alignas(CACHE_LINE) atomic_size_t head; // next cell to empty
+	_Alignas(CACHE_LINE) struct mpmcCell *cells;
+	size_t mask; // capacity - 1, the capacity is a power of 2
+};
+
+// returns false if it couldn't allocate the cells
+static bool mpmcInit(struct mpmcQueue *queue, size_t capacity) {
+	size_t rounded = 2;
+	while(rounded < capacity) {
+		rounded *= 2;
+	}
+	queue->cells = malloc(sizeof(struct mpmcCell) * rounded);
+	if(queue->cells == NULL) {
+		return false;
+	}
+	queue->mask = rounded - 1;
+	for(size_t i = 0; i < rounded; i++) {
+		atomic_init(&queue->cells[i].sequence, i);
+	}
+	atomic_init(&queue->tail, 0);
+	atomic_init(&queue->head, 0);
+	return true;
+}
+
+static void mpmcDestroy(struct mpmcQueue *queue) {
+	free(queue->cells);
+	queue->cells = NULL;
+}
+
+// the memory orders are parameters so the benchmark can compare them. they are
+// always constants in the callers, and since these functions are always
+// inlined the compiler picks the right instructions for each version.
+// - "acquire" is used to read a cell's sequence: after seeing it, we also see
+//   the value the other side wrote before publishing it
+// - "release" is used to publish a sequence: the value we wrote goes first
+// - "claim" is used for the compare-and-swap that reserves a cell, which only
+//   needs to be atomic, not ordered, since the sequence does the publishing
+static inline __attribute__((always_inline))
+bool mpmcTryPushOrdered(struct mpmcQueue *queue, uint64_t value,
+	memory_order acquire, memory_order release, memory_order claim) {
+	size_t position = atomic_load_explicit(&queue->tail, claim);
+	struct mpmcCell *cell;
+	while(true) {
+		cell = &queue->cells[position & queue->mask];
+		size_t sequence = atomic_load_explicit(&cell->sequence, acquire);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+		if(difference == 0) {
+			// our turn: try to move the tail forward. the "weak" version may
+			// fail even when it shouldn't, but we are in a loop anyway and
+			// on some CPUs it's cheaper than the strong one
+			if(atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1, claim, claim)) {
+				break;
+			}
+		} else if(difference < 0) {
+			return false; // this cell wasn't consumed yet, so the queue is full
+		} else {
+			position = atomic_load_explicit(&queue->tail, claim); // someone got ahead of us
+		}
+	}
+	atomic_store_explicit(&cell->value, value, memory_order_relaxed);
+	atomic_store_explicit(&cell->sequence, position + 1, release);
+	return true;
+}
+
+static inline __attribute__((always_inline))
+bool mpmcTryPopOrdered(struct mpmcQueue *queue, uint64_t *value,
+	memory_order acquire, memory_order release, memory_order claim) {
+	size_t position = atomic_load_explicit(&queue->head, claim);
+	struct mpmcCell *cell;
+	while(true) {
+		cell = &queue->cells[position & queue->mask];
+		size_t sequence = atomic_load_explicit(&cell->sequence, acquire);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+		if(difference == 0) {
+			if(atomic_compare_exchange_weak_explicit(&queue->head, &position, position + 1, claim, claim)) {
+				break;
+			}
+		} else if(difference < 0) {
+			return false; // nobody filled this cell yet, so the queue is empty
+		} else {
+			position = atomic_load_explicit(&queue->head, claim);
+		}
+	}
+	*value = atomic_load_explicit(&cell->value, memory_order_relaxed);
+	// mark the cell as free for the producer that comes one lap later
+	atomic_store_explicit(&cell->sequence, position + queue->mask + 1, release);
+	return true;
+}
+
+// the orders you should actually use: the weakest ones that are still correct
+static bool mpmcTryPush(struct mpmcQueue *queue, uint64_t value) {
+	return mpmcTryPushOrdered(queue, value, memory_order_acquire, memory_order_release, memory_order_relaxed);
+}
+
+static bool mpmcTryPop(struct mpmcQueue *queue, uint64_t *value) {
+	return mpmcTryPopOrdered(queue, value, memory_order_acquire, memory_order_release, memory_order_relaxed);
+}
+
+// the boring alternative, for comparison: the same ring guarded by a mutex
+struct lockedQueue {
+	mtx_t lock;
+	uint64_t *values;
+	size_t mask;
+	size_t head;
+	size_t tail;
+};
+
+static bool lockedQueueInit(struct lockedQueue *queue, size_t capacity) {
+	size_t rounded = 2;
+	while(rounded < capacity) {
+		rounded *= 2;
+	}
+	queue->values = malloc(sizeof(uint64_t) * rounded);
+	if(queue->values == NULL) {
+		return false;
+	}
+	if(mtx_init(&queue->lock, mtx_plain) != thrd_success) {
+		free(queue->values);
+		return false;
+	}
+	queue->mask = rounded - 1;
+	queue->head = queue->tail = 0;
+	return true;
+}
+
+static void lockedQueueDestroy(struct lockedQueue *queue) {
+	mtx_destroy(&queue->lock);
+	free(queue->values);
+}
+
+static bool lockedQueueTryPush(struct lockedQueue *queue, uint64_t value) {
+	bool pushed = false;
+	mtx_lock(&queue->lock);
+	if(queue->tail - queue->head <= queue->mask) {
+		queue->values[queue->tail++ & queue->mask] = value;
+		pushed = true;
+	}
+	mtx_unlock(&queue->lock);
+	return pushed;
+}
+
+static bool lockedQueueTryPop(struct lockedQueue *queue, uint64_t *value) {
+	bool popped = false;
+	mtx_lock(&queue->lock);
+	if(queue->tail != queue->head) {
+		*value = queue->values[queue->head++ & queue->mask];
+		popped = true;
+	}
+	mtx_unlock(&queue->lock);
+	return popped;
+}
+
+// one of these per version the benchmark compares
+enum queueFlavor {
+	QUEUE_SEQ_CST, // every atomic operation is memory_order_seq_cst (the default)
+	QUEUE_ACQ_REL, // acquire/release for the sequences, relaxed for the claims
+	QUEUE_RELAXED, // everything relaxed: benchmark-only, it measures the cost of
+	               // the fences, the results are not guaranteed
+	QUEUE_MUTEX, // the lockedQueue
+	QUEUE_FLAVORS
+};
+
+static const char *queueFlavorNames[QUEUE_FLAVORS] = {"seq_cst", "acq/rel", "relaxed", "mtx_t"};
+
+struct anyQueue {
+	struct mpmcQueue mpmc;
+	struct lockedQueue locked;
+};
+
+static inline __attribute__((always_inline))
+bool queueTryPush(struct anyQueue *queue, enum queueFlavor flavor, uint64_t value) {
+	switch(flavor) {
+	case QUEUE_SEQ_CST:
+		return mpmcTryPushOrdered(&queue->mpmc, value, memory_order_seq_cst, memory_order_seq_cst, memory_order_seq_cst);
+	case QUEUE_ACQ_REL:
+		return mpmcTryPush(&queue->mpmc, value);
+	case QUEUE_RELAXED:
+		return mpmcTryPushOrdered(&queue->mpmc, value, memory_order_relaxed, memory_order_relaxed, memory_order_relaxed);
+	default:
+		return lockedQueueTryPush(&queue->locked, value);
+	}
+}
+
+static inline __attribute__((always_inline))
+bool queueTryPop(struct anyQueue *queue, enum queueFlavor flavor, uint64_t *value) {
+	switch(flavor) {
+	case QUEUE_SEQ_CST:
+		return mpmcTryPopOrdered(&queue->mpmc, value, memory_order_seq_cst, memory_order_seq_cst, memory_order_seq_cst);
+	case QUEUE_ACQ_REL:
+		return mpmcTryPop(&queue->mpmc, value);
+	case QUEUE_RELAXED:
+		return mpmcTryPopOrdered(&queue->mpmc, value, memory_order_relaxed, memory_order_relaxed, memory_order_relaxed);
+	default:
+		return lockedQueueTryPop(&queue->locked, value);
+	}
+}
+
+// when the queue is full or empty we spin a bit and then give the CPU away,
+// otherwise with more threads than cores the one we wait for never runs
+static inline void queueBackoff(unsigned *failures) {
+	if(++*failures % 16 == 0) {
+		thrd_yield();
+	}
+}
+
+// everything the producer and consumer threads of one benchmark run share
+struct queueRun {
+	struct anyQueue *queue;
+	enum queueFlavor flavor;
+	uint64_t itemsPerProducer;
+	uint64_t itemsPerConsumer;
+	atomic_int arrived; // a start line, so every thread begins at the same time
+	atomic_bool go;
+	atomic_bool cancelled; // set with go when not every thread could start
+};
+
+struct queueWorker {
+	struct queueRun *run;
+	int id;
+	uint64_t sum; // what a consumer got, to check that nothing was lost
+};
+
+// returns false if the run was cancelled, and then the thread just ends
+static bool queueWaitForStart(struct queueRun *run) {
+	atomic_fetch_add(&run->arrived, 1);
+	while(!atomic_load(&run->go)) {
+		thrd_yield();
+	}
+	return !atomic_load(&run->cancelled);
+}
+
+static inline __attribute__((always_inline))
+void queueProduce(struct queueWorker *worker, enum queueFlavor flavor) {
+	struct queueRun *run = worker->run;
+	// producer p pushes p * itemsPerProducer + 1, + 2, ..., so all together
+	// they push every number from 1 to the total exactly once
+	uint64_t first = worker->id * run->itemsPerProducer + 1;
+	unsigned failures = 0;
+	for(uint64_t value = first; value < first + run->itemsPerProducer; value++) {
+		while(!queueTryPush(run->queue, flavor, value)) {
+			queueBackoff(&failures);
+		}
+	}
+}
+
+static inline __attribute__((always_inline))
+void queueConsume(struct queueWorker *worker, enum queueFlavor flavor) {
+	struct queueRun *run = worker->run;
+	uint64_t sum = 0;
+	uint64_t value;
+	unsigned failures = 0;
+	for(uint64_t i = 0; i < run->itemsPerConsumer; i++) {
+		while(!queueTryPop(run->queue, flavor, &value)) {
+			queueBackoff(&failures);
+		}
+		sum += value;
+	}
+	worker->sum = sum;
+}
+
+// the flavor is turned into a constant here, so each loop above gets
+// compiled once per flavor with the right atomic instructions inlined
+static int queueProducerMain(void *argument) {
+	struct queueWorker *worker = argument;
+	if(!queueWaitForStart(worker->run)) {
+		return 0;
+	}
+	switch(worker->run->flavor) {
+	case QUEUE_SEQ_CST: queueProduce(worker, QUEUE_SEQ_CST); break;
+	case QUEUE_ACQ_REL: queueProduce(worker, QUEUE_ACQ_REL); break;
+	case QUEUE_RELAXED: queueProduce(worker, QUEUE_RELAXED); break;
+	default: queueProduce(worker, QUEUE_MUTEX); break;
+	}
+	return 0;
+}
+
+static int queueConsumerMain(void *argument) {
+	struct queueWorker *worker = argument;
+	if(!queueWaitForStart(worker->run)) {
+		return 0;
+	}
+	switch(worker->run->flavor) {
+	case QUEUE_SEQ_CST: queueConsume(worker, QUEUE_SEQ_CST); break;
+	case QUEUE_ACQ_REL: queueConsume(worker, QUEUE_ACQ_REL); break;
+	case QUEUE_RELAXED: queueConsume(worker, QUEUE_RELAXED); break;
+	default: queueConsume(worker, QUEUE_MUTEX); break;
+	}
+	return 0;
+}
+
+// pushes about "items" numbers through the queue with the given amount of
+// producers and consumers, and returns the elapsed nanoseconds (0 if it failed)
+static uint64_t queueThroughputRun(struct anyQueue *queue, enum queueFlavor flavor,
+	int producers, int consumers, uint64_t items) {
+	struct queueRun run;
+	run.queue = queue;
+	run.flavor = flavor;
+	// every producer pushes the same amount and every consumer pops the same
+	// amount, so the total has to be a multiple of both
+	run.itemsPerProducer = items / ((uint64_t) producers * consumers) * consumers;
+	run.itemsPerConsumer = run.itemsPerProducer * producers / consumers;
+	atomic_init(&run.arrived, 0);
+	atomic_init(&run.go, false);
+	atomic_init(&run.cancelled, false);
+
+	int threadCount = producers + consumers;
+	thrd_t *threads = malloc(sizeof(thrd_t) * threadCount);
+	struct queueWorker *workers = calloc(threadCount, sizeof(struct queueWorker));
+	if(threads == NULL || workers == NULL) {
+		free(threads);
+		free(workers);
+		return 0;
+	}
+	int started = 0;
+	for(; started < threadCount; started++) {
+		bool producer = started < producers;
+		workers[started].run = &run;
+		workers[started].id = producer ? started : started - producers;
+		if(thrd_create(&threads[started], producer ? queueProducerMain : queueConsumerMain,
+			&workers[started]) != thrd_success) {
+			break;
+		}
+	}
+	if(started < threadCount) {
+		// the threads that did start would wait forever for the missing ones,
+		// so they're let go without doing anything
+		atomic_store(&run.cancelled, true);
+		atomic_store(&run.go, true);
+		for(int i = 0; i < started; i++) {
+			thrd_join(threads[i], NULL);
+		}
+		printf("couldn't start %d threads (only %d)\n", threadCount, started);
+		free(threads);
+		free(workers);
+		return 0;
+	}
+
+	while(atomic_load(&run.arrived) < threadCount) {
+		thrd_yield();
+	}
+	uint64_t start = monotonicNs();
+	atomic_store(&run.go, true);
+	uint64_t sum = 0;
+	for(int i = 0; i < threadCount; i++) {
+		thrd_join(threads[i], NULL);
+		sum += workers[i].sum;
+	}
+	uint64_t elapsed = monotonicNs() - start;
+
+	uint64_t total = run.itemsPerProducer * producers;
+	if(sum != total * (total + 1) / 2) {
+		printf("the %s queue lost or duplicated items!\n", queueFlavorNames[flavor]);
+		elapsed = 0;
+	}
+	free(threads);
+	free(workers);
+	return elapsed;
+}
+
+// the latency test: one value bounces between two threads through two queues
+struct queuePingPong {
+	struct anyQueue there;
+	struct anyQueue back;
+	enum queueFlavor flavor;
+	uint64_t rounds;
+};
+
+static inline __attribute__((always_inline))
+void queueEcho(struct queuePingPong *game, enum queueFlavor flavor) {
+	uint64_t value;
+	unsigned failures = 0;
+	for(uint64_t i = 0; i < game->rounds; i++) {
+		while(!queueTryPop(&game->there, flavor, &value)) {
+			queueBackoff(&failures);
+		}
+		while(!queueTryPush(&game->back, flavor, value)) {
+			queueBackoff(&failures);
+		}
+	}
+}
+
+static int queueEchoMain(void *argument) {
+	struct queuePingPong *game = argument;
+	switch(game->flavor) {
+	case QUEUE_SEQ_CST: queueEcho(game, QUEUE_SEQ_CST); break;
+	case QUEUE_ACQ_REL: queueEcho(game, QUEUE_ACQ_REL); break;
+	case QUEUE_RELAXED: queueEcho(game, QUEUE_RELAXED); break;
+	default: queueEcho(game, QUEUE_MUTEX); break;
+	}
+	return 0;
+}
+
+static bool anyQueueInit(struct anyQueue *queue, size_t capacity) {
+	if(!mpmcInit(&queue->mpmc, capacity)) {
+		return false;
+	}
+	if(!lockedQueueInit(&queue->locked, capacity)) {
+		mpmcDestroy(&queue->mpmc);
+		return false;
+	}
+	return true;
+}
+
+static void anyQueueDestroy(struct anyQueue *queue) {
+	mpmcDestroy(&queue->mpmc);
+	lockedQueueDestroy(&queue->locked);
+}
+
+// returns the average round trip in nanoseconds, or 0 if something failed
+static double queueRoundTripNs(enum queueFlavor flavor, uint64_t rounds) {
+	struct queuePingPong game;
+	if(!anyQueueInit(&game.there, 16)) {
+		return 0;
+	}
+	if(!anyQueueInit(&game.back, 16)) {
+		anyQueueDestroy(&game.there);
+		return 0;
+	}
+	game.flavor = flavor;
+	game.rounds = rounds;
+
+	thrd_t echo;
+	if(thrd_create(&echo, queueEchoMain, &game) != thrd_success) {
+		anyQueueDestroy(&game.there);
+		anyQueueDestroy(&game.back);
+		return 0;
+	}
+	uint64_t value;
+	unsigned failures = 0;
+	uint64_t start = monotonicNs();
+	for(uint64_t i = 0; i < rounds; i++) {
+		while(!queueTryPush(&game.there, flavor, i)) {
+			queueBackoff(&failures);
+		}
+		while(!queueTryPop(&game.back, flavor, &value)) {
+			queueBackoff(&failures);
+		}
+	}
+	uint64_t elapsed = monotonicNs() - start;
+	thrd_join(echo, NULL);
+	anyQueueDestroy(&game.there);
+	anyQueueDestroy(&game.back);
+	return (double) elapsed / rounds;
+}
+
+
+
+void testStdAtomicH() {
+	// this header gives us a way to make variables atomic and
 	// some functions to do simple atomic operations
 
-	// creates an atomic int and an atomic char
-	_Atomic int atomInt = 10;
-	_Atomic char atomChar = 'C';
+	// creates an atomic int and an atomic char
+	_Atomic int atomInt = 10;
+	_Atomic char atomChar = 'C';
+
+	printf("\n\n%c is %d/%d\n", atomChar, atomInt, atomInt);
+
+	// atomically stores a value in an atomic variable
+	atomic_store(&atomInt, 20);
+	printf("%c is %d/%d\n", atomChar, atomInt, atomInt);
+	// atomically reads the value of an atomic variable
+	int x = atomic_load(&atomInt);
+	printf("%d\n", x);
+
+	// these functions offered by this header alse have an "explicit"
+	// version each, which accepts an extra argument that is "memory_order".
+	// Memory orders define how an operation should be sincronyzed with the others,
+	// and these are the options:
+	// - memory_order_relaxed: No synchronization or ordering constraints
+	// - memory_order_acquire: Ensures that subsequent operations are not moved before this one
+	// - memory_order_release: Ensures that previous operations are not moved after this one
+	// - memory_order_acq_rel: Combines acquire and release semantics
+	// - memory_order_seq_cst: Sequential consistency, ensuring a total order of all operations
+
+	// you can also create atomic boolean flags
+	atomic_flag flag = ATOMIC_FLAG_INIT;
+	// and then activate the flag and clear it
+	if (!atomic_flag_test_and_set(&flag)) {
+    	printf("we got the flag\n");
+	}
+	atomic_flag_clear(&flag);
+	printf("we cleared the flag\n");
+
+	// with compare-and-swap (atomic_compare_exchange_weak_explicit) and those
+	// memory orders we can build a whole queue that many threads push to and
+	// pop from at the same time without any mutex (it's right above this function).
+	// lets have 2 threads push the numbers 1 to 20000 and 2 threads pop them
+	struct anyQueue queue;
+	if(!anyQueueInit(&queue, 256)) {
+		printf("couldn't allocate the queue\n");
+		return;
+	}
+	uint64_t elapsed = queueThroughputRun(&queue, QUEUE_ACQ_REL, 2, 2, 20000);
+	printf("\n2 producers and 2 consumers passed 20000 numbers through the lock-free queue: %s\n",
+		elapsed ? "none lost, none duplicated" : "SOMETHING WENT WRONG");
+	anyQueueDestroy(&queue);
+}
+
+
+void benchStdAtomicH() {
+	// compares the same lock-free queue with three sets of memory orders,
+	// and the mutex queue, with 1..N producers and 1..N consumers
+	int maxThreads = benchThreadCount();
+	uint64_t items = 1 << 21;
+	int repeats = 3;
+
+	struct anyQueue queue;
+	if(!anyQueueInit(&queue, 1024)) {
+		printf("couldn't allocate the queues\n");
+		return;
+	}
+
+	printf("throughput in millions of items per second, best of %d runs of %" PRIu64 " items\n\n",
+		repeats, items);
+	printf("producers consumers");
+	for(int f = 0; f < QUEUE_FLAVORS; f++) {
+		printf(" %10s", queueFlavorNames[f]);
+	}
+	printf("\n");
+
+	for(int producers = 1; producers <= maxThreads; producers = nextThreadStep(producers, maxThreads)) {
+		for(int consumers = 1; consumers <= maxThreads; consumers = nextThreadStep(consumers, maxThreads)) {
+			printf("%9d %9d", producers, consumers);
+			for(int f = 0; f < QUEUE_FLAVORS; f++) {
+				uint64_t best = UINT64_MAX;
+				for(int r = 0; r < repeats; r++) {
+					uint64_t elapsed = queueThroughputRun(&queue, f, producers, consumers, items);
+					if(elapsed == 0) {
+						anyQueueDestroy(&queue);
+						return;
+					}
+					best = elapsed < best ? elapsed : best;
+				}
+				uint64_t moved = items / ((uint64_t) producers * consumers) * consumers * producers;
+				printf(" %10.2f", moved * 1e3 / best);
+			}
+			printf("\n");
+			fflush(stdout);
+		}
+	}
+	anyQueueDestroy(&queue);
+
+	// if both threads don't get a CPU of their own they take turns instead of
+	// running together, and then the round trip is mostly the cost of thrd_yield()
+	uint64_t rounds = 20000;
+	printf("\nround trip latency between 2 threads (ns), average of %" PRIu64 " round trips\n", rounds);
+	for(int f = 0; f < QUEUE_FLAVORS; f++) {
+		double latency = queueRoundTripNs(f, rounds);
+		if(latency == 0) {
+			printf("couldn't run the %s ping-pong\n", queueFlavorNames[f]);
+			return;
+		}
+		printf("%10s %10.1f\n", queueFlavorNames[f], latency);
+	}
+}
+
+
+
+
+void testStdBoolH(){
+	// this tiny header just creates the bool keyword and the
+	// true and false macros
+
+	bool falseValue = false;
+	bool trueValue = true;
+
+	if(falseValue) {
+		printf("\n\nthis should not be printed\n");
+	} else if(trueValue) {
+		printf("\n\nand this should be printed\n");
+	}
+}
+
+
+
+// STRUCT LAYOUT REPORTS
+// C has no way of listing the fields of a struct, so we list them ourselves
+// with a macro, and offsetof(), sizeof and _Alignof tell us the rest. from
+// that we can see where the compiler put padding, how many cache lines a
+// struct touches, and a better order for the fields: sorting them from the
+// biggest alignment to the smallest leaves (almost) no holes between them
+// (bit-fields can't be listed, offsetof() doesn't work on them)
+
+#define LAYOUT_MAX_FIELDS 32
+
+struct fieldLayout {
+	const char *name;
+	size_t offset;
+	size_t size;
+	size_t align;
+};
+
+struct structLayout {
+	const char *name;
+	size_t size;
+	size_t align;
+	size_t fieldCount;
+	struct fieldLayout fields[LAYOUT_MAX_FIELDS];
+};
+
+// LAYOUT_FIELD(struct cat, age) describes one field, and
+// STRUCT_LAYOUT(struct cat, LAYOUT_FIELD(...), ...) the whole struct
+#define LAYOUT_FIELD(type, field) \
+	{#field, offsetof(type, field), sizeof(((type *) 0)->field), _Alignof(__typeof__(((type *) 0)->field))}
+#define STRUCT_LAYOUT(type, ...) ((struct structLayout) { \
+	#type, sizeof(type), _Alignof(type), \
+	sizeof((struct fieldLayout[]) {__VA_ARGS__}) / sizeof(struct fieldLayout), \
+	{__VA_ARGS__} \
+})
+
+static size_t alignUp(size_t value, size_t align) {
+	return (value + align - 1) / align * align;
+}
+
+// the bytes of the struct that belong to no field
+static size_t layoutPadding(const struct structLayout *layout) {
+	size_t used = 0;
+	for(size_t i = 0; i < layout->fieldCount; i++) {
+		used += layout->fields[i].size;
+	}
+	return layout->size - used;
+}
+
+// cache lines touched by one struct: at an address that's a multiple of the
+// cache line, and the average and worst case for the elements of an array
+// (the pattern of where they start repeats after at most 64 of them)
+static void layoutCacheLines(size_t size, size_t *aligned, double *average, size_t *worst) {
+	size_t total = 0;
+	*aligned = (size + CACHE_LINE - 1) / CACHE_LINE;
+	*worst = 0;
+	for(size_t i = 0; i < CACHE_LINE; i++) {
+		size_t start = i * size;
+		size_t lines = size == 0 ? 0 : (start + size - 1) / CACHE_LINE - start / CACHE_LINE + 1;
+		total += lines;
+		*worst = lines > *worst ? lines : *worst;
+	}
+	*average = (double) total / CACHE_LINE;
+}
+
+// fills "order" with the field indexes sorted by alignment (then by size),
+// both from the biggest down, and returns the size the struct would have
+static size_t layoutSuggestOrder(const struct structLayout *layout, size_t *order) {
+	for(size_t i = 0; i < layout->fieldCount; i++) {
+		order[i] = i;
+	}
+	// insertion sort: a stable sort, so equal fields keep their order
+	for(size_t i = 1; i < layout->fieldCount; i++) {
+		size_t current = order[i];
+		const struct fieldLayout *field = &layout->fields[current];
+		size_t j = i;
+		while(j > 0) {
+			const struct fieldLayout *before = &layout->fields[order[j - 1]];
+			if(before->align > field->align || (before->align == field->align && before->size >= field->size)) {
+				break;
+			}
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = current;
+	}
+	size_t offset = 0;
+	for(size_t i = 0; i < layout->fieldCount; i++) {
+		const struct fieldLayout *field = &layout->fields[order[i]];
+		offset = alignUp(offset, field->align) + field->size;
+	}
+	return alignUp(offset, layout->align);
+}
+
+static void printLayout(const struct structLayout *layout) {
+	size_t aligned, worst;
+	double average;
+	layoutCacheLines(layout->size, &aligned, &average, &worst);
+	printf("%s: %zu bytes, aligned to %zu, %zu of them padding\n",
+		layout->name, layout->size, layout->align, layoutPadding(layout));
+	printf("  cache lines: %zu when aligned to one, %.2f on average and up to %zu in an array\n", aligned, average, worst);
+
+	size_t end = 0;
+	for(size_t i = 0; i < layout->fieldCount; i++) {
+		const struct fieldLayout *field = &layout->fields[i];
+		if(field->offset > end) {
+			printf("  %6zu  (%zu bytes of padding)\n", end, field->offset - end);
+		}
+		printf("  %6zu  %-16s %4zu %-6s aligned to %zu%s\n", field->offset, field->name, field->size, field->size == 1 ? "byte," : "bytes,", field->align,
+			field->offset / CACHE_LINE != (field->offset + field->size - 1) / CACHE_LINE ? ", crosses a cache line" : "");
+		end = field->offset + field->size > end ? field->offset + field->size : end;
+	}
+	if(layout->size > end) {
+		printf("  %6zu  (%zu bytes of padding at the end)\n", end, layout->size - end);
+	}
+
+	size_t order[LAYOUT_MAX_FIELDS];
+	size_t suggested = layoutSuggestOrder(layout, order);
+	if(suggested < layout->size) {
+		printf("  reordered as");
+		for(size_t i = 0; i < layout->fieldCount; i++) {
+			printf(" %s", layout->fields[order[i]].name);
+		}
+		printf(" it would take %zu bytes (%zu less)\n", suggested, layout->size - suggested);
+	} else {
+		printf("  no order of the fields makes it smaller\n");
+	}
+}
+
+// the record type of the benchmark: a user account, where most loops only
+// want to know who is active and how much money they have
+#define ACCOUNT_NAME 40
+#define ACCOUNT_EMAIL 44
+
+struct account {
+	char name[ACCOUNT_NAME];
+	bool active;
+	uint64_t id;
+	char email[ACCOUNT_EMAIL];
+	double balance;
+	uint16_t country;
+	uint32_t lastLogin;
+};
+
+// the same records as a struct of arrays: one array per field
+struct accountColumns {
+	char (*name)[ACCOUNT_NAME];
+	bool *active;
+	uint64_t *id;
+	char (*email)[ACCOUNT_EMAIL];
+	double *balance;
+	uint16_t *country;
+	uint32_t *lastLogin;
+};
+
+// and split in two: the hot fields the common loops read go in a small
+// struct, and the rest in another array, at the same index
+struct accountHot {
+	double balance;
+	bool active;
+};
+
+struct accountCold {
+	uint64_t id;
+	uint32_t lastLogin;
+	uint16_t country;
+	char name[ACCOUNT_NAME];
+	char email[ACCOUNT_EMAIL];
+};
+
+static struct structLayout accountLayout() {
+	return STRUCT_LAYOUT(struct account,
+		LAYOUT_FIELD(struct account, name),
+		LAYOUT_FIELD(struct account, active),
+		LAYOUT_FIELD(struct account, id),
+		LAYOUT_FIELD(struct account, email),
+		LAYOUT_FIELD(struct account, balance),
+		LAYOUT_FIELD(struct account, country),
+		LAYOUT_FIELD(struct account, lastLogin));
+}
+
+// every layout gets the same made-up account i
+static struct account makeAccount(size_t i) {
+	struct account account;
+	memset(&account, 0, sizeof(account));
+	unsigned seed = (unsigned) i * 2654435761u + 1;
+	snprintf(account.name, sizeof(account.name), "user %zu", i);
+	snprintf(account.email, sizeof(account.email), "user%zu@example.com", i);
+	account.id = 1000000 + i;
+	account.active = seed % 3 != 0;
+	account.balance = (double) (seed % 100000) / 100;
+	account.country = (uint16_t) (seed % 200);
+	account.lastLogin = seed;
+	return account;
+}
+
+
+
+void testStdDefH() {
+	// the most usefull things defined in this header
+	// are the NULL macro and the offsetof() function, I would say
+
+	// NULL is a null pointer
+	int *a = NULL;
+	printf("\n\nnull pointer: %p\n", a);
+
+	// using the offsetof() function we can get the offset in bytes
+	// between the beggining of a struct and one of its properties (including paddings)
+	struct cat {
+		char *name;
+		short int age;
+		char *color;
+	};
+
+	printf("the name is at offset %ld\n", offsetof(struct cat, name));
+	printf("the age is at offset %ld\n", offsetof(struct cat, age));
+	printf("the color is at offset %ld\n", offsetof(struct cat, color));
+
+	// the layout report above testStdDefH shows where that padding is:
+	// there are 6 bytes of it after the age, so the color starts at 16
+	struct structLayout catLayout = STRUCT_LAYOUT(struct cat,
+		LAYOUT_FIELD(struct cat, name),
+		LAYOUT_FIELD(struct cat, age),
+		LAYOUT_FIELD(struct cat, color));
+	printf("\n");
+	printLayout(&catLayout);
+	struct structLayout account = accountLayout();
+	printLayout(&account);
+}
+
+
+
+void benchStdDefH() {
+	// a million accounts in three layouts: an array of structs, a struct of
+	// arrays and a hot/cold split. one loop only reads the hot fields (the
+	// total balance of the active accounts), the other reads every field.
+	// ns per record, and L1 and last level cache misses per record when the
+	// CPU lets us count them
+	size_t n = 1 << 20;
+	struct structLayout layouts[] = {
+		accountLayout(),
+		STRUCT_LAYOUT(struct accountHot, LAYOUT_FIELD(struct accountHot, balance), LAYOUT_FIELD(struct accountHot, active)),
+	};
+	for(size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+		printLayout(&layouts[i]);
+	}
+
+	int l1Misses = perfCounterOpen(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+		| (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+	int llcMisses = perfCounterOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+	if(l1Misses < 0 && llcMisses < 0) {
+		printf("\n(no hardware cache counters here, so no miss counts)\n");
+	}
+
+	void report(const char *layout, const char *loop, uint64_t ns, int64_t l1, int64_t llc) {
+		char l1Text[32] = "n/a", llcText[32] = "n/a";
+		if(l1 >= 0) snprintf(l1Text, sizeof(l1Text), "%.3f", (double) l1 / n);
+		if(llc >= 0) snprintf(llcText, sizeof(llcText), "%.3f", (double) llc / n);
+		printf("%-16s %-12s %10.3f %12s %12s\n", layout, loop, (double) ns / n, l1Text, llcText);
+	}
+	// the best of a few runs, with the misses of that same run
+	#define LAYOUT_MEASURE(layout, loop, code) do { \
+		uint64_t best = UINT64_MAX; \
+		int64_t bestL1 = -1, bestLlc = -1; \
+		for(int r = 0; r < 5; r++) { \
+			double sum = 0; \
+			perfCounterStart(l1Misses); \
+			perfCounterStart(llcMisses); \
+			uint64_t start = monotonicNs(); \
+			for(size_t i = 0; i < n; i++) { \
+				code; \
+			} \
+			uint64_t ns = monotonicNs() - start; \
+			int64_t l1 = perfCounterStop(l1Misses); \
+			int64_t llc = perfCounterStop(llcMisses); \
+			benchKeep(sum); \
+			if(ns < best) { \
+				best = ns; \
+				bestL1 = l1; \
+				bestLlc = llc; \
+			} \
+		} \
+		report(layout, loop, best, bestL1, bestLlc); \
+	} while(0)
+
+	printf("\n%-16s %-12s %10s %12s %12s\n", "layout", "loop", "ns/record", "L1 misses", "LLC misses");
+	// one layout at a time, so only one copy of the records exists at once
+	struct account *records = malloc(n * sizeof(struct account));
+	if(records != NULL) {
+		for(size_t i = 0; i < n; i++) {
+			records[i] = makeAccount(i);
+		}
+		LAYOUT_MEASURE("array of structs", "hot fields", if(records[i].active) sum += records[i].balance);
+		LAYOUT_MEASURE("array of structs", "all fields", sum += records[i].id + records[i].balance + records[i].lastLogin
+			+ records[i].country + records[i].name[5] + records[i].email[5] + records[i].active);
+		free(records);
+	}
+
+	struct accountColumns columns = {
+		malloc(n * ACCOUNT_NAME), malloc(n * sizeof(bool)), malloc(n * sizeof(uint64_t)), malloc(n * ACCOUNT_EMAIL),
+		malloc(n * sizeof(double)), malloc(n * sizeof(uint16_t)), malloc(n * sizeof(uint32_t)),
+	};
+	if(columns.name != NULL && columns.active != NULL && columns.id != NULL && columns.email != NULL
+		&& columns.balance != NULL && columns.country != NULL && columns.lastLogin != NULL) {
+		for(size_t i = 0; i < n; i++) {
+			struct account account = makeAccount(i);
+			memcpy(columns.name[i], account.name, ACCOUNT_NAME);
+			columns.active[i] = account.active;
+			columns.id[i] = account.id;
+			memcpy(columns.email[i], account.email, ACCOUNT_EMAIL);
+			columns.balance[i] = account.balance;
+			columns.country[i] = account.country;
+			columns.lastLogin[i] = account.lastLogin;
+		}
+		LAYOUT_MEASURE("struct of arrays", "hot fields", if(columns.active[i]) sum += columns.balance[i]);
+		LAYOUT_MEASURE("struct of arrays", "all fields", sum += columns.id[i] + columns.balance[i] + columns.lastLogin[i]
+			+ columns.country[i] + columns.name[i][5] + columns.email[i][5] + columns.active[i]);
+	}
+	free(columns.name);
+	free(columns.active);
+	free(columns.id);
+	free(columns.email);
+	free(columns.balance);
+	free(columns.country);
+	free(columns.lastLogin);
+
+	struct accountHot *hot = malloc(n * sizeof(struct accountHot));
+	struct accountCold *cold = malloc(n * sizeof(struct accountCold));
+	if(hot != NULL && cold != NULL) {
+		for(size_t i = 0; i < n; i++) {
+			struct account account = makeAccount(i);
+			hot[i] = (struct accountHot) {account.balance, account.active};
+			cold[i].id = account.id;
+			cold[i].lastLogin = account.lastLogin;
+			cold[i].country = account.country;
+			memcpy(cold[i].name, account.name, ACCOUNT_NAME);
+			memcpy(cold[i].email, account.email, ACCOUNT_EMAIL);
+		}
+		LAYOUT_MEASURE("hot/cold split", "hot fields", if(hot[i].active) sum += hot[i].balance);
+		LAYOUT_MEASURE("hot/cold split", "all fields", sum += cold[i].id + hot[i].balance + cold[i].lastLogin
+			+ cold[i].country + cold[i].name[5] + cold[i].email[5] + hot[i].active);
+	}
+	free(hot);
+	free(cold);
+	#undef LAYOUT_MEASURE
+
+	if(l1Misses >= 0) close(l1Misses);
+	if(llcMisses >= 0) close(llcMisses);
+}
+
+
+
+// CHECKED, SATURATING AND WRAPPING ARITHMETIC
+// INT_MAX + 1 is undefined behavior in C: the compiler may assume it never
+// happens, and the result can be anything (usually INT_MIN, silently). for
+// money that's the worst outcome, so here are three well defined choices:
+// - checked: the operation tells you it didn't fit (and you decide)
+// - saturating: the result sticks at the limit (MAX + 1 is still MAX)
+// - wrapping: the result wraps around, on purpose (MAX + 1 is MIN)
+// GCC's __builtin_add_overflow() and friends do the exact math and say if
+// the result fits in the type of the result pointer. on x86 that's the
+// add and a jump on the overflow flag, a single instruction more.
+// the macros choose the right function for the type with _Generic, so
+// saturatingAdd(a, b) works for every stdint.h width. the type of the first
+// operand picks, and the second one is converted to it
+
+// checkedAdd(a, b, &result) is true when it overflowed (result then has the
+// wrapped value). a and b can be of any integer type, only the result's
+// type matters, and it must be one of the fixed width ones
+#define CHECKED_RESULT(result) _Generic((result), \
+	int8_t *: (result), int16_t *: (result), int32_t *: (result), int64_t *: (result), long long *: (result), \
+	uint8_t *: (result), uint16_t *: (result), uint32_t *: (result), uint64_t *: (result), unsigned long long *: (result))
+#define checkedAdd(a, b, result) __builtin_add_overflow((a), (b), CHECKED_RESULT(result))
+#define checkedSub(a, b, result) __builtin_sub_overflow((a), (b), CHECKED_RESULT(result))
+#define checkedMul(a, b, result) __builtin_mul_overflow((a), (b), CHECKED_RESULT(result))
+
+// when it overflows, the sign of the true result says which limit to stick to
+// (the compiler makes the choice a cmov, no branch)
+#define SATURATING_SIGNED(name, type, min, max) \
+	static inline type saturatingAdd##name(type a, type b) { \
+		type result; \
+		return __builtin_add_overflow(a, b, &result) ? (a < 0 ? min : max) : result; \
+	} \
+	static inline type saturatingSub##name(type a, type b) { \
+		type result; \
+		return __builtin_sub_overflow(a, b, &result) ? (a < 0 ? min : max) : result; \
+	} \
+	static inline type saturatingMul##name(type a, type b) { \
+		type result; \
+		return __builtin_mul_overflow(a, b, &result) ? ((a < 0) != (b < 0) ? min : max) : result; \
+	}
+
+#define SATURATING_UNSIGNED(name, type, max) \
+	static inline type saturatingAdd##name(type a, type b) { \
+		type result; \
+		return __builtin_add_overflow(a, b, &result) ? max : result; \
+	} \
+	static inline type saturatingSub##name(type a, type b) { \
+		type result; \
+		return __builtin_sub_overflow(a, b, &result) ? 0 : result; \
+	} \
+	static inline type saturatingMul##name(type a, type b) { \
+		type result; \
+		return __builtin_mul_overflow(a, b, &result) ? max : result; \
+	}
+
+// the builtins leave the wrapped result even when they say it overflowed
+#define WRAPPING(name, type) \
+	static inline type wrappingAdd##name(type a, type b) { \
+		type result; \
+		__builtin_add_overflow(a, b, &result); \
+		return result; \
+	} \
+	static inline type wrappingSub##name(type a, type b) { \
+		type result; \
+		__builtin_sub_overflow(a, b, &result); \
+		return result; \
+	} \
+	static inline type wrappingMul##name(type a, type b) { \
+		type result; \
+		__builtin_mul_overflow(a, b, &result); \
+		return result; \
+	}
+
+SATURATING_SIGNED(I8, int8_t, INT8_MIN, INT8_MAX)
+SATURATING_SIGNED(I16, int16_t, INT16_MIN, INT16_MAX)
+SATURATING_SIGNED(I32, int32_t, INT32_MIN, INT32_MAX)
+SATURATING_SIGNED(I64, int64_t, INT64_MIN, INT64_MAX)
+SATURATING_UNSIGNED(U8, uint8_t, UINT8_MAX)
+SATURATING_UNSIGNED(U16, uint16_t, UINT16_MAX)
+SATURATING_UNSIGNED(U32, uint32_t, UINT32_MAX)
+SATURATING_UNSIGNED(U64, uint64_t, UINT64_MAX)
+WRAPPING(I8, int8_t)
+WRAPPING(I16, int16_t)
+WRAPPING(I32, int32_t)
+WRAPPING(I64, int64_t)
+WRAPPING(U8, uint8_t)
+WRAPPING(U16, uint16_t)
+WRAPPING(U32, uint32_t)
+WRAPPING(U64, uint64_t)
+
+// long long is a different type from long (int64_t) even with the same width
+#define INTEGER_GENERIC(prefix, a) _Generic((a), \
+	int8_t: prefix##I8, int16_t: prefix##I16, int32_t: prefix##I32, int64_t: prefix##I64, long long: prefix##I64, \
+	uint8_t: prefix##U8, uint16_t: prefix##U16, uint32_t: prefix##U32, uint64_t: prefix##U64, unsigned long long: prefix##U64)
+
+#define saturatingAdd(a, b) INTEGER_GENERIC(saturatingAdd, a)((a), (b))
+#define saturatingSub(a, b) INTEGER_GENERIC(saturatingSub, a)((a), (b))
+#define saturatingMul(a, b) INTEGER_GENERIC(saturatingMul, a)((a), (b))
+#define wrappingAdd(a, b) INTEGER_GENERIC(wrappingAdd, a)((a), (b))
+#define wrappingSub(a, b) INTEGER_GENERIC(wrappingSub, a)((a), (b))
+#define wrappingMul(a, b) INTEGER_GENERIC(wrappingMul, a)((a), (b))
+
+// WHOLE ARRAYS: out[i] = saturatingAdd(a[i], b[i]) a vector at a time, with
+// GCC's vector extensions and no branches. the add wraps (in unsigned lanes,
+// where wrapping is defined), and then:
+// - signed: it overflowed where a and b have the same sign and the sum
+//   doesn't ((a ^ sum) & (b ^ sum) is negative), and the limit is MAX or MIN
+//   by the sign of a: (a >> (bits - 1)) is 0 or -1, and MAX ^ -1 is MIN
+// - unsigned: it overflowed where the sum is smaller than a, and OR-ing
+//   the -1 of the comparison in makes it MAX (for sub: a < b, AND-ing makes it 0)
+// 16 byte vectors in the SSE2 versions (32 byte ones would be compared lane
+// by lane, see BATCH MATH ON WHOLE ARRAYS) and 32 bytes in the AVX2 ones
+
+#define SATURATING_ARRAYS_SIGNED(name, suffix, type, unsignedType, bytes, attributes) \
+	attributes static void saturatingAddArray##name##suffix(type *out, const type *a, const type *b, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		typedef unsignedType unsignedLanes __attribute__((vector_size(bytes))); \
+		const lanes max = (lanes) {0} + (type) ((unsignedType) -1 >> 1); \
+		size_t i = 0; \
+		for(; i + bytes / sizeof(type) <= n; i += bytes / sizeof(type)) { \
+			lanes x, y; \
+			memcpy(&x, a + i, bytes); \
+			memcpy(&y, b + i, bytes); \
+			lanes sum = (lanes) ((unsignedLanes) x + (unsignedLanes) y); \
+			lanes overflow = ((x ^ sum) & (y ^ sum)) < (lanes) {0}; \
+			lanes limit = (x >> (sizeof(type) * 8 - 1)) ^ max; \
+			sum = (overflow & limit) | (~overflow & sum); \
+			memcpy(out + i, &sum, bytes); \
+		} \
+		for(; i < n; i++) { \
+			out[i] = saturatingAdd##name(a[i], b[i]); \
+		} \
+	} \
+	attributes static void saturatingSubArray##name##suffix(type *out, const type *a, const type *b, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		typedef unsignedType unsignedLanes __attribute__((vector_size(bytes))); \
+		const lanes max = (lanes) {0} + (type) ((unsignedType) -1 >> 1); \
+		size_t i = 0; \
+		for(; i + bytes / sizeof(type) <= n; i += bytes / sizeof(type)) { \
+			lanes x, y; \
+			memcpy(&x, a + i, bytes); \
+			memcpy(&y, b + i, bytes); \
+			lanes difference = (lanes) ((unsignedLanes) x - (unsignedLanes) y); \
+			lanes overflow = ((x ^ y) & (x ^ difference)) < (lanes) {0}; \
+			lanes limit = (x >> (sizeof(type) * 8 - 1)) ^ max; \
+			difference = (overflow & limit) | (~overflow & difference); \
+			memcpy(out + i, &difference, bytes); \
+		} \
+		for(; i < n; i++) { \
+			out[i] = saturatingSub##name(a[i], b[i]); \
+		} \
+	}
+
+#define SATURATING_ARRAYS_UNSIGNED(name, suffix, type, bytes, attributes) \
+	attributes static void saturatingAddArray##name##suffix(type *out, const type *a, const type *b, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		size_t i = 0; \
+		for(; i + bytes / sizeof(type) <= n; i += bytes / sizeof(type)) { \
+			lanes x, y; \
+			memcpy(&x, a + i, bytes); \
+			memcpy(&y, b + i, bytes); \
+			lanes sum = x + y; \
+			sum |= (lanes) (sum < x); \
+			memcpy(out + i, &sum, bytes); \
+		} \
+		for(; i < n; i++) { \
+			out[i] = saturatingAdd##name(a[i], b[i]); \
+		} \
+	} \
+	attributes static void saturatingSubArray##name##suffix(type *out, const type *a, const type *b, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		size_t i = 0; \
+		for(; i + bytes / sizeof(type) <= n; i += bytes / sizeof(type)) { \
+			lanes x, y; \
+			memcpy(&x, a + i, bytes); \
+			memcpy(&y, b + i, bytes); \
+			lanes difference = (x - y) & ~(lanes) (x < y); \
+			memcpy(out + i, &difference, bytes); \
+		} \
+		for(; i < n; i++) { \
+			out[i] = saturatingSub##name(a[i], b[i]); \
+		} \
+	}
+
+SATURATING_ARRAYS_SIGNED(I8, Sse2, int8_t, uint8_t, 16, )
+SATURATING_ARRAYS_SIGNED(I16, Sse2, int16_t, uint16_t, 16, )
+SATURATING_ARRAYS_SIGNED(I32, Sse2, int32_t, uint32_t, 16, )
+SATURATING_ARRAYS_SIGNED(I64, Sse2, int64_t, uint64_t, 16, )
+SATURATING_ARRAYS_UNSIGNED(U8, Sse2, uint8_t, 16, )
+SATURATING_ARRAYS_UNSIGNED(U16, Sse2, uint16_t, 16, )
+SATURATING_ARRAYS_UNSIGNED(U32, Sse2, uint32_t, 16, )
+SATURATING_ARRAYS_UNSIGNED(U64, Sse2, uint64_t, 16, )
+#if defined(__x86_64__) || defined(__i386__)
+SATURATING_ARRAYS_SIGNED(I8, Avx2, int8_t, uint8_t, 32, MATH_AVX2)
+SATURATING_ARRAYS_SIGNED(I16, Avx2, int16_t, uint16_t, 32, MATH_AVX2)
+SATURATING_ARRAYS_SIGNED(I32, Avx2, int32_t, uint32_t, 32, MATH_AVX2)
+SATURATING_ARRAYS_SIGNED(I64, Avx2, int64_t, uint64_t, 32, MATH_AVX2)
+SATURATING_ARRAYS_UNSIGNED(U8, Avx2, uint8_t, 32, MATH_AVX2)
+SATURATING_ARRAYS_UNSIGNED(U16, Avx2, uint16_t, 32, MATH_AVX2)
+SATURATING_ARRAYS_UNSIGNED(U32, Avx2, uint32_t, 32, MATH_AVX2)
+SATURATING_ARRAYS_UNSIGNED(U64, Avx2, uint64_t, 32, MATH_AVX2)
+#else
+#define saturatingAddArrayI8Avx2 saturatingAddArrayI8Sse2
+#define saturatingAddArrayI16Avx2 saturatingAddArrayI16Sse2
+#define saturatingAddArrayI32Avx2 saturatingAddArrayI32Sse2
+#define saturatingAddArrayI64Avx2 saturatingAddArrayI64Sse2
+#define saturatingAddArrayU8Avx2 saturatingAddArrayU8Sse2
+#define saturatingAddArrayU16Avx2 saturatingAddArrayU16Sse2
+#define saturatingAddArrayU32Avx2 saturatingAddArrayU32Sse2
+#define saturatingAddArrayU64Avx2 saturatingAddArrayU64Sse2
+#define saturatingSubArrayI8Avx2 saturatingSubArrayI8Sse2
+#define saturatingSubArrayI16Avx2 saturatingSubArrayI16Sse2
+#define saturatingSubArrayI32Avx2 saturatingSubArrayI32Sse2
+#define saturatingSubArrayI64Avx2 saturatingSubArrayI64Sse2
+#define saturatingSubArrayU8Avx2 saturatingSubArrayU8Sse2
+#define saturatingSubArrayU16Avx2 saturatingSubArrayU16Sse2
+#define saturatingSubArrayU32Avx2 saturatingSubArrayU32Sse2
+#define saturatingSubArrayU64Avx2 saturatingSubArrayU64Sse2
+#endif
+
+#define SATURATING_ARRAYS_DISPATCH(name, type) \
+	static inline void saturatingAddArray##name(type *out, const type *a, const type *b, size_t n) { \
+		(mathHasAvx2() ? saturatingAddArray##name##Avx2 : saturatingAddArray##name##Sse2)(out, a, b, n); \
+	} \
+	static inline void saturatingSubArray##name(type *out, const type *a, const type *b, size_t n) { \
+		(mathHasAvx2() ? saturatingSubArray##name##Avx2 : saturatingSubArray##name##Sse2)(out, a, b, n); \
+	}
+
+SATURATING_ARRAYS_DISPATCH(I8, int8_t)
+SATURATING_ARRAYS_DISPATCH(I16, int16_t)
+SATURATING_ARRAYS_DISPATCH(I32, int32_t)
+SATURATING_ARRAYS_DISPATCH(I64, int64_t)
+SATURATING_ARRAYS_DISPATCH(U8, uint8_t)
+SATURATING_ARRAYS_DISPATCH(U16, uint16_t)
+SATURATING_ARRAYS_DISPATCH(U32, uint32_t)
+SATURATING_ARRAYS_DISPATCH(U64, uint64_t)
+
+// saturatingAddArray(out, a, b, n) for any fixed width array (out may be a or b)
+#define INTEGER_ARRAY_GENERIC(prefix, out) _Generic((out), \
+	int8_t *: prefix##I8, int16_t *: prefix##I16, int32_t *: prefix##I32, int64_t *: prefix##I64, \
+	uint8_t *: prefix##U8, uint16_t *: prefix##U16, uint32_t *: prefix##U32, uint64_t *: prefix##U64)
+#define saturatingAddArray(out, a, b, n) INTEGER_ARRAY_GENERIC(saturatingAddArray, out)((out), (a), (b), (n))
+#define saturatingSubArray(out, a, b, n) INTEGER_ARRAY_GENERIC(saturatingSubArray, out)((out), (a), (b), (n))
+
+// the true answer for a op b (the 3 answers, really), with 128 bit integers,
+// where nothing of 64 bits or less can overflow on + and -. for * the
+// magnitudes are multiplied as unsigned 128 bits (2^64 * 2^64 wouldn't fit
+// in the signed ones) and the sign is put back after the range check
+static void arithmeticReference(char op, __int128 a, __int128 b, __int128 min, __int128 max, int bits,
+		bool *overflow, __int128 *wrapped, __int128 *saturated) {
+	unsigned __int128 low = (unsigned __int128) a, high = (unsigned __int128) b;
+	unsigned __int128 bitsOf = op == '+' ? low + high : op == '-' ? low - high : low * high;
+	bitsOf &= ((unsigned __int128) 1 << bits) - 1;
+	*wrapped = min < 0 && bitsOf > (unsigned __int128) max ? (__int128) bitsOf - ((__int128) 1 << bits) : (__int128) bitsOf;
+	if(op != '*') {
+		__int128 exact = op == '+' ? a + b : a - b;
+		*overflow = exact < min || exact > max;
+		*saturated = exact < min ? min : exact > max ? max : exact;
+		return;
+	}
+	bool negative = (a < 0) != (b < 0) && a != 0 && b != 0;
+	unsigned __int128 magnitude = (unsigned __int128) (a < 0 ? -a : a) * (unsigned __int128) (b < 0 ? -b : b);
+	*overflow = negative ? magnitude > (unsigned __int128) -min : magnitude > (unsigned __int128) max;
+	*saturated = *overflow ? (negative ? min : max) : negative ? -(__int128) magnitude : (__int128) magnitude;
+}
+
+// every pair of the given values, through all the functions and macros above
+// of one type (the scalar ones and both versions of the arrays)
+#define ARITHMETIC_TEST(name, type, min, max) \
+	static size_t arithmeticTest##name(const type *values, size_t count) { \
+		size_t failures = 0; \
+		size_t pairs = count * count; \
+		type *a = malloc(pairs * sizeof(type)), *b = malloc(pairs * sizeof(type)); \
+		type *sums = malloc(pairs * sizeof(type)), *differences = malloc(pairs * sizeof(type)); \
+		type *check = malloc(pairs * sizeof(type)); \
+		if(a == NULL || b == NULL || sums == NULL || differences == NULL || check == NULL) { \
+			printf("couldn't allocate the arrays\n"); \
+			failures = 1; \
+			goto done; \
+		} \
+		for(size_t i = 0; i < count; i++) { \
+			for(size_t j = 0; j < count; j++) { \
+				type x = values[i], y = values[j]; \
+				a[i * count + j] = x; \
+				b[i * count + j] = y; \
+				for(int k = 0; k < 3; k++) { \
+					char op = "+-*"[k]; \
+					bool overflow; \
+					__int128 wrapped, saturated; \
+					arithmeticReference(op, x, y, min, max, sizeof(type) * 8, &overflow, &wrapped, &saturated); \
+					type checked, saturatedResult, wrappedResult; \
+					bool flag; \
+					if(op == '+') { \
+						flag = checkedAdd(x, y, &checked); \
+						saturatedResult = saturatingAdd(x, y); \
+						wrappedResult = wrappingAdd(x, y); \
+						sums[i * count + j] = saturatedResult; \
+					} else if(op == '-') { \
+						flag = checkedSub(x, y, &checked); \
+						saturatedResult = saturatingSub(x, y); \
+						wrappedResult = wrappingSub(x, y); \
+						differences[i * count + j] = saturatedResult; \
+					} else { \
+						flag = checkedMul(x, y, &checked); \
+						saturatedResult = saturatingMul(x, y); \
+						wrappedResult = wrappingMul(x, y); \
+					} \
+					if((flag != overflow || checked != wrapped || saturatedResult != saturated || wrappedResult != wrapped) \
+						&& failures++ < 5) { \
+						printf("  " #type ": %lld %c %lld went wrong\n", (long long) x, op, (long long) y); \
+					} \
+				} \
+			} \
+		} \
+		for(int version = 0; version < 2; version++) { \
+			if(version == 1 && !mathHasAvx2()) { \
+				break; \
+			} \
+			(version ? saturatingAddArray##name##Avx2 : saturatingAddArray##name##Sse2)(check, a, b, pairs); \
+			if(memcmp(check, sums, pairs * sizeof(type)) != 0 && failures++ < 5) { \
+				printf("  " #type ": the %s saturating add of arrays went wrong\n", version ? "avx2" : "sse2"); \
+			} \
+			(version ? saturatingSubArray##name##Avx2 : saturatingSubArray##name##Sse2)(check, a, b, pairs); \
+			if(memcmp(check, differences, pairs * sizeof(type)) != 0 && failures++ < 5) { \
+				printf("  " #type ": the %s saturating subtraction of arrays went wrong\n", version ? "avx2" : "sse2"); \
+			} \
+		} \
+	done: \
+		free(a); \
+		free(b); \
+		free(sums); \
+		free(differences); \
+		free(check); \
+		return failures; \
+	}
+
+ARITHMETIC_TEST(I8, int8_t, INT8_MIN, INT8_MAX)
+ARITHMETIC_TEST(I16, int16_t, INT16_MIN, INT16_MAX)
+ARITHMETIC_TEST(I32, int32_t, INT32_MIN, INT32_MAX)
+ARITHMETIC_TEST(I64, int64_t, INT64_MIN, INT64_MAX)
+ARITHMETIC_TEST(U8, uint8_t, 0, UINT8_MAX)
+ARITHMETIC_TEST(U16, uint16_t, 0, UINT16_MAX)
+ARITHMETIC_TEST(U32, uint32_t, 0, UINT32_MAX)
+ARITHMETIC_TEST(U64, uint64_t, 0, UINT64_MAX)
+
+// the 8 bit types with every pair of values (all 65536 of them), the wider
+// ones with every pair of the values around their limits (the ones
+// testLimitsH() prints: MIN, MAX, 0, +-1, MAX / 2, the square root of MAX
+// where * starts to overflow...) plus some random ones. returns the failures
+static size_t arithmeticTest(unsigned seed) {
+	size_t failures = 0;
+	int8_t allSigned[256];
+	uint8_t allUnsigned[256];
+	for(int v = 0; v < 256; v++) {
+		allSigned[v] = (int8_t) (v - 128);
+		allUnsigned[v] = (uint8_t) v;
+	}
+	failures += arithmeticTestI8(allSigned, 256) + arithmeticTestU8(allUnsigned, 256);
+
+	// the limits and their neighbors, at each width, and then random bits
+	#define LIMIT_VALUES(type, min, max, root) { \
+		min, min + 1, min + 2, min / 2, min / 2 - 1, -(root) - 1, -(root), -(root) + 1, -2, -1, 0, 1, 2, 3, \
+		root - 1, root, root + 1, max / 2, max / 2 + 1, max - 2, max - 1, max, \
+	}
+	int16_t values16[40] = LIMIT_VALUES(int16_t, INT16_MIN, INT16_MAX, 181);
+	int32_t values32[40] = LIMIT_VALUES(int32_t, INT32_MIN, INT32_MAX, 46340);
+	int64_t values64[40] = LIMIT_VALUES(int64_t, INT64_MIN, INT64_MAX, 3037000499);
+	uint16_t unsigned16[40] = LIMIT_VALUES(uint16_t, 0, UINT16_MAX, 255);
+	uint32_t unsigned32[40] = LIMIT_VALUES(uint32_t, 0, UINT32_MAX, 65535);
+	uint64_t unsigned64[40] = LIMIT_VALUES(uint64_t, 0, UINT64_MAX, 4294967295);
+	#undef LIMIT_VALUES
+	for(int v = 22; v < 40; v++) {
+		uint64_t bits = 0;
+		for(int k = 0; k < 4; k++) {
+			seed = seed * 1103515245u + 12345u;
+			bits = (bits << 16) | (seed >> 16);
+		}
+		bits >>= bits & 63; // every magnitude, not only huge ones
+		values16[v] = (int16_t) bits;
+		values32[v] = (int32_t) bits;
+		values64[v] = (int64_t) (v % 2 ? bits : -bits);
+		unsigned16[v] = (uint16_t) bits;
+		unsigned32[v] = (uint32_t) bits;
+		unsigned64[v] = bits;
+	}
+	failures += arithmeticTestI16(values16, 40) + arithmeticTestI32(values32, 40) + arithmeticTestI64(values64, 40);
+	failures += arithmeticTestU16(unsigned16, 40) + arithmeticTestU32(unsigned32, 40) + arithmeticTestU64(unsigned64, 40);
+	return failures;
+}
+
+void testStdIntH() {
+	// in this header many integer types and macros related to ints are defined
+
+	// defining ints of diferent sizes
+	int8_t int8 = 8;
+	int16_t int16 = 16;
+	int32_t int32 = 32;
+	int64_t int64 = 64;
+
+	printf("\n\nsize of int8_t: %ld bytes\n", sizeof(int8));
+	printf("size of int16_t: %ld bytes\n", sizeof(int16));
+	printf("size of int32_t: %ld bytes\n", sizeof(int32));
+	printf("size of int64_t: %ld bytes\n", sizeof(int64));
+
+	// the int type with the maximum width
+	intmax_t intmax = 10000;
+	printf("size of intmax_t: %ld bytes\n", sizeof(intmax));
+	// an int type that can hold a pointer
+	intptr_t intptr = (intptr_t) &int8;
+	printf("size of intptr_t: %ld bytes\n", sizeof(intptr));
+	printf("memory location being hold: %lx\n", intptr);
+
+	// and here are some macros defining the minimum and
+	// maximum values of those int types, just like in limits.h
+	printf("int8 min and max: %d, %d\n", INT8_MIN, INT8_MAX);
+	printf("int16 min and max: %d, %d\n", INT16_MIN, INT16_MAX);
+	printf("int32 min and max: %d, %d\n", INT32_MIN, INT32_MAX);
+	printf("int64 min and max: %ld, %ld\n", INT64_MIN, INT64_MAX);
+
+	// and what happens at them (see CHECKED, SATURATING AND WRAPPING ARITHMETIC above)
+	int32_t sum;
+	bool overflowed = checkedAdd(INT32_MAX, 1, &sum);
+	printf("\nINT32_MAX + 1: checked says %s (and leaves %" PRId32 "), saturating gives %" PRId32 ", wrapping %" PRId32 "\n",
+		overflowed ? "overflow" : "fine", sum, saturatingAdd((int32_t) INT32_MAX, 1), wrappingAdd((int32_t) INT32_MAX, 1));
+	uint8_t small = 250;
+	printf("uint8_t 250 + 10 saturates to %u, 250 * 2 wraps to %u, 3 - 5 saturates to %u\n",
+		saturatingAdd(small, 10), wrappingMul(small, 2), saturatingSub((uint8_t) 3, 5));
+	int64_t cents;
+	printf("a price of INT64_MAX / 100 cents times 101: %s\n",
+		checkedMul(INT64_MAX / 100, 101, &cents) ? "overflow, refused" : "fits");
+	int16_t balances[8] = {100, INT16_MAX, -32000, 0, 5, INT16_MIN, 32000, -1};
+	int16_t deposits[8] = {50, 1, -1000, -1, 5, -1, 1000, 1};
+	saturatingAddArray(balances, balances, deposits, 8);
+	printf("saturatingAddArray() of int16_t:");
+	for(int i = 0; i < 8; i++) {
+		printf(" %d", balances[i]);
+	}
+	size_t failures = arithmeticTest(3);
+	printf("\nevery width against 128 bit math at the limits: %s (%zu failed)\n", failures == 0 ? "ok" : "FAILED", failures);
+}
+
+
+
+// one row of benchStdIntH(): a[i] + b[i] into out[i] and a sum of b, in
+// plain C (the values never overflow, so it's fine here) and in the safe ways.
+// amounts are below MAX / 4, like money always is until the day it isn't,
+// and half of them are negative when isSigned
+#define ARITHMETIC_BENCH(name, type, isSigned) \
+	static void arithmeticBench##name(size_t n) { \
+		type *a = malloc(n * sizeof(type)), *b = malloc(n * sizeof(type)), *out = malloc(n * sizeof(type)); \
+		if(a == NULL || b == NULL || out == NULL) { \
+			printf("couldn't allocate the arrays\n"); \
+			goto done; \
+		} \
+		unsigned seed = 21; \
+		for(size_t i = 0; i < n; i++) { \
+			uint64_t bits = 0; \
+			for(int k = 0; k < 4; k++) { \
+				seed = seed * 1103515245u + 12345u; \
+				bits = (bits << 16) | (seed >> 16); \
+			} \
+			/* a quarter of the signed MAX, and b small enough that n of them add up to less */ \
+			uint64_t quarter = (UINT64_MAX >> (65 - 8 * sizeof(type))) / 4, small = quarter / n + 1; \
+			a[i] = (type) (bits % quarter - (isSigned && i % 2 ? quarter / 2 : 0)); \
+			b[i] = (type) ((bits >> 7) % small - (isSigned && i % 3 ? small / 2 : 0)); \
+		} \
+		/* elements per nanosecond, the best of 5 runs of 20 passes */ \
+		_Pragma("GCC diagnostic push") \
+		_Pragma("GCC diagnostic ignored \"-Wunused-but-set-variable\"") \
+		bool overflowed = false; \
+		type total = 0; \
+		printf("%-9s", #type); \
+		printf(" %9.2f", ARITHMETIC_MEASURE(for(size_t i = 0; i < n; i++) { out[i] = a[i] + b[i]; })); \
+		printf(" %9.2f", ARITHMETIC_MEASURE(for(size_t i = 0; i < n; i++) { \
+			if(checkedAdd(a[i], b[i], &out[i])) { overflowed = true; break; } })); \
+		printf(" %9.2f", ARITHMETIC_MEASURE(for(size_t i = 0; i < n; i++) { overflowed |= checkedAdd(a[i], b[i], &out[i]); })); \
+		printf(" %9.2f", ARITHMETIC_MEASURE(for(size_t i = 0; i < n; i++) { out[i] = saturatingAdd(a[i], b[i]); })); \
+		printf(" %9.2f", ARITHMETIC_MEASURE(saturatingAddArray(out, a, b, n))); \
+		/* sums: unsigned so the plain one can't overflow, then the checked one */ \
+		printf(" %9.2f", ARITHMETIC_MEASURE(total = 0; for(size_t i = 0; i < n; i++) { \
+			total = (type) ((uint64_t) total + (uint64_t) b[i]); } benchKeep(total))); \
+		printf(" %9.2f\n", ARITHMETIC_MEASURE(total = 0; for(size_t i = 0; i < n; i++) { \
+			overflowed |= checkedAdd(total, b[i], &total); } benchKeep(total))); \
+		_Pragma("GCC diagnostic pop") \
+		if(overflowed) { \
+			printf("  (an overflow happened, so the checked times are of a shorter loop)\n"); \
+		} \
+	done: \
+		free(a); \
+		free(b); \
+		free(out); \
+	}
+
+#define ARITHMETIC_MEASURE(code) ({ \
+	uint64_t best = UINT64_MAX; \
+	for(int r = 0; r < 5; r++) { \
+		uint64_t start = monotonicNs(); \
+		for(int pass = 0; pass < 20; pass++) { \
+			code; \
+			benchKeep(out); \
+		} \
+		uint64_t ns = monotonicNs() - start; \
+		best = ns < best ? ns : best; \
+	} \
+	(double) n * 20 / best; \
+})
+
+ARITHMETIC_BENCH(I16, int16_t, true)
+ARITHMETIC_BENCH(I32, int32_t, true)
+ARITHMETIC_BENCH(I64, int64_t, true)
+ARITHMETIC_BENCH(U64, uint64_t, false)
+#undef ARITHMETIC_MEASURE
+
+void benchStdIntH() {
+	// how much the safety costs next to plain + in a tight loop over arrays
+	// that fit in the cache (16384 elements)
+	size_t failures = arithmeticTest(3);
+	printf("every width against 128 bit math at the limits: %s (%zu failed)\n", failures == 0 ? "ok" : "FAILED", failures);
+	printf("saturating arrays: %s\n\n", mathHasAvx2() ? "avx2" : "sse2");
+	printf("%-9s %9s %9s %9s %9s %9s %9s %9s   (elements/ns)\n", "", "a + b", "checked", "flag", "saturate", "array",
+		"sum", "checked");
+	size_t n = 1 << 14;
+	arithmeticBenchI16(n);
+	arithmeticBenchI32(n);
+	arithmeticBenchI64(n);
+	arithmeticBenchU64(n);
+}
+
+
+
+// THREE WAYS OF COPYING A FILE
+// 1. streaming with fread()/fwrite(): the bytes go from the kernel to the FILE
+//    buffer, then to our buffer, then to the other FILE buffer and back to the
+//    kernel. setvbuf() chooses how big the FILE buffers are (how many bytes
+//    each read()/write() system call moves)
+// 2. memory mapping with mmap(): the file's pages in the kernel page cache are
+//    mapped straight into our address space, so reading it copies nothing.
+//    writing it out is one write() call from the mapping
+// 3. asking the kernel to copy it with copy_file_range() (or sendfile()), the
+//    bytes never even come to our side
+
+// the whole file as a read-only array, without reading it
+struct mappedFile {
+	const char *data;
+	size_t size;
+};
+
+static bool mapFile(const char *path, struct mappedFile *file) {
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) != 0) {
+		close(fd);
+		return false;
+	}
+	file->size = (size_t) info.st_size;
+	file->data = NULL;
+	if(file->size > 0) {
+		void *data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(data == MAP_FAILED) {
+			close(fd);
+			return false;
+		}
+		// we'll go from start to end: the kernel can read ahead aggressively
+		// and drop the pages we already went past
+		madvise(data, file->size, MADV_SEQUENTIAL);
+		file->data = data;
+	}
+	close(fd); // the mapping stays valid after closing the file
+	return true;
+}
+
+static void unmapFile(struct mappedFile *file) {
+	if(file->data != NULL) {
+		munmap((void *) file->data, file->size);
+	}
+	file->data = NULL;
+	file->size = 0;
+}
+
+// write() may write less than asked, so keep going until it's all out
+static bool writeAll(int fd, const char *data, size_t size) {
+	while(size > 0) {
+		ssize_t written = write(fd, data, size);
+		if(written < 0) {
+			if(errno == EINTR) continue;
+			return false;
+		}
+		data += written;
+		size -= (size_t) written;
+	}
+	return true;
+}
+
+// all the copy functions return false and leave errno set if something failed
+
+static bool copyFileStdio(const char *from, const char *to, size_t bufferSize) {
+	FILE *source = fopen(from, "rb");
+	if(source == NULL) {
+		return false;
+	}
+	FILE *target = fopen(to, "wb");
+	// glibc ignores the size when setvbuf() gets NULL (it keeps its own
+	// 4 KiB buffer), so the FILE buffers are ours too
+	char *chunk = malloc(bufferSize);
+	char *sourceBuffer = malloc(bufferSize);
+	char *targetBuffer = malloc(bufferSize);
+	if(target == NULL || chunk == NULL || sourceBuffer == NULL || targetBuffer == NULL) {
+		int saved = target == NULL ? errno : ENOMEM;
+		fclose(source);
+		if(target != NULL) fclose(target);
+		free(chunk);
+		free(sourceBuffer);
+		free(targetBuffer);
+		errno = saved;
+		return false;
+	}
+	// setvbuf() has to be called before the first read or write, and the
+	// buffers have to live until fclose()
+	setvbuf(source, sourceBuffer, _IOFBF, bufferSize);
+	setvbuf(target, targetBuffer, _IOFBF, bufferSize);
+
+	bool ok = true;
+	size_t got;
+	while((got = fread(chunk, 1, bufferSize, source)) > 0) {
+		if(fwrite(chunk, 1, got, target) != got) {
+			ok = false;
+			break;
+		}
+	}
+	ok = ok && !ferror(source);
+	free(chunk);
+	fclose(source);
+	// fclose() writes whatever is left in the buffer, so it can fail too
+	ok = fclose(target) == 0 && ok;
+	free(sourceBuffer);
+	free(targetBuffer);
+	return ok;
+}
+
+static bool copyFileMmap(const char *from, const char *to) {
+	struct mappedFile source;
+	if(!mapFile(from, &source)) {
+		return false;
+	}
+	int target = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(target < 0) {
+		int saved = errno;
+		unmapFile(&source);
+		errno = saved;
+		return false;
+	}
+	bool ok = writeAll(target, source.data, source.size);
+	int saved = errno;
+	unmapFile(&source);
+	if(close(target) != 0 && ok) {
+		ok = false;
+		saved = errno;
+	}
+	errno = saved;
+	return ok;
+}
+
+static bool copyFileKernel(const char *from, const char *to) {
+	int source = open(from, O_RDONLY);
+	if(source < 0) {
+		return false;
+	}
+	int target = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(target < 0) {
+		int saved = errno;
+		close(source);
+		errno = saved;
+		return false;
+	}
+	struct stat info;
+	bool ok = fstat(source, &info) == 0;
+	size_t left = ok ? (size_t) info.st_size : 0;
+	// copy_file_range() can even share the blocks on filesystems that support
+	// it, but older kernels refuse to copy between different filesystems, so
+	// if it doesn't work sendfile() does the same with any pair of files
+	bool useSendfile = false;
+	while(ok && left > 0) {
+		ssize_t copied;
+		if(!useSendfile) {
+			copied = copy_file_range(source, NULL, target, NULL, left, 0);
+			if(copied < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+				useSendfile = true;
+				continue;
+			}
+		} else {
+			copied = sendfile(target, source, NULL, left);
+		}
+		if(copied < 0 && errno == EINTR) continue;
+		if(copied <= 0) {
+			ok = false; // 0 means the file got shorter while we copied it
+			break;
+		}
+		left -= (size_t) copied;
+	}
+	int saved = errno;
+	close(source);
+	if(close(target) != 0 && ok) {
+		ok = false;
+		saved = errno;
+	}
+	errno = saved;
+	return ok;
+}
+
+// how many read-like and write-like system calls this process made so far,
+// from /proc/self/io (linux only). returns false if that file isn't there
+static bool countSyscalls(uint64_t *syscalls) {
+	FILE *io = fopen("/proc/self/io", "r");
+	if(io == NULL) {
+		return false;
+	}
+	char line[128];
+	uint64_t total = 0;
+	int found = 0;
+	while(fgets(line, sizeof(line), io) != NULL) {
+		uint64_t value;
+		if(sscanf(line, "syscr: %" SCNu64, &value) == 1 || sscanf(line, "syscw: %" SCNu64, &value) == 1) {
+			total += value;
+			found++;
+		}
+	}
+	fclose(io);
+	*syscalls = total;
+	return found == 2;
+}
+
+// page faults are how an mmap()ed file gets read, so we count them too
+static uint64_t countPageFaults() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return (uint64_t) usage.ru_minflt + (uint64_t) usage.ru_majflt;
+}
+
+// makes a file of "size" random-ish bytes in the temporary directory,
+// and writes its path to "path" (which must hold PATH_MAX chars)
+static bool makeScratchFile(char *path, size_t size) {
+	const char *directory = getenv("TMPDIR");
+	snprintf(path, PATH_MAX, "%s/header_testing_XXXXXX", directory != NULL ? directory : "/tmp");
+	int fd = mkstemp(path);
+	if(fd < 0) {
+		return false;
+	}
+	char *chunk = malloc(1 << 20);
+	bool ok = chunk != NULL;
+	uint64_t x = 0x9E3779B97F4A7C15u;
+	for(size_t written = 0; ok && written < size;) {
+		size_t part = size - written < (1 << 20) ? size - written : (1 << 20);
+		for(size_t i = 0; i + 8 <= part; i += 8) {
+			x ^= x << 13;
+			x ^= x >> 7;
+			x ^= x << 17;
+			memcpy(chunk + i, &x, 8);
+		}
+		ok = writeAll(fd, chunk, part);
+		written += part;
+	}
+	free(chunk);
+	ok = close(fd) == 0 && ok;
+	if(!ok) {
+		unlink(path);
+	}
+	return ok;
+}
+
+// compares two files byte by byte through their mappings
+static bool sameContents(const char *a, const char *b) {
+	struct mappedFile x, y;
+	if(!mapFile(a, &x)) {
+		return false;
+	}
+	if(!mapFile(b, &y)) {
+		unmapFile(&x);
+		return false;
+	}
+	bool same = x.size == y.size && (x.size == 0 || memcmp(x.data, y.data, x.size) == 0);
+	unmapFile(&x);
+	unmapFile(&y);
+	return same;
+}
+
+
+
+void testStdIOH() {
+	// this is one of the most important headers, because it allows us
+	// to interact with the FILE type, and that includes the standard input
+	// and standard output streams (usually the terminal)
+
+	// printing and reading from the standard IO
+	char input[100];
+	printf("\n\ngive me some text: ");
+	scanf("%99s", input); // reading a string with at maximum 99 chars
+	printf("you wrote %s\n", input); // printing it in the terminal
+
+	// we can also read from and write to files
+	FILE *thisCode = fopen("header_testing.c", "r"); // open this file in read mode
+	char first1000chars[1001];
+	// fread() returns how many items it really read, and it doesn't put a
+	// null-terminator at the end, that's our job if we want to print it
+	size_t charsRead = fread(first1000chars, sizeof(char), 1000, thisCode);
+	first1000chars[charsRead] = '\0';
+	printf("\nThe beggining of this file:\n%s\n", first1000chars);
+	fclose(thisCode);
+
+	FILE *newFile = fopen("target.txt", "w"); // opening in write mode
+	fwrite(first1000chars, sizeof(char), charsRead, newFile);
+	fclose(newFile);
+
+	// there are also methods to rename and delete files
+	rename("target.txt", "target_file.txt");
+	remove("target_file.txt");
+
+	// in total there must be like 50 functions that read and write to files
+	// in all sorts of ways, but this is already enough to play around with
+
+	// (ok, just one more thing) fread() always copies the bytes into our
+	// buffer, but with mmap() (from POSIX, not the C standard) the file itself
+	// shows up in memory, and no copy is made until we touch it
+	struct mappedFile mapped;
+	if(mapFile("header_testing.c", &mapped)) {
+		const char *firstNewline = memchr(mapped.data, '\n', mapped.size);
+		int firstLineLength = firstNewline ? (int) (firstNewline - mapped.data) : (int) mapped.size;
+		printf("\nthis file has %zu bytes, and its first line is: %.*s\n", mapped.size, firstLineLength, mapped.data);
+		unmapFile(&mapped);
+	}
+	// and the kernel can copy a file for us without the bytes ever passing through our program
+	if(copyFileKernel("header_testing.c", "target_copy.txt")) {
+		printf("copy_file_range() made a %s copy of this file\n",
+			sameContents("header_testing.c", "target_copy.txt") ? "perfect" : "WRONG");
+		remove("target_copy.txt");
+	}
+}
+
+
+
+void benchStdIOH() {
+	// copies files from 4 KiB up to -s MiB with every method. the source was
+	// just written, so it's in the page cache: this measures the copying
+	// itself, not the disk (dropping the cache would need root)
+	struct {
+		const char *name;
+		size_t bufferSize; // 0 for the methods that don't use a FILE buffer
+		int method; // 0 = stdio, 1 = mmap, 2 = kernel
+	} methods[] = {
+		{"fread/fwrite 4 KiB", 4 << 10, 0},
+		{"fread/fwrite 64 KiB", 64 << 10, 0},
+		{"fread/fwrite 1 MiB", 1 << 20, 0},
+		{"mmap + write", 0, 1},
+		{"copy_file_range", 0, 2},
+	};
+	size_t methodCount = sizeof(methods) / sizeof(methods[0]);
+	uint64_t syscallsBefore;
+	bool haveSyscalls = countSyscalls(&syscallsBefore);
+
+	printf("%10s  %-20s %10s %14s %12s\n", "file size", "method", "MB/s", "syscalls/MiB", "faults/MiB");
+	uint64_t maxSize = (uint64_t) benchMaxMiB << 20;
+	for(uint64_t size = 4 << 10; size <= maxSize; size = nextSizeStep(size, maxSize, 16)) {
+		char source[PATH_MAX], target[PATH_MAX + 8];
+		if(!makeScratchFile(source, size)) {
+			perror("couldn't create the source file");
+			return;
+		}
+		snprintf(target, sizeof(target), "%s.copy", source);
+		// small files are copied many times, so each measurement moves at least 64 MiB
+		uint64_t copies = ((uint64_t) 64 << 20) / size;
+		copies = copies < 1 ? 1 : copies;
+
+		for(size_t m = 0; m < methodCount; m++) {
+			uint64_t syscalls = 0, faults = countPageFaults();
+			countSyscalls(&syscalls);
+			uint64_t start = monotonicNs();
+			bool ok = true;
+			for(uint64_t c = 0; c < copies && ok; c++) {
+				if(methods[m].method == 0) {
+					ok = copyFileStdio(source, target, methods[m].bufferSize);
+				} else if(methods[m].method == 1) {
+					ok = copyFileMmap(source, target);
+				} else {
+					ok = copyFileKernel(source, target);
+				}
+			}
+			uint64_t elapsed = monotonicNs() - start;
+			uint64_t syscallsAfter = 0;
+			countSyscalls(&syscallsAfter);
+			faults = countPageFaults() - faults;
+
+			if(!ok || !sameContents(source, target)) {
+				printf("%s failed: %s\n", methods[m].name, ok ? "the copy is different" : strerror(errno));
+				continue;
+			}
+			double mib = (double) size * copies / (1 << 20);
+			char syscallText[32] = "n/a";
+			if(haveSyscalls) {
+				// -1 for the countSyscalls() read itself, which counts as one
+				snprintf(syscallText, sizeof(syscallText), "%.1f", (syscallsAfter - syscalls - 1) / mib);
+			}
+			printf("%10" PRIu64 "  %-20s %10.1f %14s %12.1f\n", size, methods[m].name,
+				(double) size * copies / (elapsed / 1e3), syscallText, faults / mib);
+			fflush(stdout);
+		}
+		unlink(target);
+		unlink(source);
+	}
+	if(!haveSyscalls) {
+		printf("\n(/proc/self/io isn't available here, so there are no syscall counts)\n");
+	}
+}
+
+
+
+// TWO ALLOCATORS THAT ARE FASTER THAN MALLOC (WHEN THEY FIT THE PROBLEM)
+// malloc() has to handle any size, in any order, from any thread, and it pays
+// for that generality on every call. if we know more about our allocations
+// we can do a lot less work:
+// - an arena hands out memory by just moving a pointer forward, and frees
+//   everything at once (or everything after a "mark") when we're done
+// - a pool only hands out blocks of one size, so a freed block can be reused
+//   by anybody, kept in a linked list made of the free blocks themselves
+
+// THE ARENA
+
+struct arenaChunk {
+	struct arenaChunk *previous;
+	size_t capacity;
+	size_t used;
+	_Alignas(max_align_t) char data[]; // flexible array member: the memory itself
+};
+
+struct arena {
+	struct arenaChunk *current;
+	size_t chunkSize;
+};
+
+// where the arena was at some point, so we can go back there later
+struct arenaMark {
+	struct arenaChunk *chunk;
+	size_t used;
+};
+
+static void arenaInit(struct arena *arena, size_t chunkSize) {
+	arena->current = NULL;
+	arena->chunkSize = chunkSize;
+}
+
+// align must be a power of 2. returns NULL if there's no memory left
+static void *arenaAlloc(struct arena *arena, size_t size, size_t align) {
+	struct arenaChunk *chunk = arena->current;
+	if(chunk != NULL) {
+		uintptr_t next = (uintptr_t) (chunk->data + chunk->used);
+		size_t start = ((next + align - 1) & ~(uintptr_t) (align - 1)) - (uintptr_t) chunk->data;
+		if(start + size <= chunk->capacity) {
+			chunk->used = start + size;
+			return chunk->data + start;
+		}
+	}
+	// doesn't fit: start a new chunk (a bigger one if this allocation is huge)
+	size_t capacity = size + align > arena->chunkSize ? size + align : arena->chunkSize;
+	chunk = malloc(sizeof(struct arenaChunk) + capacity);
+	if(chunk == NULL) {
+		return NULL;
+	}
+	chunk->previous = arena->current;
+	chunk->capacity = capacity;
+	chunk->used = 0;
+	arena->current = chunk;
+	return arenaAlloc(arena, size, align);
+}
+
+static struct arenaMark arenaGetMark(struct arena *arena) {
+	struct arenaMark mark = {arena->current, arena->current ? arena->current->used : 0};
+	return mark;
+}
+
+// frees everything allocated after the mark was taken, in one go
+static void arenaRewind(struct arena *arena, struct arenaMark mark) {
+	while(arena->current != mark.chunk) {
+		struct arenaChunk *previous = arena->current->previous;
+		free(arena->current);
+		arena->current = previous;
+	}
+	if(arena->current != NULL) {
+		arena->current->used = mark.used;
+	}
+}
+
+// frees everything
+static void arenaReset(struct arena *arena) {
+	struct arenaMark empty = {NULL, 0};
+	arenaRewind(arena, empty);
+}
+
+// THE POOL
+// the blocks are cut from big slabs, and a free block holds the pointer to
+// the next free block, so the free list costs no extra memory. the shared
+// free list needs a mutex, so every thread also keeps a small list of its own
+// (a thread_local cache) and only touches the shared one every POOL_BATCH blocks
+
+#define POOL_BATCH 32 // blocks moved between a thread's cache and the shared list at once
+#define POOL_CACHE_SLOTS 8 // how many pools a thread can cache blocks for
+
+struct poolBlock {
+	struct poolBlock *next;
+};
+
+struct poolSlab {
+	struct poolSlab *next;
+};
+
+struct fixedPool {
+	mtx_t lock;
+	size_t blockSize;
+	size_t blocksPerSlab;
+	struct poolBlock *freeList; // the shared one
+	struct poolSlab *slabs;
+	char *carve; // the part of the newest slab that was never handed out
+	size_t carveLeft; // in blocks
+};
+
+struct poolCache {
+	struct fixedPool *pool;
+	struct poolBlock *blocks;
+	size_t count;
+};
+
+static thread_local struct poolCache poolCaches[POOL_CACHE_SLOTS];
+
+// the cache for this pool in this thread, or NULL if all the slots are taken
+static struct poolCache *poolCacheFor(struct fixedPool *pool) {
+	struct poolCache *empty = NULL;
+	for(int i = 0; i < POOL_CACHE_SLOTS; i++) {
+		if(poolCaches[i].pool == pool) {
+			return &poolCaches[i];
+		}
+		if(poolCaches[i].pool == NULL && empty == NULL) {
+			empty = &poolCaches[i];
+		}
+	}
+	if(empty != NULL) {
+		empty->pool = pool;
+	}
+	return empty;
+}
+
+// blockSize is rounded up so every block can hold a pointer and stays aligned
+static bool poolInit(struct fixedPool *pool, size_t blockSize, size_t blocksPerSlab) {
+	size_t align = _Alignof(max_align_t);
+	size_t size = blockSize < sizeof(struct poolBlock) ? sizeof(struct poolBlock) : blockSize;
+	pool->blockSize = (size + align - 1) & ~(align - 1);
+	pool->blocksPerSlab = blocksPerSlab;
+	pool->freeList = NULL;
+	pool->slabs = NULL;
+	pool->carve = NULL;
+	pool->carveLeft = 0;
+	return mtx_init(&pool->lock, mtx_plain) == thrd_success;
+}
+
+// takes up to "wanted" blocks from the shared side (the free list, then
+// the slab), must be called with the lock held. returns how many it got
+static size_t poolTakeLocked(struct fixedPool *pool, struct poolBlock **list, size_t wanted) {
+	size_t got = 0;
+	while(got < wanted && pool->freeList != NULL) {
+		struct poolBlock *block = pool->freeList;
+		pool->freeList = block->next;
+		block->next = *list;
+		*list = block;
+		got++;
+	}
+	while(got < wanted) {
+		if(pool->carveLeft == 0) {
+			// the slab header is padded to a whole block, so blocks stay aligned
+			struct poolSlab *slab = malloc(pool->blockSize * (pool->blocksPerSlab + 1));
+			if(slab == NULL) {
+				break;
+			}
+			slab->next = pool->slabs;
+			pool->slabs = slab;
+			pool->carve = (char *) slab + pool->blockSize;
+			pool->carveLeft = pool->blocksPerSlab;
+		}
+		struct poolBlock *block = (struct poolBlock *) pool->carve;
+		pool->carve += pool->blockSize;
+		pool->carveLeft--;
+		block->next = *list;
+		*list = block;
+		got++;
+	}
+	return got;
+}
+
+static void *poolAlloc(struct fixedPool *pool) {
+	struct poolCache *cache = poolCacheFor(pool);
+	if(cache == NULL) {
+		// no cache slot left in this thread, go straight to the shared list
+		struct poolBlock *block = NULL;
+		mtx_lock(&pool->lock);
+		poolTakeLocked(pool, &block, 1);
+		mtx_unlock(&pool->lock);
+		return block;
+	}
+	if(cache->count == 0) {
+		mtx_lock(&pool->lock);
+		cache->count = poolTakeLocked(pool, &cache->blocks, POOL_BATCH);
+		mtx_unlock(&pool->lock);
+		if(cache->count == 0) {
+			return NULL;
+		}
+	}
+	struct poolBlock *block = cache->blocks;
+	cache->blocks = block->next;
+	cache->count--;
+	return block;
+}
+
+// gives "count" blocks from the front of the list back to the shared list
+static void poolGiveBack(struct fixedPool *pool, struct poolBlock **list, size_t count) {
+	if(count == 0) {
+		return;
+	}
+	struct poolBlock *first = *list;
+	struct poolBlock *last = first;
+	for(size_t i = 1; i < count; i++) {
+		last = last->next;
+	}
+	*list = last->next;
+	mtx_lock(&pool->lock);
+	last->next = pool->freeList;
+	pool->freeList = first;
+	mtx_unlock(&pool->lock);
+}
+
+static void poolFree(struct fixedPool *pool, void *pointer) {
+	if(pointer == NULL) {
+		return;
+	}
+	struct poolBlock *block = pointer;
+	struct poolCache *cache = poolCacheFor(pool);
+	if(cache == NULL) {
+		block->next = NULL;
+		poolGiveBack(pool, &block, 1);
+		return;
+	}
+	block->next = cache->blocks;
+	cache->blocks = block;
+	// a thread that only frees (like a consumer) would keep growing its cache
+	// forever, so when it gets too big half of it goes back to be shared
+	if(++cache->count >= 2 * POOL_BATCH) {
+		poolGiveBack(pool, &cache->blocks, POOL_BATCH);
+		cache->count -= POOL_BATCH;
+	}
+}
+
+// every thread that used a pool must call this before it ends (or before the
+// pool is destroyed), otherwise the blocks in its cache are lost
+static void poolFlushThreadCache(struct fixedPool *pool) {
+	for(int i = 0; i < POOL_CACHE_SLOTS; i++) {
+		if(poolCaches[i].pool == pool) {
+			poolGiveBack(pool, &poolCaches[i].blocks, poolCaches[i].count);
+			poolCaches[i].pool = NULL;
+			poolCaches[i].count = 0;
+		}
+	}
+}
+
+// frees all the slabs at once, even blocks that were never given back
+static void poolDestroy(struct fixedPool *pool) {
+	poolFlushThreadCache(pool);
+	while(pool->slabs != NULL) {
+		struct poolSlab *next = pool->slabs->next;
+		free(pool->slabs);
+		pool->slabs = next;
+	}
+	mtx_destroy(&pool->lock);
+}
+
+
+
+void testStdLibH() {
+	// this is also one of the most important headers, because it defines
+	// stuff like the exit() and system() functions
+
+	// the system() function allows us to make system calls such as "mkdir"
+	// or "cd" through code
+	system("ls -a");
+
+	// the functions of this header you'll use the most are malloc() and free(),
+	// which give and take back memory from the heap. but we can build faster
+	// allocators on top of them for special cases (they are right above)
+	struct arena arena;
+	arenaInit(&arena, 4096);
+	char *greeting = arenaAlloc(&arena, 32, 1);
+	strcpy(greeting, "hello from the arena");
+	// everything allocated after a mark can be thrown away at once
+	struct arenaMark mark = arenaGetMark(&arena);
+	int *scratch = arenaAlloc(&arena, 100 * sizeof(int), _Alignof(int));
+	scratch[99] = 99;
+	arenaRewind(&arena, mark);
+	printf("\n%s (the scratch array is already gone)\n", greeting);
+	arenaReset(&arena);
+
+	struct fixedPool pool;
+	if(poolInit(&pool, 48, 64)) {
+		void *first = poolAlloc(&pool);
+		poolFree(&pool, first);
+		// the block we just freed is the first one to be reused
+		void *second = poolAlloc(&pool);
+		printf("the pool gave back the %s block\n", first == second ? "same" : "a different");
+		poolFree(&pool, second);
+		poolDestroy(&pool);
+	}
+
+	// the atexit function defines functions that shall be called
+	// when the program terminantes normally (through exit() or returning from main)
+	void exiting1() {
+		printf("\ndoing something\n");
+	}
+	void exiting2() {
+		printf("doing another thing\n");
+	}
+	// the functions are called in the reverse order they are passed to atexit()
+	atexit(exiting2);
+	atexit(exiting1);
+
+	exit(0);
+}
+
+
+
+// the allocators, all behind the same two functions, for the churn patterns
+struct churnAllocator {
+	const char *name;
+	void *(*allocate)(void *context);
+	void (*release)(void *context, void *pointer);
+	void *context;
+};
+
+#define CHURN_BLOCK 64 // every churn pattern allocates blocks of this size
+
+static void *churnMalloc(void *context) { (void) context; return malloc(CHURN_BLOCK); }
+static void churnFree(void *context, void *pointer) { (void) context; free(pointer); }
+static void *churnPoolAlloc(void *context) { return poolAlloc(context); }
+static void churnPoolFree(void *context, void *pointer) { poolFree(context, pointer); }
+
+// everything one producer/consumer thread needs
+struct churnHandoff {
+	const struct churnAllocator *allocator;
+	struct mpmcQueue *queue;
+	uint64_t items; // per thread
+	atomic_bool failed;
+	atomic_bool go; // every thread waits for it, so none starts with a partner missing
+	atomic_bool cancelled; // set with go when not every thread could start
+};
+
+// returns false if the run was cancelled, and then the thread just ends
+static bool churnWaitForStart(struct churnHandoff *handoff) {
+	while(!atomic_load(&handoff->go)) {
+		thrd_yield();
+	}
+	return !atomic_load(&handoff->cancelled);
+}
+
+static int churnProducerMain(void *argument) {
+	struct churnHandoff *handoff = argument;
+	const struct churnAllocator *allocator = handoff->allocator;
+	unsigned failures = 0;
+	if(!churnWaitForStart(handoff)) {
+		return 0;
+	}
+	for(uint64_t i = 0; i < handoff->items; i++) {
+		void *block = allocator->allocate(allocator->context);
+		if(block == NULL) {
+			atomic_store(&handoff->failed, true);
+			block = &handoff->items; // keep the item count right, it's never freed
+		} else {
+			memset(block, (int) i, CHURN_BLOCK); // like real code would write it
+		}
+		while(!mpmcTryPush(handoff->queue, (uintptr_t) block)) {
+			queueBackoff(&failures);
+		}
+	}
+	if(allocator->release == churnPoolFree) {
+		poolFlushThreadCache(allocator->context);
+	}
+	return 0;
+}
+
+static int churnConsumerMain(void *argument) {
+	struct churnHandoff *handoff = argument;
+	const struct churnAllocator *allocator = handoff->allocator;
+	unsigned failures = 0;
+	uint64_t value;
+	if(!churnWaitForStart(handoff)) {
+		return 0;
+	}
+	for(uint64_t i = 0; i < handoff->items; i++) {
+		while(!mpmcTryPop(handoff->queue, &value)) {
+			queueBackoff(&failures);
+		}
+		if((void *) (uintptr_t) value != &handoff->items) {
+			allocator->release(allocator->context, (void *) (uintptr_t) value);
+		}
+	}
+	if(allocator->release == churnPoolFree) {
+		poolFlushThreadCache(allocator->context);
+	}
+	return 0;
+}
+
+void benchStdLibH() {
+	// three allocation patterns with 64 byte blocks:
+	// - LIFO: allocate 64 blocks, free them in reverse order, repeat (like
+	//   temporary objects in a function call)
+	// - random: 4096 slots, each step frees a random slot if it's taken and
+	//   fills it otherwise (like a cache or a connection table)
+	// - producer/consumer: some threads allocate, others free what they got
+	//   through the lock-free queue (like requests passed between threads)
+	// the arena can't free one block at a time, so it only runs the LIFO
+	// pattern, where a mark/rewind pair replaces the 64 frees
+	uint64_t operations = 1 << 23;
+	struct fixedPool pool;
+	if(!poolInit(&pool, CHURN_BLOCK, 4096)) {
+		printf("couldn't create the pool\n");
+		return;
+	}
+	struct churnAllocator allocators[] = {
+		{"malloc", churnMalloc, churnFree, NULL},
+		{"pool", churnPoolAlloc, churnPoolFree, &pool},
+	};
+	size_t allocatorCount = sizeof(allocators) / sizeof(allocators[0]);
+
+	printf("%-18s %-8s %12s %16s\n", "pattern", "allocator", "Mops/s", "RSS growth (KiB)");
+	void report(const char *pattern, const char *allocator, uint64_t ops, uint64_t elapsed, size_t rssBefore) {
+		size_t rss = currentRssBytes();
+		long long growth = ((long long) rss - (long long) rssBefore) / 1024;
+		printf("%-18s %-8s %12.2f %16lld\n", pattern, allocator, ops * 1e3 / elapsed, growth);
+		fflush(stdout);
+	}
+
+	// LIFO
+	void *stack[64];
+	for(size_t a = 0; a < allocatorCount; a++) {
+		const struct churnAllocator *allocator = &allocators[a];
+		size_t rss = currentRssBytes();
+		uint64_t start = monotonicNs();
+		for(uint64_t round = 0; round < operations / 128; round++) {
+			for(int i = 0; i < 64; i++) {
+				stack[i] = allocator->allocate(allocator->context);
+				benchKeep(stack[i]);
+			}
+			for(int i = 63; i >= 0; i--) {
+				allocator->release(allocator->context, stack[i]);
+			}
+		}
+		report("LIFO", allocator->name, operations / 128 * 128, monotonicNs() - start, rss);
+	}
+	struct arena arena;
+	arenaInit(&arena, 64 << 10);
+	size_t rss = currentRssBytes();
+	uint64_t start = monotonicNs();
+	for(uint64_t round = 0; round < operations / 128; round++) {
+		struct arenaMark mark = arenaGetMark(&arena);
+		for(int i = 0; i < 64; i++) {
+			stack[i] = arenaAlloc(&arena, CHURN_BLOCK, 16);
+			benchKeep(stack[i]);
+		}
+		arenaRewind(&arena, mark);
+	}
+	// 64 allocations and one rewind do the work of 64 allocations and 64 frees
+	report("LIFO", "arena", operations / 128 * 128, monotonicNs() - start, rss);
+	arenaReset(&arena);
+
+	// random
+	size_t slotCount = 4096;
+	void **slots = calloc(slotCount, sizeof(void *));
+	if(slots == NULL) {
+		printf("couldn't allocate the slots\n");
+		poolDestroy(&pool);
+		return;
+	}
+	for(size_t a = 0; a < allocatorCount; a++) {
+		const struct churnAllocator *allocator = &allocators[a];
+		uint64_t seed = 12345;
+		size_t rssBefore = currentRssBytes();
+		start = monotonicNs();
+		for(uint64_t i = 0; i < operations; i++) {
+			seed = seed * 6364136223846793005u + 1442695040888963407u;
+			size_t slot = (seed >> 33) % slotCount;
+			if(slots[slot] != NULL) {
+				allocator->release(allocator->context, slots[slot]);
+				slots[slot] = NULL;
+			} else {
+				slots[slot] = allocator->allocate(allocator->context);
+			}
+		}
+		uint64_t elapsed = monotonicNs() - start;
+		report("random", allocator->name, operations, elapsed, rssBefore);
+		for(size_t i = 0; i < slotCount; i++) {
+			allocator->release(allocator->context, slots[i]);
+			slots[i] = NULL;
+		}
+	}
+	free(slots);
+
+	// producer/consumer
+	int threadCount = benchThreadCount();
+	int producers = threadCount / 2 > 0 ? threadCount / 2 : 1;
+	int consumers = producers;
+	char pattern[32];
+	snprintf(pattern, sizeof(pattern), "%d prod/%d cons", producers, consumers);
+	struct mpmcQueue queue;
+	if(!mpmcInit(&queue, 1024)) {
+		printf("couldn't allocate the queue\n");
+		poolDestroy(&pool);
+		return;
+	}
+	for(size_t a = 0; a < allocatorCount; a++) {
+		struct churnHandoff handoff;
+		handoff.allocator = &allocators[a];
+		handoff.queue = &queue;
+		handoff.items = operations / 2 / producers;
+		atomic_init(&handoff.failed, false);
+		atomic_init(&handoff.go, false);
+		atomic_init(&handoff.cancelled, false);
+
+		thrd_t *threads = malloc(sizeof(thrd_t) * (producers + consumers));
+		if(threads == NULL) {
+			break;
+		}
+		size_t rssBefore = currentRssBytes();
+		int started = 0;
+		for(; started < producers + consumers; started++) {
+			if(thrd_create(&threads[started], started < producers ? churnProducerMain : churnConsumerMain,
+				&handoff) != thrd_success) {
+				break;
+			}
+		}
+		bool cancelled = started < producers + consumers;
+		atomic_store(&handoff.cancelled, cancelled);
+		start = monotonicNs();
+		atomic_store(&handoff.go, true);
+		for(int i = 0; i < started; i++) {
+			thrd_join(threads[i], NULL);
+		}
+		uint64_t elapsed = monotonicNs() - start;
+		free(threads);
+		if(cancelled) {
+			printf("couldn't start %d threads (only %d)\n", producers + consumers, started);
+			break;
+		}
+		if(atomic_load(&handoff.failed)) {
+			printf("%s ran out of memory\n", allocators[a].name);
+		}
+		report(pattern, allocators[a].name, handoff.items * producers * 2, elapsed, rssBefore);
+	}
+	mpmcDestroy(&queue);
+	poolDestroy(&pool);
+}
+
+
+
+void testStdNoReturnH() {
+	// this header defi"nes the _Noreturn function modifier,
+		// a function with this modifier shouldn't return ever, if
+		// it does, the behavior is undefined (in gcc you get a compilation error)
+		_Noreturn int functionThatReturns() {
+			// uncomment the return and comment the exit to see the error
+			//return 1;
+			exit(0);
+		}
+		int a = functionThatReturns();
+	}
+	
+// FAST STRING KERNELS
+// the libc string functions look at one byte at a time only in textbooks:
+// the real ones look at a whole word (8 bytes) or a whole SIMD register
+// (16 bytes with SSE2, 32 with AVX2) per step. here we write our own to see how.
+//
+// the tricky part is the end of the string: we don't know where it is, so we
+// will read a little past it. that's only a crash if those extra bytes are in
+// an unmapped page, and memory is mapped in whole pages (4096 bytes), so:
+// - aligned loads never cross a page boundary, they are always safe
+// - unaligned loads are checked first, and near the end of a page we go
+//   byte by byte instead
+// reading past the end of an object is still something AddressSanitizer
+// complains about, so these functions are excluded from it
+
+#define PAGE_SIZE_MIN 4096
+
+// true if reading "width" bytes from p would touch the next page
+static inline bool crossesPage(const void *p, size_t width) {
+	return ((uintptr_t) p & (PAGE_SIZE_MIN - 1)) > PAGE_SIZE_MIN - width;
+}
+
+// THE PORTABLE VERSION: word at a time ("SWAR", SIMD within a register)
+
+#define SWAR_ONES 0x0101010101010101u
+#define SWAR_HIGHS 0x8080808080808080u
+
+// the famous bit trick: non-zero only if some byte of the word is zero
+static inline uint64_t swarZeroBytes(uint64_t word) {
+	return (word - SWAR_ONES) & ~word & SWAR_HIGHS;
+}
+
+// memcpy() into a variable is how you read a word from any address without
+// breaking the aliasing rules, and the compiler turns it into a single load
+static inline uint64_t loadWord(const void *p) {
+	uint64_t word;
+	memcpy(&word, p, sizeof(word));
+	return word;
+}
+
+// index of the first flagged byte of a swarZeroBytes() result (little endian)
+static inline size_t swarFirstByte(uint64_t flags) {
+	return __builtin_ctzll(flags) / 8;
+}
+
+__attribute__((no_sanitize_address))
+static size_t strnlenSwar(const char *s, size_t limit) {
+	size_t i = 0;
+	// byte by byte until we are aligned to a word
+	for(; i < limit && ((uintptr_t) (s + i) & 7); i++) {
+		if(s[i] == '\0') return i;
+	}
+	for(; i < limit; i += 8) {
+		uint64_t zeros = swarZeroBytes(loadWord(s + i));
+		if(zeros) {
+			i += swarFirstByte(zeros);
+			return i < limit ? i : limit;
+		}
+	}
+	return limit;
+}
+
+static size_t strlenSwar(const char *s) {
+	return strnlenSwar(s, SIZE_MAX);
+}
+
+__attribute__((no_sanitize_address))
+static int strcmpSwar(const char *a, const char *b) {
+	const unsigned char *x = (const unsigned char *) a;
+	const unsigned char *y = (const unsigned char *) b;
+	// align the first string, and if the second one is aligned too we can go
+	// a word at a time while the words are equal and have no terminator
+	for(; (uintptr_t) x & 7; x++, y++) {
+		if(*x != *y || *x == '\0') return *x - *y;
+	}
+	if(((uintptr_t) y & 7) == 0) {
+		while(true) {
+			uint64_t wordX = loadWord(x);
+			if(wordX != loadWord(y) || swarZeroBytes(wordX)) {
+				break;
+			}
+			x += 8;
+			y += 8;
+		}
+	}
+	for(;; x++, y++) {
+		if(*x != *y || *x == '\0') return *x - *y;
+	}
+}
+
+static const void *memchrSwar(const void *s, int c, size_t n) {
+	const unsigned char *p = s;
+	unsigned char byte = (unsigned char) c;
+	uint64_t pattern = SWAR_ONES * byte;
+	size_t i = 0;
+	// a byte equal to c becomes a zero byte after the xor
+	for(; i + 8 <= n; i += 8) {
+		uint64_t matches = swarZeroBytes(loadWord(p + i) ^ pattern);
+		if(matches) return p + i + swarFirstByte(matches);
+	}
+	for(; i < n; i++) {
+		if(p[i] == byte) return p + i;
+	}
+	return NULL;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// THE SSE2 VERSION: 16 bytes at a time
+// _mm_cmpeq_epi8 compares 16 pairs of bytes at once giving 0xFF or 0x00 for
+// each, and _mm_movemask_epi8 packs them into the 16 low bits of an int, so
+// counting the trailing zeros of that int gives the position of the first match
+
+__attribute__((no_sanitize_address))
+static size_t strnlenSse2(const char *s, size_t limit) {
+	const __m128i zero = _mm_setzero_si128();
+	// start at the aligned block that contains s and ignore the bytes before s
+	uintptr_t misalign = (uintptr_t) s & 15;
+	const char *block = s - misalign;
+	unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) block), zero)) >> misalign;
+	if(mask) {
+		size_t found = __builtin_ctz(mask);
+		return found < limit ? found : limit;
+	}
+	for(block += 16; (size_t) (block - s) < limit; block += 16) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) block), zero));
+		if(mask) {
+			size_t found = block - s + __builtin_ctz(mask);
+			return found < limit ? found : limit;
+		}
+	}
+	return limit;
+}
+
+static size_t strlenSse2(const char *s) {
+	return strnlenSse2(s, SIZE_MAX);
+}
+
+__attribute__((no_sanitize_address))
+static int strcmpSse2(const char *a, const char *b) {
+	const __m128i zero = _mm_setzero_si128();
+	for(size_t i = 0;; i += 16) {
+		if(crossesPage(a + i, 16) || crossesPage(b + i, 16)) {
+			for(size_t end = i + 16; i < end; i++) {
+				unsigned char x = a[i], y = b[i];
+				if(x != y || x == '\0') return x - y;
+			}
+			i -= 16;
+			continue;
+		}
+		__m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+		// the first byte that is different, or where the strings end
+		unsigned differ = ~_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xFFFF;
+		unsigned ends = _mm_movemask_epi8(_mm_cmpeq_epi8(x, zero));
+		if(differ | ends) {
+			size_t k = i + __builtin_ctz(differ | ends);
+			return (unsigned char) a[k] - (unsigned char) b[k];
+		}
+	}
+}
+
+static const void *memchrSse2(const void *s, int c, size_t n) {
+	const unsigned char *p = s;
+	const __m128i pattern = _mm_set1_epi8((char) c);
+	size_t i = 0;
+	// we know the buffer is n bytes long, so no page tricks are needed here
+	for(; i + 16 <= n; i += 16) {
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (p + i)), pattern));
+		if(mask) return p + i + __builtin_ctz(mask);
+	}
+	return memchrSwar(p + i, c, n - i);
+}
+
+// THE AVX2 VERSION: 32 bytes at a time, and 64 in the main loops.
+// "target" lets the compiler use AVX2 in these functions only, the rest of the
+// program still runs on CPUs without it (we check before calling them)
+
+__attribute__((no_sanitize_address, target("avx2")))
+static size_t strnlenAvx2(const char *s, size_t limit) {
+	const __m256i zero = _mm256_setzero_si256();
+	uintptr_t misalign = (uintptr_t) s & 31;
+	const char *block = s - misalign;
+	unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *) block), zero)) >> misalign;
+	if(mask) {
+		size_t found = __builtin_ctz(mask);
+		return found < limit ? found : limit;
+	}
+	block += 32;
+	// one more 32 byte block if needed, so the 64 byte loop is 64 byte aligned
+	// (two blocks that straddle a page boundary could fault on the second one)
+	if(((uintptr_t) block & 63) && (size_t) (block - s) < limit) {
+		mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *) block), zero));
+		if(mask) {
+			size_t found = block - s + __builtin_ctz(mask);
+			return found < limit ? found : limit;
+		}
+		block += 32;
+	}
+	for(; (size_t) (block - s) < limit; block += 64) {
+		__m256i low = _mm256_load_si256((const __m256i *) block);
+		__m256i high = _mm256_load_si256((const __m256i *) (block + 32));
+		// min() of the two is zero wherever any of them has a zero
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(low, high), zero))) {
+			uint64_t lowMask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(low, zero));
+			uint64_t highMask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(high, zero));
+			size_t found = block - s + __builtin_ctzll(lowMask | highMask << 32);
+			return found < limit ? found : limit;
+		}
+	}
+	return limit;
+}
+
+__attribute__((target("avx2")))
+static size_t strlenAvx2(const char *s) {
+	return strnlenAvx2(s, SIZE_MAX);
+}
+
+__attribute__((no_sanitize_address, target("avx2")))
+static int strcmpAvx2(const char *a, const char *b) {
+	const __m256i zero = _mm256_setzero_si256();
+	for(size_t i = 0;; i += 32) {
+		if(crossesPage(a + i, 32) || crossesPage(b + i, 32)) {
+			for(size_t end = i + 32; i < end; i++) {
+				unsigned char x = a[i], y = b[i];
+				if(x != y || x == '\0') return x - y;
+			}
+			i -= 32;
+			continue;
+		}
+		__m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+		unsigned differ = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+		unsigned ends = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, zero));
+		if(differ | ends) {
+			size_t k = i + __builtin_ctz(differ | ends);
+			return (unsigned char) a[k] - (unsigned char) b[k];
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static const void *memchrAvx2(const void *s, int c, size_t n) {
+	const unsigned char *p = s;
+	const __m256i pattern = _mm256_set1_epi8((char) c);
+	size_t i = 0;
+	for(; i + 64 <= n; i += 64) {
+		__m256i low = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (p + i)), pattern);
+		__m256i high = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (p + i + 32)), pattern);
+		if(_mm256_movemask_epi8(_mm256_or_si256(low, high))) {
+			uint64_t lowMask = (uint32_t) _mm256_movemask_epi8(low);
+			uint64_t highMask = (uint32_t) _mm256_movemask_epi8(high);
+			return p + i + __builtin_ctzll(lowMask | highMask << 32);
+		}
+	}
+	// the tail stays in here instead of calling memchrSse2(): mixing AVX code
+	// with old SSE code without clearing the registers in between makes
+	// the CPU pay a big state transition penalty
+	for(; i + 32 <= n; i += 32) {
+		unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (p + i)), pattern));
+		if(mask) return p + i + __builtin_ctz(mask);
+	}
+	for(; i < n; i++) {
+		if(p[i] == (unsigned char) c) return p + i;
+	}
+	return NULL;
+}
+
+#endif
+
+// the libc versions, behind the same kind of pointer, so the benchmark
+// calls all of them the same way
+static size_t strlenLibc(const char *s) { return strlen(s); }
+static size_t strnlenLibc(const char *s, size_t limit) { return strnlen(s, limit); }
+static int strcmpLibc(const char *a, const char *b) { return strcmp(a, b); }
+static const void *memchrLibc(const void *s, int c, size_t n) { return memchr(s, c, n); }
+
+struct stringKernels {
+	const char *name;
+	size_t (*length)(const char *s);
+	size_t (*boundedLength)(const char *s, size_t limit);
+	int (*compare)(const char *a, const char *b);
+	const void *(*findByte)(const void *s, int c, size_t n);
+};
+
+static const struct stringKernels stringKernelSets[] = {
+	{"libc", strlenLibc, strnlenLibc, strcmpLibc, memchrLibc},
+	{"swar", strlenSwar, strnlenSwar, strcmpSwar, memchrSwar},
+#if defined(__x86_64__) || defined(__i386__)
+	{"sse2", strlenSse2, strnlenSse2, strcmpSse2, memchrSse2},
+	{"avx2", strlenAvx2, strnlenAvx2, strcmpAvx2, memchrAvx2},
+#endif
+};
+#define STRING_KERNEL_SETS (sizeof(stringKernelSets) / sizeof(stringKernelSets[0]))
+
+// can this CPU run the given set?
+static bool stringKernelsSupported(const struct stringKernels *set) {
+#if defined(__x86_64__) || defined(__i386__)
+	if(strcmp(set->name, "avx2") == 0) {
+		return __builtin_cpu_supports("avx2");
+	}
+	if(strcmp(set->name, "sse2") == 0) {
+		return __builtin_cpu_supports("sse2");
+	}
+#endif
+	return true;
+}
+
+// the fastest of our own sets this CPU supports, picked once
+static const struct stringKernels *bestStringKernels() {
+	static const struct stringKernels *best = NULL;
+	if(best == NULL) {
+		for(size_t i = 1; i < STRING_KERNEL_SETS; i++) {
+			if(stringKernelsSupported(&stringKernelSets[i])) {
+				best = &stringKernelSets[i];
+			}
+		}
+	}
+	return best;
+}
+
+static size_t fastStrlen(const char *s) {
+	return bestStringKernels()->length(s);
+}
+
+static int fastStrcmp(const char *a, const char *b) {
+	return bestStringKernels()->compare(a, b);
+}
+
+static const void *fastMemchr(const void *s, int c, size_t n) {
+	return bestStringKernels()->findByte(s, c, n);
+}
+
+// bounded copy: copies as much of src as fits in a buffer of "size" bytes,
+// always terminates it, and returns strlen(src) so you can tell if it was
+// cut (the BSD strlcpy() contract, much safer than strcpy())
+static size_t fastStrlcpy(char *destination, const char *source, size_t size) {
+	const struct stringKernels *kernels = bestStringKernels();
+	size_t sourceLength = kernels->length(source);
+	if(size > 0) {
+		size_t copied = sourceLength < size - 1 ? sourceLength : size - 1;
+		memcpy(destination, source, copied); // libc's memcpy is already vectorized
+		destination[copied] = '\0';
+	}
+	return sourceLength;
+}
+
+// bounded concatenation: the strlcat() contract, returns the length the
+// result would have had with enough room
+static size_t fastStrlcat(char *destination, const char *source, size_t size) {
+	size_t destinationLength = bestStringKernels()->boundedLength(destination, size);
+	if(destinationLength == size) {
+		return size + fastStrlen(source); // destination wasn't even terminated
+	}
+	return destinationLength + fastStrlcpy(destination + destinationLength, source, size - destinationLength);
+}
+
+// a few pages followed by one we can't touch (PROT_NONE), so reading even
+// one byte too far crashes right away instead of silently working
+struct guardedBuffer {
+	char *pages;
+	size_t usable; // bytes before the guard page
+	size_t total;
+};
+
+static bool guardedBufferInit(struct guardedBuffer *buffer, size_t pages) {
+	size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	buffer->usable = pages * pageSize;
+	buffer->total = buffer->usable + pageSize;
+	buffer->pages = mmap(NULL, buffer->total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(buffer->pages == MAP_FAILED) {
+		return false;
+	}
+	if(mprotect(buffer->pages + buffer->usable, pageSize, PROT_NONE) != 0) {
+		munmap(buffer->pages, buffer->total);
+		return false;
+	}
+	return true;
+}
+
+static void guardedBufferDestroy(struct guardedBuffer *buffer) {
+	munmap(buffer->pages, buffer->total);
+}
+
+static int signOf(int x) {
+	return (x > 0) - (x < 0);
+}
+
+// checks every kernel set against libc on strings that end right before the
+// guard page, at every alignment, and returns how many results were wrong
+static size_t stringKernelsDifferentialTest(unsigned seed) {
+	struct guardedBuffer first, second;
+	if(!guardedBufferInit(&first, 2)) {
+		return 1;
+	}
+	if(!guardedBufferInit(&second, 2)) {
+		guardedBufferDestroy(&first);
+		return 1;
+	}
+	size_t failures = 0;
+	for(size_t set = 1; set < STRING_KERNEL_SETS; set++) {
+		const struct stringKernels *kernels = &stringKernelSets[set];
+		if(!stringKernelsSupported(kernels)) {
+			continue;
+		}
+		for(size_t length = 0; length < 300; length++) {
+			// the terminator is the very last byte before the guard page
+			char *a = first.pages + first.usable - length - 1;
+			char *b = second.pages + second.usable - length - 1;
+			for(size_t i = 0; i < length; i++) {
+				seed = seed * 1103515245u + 12345u;
+				a[i] = b[i] = (char) (1 + (seed >> 16) % 255);
+			}
+			a[length] = b[length] = '\0';
+
+			failures += kernels->length(a) != strlen(a);
+			failures += kernels->boundedLength(a, length / 2) != strnlen(a, length / 2);
+			failures += kernels->boundedLength(a, length + 10) != strnlen(a, length + 10);
+			failures += kernels->compare(a, b) != 0;
+			// make them differ at a random spot (or make b shorter)
+			if(length > 0) {
+				size_t spot = (seed >> 8) % length;
+				char saved = b[spot];
+				b[spot] = (seed & 1) ? '\0' : (char) (b[spot] ^ 0x80);
+				failures += signOf(kernels->compare(a, b)) != signOf(strcmp(a, b));
+				failures += signOf(kernels->compare(b, a)) != signOf(strcmp(b, a));
+				// compare with b at other alignments too
+				failures += signOf(kernels->compare(a, b + 1)) != signOf(strcmp(a, b + 1));
+				b[spot] = saved;
+				unsigned char wanted = (unsigned char) a[spot];
+				failures += kernels->findByte(a, wanted, length) != memchr(a, wanted, length);
+			}
+			failures += kernels->findByte(a, 0, length + 1) != memchr(a, 0, length + 1);
+			failures += kernels->findByte(a, 0, length) != memchr(a, 0, length);
+		}
+	}
+	guardedBufferDestroy(&first);
+	guardedBufferDestroy(&second);
+	return failures;
+}
+
+
+
+	void testStringH() {
+		// this header has a lot of helper funtions involving strings, or,
+		// in technical terms, NTBS (Null Terminated Byte Strings)
+	
+		// getting the length of a string (not including the null-terminator)
+		char *string = "C lang";
+		printf("\n\nthe length of the string is: %ld\n", strlen(string));
+	
+		// copying an string to another variable
+		char stringCopy[7]; // strlen(string) + null-terminator = 7
+		strcpy(stringCopy, string);
+		printf("%s\n", stringCopy);
+	
+		// comparing two strings with strcmp(), returns a negative value if the first
+		// is appears before the second, 0 if they are equal, and a positive value otherwise 
+		char *string2 = "Rust lang";
+		if(strcmp(string, string2) < 0) {
+			printf("%s comes before %s\n", string, string2);
+		} else if(strcmp(string, string2) > 0) {
+			printf("%s comes after %s\n", string, string2);
+		} else {
+			printf("they are equal\n");
+		}
+	
+		// we can also concatenate 2 strings
+		char concat[20] = "I love "; // it has to be big enough to hold itself + the string we will concat
+		strcat(concat, string); // concat becomes "I love C lang"
+		printf("%s\n", concat);
+
+		// but strcpy() and strcat() don't know how big the destination is, and
+		// if it's too small they just keep writing past its end. the bounded
+		// versions get the size and cut the string instead (they are right above)
+		char small[10];
+		size_t wanted = fastStrlcpy(small, "I love ", sizeof(small));
+		wanted = fastStrlcat(small, string, sizeof(small));
+		printf("\"%s\" (it needed %zu chars, so it was cut)\n", small, wanted);
+
+		// the fast versions above look at many bytes at a time, lets make
+		// sure they give the same answers as the libc ones
+		printf("fast strlen: %zu, fast strcmp: %d, fast memchr found '%c'\n", fastStrlen(string),
+			signOf(fastStrcmp(string, string2)), *(const char *) fastMemchr(string, 'l', strlen(string)));
+		size_t failures = stringKernelsDifferentialTest(727);
+		printf("differential test against libc: %s (%zu wrong results)\n", failures ? "FAILED" : "passed", failures);
+}
+
+
+
+void benchStringH() {
+	// GB/s of each kernel set on strings from 8 bytes to 64 MiB. the small
+	// sizes measure the call overhead and the setup before the main loop,
+	// the big ones measure the main loop (and then the memory bandwidth)
+	const size_t sizes[] = {8, 64, 512, 4 << 10, 32 << 10, 256 << 10, 2 << 20, 16 << 20, 64 << 20};
+	const size_t sizeCount = sizeof(sizes) / sizeof(sizes[0]);
+	size_t maxSize = sizes[sizeCount - 1];
+	char *a = aligned_alloc(64, maxSize + 64);
+	char *b = aligned_alloc(64, maxSize + 64);
+	if(a == NULL || b == NULL) {
+		printf("couldn't allocate the buffers\n");
+		free(a);
+		free(b);
+		return;
+	}
+	for(size_t i = 0; i < maxSize; i++) {
+		a[i] = b[i] = (char) ('a' + i % 26);
+	}
+
+	const char *operations[] = {"strlen", "strcmp (equal strings)", "memchr (byte not found)"};
+	for(int operation = 0; operation < 3; operation++) {
+		printf("\n%s, GB/s\n%10s", operations[operation], "bytes");
+		for(size_t set = 0; set < STRING_KERNEL_SETS; set++) {
+			if(stringKernelsSupported(&stringKernelSets[set])) {
+				printf(" %9s", stringKernelSets[set].name);
+			}
+		}
+		printf("\n");
+
+		for(size_t s = 0; s < sizeCount; s++) {
+			size_t size = sizes[s];
+			a[size] = b[size] = '\0';
+			// enough calls to go through ~128 MiB, so every size runs for a while
+			size_t calls = ((size_t) 128 << 20) / size;
+			printf("%10zu", size);
+			for(size_t set = 0; set < STRING_KERNEL_SETS; set++) {
+				const struct stringKernels *kernels = &stringKernelSets[set];
+				if(!stringKernelsSupported(kernels)) {
+					continue;
+				}
+				uint64_t best = UINT64_MAX;
+				for(int repeat = 0; repeat < 3; repeat++) {
+					uint64_t start = monotonicNs();
+					for(size_t call = 0; call < calls; call++) {
+						if(operation == 0) {
+							benchKeep(kernels->length(a));
+						} else if(operation == 1) {
+							benchKeep(kernels->compare(a, b));
+						} else {
+							benchKeep(kernels->findByte(a, '\n', size));
+						}
+					}
+					uint64_t elapsed = monotonicNs() - start;
+					best = elapsed < best ? elapsed : best;
+				}
+				printf(" %9.2f", (double) size * calls / best);
+			}
+			printf("\n");
+			fflush(stdout);
+			a[size] = b[size] = (char) ('a' + size % 26);
+		}
+	}
+	free(a);
+	free(b);
+}
+
+
+
+// TYPE-GENERIC ARRAY MATH
+// tgmath.h picks sinf(), sin() or sinl() by the type of the argument, and
+// the choice is made by the compiler, nothing happens at run time. C11 lets
+// us do the same with _Generic, so here vsum(x, n), vdot(x, y, n),
+// vscale(x, n, a) and vaxpy(y, a, x, n) work on arrays of float, double,
+// long double and their complex versions, each with its own kernel.
+// the float and double kernels are written once with GCC's vector
+// extensions and compiled 3 times: 16 byte vectors (SSE2, every x86_64
+// has it), 32 bytes with AVX2 and FMA, and 64 bytes with AVX-512, and the
+// fastest one this CPU can run is picked the first time (that's the only
+// choice made at run time). long double has no vector instructions at
+// all (it's the old x87 unit), so its kernels are plain loops.
+// complex arrays are pairs of (real, imaginary) in memory, so the complex
+// kernels run on the same vectors of reals with the pairs swapped by a
+// shuffle where the multiplication needs it. vdot() doesn't conjugate
+// (it's BLAS's dotu: the sum of x[i] * y[i])
+
+enum arrayMathLevel {
+	ARRAY_MATH_SSE2,
+	ARRAY_MATH_AVX2,
+	ARRAY_MATH_AVX512,
+};
+
+static const char *arrayMathLevelNames[] = {"sse2", "avx2", "avx512"};
+
+// the test and the benchmark set this to try the lower levels too
+static int arrayMathLevelLimit = ARRAY_MATH_AVX512;
+
+static enum arrayMathLevel arrayMathBestLevel() {
+	static int best = -1;
+	if(best < 0) {
+		best = ARRAY_MATH_SSE2;
+#if defined(__x86_64__) || defined(__i386__)
+		if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			best = ARRAY_MATH_AVX2;
+		}
+		if(__builtin_cpu_supports("avx512f")) {
+			best = ARRAY_MATH_AVX512;
+		}
+#endif
+	}
+	return (enum arrayMathLevel) best;
+}
+
+static enum arrayMathLevel arrayMathLevel() {
+	enum arrayMathLevel best = arrayMathBestLevel();
+	return (int) best < arrayMathLevelLimit ? best : (enum arrayMathLevel) arrayMathLevelLimit;
+}
+
+#define ARRAY_AVX512 __attribute__((target("avx512f,fma")))
+
+// the real kernels. two accumulators in the reductions, so one addition
+// doesn't have to wait for the one before it (with AVX each takes 4 cycles
+// and two can start per cycle)
+#define ARRAY_REAL_KERNELS(name, suffix, type, bytes, attributes) \
+	attributes static type vsum##name##suffix(const type *x, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		const size_t count = bytes / sizeof(type); \
+		lanes first = {0}, second = {0}; \
+		size_t i = 0; \
+		for(; i + 2 * count <= n; i += 2 * count) { \
+			lanes a, b; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, x + i + count, bytes); \
+			first += a; \
+			second += b; \
+		} \
+		first += second; \
+		type sum = 0; \
+		for(size_t k = 0; k < count; k++) { \
+			sum += first[k]; \
+		} \
+		for(; i < n; i++) { \
+			sum += x[i]; \
+		} \
+		return sum; \
+	} \
+	attributes static type vdot##name##suffix(const type *x, const type *y, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		const size_t count = bytes / sizeof(type); \
+		lanes first = {0}, second = {0}; \
+		size_t i = 0; \
+		for(; i + 2 * count <= n; i += 2 * count) { \
+			lanes a, b, c, d; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, y + i, bytes); \
+			memcpy(&c, x + i + count, bytes); \
+			memcpy(&d, y + i + count, bytes); \
+			first += a * b; \
+			second += c * d; \
+		} \
+		first += second; \
+		type sum = 0; \
+		for(size_t k = 0; k < count; k++) { \
+			sum += first[k]; \
+		} \
+		for(; i < n; i++) { \
+			sum += x[i] * y[i]; \
+		} \
+		return sum; \
+	} \
+	attributes static void vscale##name##suffix(type *x, size_t n, type factor) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		const size_t count = bytes / sizeof(type); \
+		size_t i = 0; \
+		for(; i + count <= n; i += count) { \
+			lanes a; \
+			memcpy(&a, x + i, bytes); \
+			a *= factor; \
+			memcpy(x + i, &a, bytes); \
+		} \
+		for(; i < n; i++) { \
+			x[i] *= factor; \
+		} \
+	} \
+	attributes static void vaxpy##name##suffix(type *y, type factor, const type *x, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		const size_t count = bytes / sizeof(type); \
+		size_t i = 0; \
+		for(; i + count <= n; i += count) { \
+			lanes a, b; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, y + i, bytes); \
+			b += factor * a; \
+			memcpy(y + i, &b, bytes); \
+		} \
+		for(; i < n; i++) { \
+			y[i] += factor * x[i]; \
+		} \
+	}
+
+// the complex kernels, on 2n reals. "swap" is the shuffle mask that trades
+// the real and imaginary parts of every pair ({1, 0, 3, 2...}), and (a + bi)
+// * (c + di) = (ac - bd) + (ad + bc)i is then x * c + swapped(x) * (-d, +d)
+#define ARRAY_COMPLEX_KERNELS(name, suffix, type, indexType, bytes, swap, attributes) \
+	attributes static type complex vsum##name##suffix(const type complex *values, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		const type *x = (const type *) values; \
+		const size_t count = bytes / sizeof(type); \
+		lanes first = {0}, second = {0}; \
+		size_t i = 0; \
+		for(; i + 2 * count <= 2 * n; i += 2 * count) { \
+			lanes a, b; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, x + i + count, bytes); \
+			first += a; \
+			second += b; \
+		} \
+		first += second; \
+		type real = 0, imaginary = 0; \
+		for(size_t k = 0; k < count; k += 2) { \
+			real += first[k]; \
+			imaginary += first[k + 1]; \
+		} \
+		for(; i < 2 * n; i += 2) { \
+			real += x[i]; \
+			imaginary += x[i + 1]; \
+		} \
+		return CMPLX(real, imaginary); \
+	} \
+	attributes static type complex vdot##name##suffix(const type complex *xValues, const type complex *yValues, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		typedef indexType indices __attribute__((vector_size(bytes))); \
+		const type *x = (const type *) xValues, *y = (const type *) yValues; \
+		const size_t count = bytes / sizeof(type); \
+		/* products has (xr * yr, xi * yi) and crossed has (xr * yi, xi * yr) in each pair */ \
+		lanes products = {0}, crossed = {0}; \
+		size_t i = 0; \
+		for(; i + count <= 2 * n; i += count) { \
+			lanes a, b; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, y + i, bytes); \
+			products += a * b; \
+			crossed += a * __builtin_shuffle(b, swap); \
+		} \
+		type real = 0, imaginary = 0; \
+		for(size_t k = 0; k < count; k += 2) { \
+			real += products[k] - products[k + 1]; \
+			imaginary += crossed[k] + crossed[k + 1]; \
+		} \
+		for(; i < 2 * n; i += 2) { \
+			real += x[i] * y[i] - x[i + 1] * y[i + 1]; \
+			imaginary += x[i] * y[i + 1] + x[i + 1] * y[i]; \
+		} \
+		return CMPLX(real, imaginary); \
+	} \
+	attributes static void vscale##name##suffix(type complex *values, size_t n, type complex factor) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		typedef indexType indices __attribute__((vector_size(bytes))); \
+		type *x = (type *) values; \
+		const size_t count = bytes / sizeof(type); \
+		lanes real = (lanes) {0} + creal(factor), signs; \
+		for(size_t k = 0; k < count; k++) { \
+			signs[k] = k % 2 ? cimag(factor) : -cimag(factor); \
+		} \
+		size_t i = 0; \
+		for(; i + count <= 2 * n; i += count) { \
+			lanes a; \
+			memcpy(&a, x + i, bytes); \
+			a = a * real + __builtin_shuffle(a, swap) * signs; \
+			memcpy(x + i, &a, bytes); \
+		} \
+		for(; i < 2 * n; i += 2) { \
+			type xr = x[i], xi = x[i + 1]; \
+			x[i] = xr * creal(factor) - xi * cimag(factor); \
+			x[i + 1] = xr * cimag(factor) + xi * creal(factor); \
+		} \
+	} \
+	attributes static void vaxpy##name##suffix(type complex *yValues, type complex factor, const type complex *xValues, size_t n) { \
+		typedef type lanes __attribute__((vector_size(bytes))); \
+		typedef indexType indices __attribute__((vector_size(bytes))); \
+		type *y = (type *) yValues; \
+		const type *x = (const type *) xValues; \
+		const size_t count = bytes / sizeof(type); \
+		lanes real = (lanes) {0} + creal(factor), signs; \
+		for(size_t k = 0; k < count; k++) { \
+			signs[k] = k % 2 ? cimag(factor) : -cimag(factor); \
+		} \
+		size_t i = 0; \
+		for(; i + count <= 2 * n; i += count) { \
+			lanes a, b; \
+			memcpy(&a, x + i, bytes); \
+			memcpy(&b, y + i, bytes); \
+			b += a * real + __builtin_shuffle(a, swap) * signs; \
+			memcpy(y + i, &b, bytes); \
+		} \
+		for(; i < 2 * n; i += 2) { \
+			type xr = x[i], xi = x[i + 1]; \
+			y[i] += xr * creal(factor) - xi * cimag(factor); \
+			y[i + 1] += xr * cimag(factor) + xi * creal(factor); \
+		} \
+	}
+
+// plain loops, for long double (real and complex) and as the reference in the test
+#define ARRAY_SCALAR_KERNELS(name, type) \
+	static type vsum##name##Scalar(const type *x, size_t n) { \
+		type sum = 0; \
+		for(size_t i = 0; i < n; i++) { \
+			sum += x[i]; \
+		} \
+		return sum; \
+	} \
+	static type vdot##name##Scalar(const type *x, const type *y, size_t n) { \
+		type sum = 0; \
+		for(size_t i = 0; i < n; i++) { \
+			sum += x[i] * y[i]; \
+		} \
+		return sum; \
+	} \
+	static void vscale##name##Scalar(type *x, size_t n, type factor) { \
+		for(size_t i = 0; i < n; i++) { \
+			x[i] *= factor; \
+		} \
+	} \
+	static void vaxpy##name##Scalar(type *y, type factor, const type *x, size_t n) { \
+		for(size_t i = 0; i < n; i++) { \
+			y[i] += factor * x[i]; \
+		} \
+	}
+
+#define SWAP_PAIRS_2 ((indices) {1, 0})
+#define SWAP_PAIRS_4 ((indices) {1, 0, 3, 2})
+#define SWAP_PAIRS_8 ((indices) {1, 0, 3, 2, 5, 4, 7, 6})
+#define SWAP_PAIRS_16 ((indices) {1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14})
+
+ARRAY_REAL_KERNELS(Float, Sse2, float, 16, )
+ARRAY_REAL_KERNELS(Double, Sse2, double, 16, )
+ARRAY_COMPLEX_KERNELS(ComplexFloat, Sse2, float, int32_t, 16, SWAP_PAIRS_4, )
+ARRAY_COMPLEX_KERNELS(ComplexDouble, Sse2, double, int64_t, 16, SWAP_PAIRS_2, )
+#if defined(__x86_64__) || defined(__i386__)
+ARRAY_REAL_KERNELS(Float, Avx2, float, 32, MATH_AVX2)
+ARRAY_REAL_KERNELS(Double, Avx2, double, 32, MATH_AVX2)
+ARRAY_COMPLEX_KERNELS(ComplexFloat, Avx2, float, int32_t, 32, SWAP_PAIRS_8, MATH_AVX2)
+ARRAY_COMPLEX_KERNELS(ComplexDouble, Avx2, double, int64_t, 32, SWAP_PAIRS_4, MATH_AVX2)
+ARRAY_REAL_KERNELS(Float, Avx512, float, 64, ARRAY_AVX512)
+ARRAY_REAL_KERNELS(Double, Avx512, double, 64, ARRAY_AVX512)
+ARRAY_COMPLEX_KERNELS(ComplexFloat, Avx512, float, int32_t, 64, SWAP_PAIRS_16, ARRAY_AVX512)
+ARRAY_COMPLEX_KERNELS(ComplexDouble, Avx512, double, int64_t, 64, SWAP_PAIRS_8, ARRAY_AVX512)
+#endif
+ARRAY_SCALAR_KERNELS(Float, float)
+ARRAY_SCALAR_KERNELS(Double, double)
+ARRAY_SCALAR_KERNELS(LongDouble, long double)
+ARRAY_SCALAR_KERNELS(ComplexFloat, float complex)
+ARRAY_SCALAR_KERNELS(ComplexDouble, double complex)
+ARRAY_SCALAR_KERNELS(ComplexLongDouble, long double complex)
+
+// the public function of one type: the kernels of every level in a table,
+// indexed by the level (without x86 every level is the SSE2 one, which is
+// then just the generic vector code)
+#if defined(__x86_64__) || defined(__i386__)
+#define ARRAY_LEVELS(function) {function##Sse2, function##Avx2, function##Avx512}
+#else
+#define ARRAY_LEVELS(function) {function##Sse2, function##Sse2, function##Sse2}
+#endif
+
+#define ARRAY_DISPATCH(name, type) \
+	static type vsum##name(const type *x, size_t n) { \
+		static type (*const kernels[])(const type *, size_t) = ARRAY_LEVELS(vsum##name); \
+		return kernels[arrayMathLevel()](x, n); \
+	} \
+	static type vdot##name(const type *x, const type *y, size_t n) { \
+		static type (*const kernels[])(const type *, const type *, size_t) = ARRAY_LEVELS(vdot##name); \
+		return kernels[arrayMathLevel()](x, y, n); \
+	} \
+	static void vscale##name(type *x, size_t n, type factor) { \
+		static void (*const kernels[])(type *, size_t, type) = ARRAY_LEVELS(vscale##name); \
+		kernels[arrayMathLevel()](x, n, factor); \
+	} \
+	static void vaxpy##name(type *y, type factor, const type *x, size_t n) { \
+		static void (*const kernels[])(type *, type, const type *, size_t) = ARRAY_LEVELS(vaxpy##name); \
+		kernels[arrayMathLevel()](y, factor, x, n); \
+	}
+
+ARRAY_DISPATCH(Float, float)
+ARRAY_DISPATCH(Double, double)
+ARRAY_DISPATCH(ComplexFloat, float complex)
+ARRAY_DISPATCH(ComplexDouble, double complex)
+#define vsumLongDouble vsumLongDoubleScalar
+#define vdotLongDouble vdotLongDoubleScalar
+#define vscaleLongDouble vscaleLongDoubleScalar
+#define vaxpyLongDouble vaxpyLongDoubleScalar
+#define vsumComplexLongDouble vsumComplexLongDoubleScalar
+#define vdotComplexLongDouble vdotComplexLongDoubleScalar
+#define vscaleComplexLongDouble vscaleComplexLongDoubleScalar
+#define vaxpyComplexLongDouble vaxpyComplexLongDoubleScalar
+
+// the type of the array picks the function, const or not
+#define ARRAY_GENERIC(prefix, x) _Generic((x), \
+	float *: prefix##Float, const float *: prefix##Float, \
+	double *: prefix##Double, const double *: prefix##Double, \
+	long double *: prefix##LongDouble, const long double *: prefix##LongDouble, \
+	float complex *: prefix##ComplexFloat, const float complex *: prefix##ComplexFloat, \
+	double complex *: prefix##ComplexDouble, const double complex *: prefix##ComplexDouble, \
+	long double complex *: prefix##ComplexLongDouble, const long double complex *: prefix##ComplexLongDouble)
+
+#define vsum(x, n) ARRAY_GENERIC(vsum, x)((x), (n))
+#define vdot(x, y, n) ARRAY_GENERIC(vdot, x)((x), (y), (n))
+#define vscale(x, n, factor) ARRAY_GENERIC(vscale, x)((x), (n), (factor))
+#define vaxpy(y, factor, x, n) ARRAY_GENERIC(vaxpy, y)((y), (factor), (x), (n))
+
+// every level of every type against the plain loops, on lengths around the
+// vector sizes (so every tail is used). sums are compared with a tolerance
+// that grows with the length, since the vectors add in a different order;
+// scale and axpy only differ where FMA skipped a rounding. returns the failures
+static size_t arrayMathTest() {
+	size_t failures = 0;
+	size_t capacity = 300;
+	float *floatsX = malloc(capacity * sizeof(float)), *floatsY = malloc(capacity * sizeof(float)), *floatsZ = malloc(capacity * sizeof(float));
+	double *doublesX = malloc(capacity * sizeof(double)), *doublesY = malloc(capacity * sizeof(double)), *doublesZ = malloc(capacity * sizeof(double));
+	float complex *complexFloatsX = malloc(capacity * sizeof(float complex)), *complexFloatsY = malloc(capacity * sizeof(float complex)),
+		*complexFloatsZ = malloc(capacity * sizeof(float complex));
+	double complex *complexDoublesX = malloc(capacity * sizeof(double complex)), *complexDoublesY = malloc(capacity * sizeof(double complex)),
+		*complexDoublesZ = malloc(capacity * sizeof(double complex));
+	// the plain loops write their results here, whatever the type
+	void *reference = malloc(capacity * sizeof(double complex));
+	if(floatsX == NULL || floatsY == NULL || floatsZ == NULL || doublesX == NULL || doublesY == NULL || doublesZ == NULL
+		|| complexFloatsX == NULL || complexFloatsY == NULL || complexFloatsZ == NULL
+		|| complexDoublesX == NULL || complexDoublesY == NULL || complexDoublesZ == NULL || reference == NULL) {
+		printf("couldn't allocate the arrays\n");
+		failures = 1;
+		goto done;
+	}
+	unsigned seed = 17;
+	for(size_t i = 0; i < capacity; i++) {
+		double values[4];
+		for(int k = 0; k < 4; k++) {
+			seed = seed * 1103515245u + 12345u;
+			values[k] = (double) (seed >> 8) / (1 << 24) * 2 - 1;
+		}
+		floatsX[i] = (float) values[0];
+		floatsY[i] = (float) values[1];
+		doublesX[i] = values[2];
+		doublesY[i] = values[3];
+		complexFloatsX[i] = CMPLXF((float) values[0], (float) values[1]);
+		complexFloatsY[i] = CMPLXF((float) values[2], (float) values[3]);
+		complexDoublesX[i] = CMPLX(values[1], values[2]);
+		complexDoublesY[i] = CMPLX(values[3], values[0]);
+	}
+	bool near(long double complex a, long double complex b, long double tolerance) {
+		return cabsl(a - b) <= tolerance;
+	}
+	void report(bool ok, const char *what, size_t n) {
+		if(!ok && failures++ < 5) {
+			printf("  %s with %s and %zu elements is off\n", what, arrayMathLevelNames[arrayMathLevel()], n);
+		}
+	}
+	int savedLimit = arrayMathLevelLimit;
+	for(int level = ARRAY_MATH_SSE2; level <= (int) arrayMathBestLevel(); level++) {
+		arrayMathLevelLimit = level;
+		for(size_t n = 0; n < capacity; n += n < 40 ? 1 : 37) {
+			long double floatTolerance = 1e-6L * (n + 1), doubleTolerance = 1e-14L * (n + 1);
+			report(near(vsum(floatsX, n), vsumFloatScalar(floatsX, n), floatTolerance), "vsum(float)", n);
+			report(near(vdot(floatsX, floatsY, n), vdotFloatScalar(floatsX, floatsY, n), floatTolerance), "vdot(float)", n);
+			report(near(vsum(doublesX, n), vsumDoubleScalar(doublesX, n), doubleTolerance), "vsum(double)", n);
+			report(near(vdot(doublesX, doublesY, n), vdotDoubleScalar(doublesX, doublesY, n), doubleTolerance), "vdot(double)", n);
+			report(near(vsum(complexFloatsX, n), vsumComplexFloatScalar(complexFloatsX, n), floatTolerance), "vsum(float complex)", n);
+			report(near(vdot(complexFloatsX, complexFloatsY, n), vdotComplexFloatScalar(complexFloatsX, complexFloatsY, n), floatTolerance),
+				"vdot(float complex)", n);
+			report(near(vsum(complexDoublesX, n), vsumComplexDoubleScalar(complexDoublesX, n), doubleTolerance), "vsum(double complex)", n);
+			report(near(vdot(complexDoublesX, complexDoublesY, n), vdotComplexDoubleScalar(complexDoublesX, complexDoublesY, n), doubleTolerance),
+				"vdot(double complex)", n);
+
+			// scale and axpy write, so both run on copies and then every element is compared
+			#define ARRAY_ELEMENTWISE_CHECK(what, fast, expected, x, vectorCall, scalarCall, tolerance) do { \
+				__typeof__(x) expected = reference; \
+				memcpy(fast, x, n * sizeof(x[0])); \
+				memcpy(expected, x, n * sizeof(x[0])); \
+				vectorCall; \
+				scalarCall; \
+				bool ok = true; \
+				for(size_t i = 0; i < n; i++) { \
+					ok = ok && near(fast[i], expected[i], tolerance); \
+				} \
+				report(ok, what, n); \
+			} while(0)
+			ARRAY_ELEMENTWISE_CHECK("vscale(float)", floatsZ, expected, floatsX,
+				vscale(floatsZ, n, 1.5f), vscaleFloatScalar(expected, n, 1.5f), 1e-6L);
+			ARRAY_ELEMENTWISE_CHECK("vaxpy(float)", floatsZ, expected, floatsX,
+				vaxpy(floatsZ, -0.75f, floatsY, n), vaxpyFloatScalar(expected, -0.75f, floatsY, n), 1e-6L);
+			ARRAY_ELEMENTWISE_CHECK("vscale(double)", doublesZ, expected, doublesX,
+				vscale(doublesZ, n, 1.5), vscaleDoubleScalar(expected, n, 1.5), 1e-15L);
+			ARRAY_ELEMENTWISE_CHECK("vaxpy(double)", doublesZ, expected, doublesX,
+				vaxpy(doublesZ, -0.75, doublesY, n), vaxpyDoubleScalar(expected, -0.75, doublesY, n), 1e-15L);
+			ARRAY_ELEMENTWISE_CHECK("vscale(float complex)", complexFloatsZ, expected, complexFloatsX,
+				vscale(complexFloatsZ, n, CMPLXF(0.5f, -2)), vscaleComplexFloatScalar(expected, n, CMPLXF(0.5f, -2)), 1e-6L);
+			ARRAY_ELEMENTWISE_CHECK("vaxpy(float complex)", complexFloatsZ, expected, complexFloatsX,
+				vaxpy(complexFloatsZ, CMPLXF(-1, 0.25f), complexFloatsY, n),
+				vaxpyComplexFloatScalar(expected, CMPLXF(-1, 0.25f), complexFloatsY, n), 1e-6L);
+			ARRAY_ELEMENTWISE_CHECK("vscale(double complex)", complexDoublesZ, expected, complexDoublesX,
+				vscale(complexDoublesZ, n, CMPLX(0.5, -2)), vscaleComplexDoubleScalar(expected, n, CMPLX(0.5, -2)), 1e-15L);
+			ARRAY_ELEMENTWISE_CHECK("vaxpy(double complex)", complexDoublesZ, expected, complexDoublesX,
+				vaxpy(complexDoublesZ, CMPLX(-1, 0.25), complexDoublesY, n),
+				vaxpyComplexDoubleScalar(expected, CMPLX(-1, 0.25), complexDoublesY, n), 1e-15L);
+			#undef ARRAY_ELEMENTWISE_CHECK
+		}
+	}
+	arrayMathLevelLimit = savedLimit;
+
+done:
+	free(floatsX);
+	free(floatsY);
+	free(floatsZ);
+	free(doublesX);
+	free(doublesY);
+	free(doublesZ);
+	free(complexFloatsX);
+	free(complexFloatsY);
+	free(complexFloatsZ);
+	free(complexDoublesX);
+	free(complexDoublesY);
+	free(complexDoublesZ);
+	free(reference);
+	return failures;
+}
+
+#define ARRAY_MEASURE(code) ({ \
+	uint64_t best = UINT64_MAX; \
+	for(int r = 0; r < 5; r++) { \
+		uint64_t start = monotonicNs(); \
+		for(int pass = 0; pass < 200; pass++) { \
+			code; \
+			benchKeep(&sink); \
+		} \
+		uint64_t ns = monotonicNs() - start; \
+		best = ns < best ? ns : best; \
+	} \
+	(double) n * 200 / best; \
+})
+
+// one row per function of one type: the plain loop, then the generic macro
+// with every level this CPU has (long double has no levels, the macro
+// always gets the plain loop for it). scale multiplies by one and axpy adds
+// a tiny multiple, so the values don't run off to infinity (or to the slow
+// denormals) over the passes
+#define ARRAY_BENCH(name, type, one, tiny, vectorized) \
+	static void arrayMathBench##name(const char *label, size_t n) { \
+		type *x = malloc(n * sizeof(type)), *y = malloc(n * sizeof(type)); \
+		if(x == NULL || y == NULL) { \
+			printf("couldn't allocate the arrays\n"); \
+			goto done; \
+		} \
+		for(size_t i = 0; i < n; i++) { \
+			x[i] = (type) (i % 7) / 8; \
+			y[i] = (type) (i % 5) / 4; \
+		} \
+		/* through memory, or the plain loop gets x * 1 folded away */ \
+		type sink = 0, factor = one, small = tiny; \
+		benchKeep(&factor); \
+		benchKeep(&small); \
+		const char *functions[] = {"vsum", "vdot", "vscale", "vaxpy"}; \
+		int savedLimit = arrayMathLevelLimit; \
+		for(int function = 0; function < 4; function++) { \
+			char title[64]; \
+			snprintf(title, sizeof(title), "%s(%s)", functions[function], label); \
+			printf("%-28s", title); \
+			for(int level = -1; level <= (int) arrayMathBestLevel(); level++) { \
+				if(level >= 0 && !(vectorized)) { \
+					printf(" %9s", "-"); \
+					continue; \
+				} \
+				arrayMathLevelLimit = level < 0 ? ARRAY_MATH_SSE2 : level; \
+				double rate; \
+				if(function == 0) { \
+					rate = level < 0 ? ARRAY_MEASURE(sink = vsum##name##Scalar(x, n)) : ARRAY_MEASURE(sink = vsum(x, n)); \
+				} else if(function == 1) { \
+					rate = level < 0 ? ARRAY_MEASURE(sink = vdot##name##Scalar(x, y, n)) : ARRAY_MEASURE(sink = vdot(x, y, n)); \
+				} else if(function == 2) { \
+					rate = level < 0 ? ARRAY_MEASURE(vscale##name##Scalar(x, n, factor)) : ARRAY_MEASURE(vscale(x, n, factor)); \
+				} else { \
+					rate = level < 0 ? ARRAY_MEASURE(vaxpy##name##Scalar(y, small, x, n)) : ARRAY_MEASURE(vaxpy(y, small, x, n)); \
+				} \
+				printf(" %9.2f", rate); \
+			} \
+			printf("\n"); \
+			fflush(stdout); \
+		} \
+		arrayMathLevelLimit = savedLimit; \
+	done: \
+		free(x); \
+		free(y); \
+	}
+
+ARRAY_BENCH(Float, float, 1.0f, 1e-6f, true)
+ARRAY_BENCH(Double, double, 1.0, 1e-9, true)
+ARRAY_BENCH(LongDouble, long double, 1.0L, 1e-9L, false)
+ARRAY_BENCH(ComplexFloat, float complex, CMPLXF(1, 0), CMPLXF(1e-6f, 1e-6f), true)
+ARRAY_BENCH(ComplexDouble, double complex, CMPLX(1, 0), CMPLX(1e-9, 1e-9), true)
+ARRAY_BENCH(ComplexLongDouble, long double complex, CMPLXL(1, 0), CMPLXL(1e-9L, 1e-9L), false)
+#undef ARRAY_MEASURE
+
+
+
+void testTgMathH() {
+	// TGmath stands for type generic math, this header includes
+	// the math.h and complex.h headers and defines some macros to
+	// handle mathematical function calls of different types for you
+
+	// for example, when we call sin() passing a float, it automatically
+	// calls sinf() for us (the sin function that recieves a float)
+	float f = 32.5;
+	printf("\n\n%f\n", sin(f));
+
+	// thats basically it, just a helpfull header. but the trick it uses
+	// (_Generic) is ours too: vsum(), vdot(), vscale() and vaxpy() above
+	// pick their function by the type of the array in the same way
+	float floats[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+	double doubles[] = {0.5, 0.25, 0.125};
+	double complex rotations[] = {1, I, -1, -I};
+	printf("vsum(floats) = %g, vdot(floats, floats) = %g\n", vsum(floats, 10), vdot(floats, floats, 10));
+	vaxpy(doubles, 2.0, doubles, 3);
+	printf("doubles after vaxpy(doubles, 2.0, doubles) = {%g, %g, %g}\n", doubles[0], doubles[1], doubles[2]);
+	vscale(rotations, 4, I);
+	double complex total = vsum(rotations, 4);
+	printf("the powers of i times i = {%g%+gi, %g%+gi, %g%+gi, %g%+gi}, their sum is %g%+gi\n", creal(rotations[0]), cimag(rotations[0]),
+		creal(rotations[1]), cimag(rotations[1]), creal(rotations[2]), cimag(rotations[2]), creal(rotations[3]), cimag(rotations[3]),
+		creal(total), cimag(total));
+	printf("kernels in use: %s\n", arrayMathLevelNames[arrayMathLevel()]);
+	size_t failures = arrayMathTest();
+	printf("every type and level against the plain loops: %s (%zu failed)\n", failures == 0 ? "ok" : "FAILED", failures);
+}
+
+
+
+void benchTgMathH() {
+	// elements per ns of every type and function, on arrays of 4096 elements
+	// (the biggest, long double complex, is 64 KiB each, so they stay in L2).
+	// a vector of floats holds twice the elements of one of doubles, and a
+	// complex number is two of them, so those halve the rate at each step
+	size_t failures = arrayMathTest();
+	printf("every type and level against the plain loops: %s (%zu failed)\n\n", failures == 0 ? "ok" : "FAILED", failures);
+	printf("%-28s %9s", "", "loop");
+	for(int level = ARRAY_MATH_SSE2; level <= (int) arrayMathBestLevel(); level++) {
+		printf(" %9s", arrayMathLevelNames[level]);
+	}
+	printf("   (elements/ns)\n");
+	size_t n = 4096;
+	arrayMathBenchFloat("float", n);
+	arrayMathBenchDouble("double", n);
+	arrayMathBenchLongDouble("long double", n);
+	arrayMathBenchComplexFloat("float complex", n);
+	arrayMathBenchComplexDouble("double complex", n);
+	arrayMathBenchComplexLongDouble("long double complex", n);
+}
+
+
+// A WORK-STEALING THREAD POOL
+// made only with what threads.h gives us: thrd_t, mtx_t and cnd_t.
+// every worker has its own deque (double-ended queue) of tasks: it pushes and
+// pops new tasks at the back (the most recent ones, still hot in its cache),
+// and when it runs out of work it "steals" the oldest task from the front of
+// someone else's deque, so the work spreads by itself without a central queue
+
+struct poolTask {
+	void (*function)(void *argument);
+	void *argument;
+};
+
+// a growable ring buffer, protected by its own mutex, so the owner and the
+// thieves only fight over the lock of one deque instead of a global one
+struct taskDeque {
+	mtx_t lock;
+	struct poolTask *tasks;
+	size_t capacity; // always a power of 2, so "index & (capacity - 1)" wraps around
+	size_t head; // thieves take from here
+	size_t tail; // the owner pushes and pops here
+	atomic_size_t steals; // how many tasks were stolen *by* this deque's owner
+};
+
+struct threadPool {
+	thrd_t *threads;
+	struct taskDeque *deques;
+	int workerCount;
+	mtx_t sleepLock; // protects the sleeping workers and the stopping flag
+	cnd_t workAvailable;
+	cnd_t allDone;
+	int sleeping;
+	bool stopping;
+	atomic_size_t queued; // tasks waiting in some deque
+	atomic_size_t pending; // tasks submitted but not finished yet
+	atomic_uint nextDeque; // round robin for tasks submitted from outside the pool
+};
+
+struct poolWorker {
+	struct threadPool *pool;
+	int index;
+};
+
+// thread_local (from threads.h) gives every thread its own copy of a variable,
+// that's how a task knows in which worker (and deque) it is running
+static thread_local int currentWorker = -1;
+static thread_local struct threadPool *currentPool = NULL;
+
+static bool dequeInit(struct taskDeque *deque) {
+	deque->capacity = 64;
+	deque->head = deque->tail = 0;
+	atomic_init(&deque->steals, 0);
+	deque->tasks = malloc(sizeof(struct poolTask) * deque->capacity);
+	if(deque->tasks == NULL) {
+		return false;
+	}
+	if(mtx_init(&deque->lock, mtx_plain) != thrd_success) {
+		free(deque->tasks);
+		return false;
+	}
+	return true;
+}
+
+static void dequeDestroy(struct taskDeque *deque) {
+	mtx_destroy(&deque->lock);
+	free(deque->tasks);
+}
+
+static bool dequePushBack(struct taskDeque *deque, struct poolTask task) {
+	mtx_lock(&deque->lock);
+	if(deque->tail - deque->head == deque->capacity) {
+		// full: copy everything, in order, to a ring twice as big
+		struct poolTask *bigger = malloc(sizeof(struct poolTask) * deque->capacity * 2);
+		if(bigger == NULL) {
+			mtx_unlock(&deque->lock);
+			return false;
+		}
+		for(size_t i = deque->head; i != deque->tail; i++) {
+			bigger[i & (deque->capacity * 2 - 1)] = deque->tasks[i & (deque->capacity - 1)];
+		}
+		free(deque->tasks);
+		deque->tasks = bigger;
+		deque->capacity *= 2;
+	}
+	deque->tasks[deque->tail++ & (deque->capacity - 1)] = task;
+	mtx_unlock(&deque->lock);
+	return true;
+}
+
+static bool dequePopBack(struct taskDeque *deque, struct poolTask *task) {
+	bool found = false;
+	mtx_lock(&deque->lock);
+	if(deque->tail != deque->head) {
+		*task = deque->tasks[--deque->tail & (deque->capacity - 1)];
+		found = true;
+	}
+	mtx_unlock(&deque->lock);
+	return found;
+}
+
+static bool dequeStealFront(struct taskDeque *deque, struct poolTask *task) {
+	bool found = false;
+	// if somebody else is using this deque, don't wait, go try another one
+	if(mtx_trylock(&deque->lock) != thrd_success) {
+		return false;
+	}
+	if(deque->tail != deque->head) {
+		*task = deque->tasks[deque->head++ & (deque->capacity - 1)];
+		found = true;
+	}
+	mtx_unlock(&deque->lock);
+	return found;
+}
+
+// own deque first, then every other one starting from a pseudo-random victim
+static bool poolFindTask(struct threadPool *pool, int self, unsigned *seed, struct poolTask *task) {
+	if(dequePopBack(&pool->deques[self], task)) {
+		return true;
+	}
+	*seed = *seed * 1103515245u + 12345u;
+	int start = (int) ((*seed >> 16) % (unsigned) pool->workerCount);
+	for(int i = 0; i < pool->workerCount; i++) {
+		int victim = (start + i) % pool->workerCount;
+		if(victim != self && dequeStealFront(&pool->deques[victim], task)) {
+			atomic_fetch_add_explicit(&pool->deques[self].steals, 1, memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void poolRunTask(struct threadPool *pool, struct poolTask task) {
+	atomic_fetch_sub(&pool->queued, 1);
+	task.function(task.argument);
+	if(atomic_fetch_sub(&pool->pending, 1) == 1) {
+		// that was the last one, wake up whoever is in threadPoolWait()
+		mtx_lock(&pool->sleepLock);
+		cnd_broadcast(&pool->allDone);
+		mtx_unlock(&pool->sleepLock);
+	}
+}
+
+static int poolWorkerMain(void *argument) {
+	struct poolWorker *worker = argument;
+	struct threadPool *pool = worker->pool;
+	int self = worker->index;
+	unsigned seed = (unsigned) self * 2654435761u + 1;
+	free(worker);
+	currentWorker = self;
+	currentPool = pool;
+
+	struct poolTask task;
+	while(true) {
+		if(poolFindTask(pool, self, &seed, &task)) {
+			poolRunTask(pool, task);
+			continue;
+		}
+		// nothing to do anywhere: sleep until a task is submitted.
+		// "queued" is checked while holding the lock, and submitters signal
+		// while holding it too, so a wake-up can't slip between the check and the wait
+		mtx_lock(&pool->sleepLock);
+		while(!pool->stopping && atomic_load(&pool->queued) == 0) {
+			pool->sleeping++;
+			cnd_wait(&pool->workAvailable, &pool->sleepLock);
+			pool->sleeping--;
+		}
+		bool stop = pool->stopping && atomic_load(&pool->queued) == 0;
+		mtx_unlock(&pool->sleepLock);
+		if(stop) {
+			return 0;
+		}
+	}
+}
+
+static void threadPoolDestroy(struct threadPool *pool);
+
+// returns 0 on success, like the thrd_* functions return thrd_success
+static int threadPoolInit(struct threadPool *pool, int workerCount) {
+	memset(pool, 0, sizeof(*pool));
+	pool->threads = calloc(workerCount, sizeof(thrd_t));
+	pool->deques = calloc(workerCount, sizeof(struct taskDeque));
+	if(pool->threads == NULL || pool->deques == NULL) {
+		free(pool->threads);
+		free(pool->deques);
+		return -1;
+	}
+	atomic_init(&pool->queued, 0);
+	atomic_init(&pool->pending, 0);
+	atomic_init(&pool->nextDeque, 0);
+	mtx_init(&pool->sleepLock, mtx_plain);
+	cnd_init(&pool->workAvailable);
+	cnd_init(&pool->allDone);
+
+	for(int i = 0; i < workerCount; i++) {
+		if(!dequeInit(&pool->deques[i])) {
+			free(pool->threads);
+			pool->threads = NULL; // no thread was started, so there's nobody to join
+			threadPoolDestroy(pool);
+			return -1;
+		}
+		pool->workerCount = i + 1;
+	}
+	// workerCount now counts the deques, and from here on the threads started
+	int started = 0;
+	for(; started < workerCount; started++) {
+		struct poolWorker *worker = malloc(sizeof(*worker));
+		if(worker == NULL) {
+			break;
+		}
+		worker->pool = pool;
+		worker->index = started;
+		if(thrd_create(&pool->threads[started], poolWorkerMain, worker) != thrd_success) {
+			free(worker);
+			break;
+		}
+	}
+	if(started < workerCount) {
+		// couldn't start them all: stop the ones that did start and give up
+		mtx_lock(&pool->sleepLock);
+		pool->stopping = true;
+		cnd_broadcast(&pool->workAvailable);
+		mtx_unlock(&pool->sleepLock);
+		for(int i = 0; i < started; i++) {
+			thrd_join(pool->threads[i], NULL);
+		}
+		free(pool->threads);
+		pool->threads = NULL;
+		threadPoolDestroy(pool);
+		return -1;
+	}
+	return 0;
+}
+
+// can be called from outside the pool, or from inside a task to spawn
+// more tasks (those go to the back of the current worker's own deque)
+static bool threadPoolSubmit(struct threadPool *pool, void (*function)(void *), void *argument) {
+	struct poolTask task = {function, argument};
+	int target = currentPool == pool ? currentWorker
+		: (int) (atomic_fetch_add(&pool->nextDeque, 1) % (unsigned) pool->workerCount);
+
+	atomic_fetch_add(&pool->pending, 1);
+	atomic_fetch_add(&pool->queued, 1);
+	if(!dequePushBack(&pool->deques[target], task)) {
+		atomic_fetch_sub(&pool->queued, 1);
+		atomic_fetch_sub(&pool->pending, 1);
+		return false;
+	}
+	mtx_lock(&pool->sleepLock);
+	if(pool->sleeping > 0) {
+		cnd_signal(&pool->workAvailable);
+	}
+	mtx_unlock(&pool->sleepLock);
+	return true;
+}
+
+// blocks until every submitted task (and the tasks they spawned) finished,
+// so it must be called from outside the pool
+static void threadPoolWait(struct threadPool *pool) {
+	mtx_lock(&pool->sleepLock);
+	while(atomic_load(&pool->pending) != 0) {
+		cnd_wait(&pool->allDone, &pool->sleepLock);
+	}
+	mtx_unlock(&pool->sleepLock);
+}
+
+static size_t threadPoolSteals(struct threadPool *pool) {
+	size_t steals = 0;
+	for(int i = 0; i < pool->workerCount; i++) {
+		steals += atomic_load_explicit(&pool->deques[i].steals, memory_order_relaxed);
+	}
+	return steals;
+}
+
+// finishes the queued work, stops the workers and frees everything
+static void threadPoolDestroy(struct threadPool *pool) {
+	if(pool->threads != NULL) {
+		mtx_lock(&pool->sleepLock);
+		pool->stopping = true;
+		cnd_broadcast(&pool->workAvailable);
+		mtx_unlock(&pool->sleepLock);
+		for(int i = 0; i < pool->workerCount; i++) {
+			thrd_join(pool->threads[i], NULL);
+		}
+	}
+	for(int i = 0; i < pool->workerCount; i++) {
+		dequeDestroy(&pool->deques[i]);
+	}
+	mtx_destroy(&pool->sleepLock);
+	cnd_destroy(&pool->workAvailable);
+	cnd_destroy(&pool->allDone);
+	free(pool->threads);
+	free(pool->deques);
+	pool->threads = NULL;
+	pool->deques = NULL;
+	pool->workerCount = 0;
+}
+
+
+
+// THE TASK GRAPH USED BY THE DEMO AND THE BENCHMARK
+// a divide-and-conquer tree: every task splits its range in two and spawns
+// both halves, until the range is small enough to just compute. only the
+// root is submitted from outside, so all the spreading is done by stealing
+
+struct rangeTask {
+	struct threadPool *pool;
+	uint64_t first;
+	uint64_t count;
+	uint64_t grain; // ranges up to this size aren't split anymore
+	int workPerItem; // how much busy work each item costs
+	atomic_uint_fast64_t *result;
+};
+
+// deliberately CPU-bound busy work: a few rounds of xorshift per item
+static uint64_t crunchItem(uint64_t item, int rounds) {
+	uint64_t x = item * 0x9E3779B97F4A7C15u + 1;
+	for(int i = 0; i < rounds; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+	}
+	return x;
+}
+
+static uint64_t crunchRange(uint64_t first, uint64_t count, int rounds) {
+	uint64_t sum = 0;
+	for(uint64_t i = first; i < first + count; i++) {
+		sum += crunchItem(i, rounds);
+	}
+	return sum;
+}
+
+static void rangeTaskRun(void *argument) {
+	struct rangeTask *task = argument;
+	while(task->count > task->grain) {
+		struct rangeTask *half = malloc(sizeof(*half));
+		if(half == NULL) {
+			break; // no memory for a new task, just do the whole thing here
+		}
+		*half = *task;
+		half->count = task->count / 2;
+		half->first = task->first + task->count - half->count;
+		task->count -= half->count;
+		if(!threadPoolSubmit(task->pool, rangeTaskRun, half)) {
+			task->count += half->count; // keep it, it'll be computed here
+			free(half);
+			break;
+		}
+	}
+	atomic_fetch_add(task->result, crunchRange(task->first, task->count, task->workPerItem));
+	free(task);
+}
+
+// runs the whole tree on the pool and returns the sum of every item
+static bool runRangeGraph(struct threadPool *pool, uint64_t count, uint64_t grain, int workPerItem, uint64_t *sum) {
+	atomic_uint_fast64_t result;
+	atomic_init(&result, 0);
+	struct rangeTask *root = malloc(sizeof(*root));
+	if(root == NULL) {
+		return false;
+	}
+	*root = (struct rangeTask) {pool, 0, count, grain, workPerItem, &result};
+	if(!threadPoolSubmit(pool, rangeTaskRun, root)) {
+		free(root);
+		return false;
+	}
+	threadPoolWait(pool);
+	*sum = atomic_load(&result);
+	return true;
+}
+
+
+
+void testThreadsH() {
+	// this header is the C11 way of doing multithreading without depending
+	// on pthreads (even though in linux it's built on top of them)
+
+	// a thread runs a function that receives a void* and returns an int
+	int sayHi(void *argument) {
+		printf("hi from thread %d\n", *(int *) argument);
+		return *(int *) argument * 10;
+	}
+
+	// thrd_create() starts a thread and thrd_join() waits for it to end
+	// and gets what it returned
+	thrd_t threads[3];
+	int ids[3] = {1, 2, 3};
+	for(int i = 0; i < 3; i++) {
+		thrd_create(&threads[i], sayHi, &ids[i]);
+	}
+	for(int i = 0; i < 3; i++) {
+		int returned;
+		thrd_join(threads[i], &returned);
+		printf("thread %d returned %d\n", ids[i], returned);
+	}
+
+	// a mutex (mtx_t) makes sure only one thread at a time runs a piece of
+	// code, and a condition variable (cnd_t) lets a thread sleep until some
+	// other thread tells it that something changed. thread_local variables
+	// exist once per thread. With these three things we can build a thread pool:
+	// a fixed group of threads that runs whatever tasks we give them
+	// (it's right above this function, go read it!)
+	struct threadPool pool;
+	if(threadPoolInit(&pool, 4) != 0) {
+		printf("couldn't create the thread pool\n");
+		return;
+	}
+
+	// lets give it a tree of 1 + 2 + 4 + ... tasks to do, starting from only
+	// one task, and see if the other workers stole their share
+	uint64_t count = 1 << 16;
+	uint64_t sum = 0;
+	if(!runRangeGraph(&pool, count, 1024, 16, &sum)) {
+		printf("couldn't submit the tasks\n");
+	}
+	uint64_t expected = crunchRange(0, count, 16);
+	printf("\nthe pool computed %" PRIu64 ", a single thread computed %" PRIu64 " (%s)\n",
+		sum, expected, sum == expected ? "they match" : "THEY DON'T MATCH");
+	printf("the workers stole %zu tasks from each other\n", threadPoolSteals(&pool));
+
+	threadPoolDestroy(&pool);
+}
+
+
+
+void benchThreadsH() {
+	// runs the same task graph with 1, 2, ..., N workers and compares them
+	// with the one worker run: speedup = T(1) / T(n) and efficiency = speedup / n
+	// (efficiency 1.0 would be perfect scaling, and it never really happens)
+	int maxThreads = benchThreadCount();
+	uint64_t count = 1 << 22;
+	uint64_t grain = 4096;
+	int workPerItem = 32;
+	int repeats = 5;
+
+	uint64_t expected = crunchRange(0, count, workPerItem);
+	printf("task graph: %" PRIu64 " items, %" PRIu64 " per leaf task, best of %d runs\n\n",
+		count, grain, repeats);
+	printf("threads    time (ms)   speedup   efficiency   steals\n");
+
+	double baseline = 0;
+	for(int threads = 1; threads <= maxThreads; threads++) {
+		struct threadPool pool;
+		if(threadPoolInit(&pool, threads) != 0) {
+			printf("couldn't start %d threads\n", threads);
+			return;
+		}
+		uint64_t best = UINT64_MAX;
+		for(int r = 0; r < repeats; r++) {
+			uint64_t sum = 0;
+			uint64_t start = monotonicNs();
+			bool ok = runRangeGraph(&pool, count, grain, workPerItem, &sum);
+			uint64_t elapsed = monotonicNs() - start;
+			if(!ok || sum != expected) {
+				printf("the pool got the wrong result with %d threads!\n", threads);
+				threadPoolDestroy(&pool);
+				return;
+			}
+			best = elapsed < best ? elapsed : best;
+		}
+		if(threads == 1) {
+			baseline = best;
+		}
+		double speedup = baseline / best;
+		printf("%7d %12.3f %9.2f %12.2f %8zu\n", threads, best / 1e6, speedup,
+			speedup / threads, threadPoolSteals(&pool) / repeats);
+		threadPoolDestroy(&pool);
+	}
+}
+
+
+
+// CLOCKS AND WHAT THEY COST
+// every clock answers "what time is it" with a different meaning (wall
+// time, time since boot, CPU time used by us...) and a different price.
+// a clock that costs 20 ns to read can't time something that takes 50 ns,
+// and one that only moves every 4 ms (the "coarse" ones) can't time anything
+// short at all, so here each one is asked how fine it is (clock_getres())
+// and then checked: how long a read takes, and the smallest step it was
+// seen to make
+
+struct clockSource {
+	const char *name;
+	clockid_t id; // for clock_gettime(), the other readers ignore it
+	uint64_t (*read)(clockid_t id); // the time in nanoseconds
+};
+
+static uint64_t readClockGettime(clockid_t id) {
+	struct timespec now;
+	clock_gettime(id, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static uint64_t readTimespecGet(clockid_t id) {
+	(void) id;
+	struct timespec now;
+	timespec_get(&now, TIME_UTC); // the C11 one, the same as CLOCK_REALTIME
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static uint64_t readClock(clockid_t id) {
+	(void) id;
+	return (uint64_t) clock() * (1000000000u / CLOCKS_PER_SEC); // CPU time, CLOCKS_PER_SEC is always 1000000 on POSIX
+}
+
+static uint64_t readTime(clockid_t id) {
+	(void) id;
+	return (uint64_t) time(NULL) * 1000000000u;
+}
+
+static uint64_t readTimer(clockid_t id) {
+	(void) id;
+	return timerNowNs();
+}
+
+static const struct clockSource clockSources[] = {
+	{"CLOCK_REALTIME", CLOCK_REALTIME, readClockGettime},
+	{"CLOCK_REALTIME_COARSE", CLOCK_REALTIME_COARSE, readClockGettime},
+	{"CLOCK_MONOTONIC", CLOCK_MONOTONIC, readClockGettime},
+	{"CLOCK_MONOTONIC_COARSE", CLOCK_MONOTONIC_COARSE, readClockGettime},
+	{"CLOCK_MONOTONIC_RAW", CLOCK_MONOTONIC_RAW, readClockGettime},
+	{"CLOCK_BOOTTIME", CLOCK_BOOTTIME, readClockGettime},
+	{"CLOCK_TAI", CLOCK_TAI, readClockGettime},
+	{"CLOCK_PROCESS_CPUTIME_ID", CLOCK_PROCESS_CPUTIME_ID, readClockGettime},
+	{"CLOCK_THREAD_CPUTIME_ID", CLOCK_THREAD_CPUTIME_ID, readClockGettime},
+	{"timespec_get(TIME_UTC)", CLOCK_REALTIME, readTimespecGet},
+	{"clock()", CLOCK_PROCESS_CPUTIME_ID, readClock},
+	{"time()", CLOCK_REALTIME, readTime},
+	{"timerNowNs() (the TSC)", CLOCK_MONOTONIC, readTimer},
+};
+
+struct clockCost {
+	double overheadNs; // per read
+	uint64_t smallestStepNs; // 0 if it never moved while we looked
+};
+
+// the time of a read is measured with the TSC in batches of 100 reads (the
+// best batch of 50), and the step by reading until the value changes, for
+// at most 20 ms
+static struct clockCost measureClock(const struct clockSource *source) {
+	struct clockCost cost = {INFINITY, 0};
+	double nsPerTick = tscCalibration()->nsPerTick;
+	for(int r = 0; r < 50; r++) {
+		uint64_t start = cycleCounter();
+		for(int i = 0; i < 100; i++) {
+			benchKeep(source->read(source->id));
+		}
+		double ns = (cycleCounter() - start) * nsPerTick / 100;
+		cost.overheadNs = ns < cost.overheadNs ? ns : cost.overheadNs;
+	}
+	uint64_t deadline = monotonicNs() + 20000000;
+	uint64_t previous = source->read(source->id);
+	for(int changes = 0; changes < 1000 && monotonicNs() < deadline;) {
+		uint64_t now = source->read(source->id);
+		if(now != previous) {
+			uint64_t step = now - previous;
+			cost.smallestStepNs = cost.smallestStepNs == 0 || step < cost.smallestStepNs ? step : cost.smallestStepNs;
+			previous = now;
+			changes++;
+		}
+	}
+	return cost;
+}
+
+void testTimeH() {
+	// this header has the wall clock (time(), in seconds since 1970, and
+	// timespec_get() with nanoseconds), the CPU time we used (clock()) and
+	// functions to turn seconds into dates and dates into text
+	time_t now = time(NULL);
+	struct tm utc, local;
+	gmtime_r(&now, &utc); // the _r versions don't share a static buffer between calls
+	localtime_r(&now, &local);
+	char text[64];
+	strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &utc);
+	printf("\n\nnow is %lld seconds since 1970, or %s UTC\n", (long long) now, text);
+	strftime(text, sizeof(text), "%A, %d %B %Y, %H:%M %Z", &local);
+	printf("here it's %s\n", text);
+
+	// mktime() goes the other way, and fixes out of range fields on the way:
+	// the 32nd of December is the 1st of January
+	struct tm newYear = {.tm_year = local.tm_year, .tm_mon = 11, .tm_mday = 32, .tm_hour = 0, .tm_isdst = -1};
+	time_t then = mktime(&newYear);
+	strftime(text, sizeof(text), "%Y-%m-%d", &newYear);
+	printf("%s is %.1f days from now\n", text, difftime(then, now) / 86400);
+
+	clock_t cpuStart = clock();
+	volatile double sink = 0;
+	for(int i = 0; i < 10000000; i++) {
+		sink += i;
+	}
+	printf("counting to 10 million took %.3f ms of CPU time\n", (clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC);
+
+	// for timing code, the POSIX clock_gettime() clocks and the CPU's time
+	// stamp counter are what matter. first how fast the counter ticks
+	const struct tscCalibration *calibration = tscCalibration();
+	printf("\nthe time stamp counter ticks at %.3f GHz, %s\n", calibration->ticksPerNs,
+		calibration->invariant ? "at a constant rate, so timerNowNs() uses it"
+			: "but the CPU doesn't promise it's constant, so timerNowNs() uses CLOCK_MONOTONIC");
+
+	// and then every clock
+	printf("\n%-26s %14s %14s %20s\n", "clock", "getres (ns)", "read (ns)", "smallest step (ns)");
+	for(size_t i = 0; i < sizeof(clockSources) / sizeof(clockSources[0]); i++) {
+		const struct clockSource *source = &clockSources[i];
+		struct timespec resolution;
+		if(source->read == readClockGettime && clock_getres(source->id, &resolution) != 0) {
+			printf("%-26s %14s\n", source->name, "not available");
+			continue;
+		}
+		struct clockCost cost = measureClock(source);
+		printf("%-26s", source->name);
+		if(source->read == readClockGettime) {
+			printf(" %14lld", (long long) resolution.tv_sec * 1000000000 + resolution.tv_nsec);
+		} else {
+			printf(" %14s", "-");
+		}
+		printf(" %14.1f", cost.overheadNs);
+		if(cost.smallestStepNs != 0) {
+			printf(" %20llu\n", (unsigned long long) cost.smallestStepNs);
+		} else {
+			printf(" %20s\n", "didn't move in 20 ms");
+		}
+	}
+
+	// a scoped timer times a whole block, however it ends
+	uint64_t total = 0;
+	for(int round = 0; round < 3; round++) {
+		SCOPED_TIMER(timer, "one round", &total);
+		for(int i = 0; i < 1000000; i++) {
+			sink += i;
+		}
+	}
+	printf("\n3 rounds of counting took %.3f ms in total\n", total / 1e6);
+	{
+		SCOPED_TIMER(timer, "sleeping for 1 ms", NULL);
+		thrd_sleep(&(struct timespec) {.tv_nsec = 1000000}, NULL);
+	}
+}
+
+
+
+// BULK UTF-8, UTF-16 AND UTF-32
+// mbrtoc32() and friends convert one character per call, through the
+// locale and an mbstate_t, which is flexible and slow. when the text is
+// known to be UTF-8 (it nearly always is) whole blocks can be handled at
+// once: 16 bytes are checked for ASCII with one instruction, and ASCII only
+// needs to be widened or narrowed. the validation is the "lookup" algorithm
+// by John Keiser and Daniel Lemire (simdjson and simdutf use it): every
+// error UTF-8 can have shows up in the first 12 bits of a pair of
+// consecutive bytes (the previous byte and the high half of the current one),
+// so three 16 entry tables looked up with pshufb and ANDed together flag
+// them, 16 bytes at a time. the checks that need 3 or 4 bytes (is this
+// continuation byte expected?) come from the bytes 2 and 3 positions back
+
+// the result of every conversion: how many input units were read and how
+// many output units were written. when the input isn't valid, "read" is
+// where the first bad character starts, and everything before it was converted
+struct transcodeResult {
+	size_t read;
+	size_t written;
+	bool valid;
+};
+
+// decodes one character, returns its length or 0 if it isn't valid UTF-8
+// (overlong, a surrogate, above U+10FFFF, cut short or not a start byte).
+// the second byte has the narrowest range, the others just must be 10xxxxxx
+static int utf8DecodeOne(const unsigned char *text, size_t left, char32_t *out) {
+	unsigned lead = text[0];
+	if(lead < 0x80) {
+		*out = lead;
+		return 1;
+	}
+	int length;
+	char32_t value;
+	unsigned low = 0x80, high = 0xBF;
+	if(lead >= 0xC2 && lead <= 0xDF) {
+		length = 2;
+		value = lead & 0x1F;
+	} else if(lead >= 0xE0 && lead <= 0xEF) {
+		length = 3;
+		value = lead & 0x0F;
+		low = lead == 0xE0 ? 0xA0 : 0x80; // E0 80..9F would be overlong
+		high = lead == 0xED ? 0x9F : 0xBF; // ED A0..BF would be a surrogate
+	} else if(lead >= 0xF0 && lead <= 0xF4) {
+		length = 4;
+		value = lead & 0x07;
+		low = lead == 0xF0 ? 0x90 : 0x80; // F0 80..8F would be overlong
+		high = lead == 0xF4 ? 0x8F : 0xBF; // F4 90 and up is past U+10FFFF
+	} else {
+		return 0;
+	}
+	if(left < (size_t) length || text[1] < low || text[1] > high) {
+		return 0;
+	}
+	value = value << 6 | (text[1] & 0x3F);
+	for(int i = 2; i < length; i++) {
+		if((text[i] & 0xC0) != 0x80) {
+			return 0;
+		}
+		value = value << 6 | (text[i] & 0x3F);
+	}
+	*out = value;
+	return length;
+}
+
+// how many bytes from the start are valid UTF-8, one character at a time
+// (but 8 bytes at a time while they are ASCII)
+static size_t utf8ValidPrefixScalar(const unsigned char *text, size_t length) {
+	size_t i = 0;
+	while(i < length) {
+		uint64_t word;
+		if(i + 8 <= length && (memcpy(&word, text + i, 8), (word & 0x8080808080808080) == 0)) {
+			i += 8;
+			continue;
+		}
+		char32_t ignored;
+		int size = utf8DecodeOne(text + i, length - i, &ignored);
+		if(size == 0) {
+			return i;
+		}
+		i += size;
+	}
+	return length;
+}
+
+// where the character around position i starts (a character is 4 bytes
+// at most, so it's at most 3 continuation bytes back)
+static size_t utf8CharacterStart(const unsigned char *text, size_t i) {
+	for(int back = 0; back < 3 && i > 0 && (text[i] & 0xC0) == 0x80; back++) {
+		i--;
+	}
+	return i;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// the error bits of the lookup tables: every bad pair of bytes sets the same
+// bit in all three lookups, and nothing else does
+#define UTF8_TOO_SHORT (1 << 0) // a start byte followed by something that isn't a continuation
+#define UTF8_TOO_LONG (1 << 1) // ASCII followed by a continuation
+#define UTF8_OVERLONG_3 (1 << 2) // E0 80..9F
+#define UTF8_TOO_LARGE (1 << 3) // F4 90.. and F5..FF
+#define UTF8_SURROGATE (1 << 4) // ED A0..BF
+#define UTF8_OVERLONG_2 (1 << 5) // C0 and C1
+#define UTF8_TOO_LARGE_1000 (1 << 6) // F5..FF 80..8F
+#define UTF8_OVERLONG_4 (1 << 6) // F0 80..8F
+#define UTF8_TWO_CONTINUATIONS (1 << 7) // two continuations in a row (checked against the expected ones below)
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTINUATIONS)
+
+__attribute__((target("ssse3")))
+static size_t utf8ValidPrefixSsse3(const unsigned char *text, size_t length) {
+	// looked up by the high nibble of the previous byte
+	const __m128i previousHigh = _mm_setr_epi8(
+		UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+		UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+		UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS,
+		UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+		UTF8_TOO_SHORT,
+		UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+		(char) (UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4));
+	// by the low nibble of the previous byte
+	const __m128i previousLow = _mm_setr_epi8(
+		(char) (UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4),
+		(char) (UTF8_CARRY | UTF8_OVERLONG_2),
+		(char) UTF8_CARRY, (char) UTF8_CARRY,
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000),
+		(char) (UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000));
+	// and by the high nibble of the current byte
+	const __m128i currentHigh = _mm_setr_epi8(
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+		(char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4),
+		(char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE),
+		(char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_SURROGATE | UTF8_TOO_LARGE),
+		(char) (UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_SURROGATE | UTF8_TOO_LARGE),
+		UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT);
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+	// a block that ends in the middle of a character needs continuations
+	// at the start of the next one: the last 3 bytes can't be start bytes
+	// of characters longer than 3, 2 and 1 bytes
+	const __m128i lastStarts = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		(char) (0xF0 - 1), (char) (0xE0 - 1), (char) (0xC0 - 1));
+	__m128i previous = _mm_setzero_si128();
+	__m128i previousIncomplete = _mm_setzero_si128();
+	size_t i = 0;
+	for(; i + 16 <= length; i += 16) {
+		__m128i input = _mm_loadu_si128((const __m128i *) (text + i));
+		__m128i error;
+		if(_mm_movemask_epi8(input) == 0) {
+			error = previousIncomplete;
+			previousIncomplete = _mm_setzero_si128();
+		} else {
+			__m128i previous1 = _mm_alignr_epi8(input, previous, 15);
+			__m128i special = _mm_and_si128(_mm_and_si128(
+				_mm_shuffle_epi8(previousHigh, _mm_and_si128(_mm_srli_epi16(previous1, 4), nibble)),
+				_mm_shuffle_epi8(previousLow, _mm_and_si128(previous1, nibble))),
+				_mm_shuffle_epi8(currentHigh, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+			// the third and fourth bytes of 3 and 4 byte characters must be continuations
+			__m128i third = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 14), _mm_set1_epi8(0xE0 - 0x80));
+			__m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(input, previous, 13), _mm_set1_epi8((char) (0xF0 - 0x80)));
+			__m128i expected = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char) 0x80));
+			error = _mm_xor_si128(expected, special);
+			previousIncomplete = _mm_subs_epu8(input, lastStarts);
+		}
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) != 0xFFFF) {
+			break; // the exact spot is found one character at a time below
+		}
+		previous = input;
+	}
+	// the rest one character at a time, from the start of the last character
+	// of the last good block (it may be the one that's broken or cut short)
+	size_t start = i > 0 ? utf8CharacterStart(text, i - 1) : 0;
+	return start + utf8ValidPrefixScalar(text + start, length - start);
+}
+#endif
+
+static bool utf8HasSsse3() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_cpu_supports("ssse3");
+#else
+	return false;
+#endif
+}
+
+// how many bytes from the start are valid UTF-8 (all of them when it's valid)
+static size_t utf8ValidPrefix(const unsigned char *text, size_t length) {
+#if defined(__x86_64__) || defined(__i386__)
+	static int ssse3 = -1;
+	if(ssse3 < 0) {
+		ssse3 = utf8HasSsse3();
+	}
+	if(ssse3) {
+		return utf8ValidPrefixSsse3(text, length);
+	}
+#endif
+	return utf8ValidPrefixScalar(text, length);
+}
+
+// the decoders after validation: nothing is checked anymore, ASCII goes 16
+// bytes at a time (widened by interleaving with zeros) and the rest one by one
+static size_t utf8ToUtf32Valid(const unsigned char *in, size_t length, char32_t *out) {
+	size_t i = 0, o = 0;
+	while(i < length) {
+#if defined(__x86_64__) || defined(__i386__)
+		if(i + 16 <= length) {
+			__m128i block = _mm_loadu_si128((const __m128i *) (in + i));
+			if(_mm_movemask_epi8(block) == 0) {
+				__m128i zero = _mm_setzero_si128();
+				__m128i low = _mm_unpacklo_epi8(block, zero);
+				__m128i high = _mm_unpackhi_epi8(block, zero);
+				_mm_storeu_si128((__m128i *) (out + o), _mm_unpacklo_epi16(low, zero));
+				_mm_storeu_si128((__m128i *) (out + o + 4), _mm_unpackhi_epi16(low, zero));
+				_mm_storeu_si128((__m128i *) (out + o + 8), _mm_unpacklo_epi16(high, zero));
+				_mm_storeu_si128((__m128i *) (out + o + 12), _mm_unpackhi_epi16(high, zero));
+				i += 16;
+				o += 16;
+				continue;
+			}
+		}
+#endif
+		unsigned lead = in[i];
+		if(lead < 0x80) {
+			out[o++] = lead;
+			i++;
+		} else if(lead < 0xE0) {
+			out[o++] = (lead & 0x1F) << 6 | (in[i + 1] & 0x3F);
+			i += 2;
+		} else if(lead < 0xF0) {
+			out[o++] = (lead & 0x0F) << 12 | (in[i + 1] & 0x3F) << 6 | (in[i + 2] & 0x3F);
+			i += 3;
+		} else {
+			out[o++] = (lead & 0x07) << 18 | (in[i + 1] & 0x3F) << 12 | (in[i + 2] & 0x3F) << 6 | (in[i + 3] & 0x3F);
+			i += 4;
+		}
+	}
+	return o;
+}
+
+static size_t utf8ToUtf16Valid(const unsigned char *in, size_t length, char16_t *out) {
+	size_t i = 0, o = 0;
+	while(i < length) {
+#if defined(__x86_64__) || defined(__i386__)
+		if(i + 16 <= length) {
+			__m128i block = _mm_loadu_si128((const __m128i *) (in + i));
+			if(_mm_movemask_epi8(block) == 0) {
+				__m128i zero = _mm_setzero_si128();
+				_mm_storeu_si128((__m128i *) (out + o), _mm_unpacklo_epi8(block, zero));
+				_mm_storeu_si128((__m128i *) (out + o + 8), _mm_unpackhi_epi8(block, zero));
+				i += 16;
+				o += 16;
+				continue;
+			}
+		}
+#endif
+		unsigned lead = in[i];
+		if(lead < 0x80) {
+			out[o++] = lead;
+			i++;
+		} else if(lead < 0xE0) {
+			out[o++] = (char16_t) ((lead & 0x1F) << 6 | (in[i + 1] & 0x3F));
+			i += 2;
+		} else if(lead < 0xF0) {
+			out[o++] = (char16_t) ((lead & 0x0F) << 12 | (in[i + 1] & 0x3F) << 6 | (in[i + 2] & 0x3F));
+			i += 3;
+		} else {
+			// above U+FFFF it takes two UTF-16 units, a surrogate pair
+			char32_t c = (lead & 0x07) << 18 | (in[i + 1] & 0x3F) << 12 | (in[i + 2] & 0x3F) << 6 | (in[i + 3] & 0x3F);
+			out[o++] = (char16_t) (0xD800 + ((c - 0x10000) >> 10));
+			out[o++] = (char16_t) (0xDC00 + ((c - 0x10000) & 0x3FF));
+			i += 4;
+		}
+	}
+	return o;
+}
+
+// "out" needs room for "length" units in both
+static struct transcodeResult utf8ToUtf32(const unsigned char *in, size_t length, char32_t *out) {
+	size_t valid = utf8ValidPrefix(in, length);
+	return (struct transcodeResult) {valid, utf8ToUtf32Valid(in, valid, out), valid == length};
+}
+
+static struct transcodeResult utf8ToUtf16(const unsigned char *in, size_t length, char16_t *out) {
+	size_t valid = utf8ValidPrefix(in, length);
+	return (struct transcodeResult) {valid, utf8ToUtf16Valid(in, valid, out), valid == length};
+}
+
+// writes one character (already known to be valid) and returns its length
+static int utf8EncodeOne(char32_t c, unsigned char *out) {
+	if(c < 0x80) {
+		out[0] = (unsigned char) c;
+		return 1;
+	}
+	if(c < 0x800) {
+		out[0] = (unsigned char) (0xC0 | c >> 6);
+		out[1] = (unsigned char) (0x80 | (c & 0x3F));
+		return 2;
+	}
+	if(c < 0x10000) {
+		out[0] = (unsigned char) (0xE0 | c >> 12);
+		out[1] = (unsigned char) (0x80 | (c >> 6 & 0x3F));
+		out[2] = (unsigned char) (0x80 | (c & 0x3F));
+		return 3;
+	}
+	out[0] = (unsigned char) (0xF0 | c >> 18);
+	out[1] = (unsigned char) (0x80 | (c >> 12 & 0x3F));
+	out[2] = (unsigned char) (0x80 | (c >> 6 & 0x3F));
+	out[3] = (unsigned char) (0x80 | (c & 0x3F));
+	return 4;
+}
+
+// "out" needs 4 bytes per character. surrogates and anything past U+10FFFF are errors
+static struct transcodeResult utf32ToUtf8(const char32_t *in, size_t length, unsigned char *out) {
+	size_t i = 0, o = 0;
+	while(i < length) {
+#if defined(__x86_64__) || defined(__i386__)
+		if(i + 16 <= length) {
+			__m128i a = _mm_loadu_si128((const __m128i *) (in + i));
+			__m128i b = _mm_loadu_si128((const __m128i *) (in + i + 4));
+			__m128i c = _mm_loadu_si128((const __m128i *) (in + i + 8));
+			__m128i d = _mm_loadu_si128((const __m128i *) (in + i + 12));
+			__m128i any = _mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d));
+			if(_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_andnot_si128(_mm_set1_epi32(0x7F), any), _mm_setzero_si128())) == 0xFFFF) {
+				// all ASCII: two narrowing packs and 16 characters are 16 bytes
+				_mm_storeu_si128((__m128i *) (out + o), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+				i += 16;
+				o += 16;
+				continue;
+			}
+		}
+#endif
+		char32_t c = in[i];
+		if(c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) {
+			return (struct transcodeResult) {i, o, false};
+		}
+		o += utf8EncodeOne(c, out + o);
+		i++;
+	}
+	return (struct transcodeResult) {length, o, true};
+}
+
+// "out" needs 3 bytes per unit. a surrogate without its pair is an error
+static struct transcodeResult utf16ToUtf8(const char16_t *in, size_t length, unsigned char *out) {
+	size_t i = 0, o = 0;
+	while(i < length) {
+#if defined(__x86_64__) || defined(__i386__)
+		if(i + 16 <= length) {
+			__m128i a = _mm_loadu_si128((const __m128i *) (in + i));
+			__m128i b = _mm_loadu_si128((const __m128i *) (in + i + 8));
+			__m128i any = _mm_or_si128(a, b);
+			if(_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_andnot_si128(_mm_set1_epi16(0x7F), any), _mm_setzero_si128())) == 0xFFFF) {
+				_mm_storeu_si128((__m128i *) (out + o), _mm_packus_epi16(a, b));
+				i += 16;
+				o += 16;
+				continue;
+			}
+		}
+#endif
+		char32_t c = in[i];
+		if(c >= 0xD800 && c <= 0xDFFF) {
+			if(c > 0xDBFF || i + 1 >= length || in[i + 1] < 0xDC00 || in[i + 1] > 0xDFFF) {
+				return (struct transcodeResult) {i, o, false};
+			}
+			c = 0x10000 + ((c - 0xD800) << 10) + (in[i + 1] - 0xDC00);
+			i++;
+		}
+		o += utf8EncodeOne(c, out + o);
+		i++;
+	}
+	return (struct transcodeResult) {length, o, true};
+}
+
+// the same conversions the standard way, one character per call, for the
+// differential test and the benchmark (they need a UTF-8 locale). glibc
+// still follows the old ISO 10646 UTF-8, which went up to 0x7FFFFFFF, so
+// it happily decodes F4 90 80 80 and encodes 0x110000: Unicode stops at
+// U+10FFFF, and so do these
+static struct transcodeResult standardUtf8ToUtf32(const unsigned char *in, size_t length, char32_t *out) {
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	size_t i = 0, o = 0;
+	while(i < length) {
+		size_t size = mbrtoc32(&out[o], (const char *) in + i, length - i, &state);
+		if(size == (size_t) -1 || size == (size_t) -2 || out[o] > 0x10FFFF) {
+			return (struct transcodeResult) {i, o, false}; // invalid, or cut short by the end
+		}
+		i += size == 0 ? 1 : size; // 0 means it read a '\0'
+		o++;
+	}
+	return (struct transcodeResult) {length, o, true};
+}
+
+static struct transcodeResult standardUtf8ToUtf16(const unsigned char *in, size_t length, char16_t *out) {
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	size_t i = 0, o = 0;
+	while(i < length || !mbsinit(&state)) { // the last character can leave a half pair behind
+		// mbrtoc16() doesn't say which character it read, so a peek with
+		// mbrtoc32() (a character boundary of UTF-8 has an empty state)
+		mbstate_t peekState;
+		memset(&peekState, 0, sizeof(peekState));
+		char32_t peek = 0;
+		if(mbsinit(&state) && mbrtoc32(&peek, (const char *) in + i, length - i, &peekState) < (size_t) -3 && peek > 0x10FFFF) {
+			return (struct transcodeResult) {i, o, false};
+		}
+		size_t size = mbrtoc16(&out[o], (const char *) in + i, length - i, &state);
+		if(size == (size_t) -1 || size == (size_t) -2) {
+			return (struct transcodeResult) {i, o, false};
+		}
+		o++;
+		if(size == (size_t) -3) {
+			continue; // the second half of a surrogate pair, from the same bytes as the first
+		}
+		i += size == 0 ? 1 : size;
+	}
+	return (struct transcodeResult) {length, o, true};
+}
+
+static struct transcodeResult standardUtf32ToUtf8(const char32_t *in, size_t length, unsigned char *out) {
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	size_t o = 0;
+	for(size_t i = 0; i < length; i++) {
+		size_t size = in[i] > 0x10FFFF ? (size_t) -1 : c32rtomb((char *) out + o, in[i], &state);
+		if(size == (size_t) -1) {
+			return (struct transcodeResult) {i, o, false};
+		}
+		o += size;
+	}
+	return (struct transcodeResult) {length, o, true};
+}
+
+static struct transcodeResult standardUtf16ToUtf8(const char16_t *in, size_t length, unsigned char *out) {
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	size_t o = 0;
+	for(size_t i = 0; i < length; i++) {
+		size_t size = c16rtomb((char *) out + o, in[i], &state);
+		if(size == (size_t) -1) {
+			// a high surrogate waits in the state, so the error shows up
+			// on the unit after it, but the broken character started before
+			bool waiting = i > 0 && in[i - 1] >= 0xD800 && in[i - 1] <= 0xDBFF;
+			return (struct transcodeResult) {i - waiting, o, false};
+		}
+		o += size;
+	}
+	if(!mbsinit(&state)) {
+		return (struct transcodeResult) {length - 1, o, false}; // it ended with half a pair
+	}
+	return (struct transcodeResult) {length, o, true};
+}
+
+// random text in one of a few "scripts": the mix decides how many bytes
+// the UTF-8 characters take, which is what the speed depends on
+enum textMix {
+	TEXT_ASCII,
+	TEXT_CYRILLIC, // 2 bytes in UTF-8, with ASCII spaces and punctuation
+	TEXT_CHINESE, // 3 bytes
+	TEXT_EMOJI, // 4 bytes, and surrogate pairs in UTF-16
+	TEXT_MIXED, // mostly ASCII with a bit of everything, changing at every character (the worst case for branches)
+};
+
+static const char *textMixNames[] = {"ascii", "cyrillic", "chinese", "emoji", "mixed"};
+
+static char32_t randomCharacter(enum textMix mix, unsigned *seed) {
+	*seed = *seed * 1103515245u + 12345u;
+	unsigned r = *seed >> 8;
+	if(mix == TEXT_MIXED) {
+		unsigned pick = r % 100;
+		mix = pick < 70 ? TEXT_ASCII : pick < 85 ? TEXT_CYRILLIC : pick < 95 ? TEXT_CHINESE : TEXT_EMOJI;
+		r /= 100;
+	}
+	if(mix != TEXT_ASCII && r % 8 == 0) {
+		return ' ';
+	}
+	switch(mix) {
+		case TEXT_ASCII: return 0x20 + r % 95;
+		case TEXT_CYRILLIC: return 0x410 + r % 64;
+		case TEXT_CHINESE: return 0x4E00 + r % 0x5200;
+		default: return 0x1F600 + r % 80;
+	}
+}
+
+// fills "text" with UTF-8 of the given mix until it has "length" bytes
+// (it stops early if the next character doesn't fit), returns how many it used
+static size_t fillUtf8(unsigned char *text, size_t length, enum textMix mix, unsigned seed) {
+	size_t used = 0;
+	while(used + 4 <= length) {
+		used += utf8EncodeOne(randomCharacter(mix, &seed), text + used);
+	}
+	return used;
+}
+
+// compares the bulk conversions with the standard ones on random text, on
+// broken random text and on every classic way UTF-8 can be wrong, and
+// returns how many inputs they disagreed on
+static size_t utfDifferentialTest(unsigned seed, int rounds) {
+	size_t failures = 0;
+	size_t capacity = 4096;
+	unsigned char *text = malloc(capacity);
+	unsigned char *bytesA = malloc(4 * capacity), *bytesB = malloc(4 * capacity);
+	char32_t *wideA = malloc(capacity * sizeof(char32_t)), *wideB = malloc(capacity * sizeof(char32_t));
+	char16_t *halfA = malloc(2 * capacity * sizeof(char16_t)), *halfB = malloc(2 * capacity * sizeof(char16_t));
+	if(text == NULL || bytesA == NULL || bytesB == NULL || wideA == NULL || wideB == NULL || halfA == NULL || halfB == NULL) {
+		printf("couldn't allocate the buffers\n");
+		failures = 1;
+		goto done;
+	}
+	bool same(struct transcodeResult a, struct transcodeResult b, const void *outA, const void *outB, size_t unit) {
+		return a.valid == b.valid && a.read == b.read && a.written == b.written && memcmp(outA, outB, a.written * unit) == 0;
+	}
+	void check(const unsigned char *input, size_t length, const char *what) {
+		bool ok = same(utf8ToUtf32(input, length, wideA), standardUtf8ToUtf32(input, length, wideB), wideA, wideB, sizeof(char32_t))
+			&& same(utf8ToUtf16(input, length, halfA), standardUtf8ToUtf16(input, length, halfB), halfA, halfB, sizeof(char16_t));
+		// and back from whatever part of it was valid
+		struct transcodeResult wide = utf8ToUtf32(input, length, wideA);
+		struct transcodeResult half = utf8ToUtf16(input, length, halfA);
+		ok = ok && same(utf32ToUtf8(wideA, wide.written, bytesA), standardUtf32ToUtf8(wideA, wide.written, bytesB), bytesA, bytesB, 1)
+			&& same(utf16ToUtf8(halfA, half.written, bytesA), standardUtf16ToUtf8(halfA, half.written, bytesB), bytesA, bytesB, 1)
+			&& memcmp(bytesA, input, wide.read) == 0;
+		if(!ok && failures++ < 5) {
+			printf("  %s (%zu bytes) converted differently\n", what, length);
+		}
+	}
+
+	// the classics, alone and in the middle of some ASCII (so the blocks see them too)
+	const char *adversarial[] = {
+		"\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF", // overlong
+		"\xED\xA0\x80", "\xED\xBF\xBF", "\xED\x9F\xBF", // surrogates (and the last one before them)
+		"\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF", "\xFE", "\xF4\x8F\xBF\xBF", // past U+10FFFF (and the last one)
+		"\xE2\x82", "\xF0\x9F\x98", "\xC3", "\x80", "\xBF\xBF", "\xE2\x82\xAC\x80", // cut short, stray continuations
+		"\xE2\x28\xA1", "\xC3\x28", "\xF0\x28\x8C\xBC", "\xEF\xBF\xBF", "\xF0\x90\x80\x80", "\x7F\xC2\x80",
+	};
+	for(size_t a = 0; a < sizeof(adversarial) / sizeof(adversarial[0]); a++) {
+		size_t length = strlen(adversarial[a]);
+		check((const unsigned char *) adversarial[a], length, adversarial[a]);
+		for(size_t offset = 0; offset < 40; offset++) {
+			memset(text, 'a', 64);
+			memcpy(text + offset, adversarial[a], length);
+			check(text, offset + length + (offset % 3) * 7, "an adversarial sequence in ASCII");
+		}
+	}
+	// random text of every mix, then the same text with a few bytes broken
+	for(int round = 0; round < rounds; round++) {
+		seed = seed * 1103515245u + 12345u;
+		size_t length = fillUtf8(text, 1 + (seed >> 8) % (capacity - 1), (enum textMix) (round % 5), seed);
+		check(text, length, textMixNames[round % 5]);
+		for(int broken = 0; broken < 1 + round % 3; broken++) {
+			seed = seed * 1103515245u + 12345u;
+			if(length > 0) {
+				text[(seed >> 8) % length] = (unsigned char) (seed >> 4);
+			}
+		}
+		check(text, length, "broken random text");
+		// and random bytes, which are almost never valid past the first few
+		for(size_t i = 0; i < 64; i++) {
+			seed = seed * 1103515245u + 12345u;
+			text[i] = (unsigned char) (seed >> 16);
+		}
+		check(text, 64, "random bytes");
+	}
+	// UTF-16 and UTF-32 with broken surrogates and values out of range
+	const char16_t badHalves[][3] = {{0xD800, 'a', 0}, {0xDC00, 'a', 0}, {'a', 0xDBFF, 0}, {0xD83D, 0xDE00, 0xDE00}};
+	for(size_t b = 0; b < sizeof(badHalves) / sizeof(badHalves[0]); b++) {
+		if(!same(utf16ToUtf8(badHalves[b], 3, bytesA), standardUtf16ToUtf8(badHalves[b], 3, bytesB), bytesA, bytesB, 1)
+			&& failures++ < 5) {
+			printf("  broken UTF-16 number %zu converted differently\n", b);
+		}
+	}
+	const char32_t badWides[][2] = {{'a', 0xD800}, {0xDFFF, 'a'}, {0x110000, 'a'}, {'a', 0xFFFFFFFF}, {0x10FFFF, 0xFFFD}};
+	for(size_t b = 0; b < sizeof(badWides) / sizeof(badWides[0]); b++) {
+		if(!same(utf32ToUtf8(badWides[b], 2, bytesA), standardUtf32ToUtf8(badWides[b], 2, bytesB), bytesA, bytesB, 1)
+			&& failures++ < 5) {
+			printf("  broken UTF-32 number %zu converted differently\n", b);
+		}
+	}
+
+done:
+	free(text);
+	free(bytesA);
+	free(bytesB);
+	free(wideA);
+	free(wideB);
+	free(halfA);
+	free(halfB);
+	return failures;
+}
+
+// the standard functions only speak UTF-8 in a UTF-8 locale, so the tests
+// switch to one and back
+static char *useUtf8Locale() {
+	const char *current = setlocale(LC_CTYPE, NULL);
+	char *saved = current != NULL ? strdup(current) : NULL;
+	if(setlocale(LC_CTYPE, "C.UTF-8") == NULL && setlocale(LC_CTYPE, "en_US.UTF-8") == NULL) {
+		free(saved);
+		return NULL;
+	}
+	return saved;
+}
+
+static void restoreLocale(char *saved) {
+	if(saved != NULL) {
+		setlocale(LC_CTYPE, saved);
+		free(saved);
+	}
+}
+
+void testUcharH() {
+	// this header has char16_t and char32_t, for UTF-16 and UTF-32 units,
+	// and the functions to convert between them and the multibyte strings
+	// of the current locale (UTF-8 here), one character per call
+	char *savedLocale = useUtf8Locale();
+	if(savedLocale == NULL) {
+		printf("there's no UTF-8 locale here\n");
+		return;
+	}
+	const char *text = "h\xC3\xA9llo \xE2\x82\xAC \xF0\x9F\x98\x80"; // "héllo € 😀"
+	size_t length = strlen(text);
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	printf("\n\n\"%s\" in UTF-32:", text);
+	for(size_t i = 0; i < length;) {
+		char32_t c;
+		size_t size = mbrtoc32(&c, text + i, length - i, &state);
+		if(size == (size_t) -1 || size == (size_t) -2) {
+			break;
+		}
+		printf(" U+%04X", (unsigned) c);
+		i += size;
+	}
+	printf("\nand in UTF-16:");
+	memset(&state, 0, sizeof(state));
+	char16_t units[32];
+	size_t count = 0;
+	for(size_t i = 0; i < length || !mbsinit(&state);) {
+		size_t size = mbrtoc16(&units[count], text + i, length - i, &state);
+		if(size == (size_t) -1 || size == (size_t) -2) {
+			break;
+		}
+		printf(" %04X", (unsigned) units[count++]);
+		// -3 means "here is the second half of the surrogate pair", no bytes read
+		i += size == (size_t) -3 ? 0 : size;
+	}
+	// and back with c16rtomb(), which keeps the first half of a pair in the state
+	char back[64];
+	size_t written = 0;
+	memset(&state, 0, sizeof(state));
+	for(size_t u = 0; u < count; u++) {
+		written += c16rtomb(back + written, units[u], &state);
+	}
+	back[written] = '\0';
+	printf("\nand back to UTF-8: \"%s\"\n", back);
+
+	// the same with the bulk functions (see BULK UTF-8, UTF-16 AND UTF-32 above)
+	char32_t wide[32];
+	struct transcodeResult result = utf8ToUtf32((const unsigned char *) text, length, wide);
+	printf("utf8ToUtf32: %zu bytes became %zu characters\n", result.read, result.written);
+	const char *broken = "ok \xE0\x80\xAF overlong";
+	result = utf8ToUtf32((const unsigned char *) broken, strlen(broken), wide);
+	printf("\"ok \\xE0\\x80\\xAF overlong\" is %s, the problem starts at byte %zu\n",
+		result.valid ? "valid" : "not valid", result.read);
+
+	size_t failures = utfDifferentialTest(7, 500);
+	printf("bulk against the standard functions: %s (%zu differences)\n", failures == 0 ? "ok" : "FAILED", failures);
+	restoreLocale(savedLocale);
+}
+
+
+
+void benchUcharH() {
+	// gigabytes of UTF-8 per second (the UTF-8 side is counted both ways so
+	// the columns compare) for each mix, the standard way and the bulk way
+	char *savedLocale = useUtf8Locale();
+	if(savedLocale == NULL) {
+		printf("there's no UTF-8 locale here\n");
+		return;
+	}
+	size_t failures = utfDifferentialTest(11, 2000);
+	printf("bulk against the standard functions: %s (%zu differences)\n", failures == 0 ? "ok" : "FAILED", failures);
+	printf("ssse3 validation: %s\n\n", utf8HasSsse3() ? "yes" : "no, one character at a time");
+
+	size_t capacity = 1 << 20;
+	unsigned char *text = malloc(capacity);
+	unsigned char *bytes = malloc(4 * capacity);
+	char32_t *wide = malloc(capacity * sizeof(char32_t));
+	char16_t *half = malloc(capacity * sizeof(char16_t));
+	if(text == NULL || bytes == NULL || wide == NULL || half == NULL) {
+		printf("couldn't allocate the buffers\n");
+		goto done;
+	}
+
+	// the best of a few runs
+	#define UCHAR_MEASURE(code) ({ \
+		uint64_t best = UINT64_MAX; \
+		for(int r = 0; r < 5; r++) { \
+			uint64_t start = monotonicNs(); \
+			struct transcodeResult result = code; \
+			benchKeep(result.written); \
+			uint64_t ns = monotonicNs() - start; \
+			best = ns < best ? ns : best; \
+		} \
+		(double) length / best; \
+	})
+
+	printf("%-9s %9s %9s %9s %9s %9s %9s %9s %9s %9s   (GB/s of UTF-8)\n", "", "validate", "mbrtoc32", "to32",
+		"mbrtoc16", "to16", "c32rtomb", "from32", "c16rtomb", "from16");
+	for(int mix = TEXT_ASCII; mix <= TEXT_MIXED; mix++) {
+		size_t length = fillUtf8(text, capacity, (enum textMix) mix, 5);
+		size_t wideLength = utf8ToUtf32(text, length, wide).written;
+		size_t halfLength = utf8ToUtf16(text, length, half).written;
+		printf("%-9s", textMixNames[mix]);
+		printf(" %9.2f", UCHAR_MEASURE(((struct transcodeResult) {utf8ValidPrefix(text, length), 0, true})));
+		printf(" %9.2f", UCHAR_MEASURE(standardUtf8ToUtf32(text, length, wide)));
+		printf(" %9.2f", UCHAR_MEASURE(utf8ToUtf32(text, length, wide)));
+		printf(" %9.2f", UCHAR_MEASURE(standardUtf8ToUtf16(text, length, half)));
+		printf(" %9.2f", UCHAR_MEASURE(utf8ToUtf16(text, length, half)));
+		printf(" %9.2f", UCHAR_MEASURE(standardUtf32ToUtf8(wide, wideLength, bytes)));
+		printf(" %9.2f", UCHAR_MEASURE(utf32ToUtf8(wide, wideLength, bytes)));
+		printf(" %9.2f", UCHAR_MEASURE(standardUtf16ToUtf8(half, halfLength, bytes)));
+		printf(" %9.2f\n", UCHAR_MEASURE(utf16ToUtf8(half, halfLength, bytes)));
+	}
+	#undef UCHAR_MEASURE
+
+done:
+	free(text);
+	free(bytes);
+	free(wide);
+	free(half);
+	restoreLocale(savedLocale);
+}
 
-	printf("\n\n%c is %d/%d\n", atomChar, atomInt, atomInt);
 
-	// atomically stores a value in an atomic variable
-	atomic_store(&atomInt, 20);
-	printf("%c is %d/%d\n", atomChar, atomInt, atomInt);
-	// atomically reads the value of an atomic variable
-	int x = atomic_load(&atomInt);
-	printf("%d\n", x);
 
-	// these functions offered by this header alse have an "explicit"
-	// version each, which accepts an extra argument that is "memory_order".
-	// Memory orders define how an operation should be sincronyzed with the others,
-	// and these are the options:
-	// - memory_order_relaxed: No synchronization or ordering constraints
-	// - memory_order_acquire: Ensures that subsequent operations are not moved before this one
-	// - memory_order_release: Ensures that previous operations are not moved after this one
-	// - memory_order_acq_rel: Combines acquire and release semantics
-	// - memory_order_seq_cst: Sequential consistency, ensuring a total order of all operations
+// WIDE STRINGS, A VECTOR AT A TIME
+// the same tricks as the byte kernels in string.h, but a wchar_t is 4 bytes
+// here (a whole UTF-32 code point), so a vector holds 4 or 8 characters:
+// _mm_cmpeq_epi32 compares them, and the byte mask from movemask has 4 bits
+// per character, so the position of a match is its trailing zeros / 4.
+// the loads never cross into a page the string doesn't touch (aligned loads,
+// or crossesPage() before the unaligned ones), same as before
 
-	// you can also create atomic boolean flags
-	atomic_flag flag = ATOMIC_FLAG_INIT;
-	// and then activate the flag and clear it
-	if (!atomic_flag_test_and_set(&flag)) {
-    	printf("we got the flag\n");
+static size_t wcslenScalar(const wchar_t *s) {
+	size_t n = 0;
+	while(s[n] != L'\0') {
+		n++;
 	}
-	atomic_flag_clear(&flag);
-	printf("we cleared the flag\n");
+	return n;
 }
 
+static int wcscmpScalar(const wchar_t *a, const wchar_t *b) {
+	for(size_t i = 0;; i++) {
+		if(a[i] != b[i] || a[i] == L'\0') {
+			return a[i] < b[i] ? -1 : a[i] > b[i];
+		}
+	}
+}
 
+static const wchar_t *wmemchrScalar(const wchar_t *s, wchar_t c, size_t n) {
+	for(size_t i = 0; i < n; i++) {
+		if(s[i] == c) return s + i;
+	}
+	return NULL;
+}
 
-void testStdBoolH(){
-	// this tiny header just creates the bool keyword and the
-	// true and false macros
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((no_sanitize_address))
+static size_t wcslenSse2(const wchar_t *s) {
+	if((uintptr_t) s & (sizeof(wchar_t) - 1)) {
+		return wcslenScalar(s); // not even aligned to its own type, the vectors would split characters
+	}
+	const __m128i zero = _mm_setzero_si128();
+	uintptr_t misalign = (uintptr_t) s & 15;
+	const char *block = (const char *) s - misalign;
+	unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_load_si128((const __m128i *) block), zero)) >> misalign;
+	if(mask) {
+		return __builtin_ctz(mask) / sizeof(wchar_t);
+	}
+	for(block += 16;; block += 16) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_load_si128((const __m128i *) block), zero));
+		if(mask) {
+			return (block - (const char *) s + __builtin_ctz(mask)) / sizeof(wchar_t);
+		}
+	}
+}
 
-	bool falseValue = false;
-	bool trueValue = true;
+__attribute__((no_sanitize_address))
+static int wcscmpSse2(const wchar_t *a, const wchar_t *b) {
+	const __m128i zero = _mm_setzero_si128();
+	for(size_t i = 0;; i += 4) {
+		if(crossesPage(a + i, 16) || crossesPage(b + i, 16)) {
+			for(size_t end = i + 4; i < end; i++) {
+				if(a[i] != b[i] || a[i] == L'\0') return a[i] < b[i] ? -1 : a[i] > b[i];
+			}
+			i -= 4;
+			continue;
+		}
+		__m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+		unsigned differ = ~_mm_movemask_epi8(_mm_cmpeq_epi32(x, y)) & 0xFFFF;
+		unsigned ends = _mm_movemask_epi8(_mm_cmpeq_epi32(x, zero));
+		if(differ | ends) {
+			size_t k = i + __builtin_ctz(differ | ends) / sizeof(wchar_t);
+			return a[k] < b[k] ? -1 : a[k] > b[k];
+		}
+	}
+}
 
-	if(falseValue) {
-		printf("\n\nthis should not be printed\n");
-	} else if(trueValue) {
-		printf("\n\nand this should be printed\n");
+static const wchar_t *wmemchrSse2(const wchar_t *s, wchar_t c, size_t n) {
+	const __m128i pattern = _mm_set1_epi32(c);
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (s + i)), pattern));
+		if(mask) return s + i + __builtin_ctz(mask) / sizeof(wchar_t);
 	}
+	return wmemchrScalar(s + i, c, n - i);
 }
 
+__attribute__((no_sanitize_address, target("avx2")))
+static size_t wcslenAvx2(const wchar_t *s) {
+	if((uintptr_t) s & (sizeof(wchar_t) - 1)) {
+		return wcslenScalar(s);
+	}
+	const __m256i zero = _mm256_setzero_si256();
+	uintptr_t misalign = (uintptr_t) s & 31;
+	const char *block = (const char *) s - misalign;
+	unsigned mask = (unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *) block), zero)) >> misalign;
+	if(mask) {
+		return __builtin_ctz(mask) / sizeof(wchar_t);
+	}
+	for(block += 32;; block += 32) {
+		mask = _mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_load_si256((const __m256i *) block), zero));
+		if(mask) {
+			return (block - (const char *) s + __builtin_ctz(mask)) / sizeof(wchar_t);
+		}
+	}
+}
 
+__attribute__((no_sanitize_address, target("avx2")))
+static int wcscmpAvx2(const wchar_t *a, const wchar_t *b) {
+	const __m256i zero = _mm256_setzero_si256();
+	for(size_t i = 0;; i += 8) {
+		if(crossesPage(a + i, 32) || crossesPage(b + i, 32)) {
+			for(size_t end = i + 8; i < end; i++) {
+				if(a[i] != b[i] || a[i] == L'\0') return a[i] < b[i] ? -1 : a[i] > b[i];
+			}
+			i -= 8;
+			continue;
+		}
+		__m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+		unsigned differ = ~(unsigned) _mm256_movemask_epi8(_mm256_cmpeq_epi32(x, y));
+		unsigned ends = _mm256_movemask_epi8(_mm256_cmpeq_epi32(x, zero));
+		if(differ | ends) {
+			size_t k = i + __builtin_ctz(differ | ends) / sizeof(wchar_t);
+			return a[k] < b[k] ? -1 : a[k] > b[k];
+		}
+	}
+}
 
-void testStdDefH() {
-	// the most usefull things defined in this header
-	// are the NULL macro and the offsetof() function, I would say
+__attribute__((target("avx2")))
+static const wchar_t *wmemchrAvx2(const wchar_t *s, wchar_t c, size_t n) {
+	const __m256i pattern = _mm256_set1_epi32(c);
+	size_t i = 0;
+	for(; i + 16 <= n; i += 16) {
+		__m256i low = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (s + i)), pattern);
+		__m256i high = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (s + i + 8)), pattern);
+		if(_mm256_movemask_epi8(_mm256_or_si256(low, high))) {
+			uint64_t lowMask = (uint32_t) _mm256_movemask_epi8(low);
+			uint64_t highMask = (uint32_t) _mm256_movemask_epi8(high);
+			return s + i + __builtin_ctzll(lowMask | highMask << 32) / sizeof(wchar_t);
+		}
+	}
+	for(; i < n; i++) {
+		if(s[i] == c) return s + i;
+	}
+	return NULL;
+}
+#endif
+
+static size_t wcslenLibc(const wchar_t *s) { return wcslen(s); }
+static int wcscmpLibc(const wchar_t *a, const wchar_t *b) { return wcscmp(a, b); }
+static const wchar_t *wmemchrLibc(const wchar_t *s, wchar_t c, size_t n) { return wmemchr(s, c, n); }
+
+struct wideStringKernels {
+	const char *name;
+	size_t (*length)(const wchar_t *s);
+	int (*compare)(const wchar_t *a, const wchar_t *b);
+	const wchar_t *(*find)(const wchar_t *s, wchar_t c, size_t n);
+};
+
+static const struct wideStringKernels wideStringKernelSets[] = {
+	{"libc", wcslenLibc, wcscmpLibc, wmemchrLibc},
+	{"scalar", wcslenScalar, wcscmpScalar, wmemchrScalar},
+#if defined(__x86_64__) || defined(__i386__)
+	{"sse2", wcslenSse2, wcscmpSse2, wmemchrSse2},
+	{"avx2", wcslenAvx2, wcscmpAvx2, wmemchrAvx2},
+#endif
+};
+#define WIDE_STRING_KERNEL_SETS (sizeof(wideStringKernelSets) / sizeof(wideStringKernelSets[0]))
+
+static bool wideStringKernelsSupported(const struct wideStringKernels *set) {
+#if defined(__x86_64__) || defined(__i386__)
+	if(strcmp(set->name, "avx2") == 0) {
+		return __builtin_cpu_supports("avx2");
+	}
+#endif
+	return true;
+}
 
-	// NULL is a null pointer
-	int *a = NULL;
-	printf("\n\nnull pointer: %p\n", a);
+// runs every set on the same strings, at every alignment and length up to a
+// few vectors and with the end right before an unmapped page, and returns
+// how many answers were different from libc (only the sign of a comparison counts)
+static size_t wideStringKernelsTest() {
+	size_t failures = 0;
+	long pageSize = sysconf(_SC_PAGESIZE);
+	// two pages, the second one made unreadable
+	unsigned char *pages = mmap(NULL, 2 * pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(pages == MAP_FAILED) {
+		return 1;
+	}
+	mprotect(pages + pageSize, pageSize, PROT_NONE);
+	wchar_t other[80];
+	for(size_t set = 1; set < WIDE_STRING_KERNEL_SETS; set++) {
+		const struct wideStringKernels *kernels = &wideStringKernelSets[set];
+		if(!wideStringKernelsSupported(kernels)) {
+			continue;
+		}
+		for(size_t length = 0; length < 70; length++) {
+			for(int placement = 0; placement < 16; placement++) {
+				// 8 starting points at the beginning of the page and 8 that end right at its end
+				size_t offset = placement < 8 ? placement * sizeof(wchar_t)
+					: pageSize - (length + 1 + placement - 8) * sizeof(wchar_t);
+				wchar_t *s = (wchar_t *) (pages + offset);
+				for(size_t i = 0; i < length; i++) {
+					s[i] = (wchar_t) (0x41 + i % 23 + (i % 5 == 0 ? 0x4E00 : 0));
+				}
+				s[length] = L'\0';
+				wmemcpy(other, s, length + 1);
+				bool ok = kernels->length(s) == length && kernels->compare(s, other) == 0;
+				if(length > 0) {
+					other[length - 1]++;
+					ok = ok && kernels->compare(s, other) < 0 && kernels->compare(other, s) > 0;
+					other[length - 1] = -5; // wchar_t is signed here, negative ones sort first
+					ok = ok && (kernels->compare(s, other) > 0) == (wcscmp(s, other) > 0);
+					ok = ok && kernels->find(s, s[length - 1], length) == wmemchr(s, s[length - 1], length)
+						&& kernels->find(s, 0x10FFFF, length) == NULL;
+				}
+				if(!ok && failures++ < 5) {
+					printf("  %s: %zu characters at offset %zu went wrong\n", kernels->name, length, offset);
+				}
+			}
+		}
+	}
+	munmap(pages, 2 * pageSize);
+	return failures;
+}
 
-	// using the offsetof() function we can get the offset in bytes
-	// between the beggining of a struct and one of its properties (including paddings)
-	struct cat {
-		char *name;
-		short int age;
-		char *color;
-	};
+// STREAMING MULTIBYTE TO WIDE CONVERSION
+// mbstowcs() wants the whole string in memory and a wide buffer 4 times
+// its size. reading a file of a few GB that way takes many GB of memory,
+// but a character cut in half at the end of one chunk can't be converted
+// until the next chunk arrives. that's what mbstate_t is for: mbsnrtowcs()
+// converts a chunk and leaves the bytes of a cut character in the state,
+// so the next call picks up from there. when the locale is UTF-8 (and
+// wchar_t is UTF-32, which __STDC_ISO_10646__ promises) the bulk decoder
+// from BULK UTF-8, UTF-16 AND UTF-32 does the same much faster, with
+// the cut character kept in a little carry buffer instead
+
+struct wideStream {
+	mbstate_t state; // the locale's way
+	bool utf8; // or our way, with the carry
+	unsigned char carry[4];
+	size_t carryLength;
+	uint64_t bytesIn;
+	uint64_t charactersOut;
+};
+
+static void wideStreamInit(struct wideStream *stream, bool useUtf8) {
+	memset(stream, 0, sizeof(*stream));
+#ifdef __STDC_ISO_10646__
+	const char *codeset = nl_langinfo(CODESET);
+	stream->utf8 = useUtf8 && sizeof(wchar_t) == sizeof(char32_t) && strcmp(codeset, "UTF-8") == 0;
+#else
+	(void) useUtf8;
+#endif
+}
 
-	printf("the name is at offset %ld\n", offsetof(struct cat, name));
-	printf("the age is at offset %ld\n", offsetof(struct cat, age));
-	printf("the color is at offset %ld\n", offsetof(struct cat, color));
+// how long a UTF-8 character is from its first byte (1 for bytes that
+// can't start one, the decoder will complain about those)
+static int utf8LengthFromLead(unsigned char lead) {
+	return lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
 }
 
+// converts one chunk into "out", which needs room for length + 1 wide
+// characters. returns how many it wrote, or -1 if the input isn't valid
+// (or, when "last" is true, if it ends in the middle of a character)
+static long wideStreamFeed(struct wideStream *stream, const char *chunk, size_t length, wchar_t *out, bool last) {
+	size_t written = 0;
+	stream->bytesIn += length;
+	if(!stream->utf8) {
+		const char *source = chunk;
+		size_t converted = mbsnrtowcs(out, &source, length, length + 1, &stream->state);
+		if(converted == (size_t) -1 || (last && !mbsinit(&stream->state))) {
+			return -1;
+		}
+		stream->charactersOut += converted;
+		return (long) converted;
+	}
+	const unsigned char *bytes = (const unsigned char *) chunk;
+	// first finish the character the last chunk cut
+	if(stream->carryLength > 0) {
+		size_t need = utf8LengthFromLead(stream->carry[0]) - stream->carryLength;
+		size_t take = need < length ? need : length;
+		memcpy(stream->carry + stream->carryLength, bytes, take);
+		stream->carryLength += take;
+		bytes += take;
+		length -= take;
+		if(take < need) {
+			return last ? -1 : 0; // a tiny chunk, still not the whole character
+		}
+		char32_t c;
+		if(utf8DecodeOne(stream->carry, stream->carryLength, &c) != (int) stream->carryLength) {
+			return -1;
+		}
+		out[written++] = (wchar_t) c;
+		stream->carryLength = 0;
+	}
+	// then keep the character this chunk cuts for the next one
+	if(length > 0 && !last) {
+		size_t start = utf8CharacterStart(bytes, length - 1);
+		if(start + utf8LengthFromLead(bytes[start]) > length && length - start < 4) {
+			stream->carryLength = length - start;
+			memcpy(stream->carry, bytes + start, stream->carryLength);
+			length = start;
+		}
+	}
+	// wchar_t and char32_t are both 4 byte code points here
+	struct transcodeResult result = utf8ToUtf32(bytes, length, (char32_t *) (out + written));
+	if(!result.valid) {
+		return -1;
+	}
+	written += result.written;
+	stream->charactersOut += written;
+	return (long) written;
+}
 
 
-void testStdIntH() {
-	// in this header many integer types and macros related to ints are defined
 
-	// defining ints of diferent sizes
-	int8_t int8 = 8;
-	int16_t int16 = 16;
-	int32_t int32 = 32;
-	int64_t int64 = 64;
+void testWcharH() {
+	// wchar.h is string.h and stdio.h again, for wide characters (wchar_t,
+	// 4 bytes and UTF-32 on Linux, 2 bytes and UTF-16 on Windows), plus the
+	// conversions from and to the multibyte strings of the locale
+	char *savedLocale = useUtf8Locale();
+	if(savedLocale == NULL) {
+		printf("there's no UTF-8 locale here\n");
+		return;
+	}
+	const wchar_t *greeting = L"Olá, 世界!";
+	printf("\n\nwcslen(L\"%ls\") = %zu characters (strlen of the UTF-8 is %zu bytes)\n", greeting, wcslen(greeting),
+		strlen("Olá, 世界!"));
+	printf("wcscmp(L\"abc\", L\"abd\") = %d, wmemchr() finds 世 at index %td\n", wcscmp(L"abc", L"abd"),
+		wmemchr(greeting, L'世', wcslen(greeting)) - greeting);
+
+	// mbsrtowcs() and wcsrtombs() convert whole strings, and move the source
+	// pointer to where they stopped (NULL when they reached the end)
+	const char *multibyte = "ça, €10";
+	wchar_t wide[32];
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	size_t count = mbsrtowcs(wide, &multibyte, 32, &state);
+	printf("mbsrtowcs(\"ça, €10\") = %zu wide characters, the source is now %s\n", count, multibyte == NULL ? "NULL" : multibyte);
+	char back[64];
+	const wchar_t *source = wide;
+	memset(&state, 0, sizeof(state));
+	count = wcsrtombs(back, &source, sizeof(back), &state);
+	printf("wcsrtombs() back = %zu bytes: \"%s\"\n", count, back);
+	// with a NULL destination they only count, to size the buffer first
+	multibyte = "\xE2\x82\xAC\xFF";
+	memset(&state, 0, sizeof(state));
+	count = mbsrtowcs(NULL, &multibyte, 0, &state);
+	printf("mbsrtowcs() of a broken string returns %zd (errno says %s)\n", (ssize_t) count, strerror(errno));
+
+	// the vector kernels against libc
+	size_t failures = wideStringKernelsTest();
+	printf("wide string kernels against libc: %s (%zu failed)\n", failures == 0 ? "ok" : "FAILED", failures);
+
+	// the stream, in chunks of 1 to 7 bytes so every character gets cut somewhere
+	const char *text = "mixed: Ελληνικά, 中文, emoji 😀😃 and ascii";
+	size_t length = strlen(text);
+	for(int way = 0; way < 2; way++) {
+		struct wideStream stream;
+		wideStreamInit(&stream, way == 1);
+		wchar_t out[128];
+		size_t written = 0;
+		bool ok = true;
+		for(size_t i = 0, chunk = 1; i < length && ok; i += chunk, chunk = chunk % 7 + 1) {
+			size_t part = length - i < chunk ? length - i : chunk;
+			long got = wideStreamFeed(&stream, text + i, part, out + written, i + part == length);
+			ok = got >= 0;
+			written += ok ? (size_t) got : 0;
+		}
+		out[written] = L'\0';
+		printf("streamed in tiny chunks (%s): \"%ls\" %s\n", stream.utf8 ? "bulk UTF-8" : "mbsnrtowcs",
+			out, ok && written == wcslen(L"mixed: Ελληνικά, 中文, emoji 😀😃 and ascii") ? "ok" : "FAILED");
+	}
+	restoreLocale(savedLocale);
+}
 
-	printf("\n\nsize of int8_t: %ld bytes\n", sizeof(int8));
-	printf("size of int16_t: %ld bytes\n", sizeof(int16));
-	printf("size of int32_t: %ld bytes\n", sizeof(int32));
-	printf("size of int64_t: %ld bytes\n", sizeof(int64));
 
-	// the int type with the maximum width
-	intmax_t intmax = 10000;
-	printf("size of intmax_t: %ld bytes\n", sizeof(intmax));
-	// an int type that can hold a pointer
-	intptr_t intptr = (intptr_t) &int8;
-	printf("size of intptr_t: %ld bytes\n", sizeof(intptr));
-	printf("memory location being hold: %lx\n", intptr);
 
-	// and here are some macros defining the minimum and
-	// maximum values of those int types, just like in limits.h
-	printf("int8 min and max: %d, %d\n", INT8_MIN, INT8_MAX);
-	printf("int16 min and max: %d, %d\n", INT16_MIN, INT16_MAX);
-	printf("int32 min and max: %d, %d\n", INT32_MIN, INT32_MAX);
-	printf("int64 min and max: %ld, %ld\n", INT64_MIN, INT64_MAX);
-}
+void benchWcharH() {
+	// first the kernels on a 4 MiB wide string (the whole thing is read: the
+	// compare is against an equal copy and the search doesn't find anything)
+	char *savedLocale = useUtf8Locale();
+	if(savedLocale == NULL) {
+		printf("there's no UTF-8 locale here\n");
+		return;
+	}
+	size_t failures = wideStringKernelsTest();
+	printf("wide string kernels against libc: %s (%zu failed)\n\n", failures == 0 ? "ok" : "FAILED", failures);
+	size_t n = 1 << 20;
+	wchar_t *a = malloc((n + 1) * sizeof(wchar_t));
+	wchar_t *b = malloc((n + 1) * sizeof(wchar_t));
+	size_t patternSize = 1 << 20;
+	unsigned char *pattern = malloc(patternSize);
+	size_t chunkSize = (64 << 10) + 1; // odd, so the chunks cut characters everywhere
+	wchar_t *out = malloc((chunkSize + 1) * sizeof(wchar_t));
+	if(a == NULL || b == NULL || pattern == NULL || out == NULL) {
+		printf("couldn't allocate the buffers\n");
+		goto done;
+	}
+	unsigned seed = 1;
+	for(size_t i = 0; i < n; i++) {
+		a[i] = (wchar_t) randomCharacter(TEXT_MIXED, &seed);
+	}
+	a[n] = L'\0';
+	wmemcpy(b, a, n + 1);
+
+	// the best of a few runs, in GB/s of the wide string
+	#define WCHAR_MEASURE(code) ({ \
+		uint64_t best = UINT64_MAX; \
+		for(int r = 0; r < 5; r++) { \
+			uint64_t start = monotonicNs(); \
+			benchKeep(code); \
+			uint64_t ns = monotonicNs() - start; \
+			best = ns < best ? ns : best; \
+		} \
+		(double) n * sizeof(wchar_t) / best; \
+	})
+	printf("%-8s %10s %10s %10s   (GB/s)\n", "", "wcslen", "wcscmp", "wmemchr");
+	for(size_t set = 0; set < WIDE_STRING_KERNEL_SETS; set++) {
+		const struct wideStringKernels *kernels = &wideStringKernelSets[set];
+		if(!wideStringKernelsSupported(kernels)) {
+			continue;
+		}
+		printf("%-8s", kernels->name);
+		printf(" %10.2f", WCHAR_MEASURE(kernels->length(a)));
+		printf(" %10.2f", WCHAR_MEASURE(kernels->compare(a, b)));
+		printf(" %10.2f\n", WCHAR_MEASURE(kernels->find(a, 0x10FFFF, n)));
+	}
+	#undef WCHAR_MEASURE
+
+	// then the conversion of inputs up to -s MiB of UTF-8, made up on the fly
+	// from a 1 MiB pattern of words in all the scripts (mostly ASCII, like a
+	// web page). mbstowcs() needs the whole input and 4 times that for the
+	// output, so it only runs while that fits in -s
+	size_t patternLength = 0;
+	while(patternLength + 64 <= patternSize) {
+		seed = seed * 1103515245u + 12345u;
+		unsigned pick = (seed >> 8) % 100;
+		enum textMix mix = pick < 70 ? TEXT_ASCII : pick < 85 ? TEXT_CYRILLIC : pick < 95 ? TEXT_CHINESE : TEXT_EMOJI;
+		patternLength += fillUtf8(pattern + patternLength, 8 + (seed >> 16) % 56, mix, seed);
+	}
+	printf("\n%10s  %-22s %8s %10s\n", "input", "method", "GB/s", "peak MiB");
+	uint64_t maxSize = (uint64_t) benchMaxMiB << 20;
+	for(uint64_t size = 16 << 20; size <= maxSize; size = nextSizeStep(size, maxSize, 4)) {
+		for(int method = 0; method < 3; method++) {
+			const char *name = (const char *[]) {"mbstowcs(), all of it", "stream, mbsnrtowcs()", "stream, bulk UTF-8"}[method];
+			if(method == 0 && size * 5 > maxSize) {
+				printf("%10" PRIu64 "M %-22s %8s %10s\n", size >> 20, name, "-", "(over -s)");
+				continue;
+			}
+			resetPeakResident();
+			uint64_t start = monotonicNs();
+			bool ok = true;
+			if(method == 0) {
+				char *whole = malloc(size + 1);
+				wchar_t *wide = malloc((size + 1) * sizeof(wchar_t));
+				ok = whole != NULL && wide != NULL;
+				for(uint64_t filled = 0; ok && filled < size;) {
+					size_t part = size - filled < patternLength ? size - filled : patternLength;
+					memcpy(whole + filled, pattern, part);
+					filled += part;
+				}
+				if(ok) {
+					// don't end in the middle of a character
+					whole[utf8CharacterStart((const unsigned char *) whole, size - 1)] = '\0';
+					ok = mbstowcs(wide, whole, size + 1) != (size_t) -1;
+					benchKeep(wide);
+				}
+				free(whole);
+				free(wide);
+			} else {
+				struct wideStream stream;
+				wideStreamInit(&stream, method == 2);
+				for(uint64_t done = 0; ok && done < size;) {
+					size_t at = done % patternLength;
+					size_t part = chunkSize;
+					part = part < patternLength - at ? part : patternLength - at;
+					part = part < size - done ? part : size - done;
+					done += part;
+					// the last chunk may cut a character, that's an error only at the very end
+					ok = wideStreamFeed(&stream, (const char *) pattern + at, part, out, false) >= 0;
+					benchKeep(out);
+				}
+			}
+			uint64_t ns = monotonicNs() - start;
+			printf("%10" PRIu64 "M %-22s %8.2f %10.1f%s\n", size >> 20, name, (double) size / ns,
+				peakResidentKiB() / 1024.0, ok ? "" : " FAILED");
+		}
+	}
 
+done:
+	free(a);
+	free(b);
+	free(pattern);
+	free(out);
+	restoreLocale(savedLocale);
+}
 
 
-void testStdIOH() {
-	// this is one of the most important headers, because it allows us
-	// to interact with the FILE type, and that includes the standard input
-	// and standard output streams (usually the terminal)
 
-	// printing and reading from the standard IO
-	char input[100];
-	printf("\n\ngive me some text: ");
-	scanf("%99s", input); // reading a string with at maximum 99 chars
-	printf("you wrote %s\n", input); // printing it in the terminal
+// TWO-STAGE TABLES FOR WIDE CHARACTERS
+// iswalpha() and towupper() look the character up in the locale's tables
+// too, but through a function call, a check for the C locale and a few
+// levels of indirection on every character. Unicode has 0x110000 code points,
+// too many for a flat table, but most of its blocks of 256 look exactly like
+// some other block (all unassigned, all CJK letters without case...). so the
+// first stage maps the top bits of a character to a block, and the second
+// stage only keeps the distinct blocks: two loads and no branches per
+// character. the tables are built from whatever LC_CTYPE says when they are
+// built, so changing the locale afterwards means building them again
+
+#define WIDE_CODE_POINTS 0x110000
+#define WIDE_BLOCK_BITS 8
+#define WIDE_BLOCK_SIZE (1 << WIDE_BLOCK_BITS)
+#define WIDE_BLOCKS (WIDE_CODE_POINTS >> WIDE_BLOCK_BITS)
+
+// one bit per standard class, in the order of wideClassNames
+enum wideClass {
+	WIDE_ALNUM = 1 << 0,
+	WIDE_ALPHA = 1 << 1,
+	WIDE_BLANK = 1 << 2,
+	WIDE_CNTRL = 1 << 3,
+	WIDE_DIGIT = 1 << 4,
+	WIDE_GRAPH = 1 << 5,
+	WIDE_LOWER = 1 << 6,
+	WIDE_PRINT = 1 << 7,
+	WIDE_PUNCT = 1 << 8,
+	WIDE_SPACE = 1 << 9,
+	WIDE_UPPER = 1 << 10,
+	WIDE_XDIGIT = 1 << 11,
+};
+
+#define WIDE_CLASS_COUNT 12
+static const char *wideClassNames[WIDE_CLASS_COUNT] = {
+	"alnum", "alpha", "blank", "cntrl", "digit", "graph", "lower", "print", "punct", "space", "upper", "xdigit"
+};
+
+// the case mappings are kept as distances (towupper(c) - c), because whole
+// runs of letters move by the same distance, and so their blocks repeat
+struct caseDelta {
+	int32_t upper;
+	int32_t lower;
+};
+
+// the first stages have one more entry, an empty block for everything past
+// U+10FFFF (WEOF included), so the lookups don't need a range check
+struct wideTable {
+	uint16_t classIndex[WIDE_BLOCKS + 1];
+	uint16_t caseIndex[WIDE_BLOCKS + 1];
+	uint16_t *classBlocks; // WIDE_BLOCK_SIZE entries per distinct block
+	struct caseDelta *caseBlocks;
+	size_t classBlockCount;
+	size_t caseBlockCount;
+};
+
+// the distinct blocks found so far, with a small hash table to find a
+// block that was seen before without comparing it against all of them
+#define BLOCK_SET_SLOTS 8192 // a power of two, more than WIDE_BLOCKS + 1
+
+struct blockSet {
+	unsigned char *blocks;
+	size_t blockBytes;
+	size_t count;
+	uint32_t slots[BLOCK_SET_SLOTS]; // block number + 1, 0 when empty
+};
+
+// returns the number of the block (a new one or the old copy), -1 if out of memory
+static long blockSetAdd(struct blockSet *set, const void *block) {
+	uint64_t hash = 14695981039346656037u; // FNV-1a
+	for(size_t i = 0; i < set->blockBytes; i++) {
+		hash = (hash ^ ((const unsigned char *) block)[i]) * 1099511628211u;
+	}
+	for(size_t slot = hash & (BLOCK_SET_SLOTS - 1);; slot = (slot + 1) & (BLOCK_SET_SLOTS - 1)) {
+		if(set->slots[slot] == 0) {
+			unsigned char *grown = realloc(set->blocks, (set->count + 1) * set->blockBytes);
+			if(grown == NULL) {
+				return -1;
+			}
+			set->blocks = grown;
+			memcpy(set->blocks + set->count * set->blockBytes, block, set->blockBytes);
+			set->slots[slot] = (uint32_t) ++set->count;
+			return (long) set->count - 1;
+		}
+		size_t existing = set->slots[slot] - 1;
+		if(memcmp(set->blocks + existing * set->blockBytes, block, set->blockBytes) == 0) {
+			return (long) existing;
+		}
+	}
+}
 
-	// we can also read from and write to files
-	FILE *thisCode = fopen("header_testing.c", "r"); // open this file in read mode
-	char first1000chars[1001];
-	fread(first1000chars, sizeof(char), 1000, thisCode);
-	printf("\nThe beggining of this file:\n%s\n", first1000chars);
-	fclose(thisCode);
+// asks the locale about every code point once. returns false if out of memory
+static bool wideTableBuild(struct wideTable *table) {
+	memset(table, 0, sizeof(*table));
+	wctype_t types[WIDE_CLASS_COUNT];
+	for(int k = 0; k < WIDE_CLASS_COUNT; k++) {
+		types[k] = wctype(wideClassNames[k]);
+	}
+	struct blockSet *classSet = calloc(1, sizeof(struct blockSet));
+	struct blockSet *caseSet = calloc(1, sizeof(struct blockSet));
+	if(classSet == NULL || caseSet == NULL) {
+		free(classSet);
+		free(caseSet);
+		return false;
+	}
+	classSet->blockBytes = WIDE_BLOCK_SIZE * sizeof(uint16_t);
+	caseSet->blockBytes = WIDE_BLOCK_SIZE * sizeof(struct caseDelta);
+	bool ok = true;
+	for(size_t block = 0; block <= WIDE_BLOCKS && ok; block++) {
+		uint16_t classes[WIDE_BLOCK_SIZE] = {0};
+		struct caseDelta deltas[WIDE_BLOCK_SIZE] = {{0}};
+		for(size_t i = 0; i < WIDE_BLOCK_SIZE && block < WIDE_BLOCKS; i++) {
+			wint_t c = (wint_t) (block << WIDE_BLOCK_BITS | i);
+			for(int k = 0; k < WIDE_CLASS_COUNT; k++) {
+				classes[i] |= iswctype(c, types[k]) ? 1 << k : 0;
+			}
+			deltas[i].upper = (int32_t) (towupper(c) - c);
+			deltas[i].lower = (int32_t) (towlower(c) - c);
+		}
+		long classBlock = blockSetAdd(classSet, classes);
+		long caseBlock = blockSetAdd(caseSet, deltas);
+		ok = classBlock >= 0 && caseBlock >= 0;
+		table->classIndex[block] = (uint16_t) classBlock;
+		table->caseIndex[block] = (uint16_t) caseBlock;
+	}
+	table->classBlocks = (uint16_t *) classSet->blocks;
+	table->caseBlocks = (struct caseDelta *) caseSet->blocks;
+	table->classBlockCount = classSet->count;
+	table->caseBlockCount = caseSet->count;
+	free(classSet);
+	free(caseSet);
+	return ok;
+}
 
-	FILE *newFile = fopen("target.txt", "w"); // opening in write mode
-	fwrite(first1000chars, sizeof(char), 1000, newFile);
-	fclose(newFile);
+static void wideTableFree(struct wideTable *table) {
+	free(table->classBlocks);
+	free(table->caseBlocks);
+	table->classBlocks = NULL;
+	table->caseBlocks = NULL;
+}
 
-	// there are also methods to rename and delete files
-	rename("target.txt", "target_file.txt");
-	remove("target_file.txt");
+// how much memory the two stages take, against 0x110000 entries in flat tables
+static size_t wideTableBytes(const struct wideTable *table) {
+	return sizeof(table->classIndex) + sizeof(table->caseIndex) + table->classBlockCount * WIDE_BLOCK_SIZE * sizeof(uint16_t)
+		+ table->caseBlockCount * WIDE_BLOCK_SIZE * sizeof(struct caseDelta);
+}
 
-	// in total there must be like 50 functions that read and write to files
-	// in all sorts of ways, but this is already enough to play around with
+// the block of c, or the empty one past the end (the compiler makes it a cmov)
+static inline size_t wideBlockOf(wint_t c) {
+	size_t block = c >> WIDE_BLOCK_BITS;
+	return block < WIDE_BLOCKS ? block : WIDE_BLOCKS;
 }
 
+// every class bit of c at once
+static inline unsigned wideClassesOf(const struct wideTable *table, wint_t c) {
+	return table->classBlocks[(size_t) table->classIndex[wideBlockOf(c)] << WIDE_BLOCK_BITS | (c & (WIDE_BLOCK_SIZE - 1))];
+}
 
+static inline bool wideIs(const struct wideTable *table, wint_t c, enum wideClass classes) {
+	return (wideClassesOf(table, c) & classes) != 0;
+}
 
-void testStdLibH() {
-	// this is also one of the most important headers, because it defines
-	// stuff like the exit() and system() functions
+static inline wint_t wideUpper(const struct wideTable *table, wint_t c) {
+	return c + table->caseBlocks[(size_t) table->caseIndex[wideBlockOf(c)] << WIDE_BLOCK_BITS | (c & (WIDE_BLOCK_SIZE - 1))].upper;
+}
 
-	// the system() function allows us to make system calls such as "mkdir"
-	// or "cd" through code
-	system("ls -a");
+static inline wint_t wideLower(const struct wideTable *table, wint_t c) {
+	return c + table->caseBlocks[(size_t) table->caseIndex[wideBlockOf(c)] << WIDE_BLOCK_BITS | (c & (WIDE_BLOCK_SIZE - 1))].lower;
+}
 
-	// the atexit function defines functions that shall be called
-	// when the program terminantes normally (through exit() or returning from main)
-	void exiting1() {
-		printf("\ndoing something\n");
-	}
-	void exiting2() {
-		printf("doing another thing\n");
+// the class bit of a wctype() name, 0 if it isn't one of the standard ones
+static enum wideClass wideClassNamed(const char *name) {
+	for(int k = 0; k < WIDE_CLASS_COUNT; k++) {
+		if(strcmp(name, wideClassNames[k]) == 0) {
+			return (enum wideClass) (1 << k);
+		}
 	}
-	// the functions are called in the reverse order they are passed to atexit()
-	atexit(exiting2);
-	atexit(exiting1);
-
-	exit(0);
+	return 0;
 }
 
+// the bulk versions, for whole strings
+static size_t wideCountClass(const struct wideTable *table, const wchar_t *text, size_t n, enum wideClass classes) {
+	size_t count = 0;
+	for(size_t i = 0; i < n; i++) {
+		count += wideIs(table, (wint_t) text[i], classes);
+	}
+	return count;
+}
 
+static void wideUpperString(const struct wideTable *table, wchar_t *out, const wchar_t *text, size_t n) {
+	for(size_t i = 0; i < n; i++) {
+		out[i] = (wchar_t) wideUpper(table, (wint_t) text[i]);
+	}
+}
 
-void testStdNoReturnH() {
-	// this header defi"nes the _Noreturn function modifier,
-		// a function with this modifier shouldn't return ever, if
-		// it does, the behavior is undefined (in gcc you get a compilation error)
-		_Noreturn int functionThatReturns() {
-			// uncomment the return and comment the exit to see the error
-			//return 1;
-			exit(0);
+// compares the table with the isw*() and tow*() functions (not iswctype(),
+// which built it) for every code point, WEOF and a few past the end.
+// returns how many answers were different
+static size_t wideTableVerify(const struct wideTable *table) {
+	int (*functions[WIDE_CLASS_COUNT])(wint_t) = {
+		iswalnum, iswalpha, iswblank, iswcntrl, iswdigit, iswgraph, iswlower, iswprint, iswpunct, iswspace, iswupper, iswxdigit
+	};
+	size_t mismatches = 0;
+	void check(wint_t c) {
+		unsigned classes = wideClassesOf(table, c);
+		for(int k = 0; k < WIDE_CLASS_COUNT; k++) {
+			if(((classes >> k) & 1) != (functions[k](c) != 0) && mismatches++ < 5) {
+				printf("  U+%04X: is%s is different\n", (unsigned) c, wideClassNames[k]);
+			}
 		}
-		int a = functionThatReturns();
-	}
-	
-	void testStringH() {
-		// this header has a lot of helper funtions involving strings, or,
-		// in technical terms, NTBS (Null Terminated Byte Strings)
-	
-		// getting the length of a string (not including the null-terminator)
-		char *string = "C lang";
-		printf("\n\nthe length of the string is: %ld\n", strlen(string));
-	
-		// copying an string to another variable
-		char stringCopy[7]; // strlen(string) + null-terminator = 7
-		strcpy(stringCopy, string);
-		printf("%s\n", stringCopy);
-	
-		// comparing two strings with strcmp(), returns a negative value if the first
-		// is appears before the second, 0 if they are equal, and a positive value otherwise 
-		char *string2 = "Rust lang";
-		if(strcmp(string, string2) < 0) {
-			printf("%s comes before %s\n", string, string2);
-		} else if(strcmp(string, string2) > 0) {
-			printf("%s comes after %s\n", string, string2);
-		} else {
-			printf("they are equal\n");
+		if((wideUpper(table, c) != towupper(c) || wideLower(table, c) != towlower(c)) && mismatches++ < 5) {
+			printf("  U+%04X: the case mapping is different\n", (unsigned) c);
 		}
-	
-		// we can also concatenate 2 strings
-		char concat[20] = "I love "; // it has to be big enough to hold itself + the string we will concat
-		strcat(concat, string); // concat becomes "I love C lang"
-		printf("%s\n", concat);
+	}
+	for(wint_t c = 0; c < WIDE_CODE_POINTS; c++) {
+		check(c);
+	}
+	check(WEOF);
+	check(WIDE_CODE_POINTS);
+	check(0x7FFFFFFF);
+	return mismatches;
 }
 
+void testWCtypeH() {
+	// the wide versions of ctype.h: what a character is depends on LC_CTYPE,
+	// and in a UTF-8 locale they know all of Unicode
+	char *savedLocale = useUtf8Locale();
+	if(savedLocale == NULL) {
+		printf("there's no UTF-8 locale here\n");
+		return;
+	}
+	const wchar_t *text = L"Ça va? Ωμέγα 123 ß 東京\t!";
+	printf("\n\n");
+	for(const wchar_t *c = text; *c != L'\0'; c++) {
+		printf("U+%04X alpha %d space %d upper U+%04X\n", (unsigned) *c, iswalpha(*c) != 0, iswspace(*c) != 0, (unsigned) towupper(*c));
+	}
+	// wctype() turns a class name into a handle for iswctype(), so the class
+	// can come from a string (that's how regular expressions do [[:alpha:]])
+	wctype_t digit = wctype("digit");
+	printf("iswctype(L'7', wctype(\"digit\")) = %d, and a class that doesn't exist: %lu\n",
+		iswctype(L'7', digit) != 0, (unsigned long) wctype("letters"));
+	// towctrans() does the same for the mappings
+	printf("towctrans(L'Ω', wctrans(\"tolower\")) = U+%04X\n", (unsigned) towctrans(L'Ω', wctrans("tolower")));
+
+	// the two-stage table for this locale
+	struct wideTable *table = malloc(sizeof(struct wideTable));
+	if(table == NULL || !wideTableBuild(table)) {
+		printf("couldn't build the table\n");
+		// a half built table still has the blocks it got before running out
+		if(table != NULL) {
+			wideTableFree(table);
+		}
+		free(table);
+		restoreLocale(savedLocale);
+		return;
+	}
+	printf("\n%s: %zu distinct class blocks and %zu case blocks out of %d, %zu KiB (flat tables would take %d KiB)\n",
+		setlocale(LC_CTYPE, NULL), table->classBlockCount, table->caseBlockCount, WIDE_BLOCKS,
+		wideTableBytes(table) >> 10, WIDE_CODE_POINTS * (int) (sizeof(uint16_t) + sizeof(struct caseDelta)) >> 10);
+	printf("the table says Ω is %s and its lowercase is U+%04X, and [[:%s:]] matches 7\n",
+		wideIs(table, L'Ω', wideClassNamed("upper")) ? "uppercase" : "not uppercase",
+		(unsigned) wideLower(table, L'Ω'), wideIs(table, L'7', WIDE_DIGIT) ? "digit" : "nothing");
+	size_t mismatches = wideTableVerify(table);
+	printf("every code point against the isw*() functions: %s (%zu differences)\n", mismatches == 0 ? "ok" : "FAILED", mismatches);
+	wideTableFree(table);
+	free(table);
+	restoreLocale(savedLocale);
+}
 
 
-void testTgMathH() {
-	// TGmath stands for type generic math, this header includes
-	// the math.h and complex.h headers and defines some macros to
-	// handle mathematical function calls of different types for you
 
-	// for example, when we call sin() passing a float, it automatically
-	// calls sinf() for us (the sin function that recieves a float)
-	float f = 32.5;
-	printf("\n\n%f\n", sin(f));
+void benchWCtypeH() {
+	// characters per microsecond classifying and uppercasing text of each
+	// mix from BULK UTF-8, UTF-16 AND UTF-32, with libc and with the table
+	char *savedLocale = useUtf8Locale();
+	if(savedLocale == NULL) {
+		printf("there's no UTF-8 locale here\n");
+		return;
+	}
+	size_t n = 1 << 18;
+	// calloc() so that wideTableFree() works on it even if it wasn't built
+	struct wideTable *table = calloc(1, sizeof(struct wideTable));
+	wchar_t *text = malloc(n * sizeof(wchar_t));
+	wchar_t *converted = malloc(n * sizeof(wchar_t));
+	uint64_t start = monotonicNs();
+	if(table == NULL || text == NULL || converted == NULL || !wideTableBuild(table)) {
+		printf("couldn't allocate the buffers\n");
+		if(table != NULL) {
+			wideTableFree(table);
+		}
+		free(table);
+		free(text);
+		free(converted);
+		restoreLocale(savedLocale);
+		return;
+	}
+	printf("building the table for %s: %.1f ms, %zu KiB\n", setlocale(LC_CTYPE, NULL), (monotonicNs() - start) / 1e6,
+		wideTableBytes(table) >> 10);
+	size_t mismatches = wideTableVerify(table);
+	printf("every code point against the isw*() functions: %s (%zu differences)\n\n", mismatches == 0 ? "ok" : "FAILED", mismatches);
+
+	// the best of a few runs
+	#define WCTYPE_MEASURE(code) ({ \
+		uint64_t best = UINT64_MAX; \
+		for(int r = 0; r < 5; r++) { \
+			uint64_t start = monotonicNs(); \
+			code; \
+			uint64_t ns = monotonicNs() - start; \
+			best = ns < best ? ns : best; \
+		} \
+		(double) n * 1000 / best; \
+	})
+
+	wctype_t alpha = wctype("alpha");
+	printf("%-9s %10s %10s %10s %10s %10s %10s   (characters/us)\n", "", "iswalpha", "iswctype", "table", "all bits",
+		"towupper", "table");
+	for(int mix = TEXT_ASCII; mix <= TEXT_MIXED; mix++) {
+		unsigned seed = 9;
+		for(size_t i = 0; i < n; i++) {
+			text[i] = (wchar_t) randomCharacter((enum textMix) mix, &seed);
+		}
+		size_t count = 0;
+		printf("%-9s", textMixNames[mix]);
+		printf(" %10.1f", WCTYPE_MEASURE(for(size_t i = 0; i < n; i++) { count += iswalpha((wint_t) text[i]) != 0; } benchKeep(count)));
+		printf(" %10.1f", WCTYPE_MEASURE(for(size_t i = 0; i < n; i++) { count += iswctype((wint_t) text[i], alpha) != 0; } benchKeep(count)));
+		printf(" %10.1f", WCTYPE_MEASURE(benchKeep(wideCountClass(table, text, n, WIDE_ALPHA))));
+		unsigned any = 0;
+		printf(" %10.1f", WCTYPE_MEASURE(for(size_t i = 0; i < n; i++) { any += wideClassesOf(table, (wint_t) text[i]); } benchKeep(any)));
+		printf(" %10.1f", WCTYPE_MEASURE(for(size_t i = 0; i < n; i++) { converted[i] = (wchar_t) towupper((wint_t) text[i]); } benchKeep(converted)));
+		printf(" %10.1f\n", WCTYPE_MEASURE(wideUpperString(table, converted, text, n); benchKeep(converted)));
+	}
+	#undef WCTYPE_MEASURE
 
-	// thats basically it, just a helpfull header
-}
\ No newline at end of file
+	wideTableFree(table);
+	free(table);
+	free(text);
+	free(converted);
+	restoreLocale(savedLocale);
+}